@@ -5,6 +5,10 @@
 #include <x86intrin.h>
 #include <sched.h> // Required for this!
 
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_warmup.h"
+#include "../../../common/uarch_cpu.h"
+
 // --- PORTABLE TIMING HARNESS ---
 static inline void cpu_id(uint32_t op, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
     uint32_t level = op;
@@ -22,29 +26,10 @@ static inline uint64_t rdtscp_serial(uint32_t* aux) {
     return t;
 }
 
-typedef struct {
-    volatile char* buffer;
-    size_t num_accesses;
-    size_t stride;
-} benchmark_args_t;
-
-void access_working_set(void* arg) {
-    benchmark_args_t* args = (benchmark_args_t*)arg;
-    volatile char* buf = args->buffer;
-    size_t accesses = args->num_accesses;
-    size_t st = args->stride;
-    for (size_t i = 0; i < accesses; i++) {
-        volatile char x = buf[(i * st) % (accesses * st)];
-        (void)x;
-    }
-}
-
 int main() {
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
@@ -57,35 +42,51 @@ int main() {
     if (!buffer) { perror("malloc failed"); return 1; }
     for (size_t i = 0; i < max_size; i += 4096) buffer[i] = 0;
 
+    // One strided load per access, no index arithmetic in the timed loop
+    kern_t kern = {0};
+
     FILE* csv_file = fopen("cache_sweep_results.csv", "w");
     if (!csv_file) { perror("Failed to open CSV file"); free((void*)buffer); return 1; }
     
-    fprintf(csv_file, "working_set_size_bytes,time_per_access_cycles\n");
+    fprintf(csv_file, "working_set_size_bytes,time_per_access_cycles,warmup_passes\n");
 
     for (size_t size = min_size; size <= max_size; size *= 1.1) {
         if(size > max_size) size = max_size;
         size_t num_accesses = size / stride;
         if (num_accesses < 10) num_accesses = 10;
 
-        benchmark_args_t args = {buffer, num_accesses, stride};
+        if (kern_strided(&kern, KERN_LOAD, 1, stride, num_accesses) != 0) return 1;
         uint64_t total_cycles = 0;
         uint32_t aux;
 
+        // Passes over the working set until the per-pass time settles
+        warmup_t warm;
+        warmup_init(&warm, WARMUP_WINDOW);
+        uint64_t start, end;
+        do {
+            start = rdtsc_serial();
+            kern_run(&kern, (void*)buffer, NULL, 1);
+            end = rdtscp_serial(&aux);
+        } while (warmup_feed(&warm, (double)(end - start)));
+
         for (int i = 0; i < iterations; i++) {
             uint64_t start = rdtsc_serial();
-            access_working_set(&args);
+            kern_run(&kern, (void*)buffer, NULL, 1);
             uint64_t end = rdtscp_serial(&aux);
             total_cycles += (end - start);
         }
         double avg_cycles = (double)total_cycles / (double)iterations;
         double time_per_access = avg_cycles / (double)num_accesses;
 
-        fprintf(csv_file, "%zu,%.2f\n", size, time_per_access);
-        printf("Size: %zu KB, Time/Access: %.2f cycles\n", size/1024, time_per_access);
+        fprintf(csv_file, "%zu,%.2f,%d\n", size, time_per_access, warm.warm_batches);
+        printf("Size: %zu KB, Time/Access: %.2f cycles (warm after %d passes)\n",
+               size/1024, time_per_access, warm.warm_batches);
     }
 
     fclose(csv_file);
+    kern_free(&kern);
     free((void*)buffer);
     printf("Data written to cache_sweep_results.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
@@ -41,69 +41,112 @@ def get_cache_sizes():
     return cache_sizes
 
 # --- main plotting ---
-def plot_cache(csv_file):
-    try:
-        data = pd.read_csv(csv_file)
-    except FileNotFoundError:
-        print(f"Error: file '{csv_file}' not found")
-        return
+LAYOUT_COLORS = {
+    "elem": "teal",
+    "line": "crimson",
+    "page_lines": "royalblue",
+    "page": "darkorange",
+    "page_off": "olive",
+}
 
-    # sort by working set
-    data = data.sort_values("working_set_size_bytes")
-
-    # --- noise removal: keep mean ± 1 std ---
+def summarize(data, col):
+    """Mean/std of col per (layout, size) after keeping mean ± 1 std."""
     filtered_data = []
-    for size, group in data.groupby("working_set_size_bytes"):
+    for _, group in data.groupby(["layout", "working_set_size_bytes"]):
         if len(group) < 2:
             filtered_data.append(group)
             continue
-        mean = group["time_per_access_cycles"].mean()
-        std = group["time_per_access_cycles"].std()
-        cleaned = group[
-            (group["time_per_access_cycles"] >= mean - std)
-            & (group["time_per_access_cycles"] <= mean + std)
-        ]
+        mean = group[col].mean()
+        std = group[col].std()
+        cleaned = group[(group[col] >= mean - std) & (group[col] <= mean + std)]
         filtered_data.append(cleaned)
     cleaned_df = pd.concat(filtered_data, ignore_index=True)
+    return cleaned_df.groupby(["layout", "working_set_size_bytes"])[col].agg(
+        ["mean", "std"]).fillna(0).reset_index()
+
+def mark_cache_levels(ax, cache_sizes, max_size):
+    for name, size in cache_sizes.items():
+        if size <= max_size:
+            ax.axvline(size, color="darkviolet", linestyle="--", alpha=0.7)
+            ax.text(size * 1.05, ax.get_ylim()[1] * 0.9, name,
+                    rotation=90, color="darkviolet",
+                    fontsize=11, fontweight="bold")
 
-    # summary (mean/std)
-    summary = cleaned_df.groupby("working_set_size_bytes")[
-        "time_per_access_cycles"
-    ].agg(["mean", "std"]).reset_index()
+def report_levels(curves, walk, cache_sizes):
+    """Latency at half of each cache level, with and without the TLB."""
+    if walk is None:
+        return
+    print(f"{'level':>5} {'size':>10} {'with TLB':>9} {'TLB-less':>9} {'walk':>8}")
+    for name, size in sorted(cache_sizes.items(), key=lambda kv: kv[1]):
+        fits = walk[walk.index <= size // 2]
+        if fits.empty:
+            continue
+        at = fits.index.max()
+        print(f"{name:>5} {at:>10} {curves['line'][at]:>9.2f} "
+              f"{curves['page_lines'][at]:>9.2f} {walk[at]:>8.2f}")
+
+def plot_cache(csv_file):
+    try:
+        data = pd.read_csv(csv_file)
+    except FileNotFoundError:
+        print(f"Error: file '{csv_file}' not found")
+        return
+    if 'valid' in data:
+        data = data[data['valid'] != 0].copy()   # CFS-throttled points
+
+    # files from before the layout sweep hold one 8-byte-element curve
+    if "layout" not in data.columns:
+        data["layout"] = "elem"
+    # core cycles (APERF/MPERF-scaled) when the probe recorded them
+    col = "core_cycles_per_access" if "core_cycles_per_access" in data.columns \
+        else "time_per_access_cycles"
+    summary = summarize(data.sort_values("working_set_size_bytes"), col)
+    curves = {layout: group.set_index("working_set_size_bytes")["mean"]
+              for layout, group in summary.groupby("layout")}
+
+    # line vs page_lines: same lines, one page walk per hop vs per 64 hops
+    walk = None
+    if "line" in curves and "page_lines" in curves:
+        walk = (curves["line"] - curves["page_lines"]).dropna()
 
     # --- plot ---
-    plt.figure(figsize=(10, 6))
-    plt.plot(
-        summary["working_set_size_bytes"],
-        summary["mean"],
-        linestyle="-",
-        color="teal",
-        label="Mean latency (±1σ)"
-    )
-    plt.fill_between(
-        summary["working_set_size_bytes"],
-        summary["mean"] - summary["std"],
-        summary["mean"] + summary["std"],
-        color="teal",
-        alpha=0.2
-    )
-
-    plt.xscale("log", base=2)
-    plt.xlabel("Working Set Size (bytes, log2)")
-    plt.ylabel("Time per Access (cycles)")
-    plt.title("Cache Hierarchy Latency (Artemisia)")
-    plt.grid(True, which="both", linestyle="--", alpha=0.7)
+    rows = 2 if walk is not None else 1
+    fig, axes = plt.subplots(rows, 1, figsize=(10, 6 if rows == 1 else 9),
+                             sharex=True, squeeze=False)
+    ax = axes[0][0]
+    for layout, group in summary.groupby("layout"):
+        color = LAYOUT_COLORS.get(layout, None)
+        ax.plot(group["working_set_size_bytes"], group["mean"],
+                linestyle="-", color=color, label=f"{layout} (±1σ)")
+        ax.fill_between(group["working_set_size_bytes"],
+                        group["mean"] - group["std"],
+                        group["mean"] + group["std"],
+                        color=color, alpha=0.2)
+
+    ax.set_xscale("log", base=2)
+    ax.set_ylabel("Time per Access (core cycles)" if col.startswith("core")
+                  else "Time per Access (TSC cycles)")
+    ax.set_title("Cache Hierarchy Latency (Artemisia)")
+    ax.grid(True, which="both", linestyle="--", alpha=0.7)
 
     # add cache levels
     cache_sizes = get_cache_sizes()
-    for name, size in cache_sizes.items():
-        if size <= summary["working_set_size_bytes"].max():
-            plt.axvline(size, color="darkviolet", linestyle="--", alpha=0.7)
-            plt.text(size * 1.05, plt.ylim()[1] * 0.9, name,
-                     rotation=90, color="darkviolet",
-                     fontsize=11, fontweight="bold")
+    max_size = summary["working_set_size_bytes"].max()
+    mark_cache_levels(ax, cache_sizes, max_size)
+    ax.legend()
+
+    if walk is not None:
+        ax = axes[1][0]
+        ax.plot(walk.index, walk.values, color="black",
+                label="line - page_lines (page-walk cost)")
+        ax.axhline(0, color="gray", linewidth=0.8)
+        ax.set_ylabel("Page walk (cycles)")
+        ax.grid(True, which="both", linestyle="--", alpha=0.7)
+        mark_cache_levels(ax, cache_sizes, max_size)
+        ax.legend()
+        report_levels(curves, walk, cache_sizes)
 
-    plt.legend()
+    axes[-1][0].set_xlabel("Working Set Size (bytes, log2)")
     plt.tight_layout()
 
     output_file = "cache_hierarchy_plot.png"
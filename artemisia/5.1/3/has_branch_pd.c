@@ -6,6 +6,8 @@
 #include <x86intrin.h>
 #include <sched.h> // Header for sched_setaffinity
 
+#include "../../../common/uarch_cpu.h"
+
 #define ITERATIONS 1000000
 #define NUM_TESTS 1024 
 
@@ -95,11 +97,9 @@ double test_no_branches() {
 
 int main() {
     // Pin process to a single CPU core
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
     srand(time(NULL));
@@ -131,6 +131,7 @@ int main() {
     fclose(csv);
     
     printf("\nData saved to branch_prediction_results.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
 
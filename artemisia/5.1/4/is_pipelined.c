@@ -5,6 +5,8 @@
 #include <x86intrin.h>
 #include <sched.h>
 
+#include "../../../common/uarch_cpu.h"
+
 #define ITERATIONS 1000000
 #define NUM_TESTS 10
 #define CHAIN_LENGTH 10 // Number of instructions per loop
@@ -30,11 +32,10 @@ static inline uint64_t rdtscp_serial(uint32_t* aux) {
 
 int main() {
     // Pin process to a single CPU core
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed"); return 1;
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
     }
 
     uint64_t start, end;
@@ -146,5 +147,6 @@ int main() {
         perror("fopen");
     }
 
+    cpu_report(&cpus);
     return 0;
 }
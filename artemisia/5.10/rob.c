@@ -7,9 +7,11 @@
 #include <unistd.h>
 #include <x86intrin.h>
 
-// Set these to the two logical CPUs of a single physical core from `lscpu -e`
-#define LOGICAL_CPU_A 0
-#define LOGICAL_CPU_B 56
+#include "../../common/uarch_cpu.h"
+
+// Two logical CPUs of one physical core, picked from our cpuset by cpu_pick_pair()
+static cpu_ctx_t cpus;
+static int cpu_a, cpu_b;
 
 #define NUM_REPS (1 << 18)
 
@@ -63,10 +65,7 @@ static inline void rob_filler_workload() {
 
 // --- Polluter Thread ---
 void* polluter_thread_func(void* args) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(LOGICAL_CPU_A, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    cpu_pin(&cpus, cpu_a);
 
     pthread_barrier_wait(&barrier);
 
@@ -78,10 +77,7 @@ void* polluter_thread_func(void* args) {
 
 // --- Victim Thread ---
 void* victim_thread_func(void* args) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(LOGICAL_CPU_B, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    cpu_pin(&cpus, cpu_b);
     
     pthread_barrier_wait(&barrier);
 
@@ -103,39 +99,58 @@ int main() {
     pthread_t polluter, victim;
 
     printf("### ROB Shared vs. Partitioned Test ###\n");
-    printf("Using logical CPUs %d and %d.\n\n", LOGICAL_CPU_A, LOGICAL_CPU_B);
+    if (cpu_init(&cpus) != 0 || cpu_pick_pair(&cpus, &cpu_a, &cpu_b) != 0) {
+        fprintf(stderr, "Need two SMT siblings of one physical core in our cpuset\n");
+        return 1;
+    }
+    printf("Using logical CPUs %d and %d.\n", cpu_a, cpu_b);
+    cpu_print(&cpus, -1, stdout);
+    printf("\n");
+
+    // A run during which the cgroup was CFS-throttled timed the quota
+    cpu_throttle_t before;
+    int invalid = 0;
 
     // --- 1. Baseline Run (Victim only) ---
     printf("--- Running Baseline (Victim Only) ---\n");
     pthread_barrier_init(&barrier, NULL, 1);
+    cpu_throttle_read(&cpus.stat, &before);
     pthread_create(&victim, NULL, victim_thread_func, NULL);
     pthread_join(victim, &victim_result);
     baseline_cycles = (uint64_t)victim_result;
-    printf("Baseline Cycles: %lu\n\n", baseline_cycles);
+    int throttled = cpu_throttled(&cpus, &before);
+    invalid |= throttled;
+    printf("Baseline Cycles: %lu%s\n\n", baseline_cycles, throttled ? " (INVALID: throttled)" : "");
     pthread_barrier_destroy(&barrier);
 
     // --- 2. Interference Run (Polluter + Victim) ---
     printf("--- Running Interference Test (Polluter + Victim) ---\n");
     pthread_barrier_init(&barrier, NULL, 2);
     exit_flag = 0;
+    cpu_throttle_read(&cpus.stat, &before);
     pthread_create(&polluter, NULL, polluter_thread_func, NULL);
     pthread_create(&victim, NULL, victim_thread_func, NULL);
     pthread_join(victim, &victim_result);
     exit_flag = 1; // Signal polluter to stop
     pthread_join(polluter, NULL);
     interference_cycles = (uint64_t)victim_result;
-    printf("Interference Cycles: %lu\n\n", interference_cycles);
+    throttled = cpu_throttled(&cpus, &before);
+    invalid |= throttled;
+    printf("Interference Cycles: %lu%s\n\n", interference_cycles, throttled ? " (INVALID: throttled)" : "");
     pthread_barrier_destroy(&barrier);
 
     // --- 3. Conclusion ---
     printf("--- Conclusion ---\n");
     double slowdown = (double)interference_cycles / baseline_cycles;
     printf("Performance slowdown: %.2fx\n", slowdown);
-    if (slowdown > 1.20) { // If performance is >20% worse
+    if (invalid) {
+        printf("Result: none, the cgroup's CPU quota throttled a run; raise cpu.max or rerun.\n");
+    } else if (slowdown > 1.20) { // If performance is >20% worse
         printf("Result: The ROB appears to be SHARED across Hyper-Threads.\n");
     } else {
         printf("Result: The ROB appears to be PARTITIONED for each Hyper-Thread.\n");
     }
 
+    cpu_close(&cpus);
     return 0;
 }
\ No newline at end of file
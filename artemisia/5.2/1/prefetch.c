@@ -6,11 +6,18 @@
 #include <time.h>
 #include <string.h>
 
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_cpu.h"
+
 // This size (128 MB) is chosen to be larger than the L3 cache
 #define ARRAY_SIZE_BYTES (128 * 1024 * 1024)
 #define NUM_ELEMENTS (ARRAY_SIZE_BYTES / sizeof(long))
+#ifndef NUM_RUNS
 #define NUM_RUNS 100   // You can increase to 500 for statistics
+#endif
+#ifndef MAX_STRIDE
 #define MAX_STRIDE 1024 // Test strides up to 1024
+#endif
 
 // A portable rdtsc wrapper to read the Time Stamp Counter on x86_64 CPUs.
 static inline uint64_t rdtsc() {
@@ -41,11 +48,9 @@ void flush_cache(long *arr, size_t n) {
 
 int main() {
     // Pin the process to a single CPU core.
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return -1;
     }
 
@@ -56,9 +61,12 @@ int main() {
         return -1;
     }
     size_t *indices = malloc(NUM_ELEMENTS * sizeof(size_t));
-    if (!indices) {
+    uint32_t *offsets = malloc(NUM_ELEMENTS * sizeof(uint32_t));
+    if (!indices || !offsets) {
         fprintf(stderr, "Memory allocation failed.\n");
         free(data_array);
+        free(indices);
+        free(offsets);
         return -1;
     }
 
@@ -74,6 +82,7 @@ int main() {
         fprintf(stderr, "Could not open prefetcher_data.csv for writing.\n");
         free(data_array);
         free(indices);
+        free(offsets);
         return -1;
     }
     fprintf(csv_file, "type,stride,run,cycles_per_access\n");
@@ -81,22 +90,28 @@ int main() {
     srand(time(NULL));
     volatile long sum = 0;
 
+    // Unrolled 8-byte load kernels: strided for sequential/stride, gather
+    // (sequential offset table) for random
+    kern_t kern = {0};
+
     printf("Running %d runs for sequential, stride, and random access...\n", NUM_RUNS);
 
     for (int run = 0; run < NUM_RUNS; run++) {
         // Sequential Access
+        kern_strided(&kern, KERN_LOAD, 8, sizeof(long), NUM_ELEMENTS);
         flush_cache(data_array, NUM_ELEMENTS);
         uint64_t start_seq = rdtsc();
-        for (size_t i = 0; i < NUM_ELEMENTS; i++) sum += data_array[i];
+        sum += kern_run(&kern, data_array, NULL, 1);
         uint64_t end_seq = rdtsc();
         double sequential_avg = (double)(end_seq - start_seq) / NUM_ELEMENTS;
         fprintf(csv_file, "sequential,1,%d,%.2f\n", run, sequential_avg);
 
         // Strided Access
         for (size_t stride = 2; stride <= MAX_STRIDE; stride *= 2) {
+            kern_strided(&kern, KERN_LOAD, 8, stride * sizeof(long), NUM_ELEMENTS / stride);
             flush_cache(data_array, NUM_ELEMENTS);
             uint64_t start_stride = rdtsc();
-            for (size_t i = 0; i < NUM_ELEMENTS; i += stride) sum += data_array[i];
+            sum += kern_run(&kern, data_array, NULL, 1);
             uint64_t end_stride = rdtsc();
             double stride_avg = (double)(end_stride - start_stride) / (NUM_ELEMENTS / stride);
             fprintf(csv_file, "stride,%zu,%d,%.2f\n", stride, run, stride_avg);
@@ -104,18 +119,23 @@ int main() {
 
         // Random Access
         shuffle(indices, NUM_ELEMENTS);
+        for (size_t i = 0; i < NUM_ELEMENTS; i++) offsets[i] = (uint32_t)(indices[i] * sizeof(long));
+        kern_gather(&kern, KERN_LOAD, NUM_ELEMENTS);
         flush_cache(data_array, NUM_ELEMENTS);
         uint64_t start_rand = rdtsc();
-        for (size_t i = 0; i < NUM_ELEMENTS; i++) sum += data_array[indices[i]];
+        sum += kern_run(&kern, data_array, offsets, 1);
         uint64_t end_rand = rdtsc();
         double random_avg = (double)(end_rand - start_rand) / NUM_ELEMENTS;
         fprintf(csv_file, "random,NA,%d,%.2f\n", run, random_avg);
     }
 
     fclose(csv_file);
+    kern_free(&kern);
     free(data_array);
     free(indices);
+    free(offsets);
 
     printf("Done. Results saved to prefetcher_data.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
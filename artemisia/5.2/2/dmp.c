@@ -7,6 +7,13 @@
 #include <time.h>
 #include <string.h>
 
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_chain.h"
+#include "../../../common/uarch_cpu.h"
+
+// cur = list[cur] as one unrolled mov rax, [list + rax*8] per step
+static kern_t chase;
+
 static inline uint64_t rdtsc_start(void){
     unsigned eax, ebx, ecx, edx;
     // FIX: Removed "%rbx" and "%rcx" from the clobber list
@@ -28,29 +35,12 @@ static inline uint64_t rdtsc_end(void){
     return t;
 }
 
-void pin_core(int core) {
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(core, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
-        perror("sched_setaffinity");
-    }
-}
-
 size_t *make_random_list(size_t n) {
     size_t *arr = malloc(n * sizeof(size_t));
-    size_t *idx = malloc(n * sizeof(size_t));
-    for (size_t i = 0; i < n; i++) idx[i] = i;
-    // Fisher-Yates shuffle
-    for (size_t i = n - 1; i > 0; i--) {
-        size_t j = rand() % (i + 1);
-        size_t t = idx[i];
-        idx[i] = idx[j];
-        idx[j] = t;
-    }
-    for (size_t i = 0; i < n - 1; i++) arr[idx[i]] = idx[i+1];
-    arr[idx[n-1]] = idx[0]; // Complete the cycle
-    free(idx);
+    chain_perm_t perm;
+    if (!arr || chain_perm(&perm, n, CHAIN_SEED) != 0) exit(EXIT_FAILURE);
+    chain_link_index(arr, &perm); // single cycle: arr[order[i]] = order[i+1]
+    chain_perm_free(&perm);
     return arr;
 }
 
@@ -69,20 +59,25 @@ size_t *make_signature_pattern(size_t n, size_t period) {
 }
 
 double run_chase(size_t *list, size_t n, size_t steps, int warm) {
-    volatile size_t cur = 0;
+    size_t cur = 0;
     if (warm) {
-        for (size_t i = 0; i < n; i++) cur = list[cur];
+        cur = kern_run(&chase, list, (void*)cur, (n + chase.per_rep - 1) / chase.per_rep);
     }
+    uint64_t reps = steps / chase.per_rep;
     uint64_t t0 = rdtsc_start();
-    for (size_t i = 0; i < steps; i++) cur = list[cur];
+    kern_run(&chase, list, (void*)cur, reps);
     uint64_t t1 = rdtsc_end();
-    (void)cur; // Prevent unused variable warning
-    return (double)(t1 - t0) / (double)steps;
+    return (double)(t1 - t0) / (double)(reps * chase.per_rep);
 }
 
 int main(int argc, char **argv){
-    pin_core(0);
-    srand(time(NULL) ^ (uintptr_t)&argc);
+    (void)argc;
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+    if (kern_chase(&chase, KERN_CHASE_INDEX) != 0) return 1;
 
     size_t n = 4 * 1024 * 1024 / sizeof(size_t); // array about 32MB
     size_t steps = 1000000;
@@ -109,6 +104,8 @@ int main(int argc, char **argv){
 
     fclose(f);
     free(rand_list); free(off16); free(off64); free(sig8); free(sig16);
+    kern_free(&chase);
     printf("Done: written dmp_pointer_chase.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
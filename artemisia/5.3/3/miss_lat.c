@@ -6,6 +6,13 @@
 #include <stdlib.h>
 #include <sched.h>
 #include <string.h>
+#include <getopt.h>
+
+#include "../../../common/uarch_evict.h"
+#include "../../../common/uarch_timer.h"
+#include "../../../common/uarch_hist.h"
+#include "../../../common/uarch_ckpt.h"
+#include "../../../common/uarch_cpu.h"
 
 #define NUM_RUNS 100000
 
@@ -14,10 +21,10 @@
 #define L2_SIZE (2 * 1024 * 1024)      // 2 MB L2 cache
 #define L3_SIZE (60 * 1024 * 1024)     // 60 MB L3 cache
 
-// Eviction buffer sizes (2x cache size for thorough eviction)
+// Fallback eviction buffer sizes (2x cache size), used only for levels
+// where no minimal eviction set could be built
 #define L1_EVICT_SIZE (L1D_SIZE * 2)
 #define L2_EVICT_SIZE (L2_SIZE * 2)
-#define L3_EVICT_SIZE (L3_SIZE * 2)
 
 // Intel-recommended timing harness with serialization
 static inline uint64_t start_timer(void) {
@@ -33,6 +40,43 @@ static inline uint64_t end_timer(void) {
     return t;
 }
 
+// --hires: time each access with lfence/rdtscp brackets (or rdpmc with
+// --pmc) minus the calibrated bracket overhead, and keep HDR histograms
+// instead of the per-run CSV
+static int hires = 0;
+static int use_pmc = 0;
+static int resume = 0;      // --resume: continue an interrupted run
+static timer_ctx_t timer;
+
+enum { LVL_L1, LVL_L2, LVL_L3, LVL_RAM, NUM_LEVELS };
+static const char* level_names[NUM_LEVELS] = {"l1_hit", "l2_hit", "l3_hit", "ram_access"};
+
+static inline uint64_t time_access(volatile int* p, int* sink) {
+    if (hires) return timer_load(&timer, p);
+    uint64_t start = start_timer();
+    *sink = *p;
+    uint64_t end = end_timer();
+    return end - start;
+}
+
+void handle_args(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"hires", no_argument, NULL, 'h'},
+        {"pmc", no_argument, NULL, 'p'},
+        {"resume", no_argument, NULL, 'r'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'h': hires = 1; break;
+            case 'p': hires = 1; use_pmc = 1; break;
+            case 'r': resume = 1; break;
+            default: exit(EXIT_FAILURE);
+        }
+    }
+}
+
 // Evict cache by reading through a large buffer multiple times
 void evict_cache(volatile char* buf, size_t size) {
     // Read through buffer twice to ensure eviction
@@ -43,120 +87,163 @@ void evict_cache(volatile char* buf, size_t size) {
     }
 }
 
-int main(void) {
-    // Pin to CPU core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+int main(int argc, char *argv[]) {
+    handle_args(argc, argv);
+
+    // Pin to one core of our cpuset
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0) {
+        perror("cpu_init failed");
         return 1;
     }
-
-    // Allocate eviction buffers
-    volatile char* evict_l1 = malloc(L1_EVICT_SIZE);
-    volatile char* evict_l2 = malloc(L2_EVICT_SIZE);
-    volatile char* evict_l3 = malloc(L3_EVICT_SIZE);
-    
-    if (!evict_l1 || !evict_l2 || !evict_l3) {
-        perror("malloc failed");
+    int cpu = cpu_pick(&cpus);
+    if (cpu_pin(&cpus, cpu) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
-    
-    // Initialize buffers
-    memset((void*)evict_l1, 1, L1_EVICT_SIZE);
-    memset((void*)evict_l2, 1, L2_EVICT_SIZE);
-    memset((void*)evict_l3, 1, L3_EVICT_SIZE);
 
-    // Target data
-    volatile int target = 42;
-    int sink;
+    // Build minimal eviction sets for the target line once; the target
+    // lives in the eviction pool so its set bits are known. Only the L1
+    // and L2 sets are used, so the pool is sized from L2, not the LLC
+    evict_t ev;
+    if (evict_init(&ev, 2, 0) != 0) return 1;
+    printf("Building eviction sets...\n");
+    int levels = evict_build(&ev, 1);
+
+    // Fall back to buffer walks for levels without a set
+    volatile char* evict_l1 = NULL;
+    volatile char* evict_l2 = NULL;
+    if (levels < 1) {
+        evict_l1 = malloc(L1_EVICT_SIZE);
+        if (!evict_l1) { perror("malloc failed"); return 1; }
+        memset((void*)evict_l1, 1, L1_EVICT_SIZE);
+    }
+    if (levels < 2) {
+        evict_l2 = malloc(L2_EVICT_SIZE);
+        if (!evict_l2) { perror("malloc failed"); return 1; }
+        memset((void*)evict_l2, 1, L2_EVICT_SIZE);
+    }
 
-    // Open CSV file
-    FILE* fp = fopen("cache_latency_data.csv", "w");
-    if (!fp) {
-        perror("fopen failed");
-        return 1;
+    // Target data
+    volatile int* target = (volatile int*)ev.target;
+    *target = 42;
+    int sink = 0;
+
+    hist_t hist[NUM_LEVELS];
+    for (int l = 0; l < NUM_LEVELS; l++) hist_init(&hist[l]);
+    if (hires) {
+        timer_init(&timer, use_pmc);
+        printf("Timer: %s, bracket overhead %.1f subtracted\n", timer_name(&timer), timer.overhead);
     }
-    fprintf(fp, "run,l1_hit,l2_hit,l3_hit,ram_access\n");
+
+    // Open CSV file through a checkpoint; --hires keeps its histograms
+    // in the checkpoint state until they are written at the end
+    const char* csv_name = hires ? "cache_latency_hist.csv" : "cache_latency_data.csv";
+    char config[128];
+    snprintf(config, sizeof(config), "miss_lat runs=%d hires=%d pmc=%d valid=1", NUM_RUNS, hires, use_pmc);
+    ckpt_t ckpt;
+    FILE* fp = ckpt_open(&ckpt, csv_name,
+                         hires ? "level,lo,hi,count\n" : "run,l1_hit,l2_hit,l3_hit,ram_access,valid\n",
+                         config, resume);
+    if (!fp) return 1;
+    if (ckpt.complete) { ckpt_close(&ckpt); return 0; }
+    if (hires && ckpt.resumed && ckpt_state(&ckpt, hist, sizeof(hist)) != 0) return 1;
 
     printf("Running cache latency measurements (%d iterations)...\n", NUM_RUNS);
-    printf("Pinned to CPU core 0\n\n");
+    cpu_print(&cpus, cpu, stdout);
+    printf("\n");
 
-    for (int i = 0; i < NUM_RUNS; i++) {
-        uint64_t start, end;
+    uint64_t throttled = 0;
+    for (int i = (int)ckpt.last_point + 1; i < NUM_RUNS; i++) {
         uint64_t l1_hit, l2_hit, l3_hit, ram_access;
+        cpu_throttle_t thr;
+        cpu_throttle_read(&cpus.stat, &thr);
 
         // ===== 1. L1 HIT =====
         // Prime: Load target into all cache levels
-        sink = target;
+        sink = *target;
         _mm_mfence();
         
         // Measure L1 hit
-        start = start_timer();
-        sink = target;
-        end = end_timer();
-        l1_hit = end - start;
+        l1_hit = time_access(target, &sink);
 
         // ===== 2. L2 HIT (L1 miss) =====
         // Evict only L1, keep L2/L3
-        evict_cache(evict_l1, L1_EVICT_SIZE);
+        if (levels >= 1) evict_level(&ev, 0);
+        else evict_cache(evict_l1, L1_EVICT_SIZE);
         _mm_mfence();
         
         // Measure L2 hit (L1 miss)
-        start = start_timer();
-        sink = target;
-        end = end_timer();
-        l2_hit = end - start;
+        l2_hit = time_access(target, &sink);
 
         // ===== 3. L3 HIT (L1+L2 miss) =====
         // Reload target to all levels first
-        sink = target;
+        sink = *target;
         _mm_mfence();
         
         // Evict L1 and L2, keep L3
-        evict_cache(evict_l2, L2_EVICT_SIZE);
+        if (levels >= 2) evict_level(&ev, 1);
+        else evict_cache(evict_l2, L2_EVICT_SIZE);
         _mm_mfence();
         
         // Measure L3 hit (L1+L2 miss)
-        start = start_timer();
-        sink = target;
-        end = end_timer();
-        l3_hit = end - start;
+        l3_hit = time_access(target, &sink);
 
         // ===== 4. RAM ACCESS (all caches miss) =====
         // Use clflush to evict from all cache levels
         _mm_mfence();
-        _mm_clflush((void*)&target);
+        _mm_clflush((void*)target);
         _mm_mfence();
         
         // Measure RAM access
-        start = start_timer();
-        sink = target;
-        end = end_timer();
-        ram_access = end - start;
-
-        // Write to CSV
-        fprintf(fp, "%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", 
-                i, l1_hit, l2_hit, l3_hit, ram_access);
+        ram_access = time_access(target, &sink);
+
+        // A CFS-throttled run is marked invalid (--hires leaves it out)
+        int valid = !cpu_throttled(&cpus, &thr);
+        throttled += !valid;
+
+        if (hires) {
+            if (valid) {
+                hist_record(&hist[LVL_L1], l1_hit);
+                hist_record(&hist[LVL_L2], l2_hit);
+                hist_record(&hist[LVL_L3], l3_hit);
+                hist_record(&hist[LVL_RAM], ram_access);
+            }
+        } else {
+            // Write to CSV
+            fprintf(fp, "%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d\n", 
+                    i, l1_hit, l2_hit, l3_hit, ram_access, valid);
+        }
 
         // Progress indicator
         if ((i + 1) % 1000 == 0) {
             printf("Progress: %d/%d runs complete\n", i + 1, NUM_RUNS);
+            if (ckpt_done(&ckpt, i, hires ? hist : NULL, hires ? sizeof(hist) : 0) != 0) return 1;
+        }
+    }
+
+    if (hires) {
+        printf("\nLatency distribution (%s):\n", timer.mode == TIMER_PMC ? "core cycles" : "TSC ticks");
+        for (int l = 0; l < NUM_LEVELS; l++) {
+            hist_print(&hist[l], level_names[l], stdout);
+            hist_write_csv(&hist[l], level_names[l], fp);
         }
+        timer_close(&timer);
     }
 
-    fclose(fp);
+    ckpt_close(&ckpt);
     free((void*)evict_l1);
     free((void*)evict_l2);
-    free((void*)evict_l3);
+    evict_free(&ev);
 
+    if (throttled) printf("\n%" PRIu64 " runs were CFS-throttled and marked invalid\n", throttled);
     printf("\n✓ Test complete!\n");
-    printf("Data saved to cache_latency_data.csv\n");
-    printf("Run: python3 plot_cache_latency.py cache_latency_data.csv\n");
+    printf("Data saved to %s\n", csv_name);
+    printf("Run: python3 plot.py %s\n", csv_name);
 
     // Prevent optimization
     if (sink == -1) printf("%d", sink);
 
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
@@ -2,48 +2,106 @@ import pandas as pd
 import matplotlib.pyplot as plt
 import matplotlib.colors as colors
 import numpy as np
-import sys
-
-def plot_cache_heatmap(csv_filename):
+import argparse
+
+# Columns benchmark.c sweeps; everything else is a measured value
+AXES = ['page', 'threads', 'access', 'order', 'size_bytes', 'stride_bytes']
+VALUE = 'cycles_per_access'
+
+AXIS_LABELS = {
+    'page': 'Page Size',
+    'threads': 'Threads',
+    'access': 'Access Type',
+    'order': 'Access Order',
+    'size_bytes': 'Array Size (KB)',
+    'stride_bytes': 'Stride (Bytes)'
+}
+
+def load_heatmap(csv_filename):
+    data = pd.read_csv(csv_filename)
+    # Original two-column sweep: RMW, strided, 4K pages, one thread
+    if 'array_size_kb' in data.columns:
+        data = data.rename(columns={'avg_cycles_per_access': VALUE})
+        data['size_bytes'] = data.pop('array_size_kb') * 1024
+        data['page'] = '4k'
+        data['threads'] = 1
+        data['access'] = 'rmw'
+        data['order'] = 'strided'
+    return data
+
+def parse_fix(fix_args):
+    fixed = {}
+    for item in fix_args or []:
+        for pair in item.split(','):
+            key, _, val = pair.partition('=')
+            if key not in AXES or not val:
+                raise SystemExit(f"Bad --fix '{pair}' (axes: {', '.join(AXES)})")
+            fixed[key] = val
+    return fixed
+
+def tick_label(axis, value):
+    if axis == 'size_bytes':
+        kb = value / 1024
+        return f"{kb:g}"
+    return f"{value}"
+
+def plot_cache_heatmap(csv_filename, x_axis, y_axis, fix_args):
     try:
-        data = pd.read_csv(csv_filename)
+        data = load_heatmap(csv_filename)
     except FileNotFoundError:
         print(f"Error: File '{csv_filename}' not found.")
         return
 
+    if x_axis == y_axis:
+        raise SystemExit("--x and --y must differ")
+
+    # Pin every other axis: --fix values, else the first value in the file
+    fixed = parse_fix(fix_args)
+    for axis in AXES:
+        if axis in (x_axis, y_axis):
+            continue
+        if axis in fixed:
+            col = data[axis].astype(str)
+            data = data[col == fixed[axis]]
+        else:
+            first = data[axis].iloc[0]
+            fixed[axis] = str(first)
+            data = data[data[axis] == first]
+    if data.empty:
+        raise SystemExit(f"No rows match {fixed}")
+
     print("=" * 70)
     print("CACHE HIERARCHY HEATMAP ANALYSIS")
     print("=" * 70)
-    print(f"Total data points: {len(data)}")
-    print(f"Array sizes: {data['array_size_kb'].min()} KB to {data['array_size_kb'].max()} KB")
-    print(f"Strides: {data['stride_bytes'].min()} to {data['stride_bytes'].max()} bytes")
+    print(f"Plane: {y_axis} x {x_axis}")
+    print("Fixed: " + ", ".join(f"{k}={v}" for k, v in fixed.items()))
+    print(f"Data points in plane: {len(data)}")
     print()
 
-    # Pivot data for heatmap
-    heatmap_data = data.pivot_table(
-        index='array_size_kb',
-        columns='stride_bytes',
-        values='avg_cycles_per_access'
-    )
+    # Pivot data for heatmap (repeated points are averaged)
+    heatmap_data = data.pivot_table(index=y_axis, columns=x_axis, values=VALUE)
 
     print("Average cycles per access range:")
-    print(f"  Minimum: {data['avg_cycles_per_access'].min():.2f}")
-    print(f"  Maximum: {data['avg_cycles_per_access'].max():.2f}")
+    print(f"  Minimum: {data[VALUE].min():.2f}")
+    print(f"  Maximum: {data[VALUE].max():.2f}")
     print()
 
-    # Identify cache level transitions (approximate)
-    stride_64 = data[data['stride_bytes'] == 64].copy().sort_values('array_size_kb')
-    latencies = stride_64['avg_cycles_per_access'].values
-    sizes = stride_64['array_size_kb'].values
-
-    print("Cache level transitions (stride=64 bytes):")
-    for i in range(1, len(latencies)):
-        ratio = latencies[i] / latencies[i-1]
-        if ratio > 1.3:  # Detect jumps
-            print(f"  {sizes[i-1]:6d} KB -> {sizes[i]:6d} KB: "
-                  f"{latencies[i-1]:6.2f} -> {latencies[i]:6.2f} cycles "
-                  f"({ratio:.2f}×)")
-    print()
+    # Identify cache level transitions along the size axis (stride 64 when shown)
+    if 'size_bytes' in (x_axis, y_axis):
+        other = x_axis if y_axis == 'size_bytes' else y_axis
+        series = heatmap_data if y_axis == 'size_bytes' else heatmap_data.T
+        column = 64 if other == 'stride_bytes' and 64 in series.columns else series.columns[0]
+        curve = series[column].dropna()
+        sizes = curve.index.values
+        latencies = curve.values
+        print(f"Cache level transitions ({other}={column}):")
+        for i in range(1, len(latencies)):
+            ratio = latencies[i] / latencies[i-1]
+            if ratio > 1.3:  # Detect jumps
+                print(f"  {sizes[i-1]/1024:9.1f} KB -> {sizes[i]/1024:9.1f} KB: "
+                      f"{latencies[i-1]:6.2f} -> {latencies[i]:6.2f} cycles "
+                      f"({ratio:.2f}×)")
+        print()
 
     # Create figure
     fig, ax = plt.subplots(figsize=(12, 6))
@@ -58,22 +116,25 @@ def plot_cache_heatmap(csv_filename):
         interpolation='nearest'
     )
 
-    ax.set_title('Memory Access Latency: Array Size vs. Stride (Artemisia)',
+    ax.set_title(f'Memory Access Latency: {AXIS_LABELS[y_axis]} vs. {AXIS_LABELS[x_axis]} (Artemisia)\n'
+                 + ", ".join(f"{k}={v}" for k, v in fixed.items()),
                  fontsize=14, weight='bold', pad=15)
 
-    # Y-axis (Array Size)
+    # Y-axis
     y_ticks = np.arange(len(heatmap_data.index))
-    y_labels = [f"{int(s)}" for s in heatmap_data.index]
-    ax.set_yticks(y_ticks[::2])
-    ax.set_yticklabels(y_labels[::2])
-    ax.set_ylabel('Array Size (KB)', fontsize=12, weight='bold')
+    y_labels = [tick_label(y_axis, s) for s in heatmap_data.index]
+    step = max(1, len(y_ticks) // 16)
+    ax.set_yticks(y_ticks[::step])
+    ax.set_yticklabels(y_labels[::step])
+    ax.set_ylabel(AXIS_LABELS[y_axis], fontsize=12, weight='bold')
 
-    # X-axis (Stride)
+    # X-axis
     x_ticks = np.arange(len(heatmap_data.columns))
-    x_labels = [f"{int(s)}" for s in heatmap_data.columns]
-    ax.set_xticks(x_ticks)
-    ax.set_xticklabels(x_labels, rotation=45)
-    ax.set_xlabel('Stride (Bytes)', fontsize=12, weight='bold')
+    x_labels = [tick_label(x_axis, s) for s in heatmap_data.columns]
+    step = max(1, len(x_ticks) // 24)
+    ax.set_xticks(x_ticks[::step])
+    ax.set_xticklabels(x_labels[::step], rotation=45)
+    ax.set_xlabel(AXIS_LABELS[x_axis], fontsize=12, weight='bold')
 
     # Colorbar
     cbar = fig.colorbar(im, ax=ax, fraction=0.046, pad=0.04)
@@ -81,21 +142,25 @@ def plot_cache_heatmap(csv_filename):
 
     # Cache level annotations (based on your per-core info)
     cache_levels = [
-        (48, 'L1: 48 KB', 'yellow'),
-        (2*1024*1024, 'L2: 2 MB', 'orange'),
-        (53*1024, 'L3: ~54 MB', 'red')
+        (48 * 1024, 'L1: 48 KB', 'yellow'),
+        (2 * 1024 * 1024, 'L2: 2 MB', 'orange'),
+        (53 * 1024 * 1024, 'L3: ~54 MB', 'red')
     ]
 
-    for size_kb, label, color in cache_levels:
-        if size_kb >= heatmap_data.index.min() and size_kb <= heatmap_data.index.max():
-            idx = np.argmin(np.abs(heatmap_data.index - size_kb))
-            ax.axhline(y=idx, color=color, linestyle='--', linewidth=2, alpha=0.7)
-            ax.text(len(heatmap_data.columns) + 0.5, idx, label,
-                    color=color, fontsize=10, weight='bold', va='center')
+    if y_axis == 'size_bytes':
+        for size, label, color in cache_levels:
+            if size >= heatmap_data.index.min() and size <= heatmap_data.index.max():
+                idx = np.argmin(np.abs(heatmap_data.index - size))
+                ax.axhline(y=idx, color=color, linestyle='--', linewidth=2, alpha=0.7)
+                ax.text(len(heatmap_data.columns) + 0.5, idx, label,
+                        color=color, fontsize=10, weight='bold', va='center')
 
     plt.tight_layout()
 
-    output_filename = 'cache_hierarchy_heatmap.png'
+    if (x_axis, y_axis) == ('stride_bytes', 'size_bytes'):
+        output_filename = 'cache_hierarchy_heatmap.png'
+    else:
+        output_filename = f'cache_heatmap_{y_axis}_vs_{x_axis}.png'
     plt.savefig(output_filename, dpi=300, bbox_inches='tight')
 
     print("=" * 70)
@@ -111,8 +176,15 @@ def plot_cache_heatmap(csv_filename):
 
 
 if __name__ == "__main__":
-    if len(sys.argv) != 2:
-        print(f"Usage: python {sys.argv[0]} <csv_file>")
-        print(f"Example: python {sys.argv[0]} cache_heatmap.csv")
-    else:
-        plot_cache_heatmap(sys.argv[1])
+    parser = argparse.ArgumentParser(
+        description="Plot any 2D plane of the benchmark heatmap CSV.",
+        epilog="Example: python plot.py cache_heatmap.csv --x order --y size_bytes "
+               "--fix access=load,stride_bytes=64")
+    parser.add_argument('csv_file')
+    parser.add_argument('--x', default='stride_bytes', choices=AXES)
+    parser.add_argument('--y', default='size_bytes', choices=AXES)
+    parser.add_argument('--fix', action='append',
+                        help="axis=value[,axis=value] for axes not on the plot "
+                             "(default: first value in the file)")
+    args = parser.parse_args()
+    plot_cache_heatmap(args.csv_file, args.x, args.y, args.fix)
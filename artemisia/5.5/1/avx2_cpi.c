@@ -5,6 +5,8 @@
 #include <x86intrin.h>
 #include <sched.h>
 
+#include "../../../common/uarch_cpu.h"
+
 #define ITERATIONS 1000000
 #define NUM_TESTS 10
 #define UNROLL 100   // number of asm unrolls per loop
@@ -33,12 +35,10 @@ static inline uint64_t rdtscp_serial(uint32_t* aux) {
 }
 
 int main() {
-    // Pin process to core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    // Pin to one core of our cpuset
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
@@ -96,5 +96,6 @@ int main() {
         printf("Inference: The complex dependency chain in the benchmark is stalling the pipeline, preventing the \n CPU from using its parallel execution units effectively.\n");
     }
 
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
@@ -5,9 +5,11 @@
 #include <x86intrin.h>
 #include <sched.h>
 
+#include "../../../common/uarch_warmup.h"
+#include "../../../common/uarch_cpu.h"
+
 #define ITERATIONS 1000000   // iterations per run
 #define NUM_RUNS 500         // number of runs for averaging
-#define DISCARD 15           // discard first few runs (warmup)
 #define CHAIN_LENGTH 10      // dependent ops per loop
 
 // --- Timing Harness ---
@@ -61,12 +63,10 @@ double measure_latency_chain() {
 }
 
 int main() {
-    // Pin process to core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    // Pin to one core of our cpuset
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
@@ -79,11 +79,21 @@ int main() {
     printf("Measuring AVX2 VPXOR true latency (%d dependent ops per loop)...\n",
            CHAIN_LENGTH);
 
+    // Warm-up runs until the latency settles (AVX power-up, clock ramp)
+    warmup_t warm;
+    warmup_init(&warm, WARMUP_WINDOW);
+    double total_ops = (double)ITERATIONS * CHAIN_LENGTH;
+    double empty_cycles, chain_cycles;
+    do {
+        empty_cycles = measure_empty_loop();
+        chain_cycles = measure_latency_chain();
+    } while (warmup_feed(&warm, (chain_cycles - empty_cycles) / total_ops));
+    warmup_print(&warm, "runs");
+
     for (int run = 0; run < NUM_RUNS; run++) {
         double empty_cycles = measure_empty_loop();
         double chain_cycles = measure_latency_chain();
 
-        double total_ops = (double)ITERATIONS * CHAIN_LENGTH;
         double latency = (chain_cycles - empty_cycles) / total_ops;
 
         results[run] = latency;
@@ -95,16 +105,17 @@ int main() {
 
     fclose(csv);
 
-    // Average (excluding warmup)
+    // Average (warm-up runs were never recorded)
     double sum = 0.0;
-    for (int i = DISCARD; i < NUM_RUNS; i++) sum += results[i];
-    double avg = sum / (NUM_RUNS - DISCARD);
+    for (int i = 0; i < NUM_RUNS; i++) sum += results[i];
+    double avg = sum / NUM_RUNS;
 
     printf("\n--- FINAL SUMMARY ---\n");
-    printf("Average Latency (excluding first %d runs): %.3f cycles/op\n",
-           DISCARD, avg);
+    printf("Average Latency (after %d warm-up runs): %.3f cycles/op\n",
+           warm.batches, avg);
     printf("CSV saved: avx2_vpxor_latency.csv\n");
     printf("---------------------\n");
 
+    cpu_report(&cpus);
     return 0;
 }
@@ -12,6 +12,8 @@
 #include <stdalign.h>
 #include <stdbool.h>
 
+#include "../../../common/uarch_cpu.h"
+
 #define ITERATIONS 1000000
 #define NUM_RUNS 30
 
@@ -167,10 +169,11 @@ void run_benchmark(FILE* csv, const char* data_type, uint8_t rows, uint16_t cols
 __attribute__((target("amx-int8,amx-bf16")))
 int main() {
     // Pin thread
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    sched_setaffinity(0, sizeof(set), &set);
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
     srand(time(NULL));
 
     if (!set_tiledata_use()) {
@@ -194,6 +197,7 @@ int main() {
     _tile_release();
     fclose(csv);
     printf("\nData saved to amx_combined_results.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
 
@@ -8,8 +8,12 @@
 #include <sys/mman.h>
 #include <x86intrin.h>
 
+#include "../../common/uarch_warmup.h"
+#include "../../common/uarch_cpu.h"
+
 #define NUM_NODES (1 << 16)
 #define ACCESSES_PER_RUN (1 << 20)
+#define WARMUP_BATCH (1 << 14)  // iterations per warm-up batch
 
 typedef struct Node {
     struct Node *next;
@@ -29,10 +33,11 @@ void shuffle(int *array, size_t n) {
 
 int main() {
     // Pin to a single core
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(1, &cpuset);
-    sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
 
     // Allocate and set up the circular linked list
     Node *nodes = malloc(NUM_NODES * sizeof(Node));
@@ -51,10 +56,16 @@ int main() {
     
     // --- 1. Measure Baseline (Correctly Predicted Branch) ---
     volatile Node *current = &nodes[0];
-    // Warmup
-    for(int i = 0; i < ACCESSES_PER_RUN; i++) {
-        current = current->next;
-    }
+    // Warm up until the per-batch time settles
+    warmup_t warm_base;
+    warmup_init(&warm_base, WARMUP_WINDOW);
+    do {
+        start = __rdtscp(&junk);
+        for(int i = 0; i < WARMUP_BATCH; i++) {
+            current = current->next;
+        }
+        end = __rdtscp(&junk);
+    } while (warmup_feed(&warm_base, (double)(end - start) / WARMUP_BATCH));
     
     start = __rdtscp(&junk);
     for(int i = 0; i < ACCESSES_PER_RUN; i++) {
@@ -66,11 +77,17 @@ int main() {
     // --- 2. Measure Mispredicted Branch ---
     current = &nodes[0];
     volatile int dummy = 0;
-    // Warmup
-    for(int i = 0; i < ACCESSES_PER_RUN; i++) {
-        if (current->payload & 1) dummy++;
-        current = current->next;
-    }
+    // Warm up until the predictor has learned what it can
+    warmup_t warm_mis;
+    warmup_init(&warm_mis, WARMUP_WINDOW);
+    do {
+        start = __rdtscp(&junk);
+        for(int i = 0; i < WARMUP_BATCH; i++) {
+            if (current->payload & 1) dummy++;
+            current = current->next;
+        }
+        end = __rdtscp(&junk);
+    } while (warmup_feed(&warm_mis, (double)(end - start) / WARMUP_BATCH));
 
     start = __rdtscp(&junk);
     for(int i = 0; i < ACCESSES_PER_RUN; i++) {
@@ -89,9 +106,13 @@ int main() {
     printf("-----------------------------------------\n");
     printf("Estimated Branch Misprediction Penalty: %.0f cycles\n", misprediction_penalty);
     printf("-----------------------------------------\n");
+    printf("Warm-up (batches of %d iterations): baseline %d, mispredicted %d%s\n", WARMUP_BATCH,
+           warm_base.warm_batches, warm_mis.warm_batches,
+           warm_base.settled && warm_mis.settled ? "" : " (did not settle)");
 
     free(indices);
     free(nodes);
+    cpu_report(&cpus);
     return 0;
 }
 
@@ -6,6 +6,8 @@
 #include <unistd.h>
 #include <x86intrin.h>
 
+#include "../../common/uarch_cpu.h"
+
 // The number of NOPs we will unroll in our assembly code.
 // A larger number reduces the relative overhead of the loop's jump.
 #define NUM_NOPS 1024
@@ -20,11 +22,9 @@
 
 int main() {
     // Pin the process to a single core for stable measurements.
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(1, &cpuset);
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
@@ -72,5 +72,6 @@ int main() {
     int fetch_width = (int)(ipc + 0.5);
     printf("Inferred CPU Fetch Width: %d\n", fetch_width);
 
+    cpu_report(&cpus);
     return 0;
 }
@@ -0,0 +1,513 @@
+/*
+  Fleet agent: short probes on a schedule, under a CPU and memory budget.
+
+  The lab probes characterize a machine once; the agent watches it for
+  drift in production. A background thread (agent_start()) or a caller's
+  own loop (agent_cycle()) runs one cycle every interval:
+
+    freq        core clock: the freq_init() TSC rate times the
+                freq__add_ratio() add chain (~1-2 ms), plus the sysfs
+                thermal_throttle core/package counts when present
+    latency     ns per hop of a random line chase over the memory budget
+                (calib__chase(): CALIB_HOPS hops, best of CALIB_TRIES);
+                DRAM latency when the budget is larger than the LLC
+    bandwidth   one 8-byte load per line over the same buffer
+                (calib__strided())
+    mispredict  the bpred.c branch: one test/jz per byte over random vs
+                all-ones bytes, in core cycles at the cycle's clock
+    host        steal time (/proc/stat) and CPU pressure (PSI avg10)
+
+  Budget:
+    CPU         thread CPU time (CLOCK_THREAD_CPUTIME_ID) per cycle; the
+                next cycle waits until the agent's share of the wall
+                clock is back under cpu_pct
+    memory      the chase buffer and its shuffle index together stay
+                within mem_bytes; they are mapped per cycle and unmapped
+                after it, so nothing stays resident between cycles
+
+  Each cycle runs on the next physical core of the process's cpuset
+  (cpu_pick_cores() of uarch_cpu.h, so SMT siblings are not measured
+  twice), pinning only the agent thread and preferring that core's NUMA
+  node for the cycle's buffer; the per-CPU gauges carry a cpu label.
+
+  Yielding: before each probe the agent reads the instantaneous number
+  of runnable tasks (/proc/stat procs_running) and PSI cpu some avg10;
+  above max_load per online CPU or max_pressure percent it abandons the
+  rest of the cycle. A probe during which the thread was involuntarily
+  switched out (getrusage(RUSAGE_THREAD)) is discarded; a single stray
+  kworker or tick can do that, so the probe gets AGENT_ATTEMPTS runs
+  (each behind the same checks) before the cycle gives way. A probe
+  during which the cgroup was CFS-throttled (cpu.stat nr_throttled) is
+  discarded and the cycle gives way at once: the quota is spent. Each
+  probe is a few milliseconds, so the agent never holds a contended CPU
+  for longer than that; sched_idle additionally runs the thread at
+  SCHED_IDLE.
+
+  After every cycle the metrics go to <dir>/uarch_agent.prom (Prometheus
+  text format, for node_exporter's textfile collector) or, with
+  openmetrics, <dir>/uarch_agent.om with `# EOF`; both are written to a
+  temporary file and renamed, so a scrape never sees half a file.
+
+    agent_t a;
+    agent_cfg_t cfg = agent_defaults();
+    cfg.dir = "/var/lib/node_exporter";
+    agent_start(&a, &cfg);
+    ...
+    agent_stop(&a);
+*/
+#ifndef UARCH_AGENT_H
+#define UARCH_AGENT_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "uarch_calib.h"
+#include "uarch_cpu.h"
+#include "uarch_freq.h"
+
+#define AGENT_MAX_CPUS CPU_SETSIZE
+#define AGENT_BRANCH_BYTES 16384
+#define AGENT_PATH_LEN 512
+#define AGENT_MIN_MEM (1u << 20)
+#define AGENT_ATTEMPTS 2        // preempted runs of one probe before the cycle gives way
+
+enum { AGENT_FREQ, AGENT_LATENCY, AGENT_BANDWIDTH, AGENT_MISPREDICT, AGENT_NUM_PROBES };
+enum { AGENT_YIELD_LOAD, AGENT_YIELD_PRESSURE, AGENT_YIELD_PREEMPTED, AGENT_YIELD_THROTTLED,
+       AGENT_NUM_YIELDS };
+
+static const char* const agent_probe_names[AGENT_NUM_PROBES] = {
+    "freq", "latency", "bandwidth", "mispredict"
+};
+static const char* const agent_yield_names[AGENT_NUM_YIELDS] = {
+    "load", "pressure", "preempted", "throttled"
+};
+
+typedef struct {
+    const char* dir;            // where the metrics file goes
+    double interval_s;          // cycle period when the CPU budget allows it
+    double cpu_pct;             // agent CPU time / wall time, percent
+    size_t mem_bytes;           // chase buffer + shuffle index
+    double max_load;            // runnable tasks per online CPU before yielding
+    double max_pressure;        // PSI cpu some avg10, percent
+    int openmetrics;            // OpenMetrics instead of Prometheus text
+    int sched_idle;             // run the agent thread at SCHED_IDLE
+    long cycles;                // stop after this many cycles, 0 = never
+} agent_cfg_t;
+
+typedef struct {
+    int valid;                  // bit per probe
+    double lat_ns, bw_gbps, mispredict_cycles, core_ghz;
+    long throttle_core, throttle_pkg;   // -1 when sysfs has no counter
+} agent_cpu_t;
+
+typedef struct {
+    agent_cfg_t cfg;
+    cpu_ctx_t cpus;
+    int cores[AGENT_MAX_CPUS];  // one CPU per physical core of our cpuset
+    int ncores, next;           // rotation position
+    freq_ctx_t freq;
+    agent_cpu_t cpu[AGENT_MAX_CPUS];
+    uint64_t runs[AGENT_NUM_PROBES];
+    uint64_t yields[AGENT_NUM_YIELDS];
+    uint64_t cycles;
+    double cpu_s;               // agent thread CPU time so far
+    double steal, pressure;     // host: steal fraction, PSI avg10 percent
+    uint64_t stat_steal, stat_total;
+    double last_run;
+    // thread mode
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int running, stopping, done;
+} agent_t;
+
+static inline agent_cfg_t agent_defaults(void) {
+    agent_cfg_t c;
+    memset(&c, 0, sizeof(c));
+    c.dir = ".";
+    c.interval_s = 60;
+    c.cpu_pct = 1.0;
+    c.mem_bytes = CALIB_MAX_BYTES;
+    c.max_load = 1.0;
+    c.max_pressure = 10.0;
+    return c;
+}
+
+static inline double agent__clock(clockid_t id) {
+    struct timespec t;
+    clock_gettime(id, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static inline long agent__ivcsw(void) {
+    struct rusage ru;
+    return getrusage(RUSAGE_THREAD, &ru) == 0 ? ru.ru_nivcsw : 0;
+}
+
+// --- host state ---
+static inline long agent__procs_running(void) {
+    FILE* f = fopen("/proc/stat", "r");
+    char line[256];
+    long n = -1;
+    while (f && fgets(line, sizeof(line), f))
+        if (sscanf(line, "procs_running %ld", &n) == 1) break;
+    if (f) fclose(f);
+    return n;
+}
+
+// PSI cpu "some avg10", percent; -1 without PSI
+static inline double agent__pressure(void) {
+    FILE* f = fopen("/proc/pressure/cpu", "r");
+    double v = -1;
+    if (f && fscanf(f, "some avg10=%lf", &v) != 1) v = -1;
+    if (f) fclose(f);
+    return v;
+}
+
+static inline void agent__steal(agent_t* a) {
+    FILE* f = fopen("/proc/stat", "r");
+    uint64_t v[8] = {0};
+    int n = f ? fscanf(f, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
+                       &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) : 0;
+    if (f) fclose(f);
+    if (n != 8) return;
+    uint64_t total = 0;
+    for (int i = 0; i < 8; i++) total += v[i];
+    if (a->stat_total && total > a->stat_total)
+        a->steal = (double)(v[7] - a->stat_steal) / (double)(total - a->stat_total);
+    a->stat_steal = v[7];
+    a->stat_total = total;
+}
+
+static inline long agent__throttle(int cpu, const char* name) {
+    char path[128], v[32];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/%s", cpu, name);
+    ckpt__read_line(path, v, sizeof(v));
+    return strcmp(v, "unknown") ? atol(v) : -1;
+}
+
+// Yield reason + 1 when the host is busy enough to give way
+static inline int agent__busy(agent_t* a) {
+    long running = agent__procs_running();
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    // procs_running includes the agent itself
+    if (running > 0 && online > 0 && (double)(running - 1) / online > a->cfg.max_load)
+        return AGENT_YIELD_LOAD + 1;
+    a->pressure = agent__pressure();
+    if (a->pressure > a->cfg.max_pressure) return AGENT_YIELD_PRESSURE + 1;
+    return 0;
+}
+
+// --- probes ---
+// ns per byte of the bpred.c branch over n bytes, best of CALIB_TRIES
+static inline double agent__branch(uint8_t* bits, size_t n, int random, chain_rng_t* r) {
+    double best = 0;
+    for (int t = 0; t < CALIB_TRIES; t++) {
+        // fresh outcomes per try, so nothing is learned across passes
+        for (size_t i = 0; i < n; i++) bits[i] = random ? (uint8_t)(chain_rng_next(r) & 1) : 1;
+        double t0 = calib__now_ns();
+        for (size_t i = 0; i < n; i++) {
+            __asm__ volatile("test %0, %0\n\t"
+                             "jz 1f\n\t"
+                             "nop\n"
+                             "1:" :: "r"((uint32_t)bits[i]) : "cc");
+        }
+        double ns = (calib__now_ns() - t0) / n;
+        if (t == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// `ran` has a bit per probe already run this cycle
+static inline int agent__probe(agent_t* a, int probe, int cpu, int ran, char* buf, size_t size,
+                               uint32_t* order, uint8_t* bits, chain_rng_t* r) {
+    agent_cpu_t* s = &a->cpu[cpu];
+    kern_t k = {0};
+    double v = 0;
+    switch (probe) {
+        case AGENT_FREQ:
+            v = a->freq.tsc_ghz * freq__add_ratio();
+            break;
+        case AGENT_LATENCY:
+            if (kern_chase(&k, KERN_CHASE_PTR) != 0) return -1;
+            v = calib__chase(&k, buf, size, order, r);
+            break;
+        case AGENT_BANDWIDTH:
+            if (kern_strided(&k, KERN_LOAD, 8, CHAIN_LINE_SIZE, size / CHAIN_LINE_SIZE) != 0) return -1;
+            v = CHAIN_LINE_SIZE / calib__strided(&k, buf, 1);
+            break;
+        case AGENT_MISPREDICT: {
+            if (!(ran & (1 << AGENT_FREQ))) return -1;
+            double rnd = agent__branch(bits, AGENT_BRANCH_BYTES, 1, r);
+            double one = agent__branch(bits, AGENT_BRANCH_BYTES, 0, r);
+            // half of the random outcomes are mispredicted
+            v = (rnd - one) * 2 * s->core_ghz;
+            break;
+        }
+    }
+    kern_free(&k);
+    switch (probe) {
+        case AGENT_FREQ:
+            s->core_ghz = v;
+            s->throttle_core = agent__throttle(cpu, "core_throttle_count");
+            s->throttle_pkg = agent__throttle(cpu, "package_throttle_count");
+            break;
+        case AGENT_LATENCY: s->lat_ns = v; break;
+        case AGENT_BANDWIDTH: s->bw_gbps = v; break;
+        case AGENT_MISPREDICT: s->mispredict_cycles = v; break;
+    }
+    return 0;
+}
+
+// --- output ---
+// Prometheus names counters with their _total suffix, OpenMetrics without
+static inline void agent__meta(FILE* f, const agent_t* a, const char* name,
+                               const char* type, const char* help) {
+    int counter = !strcmp(type, "counter");
+    size_t len = strlen(name) - (counter && a->cfg.openmetrics ? 6 : 0);
+    fprintf(f, "# HELP %.*s %s\n", (int)len, name, help);
+    fprintf(f, "# TYPE %.*s %s\n", (int)len, name, type);
+}
+
+static inline void agent__gauge(FILE* f, const agent_t* a, const char* name, const char* help,
+                                int probe, size_t offset, double scale) {
+    agent__meta(f, a, name, "gauge", help);
+    for (int c = 0; c < AGENT_MAX_CPUS; c++) {
+        const agent_cpu_t* s = &a->cpu[c];
+        if (s->valid & (1 << probe))
+            fprintf(f, "%s{cpu=\"%d\"} %.6g\n", name, c,
+                    *(const double*)((const char*)s + offset) * scale);
+    }
+}
+
+static inline int agent_write(const agent_t* a) {
+    char path[AGENT_PATH_LEN], tmp[AGENT_PATH_LEN + 16];
+    snprintf(path, sizeof(path), "%s/uarch_agent.%s", a->cfg.dir, a->cfg.openmetrics ? "om" : "prom");
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid());
+    FILE* f = fopen(tmp, "w");
+    if (!f) return -1;
+
+    agent__gauge(f, a, "uarch_agent_memory_latency_seconds",
+                 "Random line chase latency over the agent's memory budget",
+                 AGENT_LATENCY, offsetof(agent_cpu_t, lat_ns), 1e-9);
+    agent__gauge(f, a, "uarch_agent_read_bandwidth_bytes_per_second",
+                 "Single-core read bandwidth over the agent's memory budget",
+                 AGENT_BANDWIDTH, offsetof(agent_cpu_t, bw_gbps), 1e9);
+    agent__gauge(f, a, "uarch_agent_branch_mispredict_cycles",
+                 "Branch misprediction penalty in core cycles",
+                 AGENT_MISPREDICT, offsetof(agent_cpu_t, mispredict_cycles), 1);
+    agent__gauge(f, a, "uarch_agent_core_frequency_hertz",
+                 "Core clock under load (add-chain estimate)",
+                 AGENT_FREQ, offsetof(agent_cpu_t, core_ghz), 1e9);
+
+    agent__meta(f, a, "uarch_agent_thermal_throttle_total", "counter",
+                "Thermal throttling events reported by the kernel");
+    for (int c = 0; c < AGENT_MAX_CPUS; c++) {
+        const agent_cpu_t* s = &a->cpu[c];
+        if (!(s->valid & (1 << AGENT_FREQ))) continue;
+        if (s->throttle_core >= 0)
+            fprintf(f, "uarch_agent_thermal_throttle_total{cpu=\"%d\",scope=\"core\"} %ld\n", c, s->throttle_core);
+        if (s->throttle_pkg >= 0)
+            fprintf(f, "uarch_agent_thermal_throttle_total{cpu=\"%d\",scope=\"package\"} %ld\n", c, s->throttle_pkg);
+    }
+
+    agent__meta(f, a, "uarch_agent_steal_ratio", "gauge",
+                "Fraction of host CPU time stolen by the hypervisor since the last cycle");
+    fprintf(f, "uarch_agent_steal_ratio %.6g\n", a->steal);
+    if (a->pressure >= 0) {
+        agent__meta(f, a, "uarch_agent_cpu_pressure_ratio", "gauge",
+                    "PSI cpu some avg10");
+        fprintf(f, "uarch_agent_cpu_pressure_ratio %.6g\n", a->pressure / 100);
+    }
+
+    agent__meta(f, a, "uarch_agent_probe_runs_total", "counter", "Probe runs that produced a value");
+    for (int p = 0; p < AGENT_NUM_PROBES; p++)
+        fprintf(f, "uarch_agent_probe_runs_total{probe=\"%s\"} %lu\n", agent_probe_names[p], a->runs[p]);
+    agent__meta(f, a, "uarch_agent_yields_total", "counter", "Cycles abandoned to give way to the host");
+    for (int y = 0; y < AGENT_NUM_YIELDS; y++)
+        fprintf(f, "uarch_agent_yields_total{reason=\"%s\"} %lu\n", agent_yield_names[y], a->yields[y]);
+    agent__meta(f, a, "uarch_agent_cycles_total", "counter", "Cycles started");
+    fprintf(f, "uarch_agent_cycles_total %lu\n", a->cycles);
+    agent__meta(f, a, "uarch_agent_cpu_seconds_total", "counter", "CPU time used by the agent thread");
+    fprintf(f, "uarch_agent_cpu_seconds_total %.6f\n", a->cpu_s);
+    agent__meta(f, a, "uarch_agent_memory_budget_bytes", "gauge", "Memory the agent may map per cycle");
+    fprintf(f, "uarch_agent_memory_budget_bytes %zu\n", a->cfg.mem_bytes);
+    agent__meta(f, a, "uarch_agent_last_run_timestamp_seconds", "gauge", "Wall clock of the last cycle");
+    fprintf(f, "uarch_agent_last_run_timestamp_seconds %.3f\n", a->last_run);
+    if (a->cfg.openmetrics) fprintf(f, "# EOF\n");
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0 || !ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// --- cycles ---
+static inline int agent__setup(agent_t* a) {
+    a->freq.msr_fd = -1;
+    if (cpu_init(&a->cpus) != 0) return -1;
+    a->ncores = cpu_pick_cores(&a->cpus, AGENT_MAX_CPUS, a->cores);
+    if (a->ncores == 0) return -1;
+    a->pressure = -1;
+    freq_init(&a->freq, a->cores[0]);
+    agent__steal(a);
+    return 0;
+}
+
+// For callers that run cycles on their own thread; agent_close() after
+static inline int agent_init(agent_t* a, const agent_cfg_t* cfg) {
+    memset(a, 0, sizeof(*a));
+    a->cfg = cfg ? *cfg : agent_defaults();
+    if (a->cfg.mem_bytes < AGENT_MIN_MEM || a->cfg.cpu_pct <= 0) return -1;
+    return agent__setup(a);
+}
+
+static inline void agent_close(agent_t* a) {
+    freq_close(&a->freq);
+    cpu_close(&a->cpus);
+}
+
+// One cycle on the next core. Returns 0 when every probe ran, the
+// yield reason + 1 when the host was busy, -1 on error.
+static inline int agent_cycle(agent_t* a) {
+    double cpu0 = agent__clock(CLOCK_THREAD_CPUTIME_ID);
+    int cpu = a->cores[a->next++ % a->ncores];
+    a->cycles++;
+    cpu_pin(&a->cpus, cpu);
+    agent__steal(a);
+
+    // buffer + one uint32_t index per line within mem_bytes
+    size_t size = a->cfg.mem_bytes / (CHAIN_LINE_SIZE + sizeof(uint32_t)) * CHAIN_LINE_SIZE;
+    size_t index = size / CHAIN_LINE_SIZE * sizeof(uint32_t);
+    size_t map_size = size + index + AGENT_BRANCH_BYTES;
+    char* map = (char*)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    int rc = 0;
+    if (map == MAP_FAILED) {
+        rc = -1;
+    } else {
+        madvise(map, size, MADV_HUGEPAGE);
+        uint32_t* order = (uint32_t*)(map + size);
+        uint8_t* bits = (uint8_t*)(map + size + index);
+        chain_rng_t r;
+        chain_rng_seed(&r, CHAIN_SEED, a->cycles);
+        int ran = 0;
+        for (int p = 0; p < AGENT_NUM_PROBES && rc == 0; p++) {
+            for (int attempt = 0; attempt < AGENT_ATTEMPTS; attempt++) {
+                if ((rc = agent__busy(a)) != 0) break;
+                long ivcsw = agent__ivcsw();
+                cpu_throttle_t throttle;
+                cpu_throttle_read(&a->cpus.stat, &throttle);
+                agent_cpu_t prev = a->cpu[cpu];
+                if (agent__probe(a, p, cpu, ran, map, size, order, bits, &r) != 0) break;
+                int throttled = cpu_throttled(&a->cpus, &throttle);
+                if (!throttled && agent__ivcsw() == ivcsw) {
+                    ran |= 1 << p;
+                    a->cpu[cpu].valid |= 1 << p;
+                    a->runs[p]++;
+                    break;
+                }
+                a->cpu[cpu] = prev;     // keep the last clean value
+                rc = (throttled ? AGENT_YIELD_THROTTLED : AGENT_YIELD_PREEMPTED) + 1;
+                if (throttled) break;
+            }
+        }
+        munmap(map, map_size);
+        if (rc > 0) a->yields[rc - 1]++;
+    }
+
+    pthread_setaffinity_np(pthread_self(), sizeof(a->cpus.allowed), &a->cpus.allowed);
+    a->cpu_s += agent__clock(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+    a->last_run = agent__clock(CLOCK_REALTIME);
+    if (agent_write(a) != 0 && rc == 0) rc = -1;
+    return rc;
+}
+
+// Seconds to wait after a cycle that used `cpu_s` of CPU and took `wall_s`
+static inline double agent_pause(const agent_t* a, double cpu_s, double wall_s) {
+    double period = cpu_s * 100 / a->cfg.cpu_pct;
+    if (period < a->cfg.interval_s) period = a->cfg.interval_s;
+    return period > wall_s ? period - wall_s : 0;
+}
+
+// --- thread mode ---
+static inline void* agent__main(void* arg) {
+    agent_t* a = (agent_t*)arg;
+    if (a->cfg.sched_idle) {
+        struct sched_param sp = {0};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &sp);
+    }
+    pthread_mutex_lock(&a->lock);
+    if (agent__setup(a) != 0) a->stopping = 1;
+    while (!a->stopping && (!a->cfg.cycles || (long)a->cycles < a->cfg.cycles)) {
+        pthread_mutex_unlock(&a->lock);
+        double wall0 = agent__clock(CLOCK_MONOTONIC);
+        double cpu0 = agent__clock(CLOCK_THREAD_CPUTIME_ID);
+        agent_cycle(a);
+        double wait = agent_pause(a, agent__clock(CLOCK_THREAD_CPUTIME_ID) - cpu0,
+                                  agent__clock(CLOCK_MONOTONIC) - wall0);
+        pthread_mutex_lock(&a->lock);
+        if (a->cfg.cycles && (long)a->cycles >= a->cfg.cycles) break;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        double t = until.tv_sec + until.tv_nsec * 1e-9 + wait;
+        until.tv_sec = (time_t)t;
+        until.tv_nsec = (long)((t - (double)until.tv_sec) * 1e9);
+        while (!a->stopping && pthread_cond_timedwait(&a->wake, &a->lock, &until) != ETIMEDOUT);
+    }
+    a->done = 1;
+    pthread_mutex_unlock(&a->lock);
+    agent_close(a);
+    return NULL;
+}
+
+// Starts the agent thread. It blocks every signal, so the host process
+// keeps receiving its own on its own threads.
+static inline int agent_start(agent_t* a, const agent_cfg_t* cfg) {
+    memset(a, 0, sizeof(*a));
+    a->cfg = cfg ? *cfg : agent_defaults();
+    if (a->cfg.mem_bytes < AGENT_MIN_MEM || a->cfg.cpu_pct <= 0) return -1;
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->wake, NULL);
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int rc = pthread_create(&a->thread, NULL, agent__main, a);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    a->running = rc == 0;
+    return rc == 0 ? 0 : -1;
+}
+
+static inline int agent_done(agent_t* a) {
+    pthread_mutex_lock(&a->lock);
+    int done = a->done;
+    pthread_mutex_unlock(&a->lock);
+    return done;
+}
+
+static inline void agent_stop(agent_t* a) {
+    if (!a->running) return;
+    pthread_mutex_lock(&a->lock);
+    a->stopping = 1;
+    pthread_cond_signal(&a->wake);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->thread, NULL);
+    pthread_cond_destroy(&a->wake);
+    pthread_mutex_destroy(&a->lock);
+    a->running = 0;
+}
+
+#endif // UARCH_AGENT_H
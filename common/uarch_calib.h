@@ -0,0 +1,463 @@
+/*
+  Quick start-up calibration: a coarse machine model in ~100-200 ms.
+
+  The probes take minutes and 128-256 MB each. A service that wants to
+  size its buffers or pick a code path at start-up only needs the broad
+  shape of the machine, so calib_quick() measures it with the probe
+  kernels at a fraction of the cost and at most CALIB_MAX_BYTES of memory:
+
+    caches     random line chase (kern_chase, the cache_levels.c walk)
+               over half-octave working sets from 4 KB to CALIB_MAX_BYTES;
+               a level ends where the next two sizes both sit
+               CALIB_STEP_RATIO above the plateau since the previous step
+               (the uarch_metrics.py rule) and the step outgrows the
+               spread within the plateau, so a TLB ramp that climbs a
+               little every octave is no level. A plateau past a level
+               needs two sizes besides the ramp out of it. The level size
+               is the middle of the step, snapped to the sysfs size of the
+               data or unified cache within CALIB_SNAP of it; with sysfs,
+               steps no cache explains are dropped and llc_bytes stays 0
+               when the last cache is larger than CALIB_MAX_BYTES.
+               CALIB_HOPS hops per size, best of CALIB_TRIES, so
+               DRAM-sized sets never get a full warm pass: the hops land
+               on random lines, and the lines left cached by the link
+               pass give the steady-state hit rate.
+    line       sysfs coherency_line_size. Without it, strided byte loads
+               over CALIB_LINE_BYTES (kern_strided, the has_cache.c /
+               cache_line.c walk): the end of the steepest climb in cost
+               per access, kept only within CALIB_LINE_MIN..CALIB_LINE_MAX.
+               The adjacent-line prefetcher can make that 128, which is
+               why the kernel's value wins when there is one.
+    bandwidth  one 8-byte load per line over the whole buffer, best of
+               CALIB_TRIES: per-core read bandwidth from wherever
+               CALIB_MAX_BYTES lives (DRAM unless the LLC is larger).
+    topology   sysfs: logical CPUs, physical cores, packages, SMT width.
+
+  Latencies are nanoseconds from CLOCK_MONOTONIC, so the model needs no
+  TSC or MSR access. Everything runs on the calling thread's CPU, whose
+  affinity is left alone.
+
+  The result is cached as text under $UARCH_CALIB_CACHE (default
+  ~/.cache/uarch_calib, "off" disables), one file per machine fingerprint
+  (ckpt_fingerprint(): host, CPU, microcode, kernel, BIOS, governor, THP,
+  SMT, turbo), so the next start-up on the same machine and settings reads
+  it back in microseconds and a firmware or kernel update re-measures.
+
+    calib_t m;
+    if (calib_quick(&m, 0) == 0) calib_print(&m, stderr);
+*/
+#ifndef UARCH_CALIB_H
+#define UARCH_CALIB_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "uarch_chain.h"
+#include "uarch_ckpt.h"
+#include "uarch_evict.h"
+#include "uarch_kernels.h"
+
+#define CALIB_VERSION 3
+#ifndef CALIB_MAX_BYTES
+#define CALIB_MAX_BYTES (64u << 20)
+#endif
+#define CALIB_MIN_BYTES 4096
+#define CALIB_HOPS 8192
+#define CALIB_TRIES 3
+#define CALIB_STEP_RATIO 1.4
+#define CALIB_SNAP 1.5             // sysfs size accepted this far outside the step
+#define CALIB_LINE_BYTES (8u << 20)
+#define CALIB_LINE_MAX_STRIDE 512
+#define CALIB_LINE_MIN 32
+#define CALIB_LINE_MAX 256
+#define CALIB_MAX_SIZES 64
+#define CALIB_MAX_LEVELS 4
+#define CALIB_HUGE_PAGE (2u << 20)
+
+// calib_quick() flags
+#define CALIB_FRESH 1           // measure even when a cached model exists
+#define CALIB_NO_SAVE 2         // do not write the cache
+
+typedef struct {
+    char fp_id[17];             // fingerprint hash the model belongs to
+    int cached;                 // read from the cache rather than measured
+    double ms;                  // time calib_quick() took
+    int levels;                 // cache levels found below CALIB_MAX_BYTES
+    size_t level_bytes[CALIB_MAX_LEVELS];
+    double level_ns[CALIB_MAX_LEVELS];
+    size_t l1_bytes, l2_bytes, llc_bytes;   // 0 when not found or unknown
+    double dram_ns;             // chase latency past the last level
+    int dram_ok;                // largest set was at least twice the LLC
+    int line_bytes;
+    double bw_gbps;             // per-core sequential read bandwidth
+    size_t bw_bytes;            // ... over this many bytes
+    int cpus, cores, packages, smt;
+} calib_t;
+
+static inline double calib__now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static inline double calib__median(double* v, int n) {
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && v[j - 1] > v[j]; j--) {
+            double t = v[j]; v[j] = v[j - 1]; v[j - 1] = t;
+        }
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// --- fingerprint and cache file ---
+static inline void calib__fp_id(char* out) {
+    ckpt_fp_t fp;
+    ckpt_fingerprint(&fp);
+    uint64_t h = 0xCBF29CE484222325ULL;     // FNV-1a over "key=value\n"
+    for (int i = 0; i < fp.n; i++) {
+        const char* parts[4] = {fp.key[i], "=", fp.value[i], "\n"};
+        for (int p = 0; p < 4; p++)
+            for (const char* s = parts[p]; *s; s++) h = (h ^ (uint8_t)*s) * 0x100000001B3ULL;
+    }
+    snprintf(out, 17, "%016llx", (unsigned long long)h);
+}
+
+static inline int calib__cache_path(char* path, size_t len, const char* fp_id) {
+    const char* dir = getenv("UARCH_CALIB_CACHE");
+    char def[512];
+    if (dir && (!strcmp(dir, "off") || !strcmp(dir, "0") || !*dir)) return 0;
+    if (!dir) {
+        const char* home = getenv("HOME");
+        if (!home) return 0;
+        snprintf(def, sizeof(def), "%s/.cache", home);
+        mkdir(def, 0755);
+        snprintf(def, sizeof(def), "%s/.cache/uarch_calib", home);
+        dir = def;
+    }
+    mkdir(dir, 0755);
+    snprintf(path, len, "%s/%s.txt", dir, fp_id);
+    return 1;
+}
+
+static inline int calib__load(calib_t* c, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256], key[64];
+    int version = 0, ok = 0;
+    unsigned long max_bytes = 0;
+    memset(c, 0, sizeof(*c));
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long u;
+        double d;
+        int i;
+        if (sscanf(line, "uarch-calib %d %lu", &version, &max_bytes) == 2) continue;
+        if (sscanf(line, "level %d %llu %lf", &i, &u, &d) == 3 && i >= 0 && i < CALIB_MAX_LEVELS) {
+            c->level_bytes[i] = u;
+            c->level_ns[i] = d;
+            continue;
+        }
+        if (sscanf(line, "%63s %lf", key, &d) != 2) continue;
+        if (!strcmp(key, "levels")) c->levels = (int)d;
+        else if (!strcmp(key, "l1_bytes")) c->l1_bytes = (size_t)d;
+        else if (!strcmp(key, "l2_bytes")) c->l2_bytes = (size_t)d;
+        else if (!strcmp(key, "llc_bytes")) c->llc_bytes = (size_t)d;
+        else if (!strcmp(key, "dram_ns")) c->dram_ns = d;
+        else if (!strcmp(key, "dram_ok")) c->dram_ok = (int)d;
+        else if (!strcmp(key, "line_bytes")) c->line_bytes = (int)d;
+        else if (!strcmp(key, "bw_gbps")) c->bw_gbps = d;
+        else if (!strcmp(key, "bw_bytes")) c->bw_bytes = (size_t)d;
+        else if (!strcmp(key, "cpus")) c->cpus = (int)d;
+        else if (!strcmp(key, "cores")) c->cores = (int)d;
+        else if (!strcmp(key, "packages")) c->packages = (int)d;
+        else if (!strcmp(key, "smt")) c->smt = (int)d;
+        else if (!strcmp(key, "end")) ok = 1;
+    }
+    fclose(f);
+    // a model measured with a different buffer bound is not the same model
+    if (!ok || version != CALIB_VERSION || max_bytes != CALIB_MAX_BYTES) return -1;
+    if (c->levels < 0 || c->levels > CALIB_MAX_LEVELS) return -1;
+    return 0;
+}
+
+// Write via a temp file + rename so concurrent start-ups never see a partial file
+static inline void calib__save(const calib_t* c, const char* path) {
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid());
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    fprintf(f, "uarch-calib %d %lu\n", CALIB_VERSION, (unsigned long)CALIB_MAX_BYTES);
+    fprintf(f, "levels %d\n", c->levels);
+    for (int i = 0; i < c->levels; i++)
+        fprintf(f, "level %d %zu %.3f\n", i, c->level_bytes[i], c->level_ns[i]);
+    fprintf(f, "l1_bytes %zu\nl2_bytes %zu\nllc_bytes %zu\n", c->l1_bytes, c->l2_bytes, c->llc_bytes);
+    fprintf(f, "dram_ns %.3f\ndram_ok %d\nline_bytes %d\n", c->dram_ns, c->dram_ok, c->line_bytes);
+    fprintf(f, "bw_gbps %.3f\nbw_bytes %zu\n", c->bw_gbps, c->bw_bytes);
+    fprintf(f, "cpus %d\ncores %d\npackages %d\nsmt %d\nend 1\n", c->cpus, c->cores, c->packages, c->smt);
+    if (fclose(f) != 0 || rename(tmp, path) != 0) unlink(tmp);
+}
+
+// --- topology ---
+static inline void calib__topology(calib_t* c) {
+    long n = sysconf(_SC_NPROCESSORS_CONF);
+    int core_pkg[1024][2], ncores = 0, pkgs[64], npkgs = 0;
+    c->cpus = 0;
+    for (long cpu = 0; cpu < n && cpu < 1024; cpu++) {
+        char path[128], v[32];
+        int core, pkg;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/online", cpu);
+        ckpt__read_line(path, v, sizeof(v));
+        if (!strcmp(v, "0")) continue;              // cpu0 has no online file
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/topology/core_id", cpu);
+        ckpt__read_line(path, v, sizeof(v));
+        if (sscanf(v, "%d", &core) != 1) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/topology/physical_package_id", cpu);
+        ckpt__read_line(path, v, sizeof(v));
+        if (sscanf(v, "%d", &pkg) != 1) pkg = 0;
+        c->cpus++;
+        int seen = 0;
+        for (int i = 0; i < ncores && !seen; i++) seen = core_pkg[i][0] == core && core_pkg[i][1] == pkg;
+        if (!seen) { core_pkg[ncores][0] = core; core_pkg[ncores][1] = pkg; ncores++; }
+        seen = 0;
+        for (int i = 0; i < npkgs && !seen; i++) seen = pkgs[i] == pkg;
+        if (!seen && npkgs < 64) pkgs[npkgs++] = pkg;
+    }
+    if (!c->cpus) {                                 // no sysfs topology
+        c->cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        ncores = c->cpus;
+        npkgs = 1;
+    }
+    c->cores = ncores;
+    c->packages = npkgs;
+    c->smt = ncores ? c->cpus / ncores : 1;
+}
+
+// --- measurements ---
+// ns per hop of a random single-cycle chase over the first `size` bytes
+static inline double calib__chase(kern_t* k, char* buf, size_t size, uint32_t* order, chain_rng_t* r) {
+    size_t n = size / CHAIN_LINE_SIZE;
+    // Sattolo's shuffle: one cycle through every line
+    for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = chain_rng_below(r, i);
+        uint32_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for (size_t i = 0; i < n; i++)
+        *(void**)chain_node(buf, CHAIN_LINE, i) = chain_node(buf, CHAIN_LINE, order[i]);
+
+    uint64_t reps = CALIB_HOPS / KERN_UNROLL;
+    void* head = (void*)(uintptr_t)kern_run(k, buf, NULL, reps / 4);    // warm the path
+    double best = 0;
+    for (int t = 0; t < CALIB_TRIES; t++) {
+        double t0 = calib__now_ns();
+        head = (void*)(uintptr_t)kern_run(k, head, NULL, reps);
+        double ns = (calib__now_ns() - t0) / (reps * KERN_UNROLL);
+        if (t == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// Best time per access of `reps` passes of an already-built strided kernel
+static inline double calib__strided(const kern_t* k, char* buf, uint64_t reps) {
+    double best = 0;
+    kern_run(k, buf, NULL, 1);
+    for (int t = 0; t < CALIB_TRIES; t++) {
+        double t0 = calib__now_ns();
+        kern_run(k, buf, NULL, reps);
+        double ns = (calib__now_ns() - t0) / (reps * k->per_rep);
+        if (t == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// Levels from the chase curve. A level is a run of sizes followed by a
+// step larger than the spread within the run; its size is the middle
+// of the two sizes around the step, or the sysfs size that falls
+// near it. With sysfs geometry, steps no data or unified cache explains
+// (TLB reach, page walks) are dropped and l1/l2/llc follow the sysfs
+// levels, llc staying 0 when the last one lies past CALIB_MAX_BYTES.
+// Without sysfs llc stays 0 when the curve keeps climbing past the last
+// level, as it does through a TLB ramp.
+static inline int calib__levels(calib_t* c, const size_t* sizes, const double* raw, int n) {
+    // the curve only climbs: a lone point a step above both neighbours was
+    // a preemption or interrupt, not the cache
+    double ns[CALIB_MAX_SIZES];
+    memcpy(ns, raw, n * sizeof(double));
+    for (int i = 1; i + 1 < n; i++) {
+        double around = raw[i - 1] > raw[i + 1] ? raw[i - 1] : raw[i + 1];
+        if (raw[i] > CALIB_STEP_RATIO * around) ns[i] = around;
+    }
+    evict_geom_t geom[EVICT_MAX_LEVELS];
+    int n_geom = evict_read_geometry(geom, EVICT_MAX_LEVELS);
+    int matched[CALIB_MAX_LEVELS], next_geom = 0, start = 0;
+    double tmp[CALIB_MAX_SIZES];
+    c->levels = 0;
+    for (int i = 0; i + 2 < n && c->levels < CALIB_MAX_LEVELS; i++) {
+        // past a level the first size is the ramp out of it, not the plateau
+        int base = start + (c->levels > 0);
+        if (i < base + (c->levels > 0)) continue;
+        double lo = ns[base], hi = ns[base];
+        for (int j = base; j <= i; j++) {
+            if (ns[j] < lo) lo = ns[j];
+            if (ns[j] > hi) hi = ns[j];
+        }
+        memcpy(tmp, ns + base, (i + 1 - base) * sizeof(double));
+        double plateau = calib__median(tmp, i + 1 - base);
+        if (ns[i + 1] <= CALIB_STEP_RATIO * plateau || ns[i + 2] <= CALIB_STEP_RATIO * plateau) continue;
+        if (hi / lo >= ns[i + 1] / plateau) continue;  // a ramp: the step is no bigger than its climb
+
+        size_t bytes = ((sizes[i] + sizes[i + 1]) / 2 + 2048) & ~(size_t)4095;
+        int g = -1;
+        for (int j = next_geom; j < n_geom && g < 0; j++)
+            if (geom[j].size * CALIB_SNAP >= sizes[i] && geom[j].size <= sizes[i + 1] * CALIB_SNAP) g = j;
+        if (n_geom && g < 0) continue;                  // no cache there: TLB or page walks
+        if (g >= 0) {
+            bytes = geom[g].size;
+            next_geom = g + 1;
+        }
+        matched[c->levels] = g;
+        c->level_bytes[c->levels] = bytes;
+        c->level_ns[c->levels] = plateau;
+        c->levels++;
+        start = i + 1;
+    }
+    memcpy(tmp, ns + start, (n - start) * sizeof(double));
+    c->dram_ns = calib__median(tmp, n - start);
+    c->l1_bytes = c->l2_bytes = c->llc_bytes = 0;
+    if (n_geom) {
+        for (int i = 0; i < c->levels; i++) {
+            const evict_geom_t* g = &geom[matched[i]];
+            if (g->level == 1) c->l1_bytes = g->size;
+            else if (matched[i] == n_geom - 1) c->llc_bytes = g->size;
+            else if (g->level == 2) c->l2_bytes = g->size;
+        }
+        c->dram_ok = c->llc_bytes && sizes[n - 1] >= 2 * c->llc_bytes;
+        return c->levels;
+    }
+    // without sysfs the last level is the LLC only if the curve settles past it
+    double lo = ns[start], hi = ns[start];
+    for (int j = start; j < n; j++) {
+        if (ns[j] < lo) lo = ns[j];
+        if (ns[j] > hi) hi = ns[j];
+    }
+    int settled = n - start >= 2 && hi <= CALIB_STEP_RATIO * lo;
+    if (c->levels >= 1) c->l1_bytes = c->level_bytes[0];
+    if (c->levels >= 3 || (c->levels == 2 && !settled)) c->l2_bytes = c->level_bytes[1];
+    if (c->levels >= 2 && settled) c->llc_bytes = c->level_bytes[c->levels - 1];
+    c->dram_ok = c->levels >= 1 && settled && sizes[n - 1] >= 2 * c->level_bytes[c->levels - 1];
+    return c->levels;
+}
+
+static inline int calib__line(kern_t* k, char* buf) {
+    size_t strides[16];
+    double ns[16];
+    int n = 0;
+    for (size_t s = 4; s <= CALIB_LINE_MAX_STRIDE && n < 16; s *= 2, n++) {
+        strides[n] = s;
+        if (kern_strided(k, KERN_LOAD, 1, s, CALIB_LINE_BYTES / s) != 0) return 0;
+        ns[n] = calib__strided(k, buf, 1);
+    }
+    // end of the climb containing the largest step (uarch_metrics line_size)
+    int top = -1;
+    for (int i = 0; i + 1 < n; i++)
+        if (ns[i] > 0 && (top < 0 || ns[i + 1] / ns[i] > ns[top + 1] / ns[top])) top = i;
+    if (top < 0 || ns[top + 1] / ns[top] < 1.5) return 0;
+    while (top + 2 < n && ns[top + 2] / ns[top + 1] >= 1.5) top++;
+    if (strides[top + 1] < CALIB_LINE_MIN || strides[top + 1] > CALIB_LINE_MAX) return 0;
+    return (int)strides[top + 1];
+}
+
+static inline int calib_measure(calib_t* c) {
+    size_t map_size = CALIB_MAX_BYTES + CALIB_HUGE_PAGE;
+    char* map = (char*)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return -1;
+    char* buf = (char*)(((uintptr_t)map + CALIB_HUGE_PAGE - 1) & ~(uintptr_t)(CALIB_HUGE_PAGE - 1));
+    madvise(buf, CALIB_MAX_BYTES, MADV_HUGEPAGE);     // keep TLB misses out of the cache steps
+    uint32_t* order = (uint32_t*)malloc(CALIB_MAX_BYTES / CHAIN_LINE_SIZE * sizeof(uint32_t));
+    kern_t k = {0};
+    if (!order || kern_chase(&k, KERN_CHASE_PTR) != 0) {
+        free(order);
+        munmap(map, map_size);
+        return -1;
+    }
+
+    size_t sizes[CALIB_MAX_SIZES];
+    double ns[CALIB_MAX_SIZES];
+    int n = 0;
+    chain_rng_t r;
+    chain_rng_seed(&r, CHAIN_SEED, 0);
+    for (size_t s = CALIB_MIN_BYTES; s <= CALIB_MAX_BYTES && n < CALIB_MAX_SIZES; s *= 2) {
+        // half-octave steps: s, 1.5 s
+        size_t half[2] = {s, s + s / 2};
+        for (int h = 0; h < 2 && half[h] <= CALIB_MAX_BYTES && n < CALIB_MAX_SIZES; h++) {
+            sizes[n] = half[h];
+            ns[n] = calib__chase(&k, buf, half[h], order, &r);
+            n++;
+        }
+    }
+    calib__levels(c, sizes, ns, n);
+
+    // the kernel's line size wins over the climb, as sysfs sizes do in calib__levels
+    char v[32];
+    ckpt__read_line("/sys/devices/system/cpu/cpu0/cache/index0/coherency_line_size", v, sizeof(v));
+    c->line_bytes = atoi(v);
+    if (c->line_bytes < CALIB_LINE_MIN || c->line_bytes > CALIB_LINE_MAX) c->line_bytes = calib__line(&k, buf);
+
+    int line = c->line_bytes > 0 ? c->line_bytes : CHAIN_LINE_SIZE;
+    c->bw_bytes = CALIB_MAX_BYTES;
+    if (kern_strided(&k, KERN_LOAD, 8, line, CALIB_MAX_BYTES / line) == 0)
+        c->bw_gbps = line / calib__strided(&k, buf, 1);
+
+    kern_free(&k);
+    free(order);
+    munmap(map, map_size);
+    return 0;
+}
+
+// Coarse machine model, cached per fingerprint; 0 on success
+static inline int calib_quick(calib_t* c, int flags) {
+    double t0 = calib__now_ns();
+    char id[17], path[1024];
+    calib__fp_id(id);
+    int cache = calib__cache_path(path, sizeof(path), id);
+    if (cache && !(flags & CALIB_FRESH) && calib__load(c, path) == 0) {
+        memcpy(c->fp_id, id, sizeof(id));
+        c->cached = 1;
+        c->ms = (calib__now_ns() - t0) / 1e6;
+        return 0;
+    }
+    memset(c, 0, sizeof(*c));
+    memcpy(c->fp_id, id, sizeof(id));
+    calib__topology(c);
+    if (calib_measure(c) != 0) return -1;
+    if (cache && !(flags & CALIB_NO_SAVE)) calib__save(c, path);
+    c->ms = (calib__now_ns() - t0) / 1e6;
+    return 0;
+}
+
+static inline void calib_print(const calib_t* c, FILE* out) {
+    fprintf(out, "calib %s: %s in %.1f ms\n", c->fp_id, c->cached ? "cached" : "measured", c->ms);
+    for (int i = 0; i < c->levels; i++)
+        fprintf(out, "  level %d: %6zu KB  %6.2f ns\n", i + 1, c->level_bytes[i] >> 10, c->level_ns[i]);
+    const size_t named[3] = {c->l1_bytes, c->l2_bytes, c->llc_bytes};
+    const char* names[3] = {"L1", "L2", "LLC"};
+    fprintf(out, " ");
+    for (int i = 0; i < 3; i++) {
+        if (named[i]) fprintf(out, " %s %zu KB", names[i], named[i] >> 10);
+        else fprintf(out, " %s unknown", names[i]);
+        fprintf(out, i < 2 ? "," : "\n");
+    }
+    fprintf(out, "  DRAM %.1f ns%s\n", c->dram_ns,
+            c->dram_ok ? "" : " (buffer not clearly past the last cache)");
+    fprintf(out, "  line %d B, read bandwidth %.1f GB/s over %zu MB\n",
+            c->line_bytes, c->bw_gbps, c->bw_bytes >> 20);
+    fprintf(out, "  %d CPUs, %d cores, %d packages, %d-way SMT\n",
+            c->cpus, c->cores, c->packages, c->smt);
+}
+
+#endif // UARCH_CALIB_H
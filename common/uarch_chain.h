@@ -0,0 +1,436 @@
+/*
+  Random pointer-chain construction for the chase-based probes.
+
+  A chain is one random cycle through every node of a buffer, so a chase
+  from any node visits all of them before repeating (rand()-driven
+  shuffles of the pointer values leave several short cycles instead).
+
+    chain_perm()   random order of node ids 0..n-1. xoshiro256** streams
+                   per block of ids scatter them into random buckets, and
+                   the buckets are Fisher-Yates shuffled, all in parallel;
+                   the result is a uniform permutation that depends only on
+                   (n, seed), never on the thread count.
+    chain_link()   writes node[order[i]] = &node[order[i+1]] (the last
+                   node closes the cycle) for a layout: where node k lives.
+    chain_build()  both, for callers that only want the head pointer.
+
+  Layouts separate cache from TLB effects at the same working set:
+
+    elem        every 8-byte slot; neighbours share lines
+    line        one node per 64-byte line, lines in random order: each hop
+                is a new line and, past the TLB reach, usually a new page
+    page_lines  all 64 lines of a page in random order, then a random next
+                page: one TLB miss per 64 hops, so the curve is "TLB-less"
+                and line - page_lines isolates the page-walk cost
+    page        one node per 4 KB page, always at offset 0: every hop
+                misses the TLB, and every node maps to the same L1/L2 sets
+    page_off    one node per page at line (k mod 64), so consecutive nodes
+                use different sets and never 4K-alias
+
+  The page_lines permutation orders pages; lines within page p follow a
+  fixed shuffle derived from (seed, p).
+
+  Permutations are cached as raw uint32 arrays under $UARCH_CHAIN_CACHE
+  (default ~/.cache/uarch_chains, "off" disables) and mmap'd on the next
+  run, so only the parallel link pass remains. They are address- and
+  layout-independent: one file serves any buffer of the same node count.
+*/
+#ifndef UARCH_CHAIN_H
+#define UARCH_CHAIN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "uarch_cpu.h"
+
+#define CHAIN_SEED 42
+#define CHAIN_MIN_BLOCK (64 * 1024)     // ids per RNG stream / bucket target
+#define CHAIN_MAX_BLOCKS 1024
+#define CHAIN_MAX_THREADS 64
+#define CHAIN_MAGIC "UACHAIN1"
+
+#define CHAIN_LINE_SIZE 64
+#define CHAIN_PAGE_SIZE 4096
+#define CHAIN_PAGE_LINES_N (CHAIN_PAGE_SIZE / CHAIN_LINE_SIZE)
+
+// Node placement (see above)
+enum { CHAIN_ELEM, CHAIN_LINE, CHAIN_PAGE_LINES, CHAIN_PAGE, CHAIN_PAGE_OFF, CHAIN_NUM_LAYOUTS };
+
+static inline const char* chain_layout_name(int layout) {
+    static const char* names[CHAIN_NUM_LAYOUTS] = {"elem", "line", "page_lines", "page", "page_off"};
+    return layout >= 0 && layout < CHAIN_NUM_LAYOUTS ? names[layout] : "?";
+}
+
+// Layout id by name; -1 if unknown
+static inline int chain_layout_parse(const char* name) {
+    for (int l = 0; l < CHAIN_NUM_LAYOUTS; l++)
+        if (!strcmp(name, chain_layout_name(l))) return l;
+    return -1;
+}
+
+// --- xoshiro256** ---
+typedef struct { uint64_t s[4]; } chain_rng_t;
+
+static inline uint64_t chain__splitmix(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline void chain_rng_seed(chain_rng_t* r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int i = 0; i < 4; i++) r->s[i] = chain__splitmix(&x);
+}
+
+static inline uint64_t chain_rng_next(chain_rng_t* r) {
+    uint64_t* s = r->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// Uniform in [0, bound) (multiply-shift; bias is negligible for bound << 2^64)
+static inline uint64_t chain_rng_below(chain_rng_t* r, uint64_t bound) {
+    return (uint64_t)(((unsigned __int128)chain_rng_next(r) * bound) >> 64);
+}
+
+// --- Minimal parallel-for over [0, count) ---
+typedef struct {
+    void (*fn)(void* ctx, size_t i);
+    void* ctx;
+    size_t count;
+    size_t next;
+    cpu_set_t spread;   // affinity from before the probe pinned itself
+} chain__pool_t;
+
+static void* chain__worker(void* arg) {
+    chain__pool_t* p = (chain__pool_t*)arg;
+    // Probes pin themselves to one CPU first; let the builders spread over
+    // the cpuset (and any taskset / numactl mask) the process started with
+    sched_setaffinity(0, sizeof(p->spread), &p->spread);
+
+    size_t i;
+    while ((i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->count) p->fn(p->ctx, i);
+    return NULL;
+}
+
+static inline void chain__parallel(void (*fn)(void*, size_t), void* ctx, size_t count) {
+    chain__pool_t pool = {fn, ctx, count, 0, {{0}}};
+    int ncpus = cpu_origin(&pool.spread);
+    size_t threads = ncpus > 0 ? (size_t)ncpus : 1;
+    if (threads > CHAIN_MAX_THREADS) threads = CHAIN_MAX_THREADS;
+    if (threads > count) threads = count;
+    pthread_t tids[CHAIN_MAX_THREADS];
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++)
+        if (pthread_create(&tids[started], NULL, chain__worker, &pool) == 0) started++;
+    size_t i;
+    while ((i = __atomic_fetch_add(&pool.next, 1, __ATOMIC_RELAXED)) < count) fn(ctx, i);
+    for (size_t t = 0; t < started; t++) pthread_join(tids[t], NULL);
+}
+
+// --- Permutation ---
+typedef struct {
+    const uint32_t* order;
+    size_t n;
+    uint64_t seed;
+    void* map;          // mmap'd cache file (header + order), or NULL
+    size_t map_size;
+    uint32_t* owned;    // heap copy when not mapped
+} chain_perm_t;
+
+typedef struct {
+    char magic[8];
+    uint64_t n;
+    uint64_t seed;
+} chain__file_t;
+
+typedef struct {
+    size_t n, block, nblocks, nbuckets;
+    uint64_t seed;
+    uint32_t* counts;   // [block][bucket], then scatter cursors
+    uint32_t* bucket_start;
+    uint32_t* out;
+} chain__shuffle_t;
+
+static void chain__count(void* ctx, size_t blk) {
+    chain__shuffle_t* s = (chain__shuffle_t*)ctx;
+    chain_rng_t r;
+    chain_rng_seed(&r, s->seed, blk);
+    uint32_t* c = s->counts + blk * s->nbuckets;
+    size_t end = (blk + 1) * s->block < s->n ? (blk + 1) * s->block : s->n;
+    for (size_t id = blk * s->block; id < end; id++) c[chain_rng_below(&r, s->nbuckets)]++;
+}
+
+static void chain__scatter(void* ctx, size_t blk) {
+    chain__shuffle_t* s = (chain__shuffle_t*)ctx;
+    chain_rng_t r;
+    chain_rng_seed(&r, s->seed, blk);   // same stream as the count pass
+    uint32_t* cur = s->counts + blk * s->nbuckets;
+    size_t end = (blk + 1) * s->block < s->n ? (blk + 1) * s->block : s->n;
+    for (size_t id = blk * s->block; id < end; id++)
+        s->out[cur[chain_rng_below(&r, s->nbuckets)]++] = (uint32_t)id;
+}
+
+static void chain__shuffle_bucket(void* ctx, size_t b) {
+    chain__shuffle_t* s = (chain__shuffle_t*)ctx;
+    chain_rng_t r;
+    chain_rng_seed(&r, ~s->seed, b);
+    uint32_t* a = s->out + s->bucket_start[b];
+    size_t len = s->bucket_start[b + 1] - s->bucket_start[b];
+    for (size_t i = len; i > 1; i--) {
+        size_t j = chain_rng_below(&r, i);
+        uint32_t t = a[i - 1]; a[i - 1] = a[j]; a[j] = t;
+    }
+}
+
+// Fill out[0..n) with a uniform random permutation of 0..n-1
+static inline int chain__shuffle(uint32_t* out, size_t n, uint64_t seed) {
+    chain__shuffle_t s;
+    s.n = n;
+    s.seed = seed;
+    s.block = n / CHAIN_MAX_BLOCKS > CHAIN_MIN_BLOCK ? (n + CHAIN_MAX_BLOCKS - 1) / CHAIN_MAX_BLOCKS : CHAIN_MIN_BLOCK;
+    s.nblocks = (n + s.block - 1) / s.block;
+    s.nbuckets = s.nblocks;
+    s.out = out;
+    s.counts = (uint32_t*)calloc(s.nblocks * s.nbuckets, sizeof(uint32_t));
+    s.bucket_start = (uint32_t*)malloc((s.nbuckets + 1) * sizeof(uint32_t));
+    if (!s.counts || !s.bucket_start) {
+        free(s.counts);
+        free(s.bucket_start);
+        return -1;
+    }
+
+    chain__parallel(chain__count, &s, s.nblocks);
+
+    // Bucket-major prefix sums turn counts into scatter cursors
+    uint32_t pos = 0;
+    for (size_t b = 0; b < s.nbuckets; b++) {
+        s.bucket_start[b] = pos;
+        for (size_t blk = 0; blk < s.nblocks; blk++) {
+            uint32_t c = s.counts[blk * s.nbuckets + b];
+            s.counts[blk * s.nbuckets + b] = pos;
+            pos += c;
+        }
+    }
+    s.bucket_start[s.nbuckets] = pos;
+
+    chain__parallel(chain__scatter, &s, s.nblocks);
+    chain__parallel(chain__shuffle_bucket, &s, s.nbuckets);
+    free(s.counts);
+    free(s.bucket_start);
+    return 0;
+}
+
+// Cache file path for (n, seed); 0 if caching is disabled
+static inline int chain__cache_path(char* path, size_t len, size_t n, uint64_t seed) {
+    const char* dir = getenv("UARCH_CHAIN_CACHE");
+    char def[512];
+    if (dir && (!strcmp(dir, "off") || !strcmp(dir, "0") || !*dir)) return 0;
+    if (!dir) {
+        const char* home = getenv("HOME");
+        if (!home) return 0;
+        snprintf(def, sizeof(def), "%s/.cache", home);
+        mkdir(def, 0755);
+        snprintf(def, sizeof(def), "%s/.cache/uarch_chains", home);
+        dir = def;
+    }
+    mkdir(dir, 0755);
+    snprintf(path, len, "%s/chain_%zu_%llx.bin", dir, n, (unsigned long long)seed);
+    return 1;
+}
+
+static inline int chain__load(chain_perm_t* p, const char* path, size_t n, uint64_t seed) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    size_t want = sizeof(chain__file_t) + n * sizeof(uint32_t);
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != want) {
+        close(fd);
+        return -1;
+    }
+    void* m = mmap(NULL, want, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    const chain__file_t* h = (const chain__file_t*)m;
+    if (memcmp(h->magic, CHAIN_MAGIC, 8) || h->n != n || h->seed != seed) {
+        munmap(m, want);
+        return -1;
+    }
+    p->map = m;
+    p->map_size = want;
+    p->order = (const uint32_t*)((const char*)m + sizeof(chain__file_t));
+    return 0;
+}
+
+// Write via a temp file + rename so concurrent runs never see a partial file
+static inline void chain__save(const chain_perm_t* p, const char* path, uint64_t seed) {
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid());
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return;
+    chain__file_t h;
+    memcpy(h.magic, CHAIN_MAGIC, 8);
+    h.n = p->n;
+    h.seed = seed;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1
+          && fwrite(p->order, sizeof(uint32_t), p->n, f) == p->n;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) unlink(tmp);
+}
+
+// Random order of n node ids (n < 2^32); 0 on success
+static inline int chain_perm(chain_perm_t* p, size_t n, uint64_t seed) {
+    memset(p, 0, sizeof(*p));
+    p->n = n;
+    p->seed = seed;
+    if (!n || n > UINT32_MAX) {
+        fprintf(stderr, "chain: node count %zu out of range\n", n);
+        return -1;
+    }
+    char path[1024];
+    int cached = chain__cache_path(path, sizeof(path), n, seed);
+    if (cached && chain__load(p, path, n, seed) == 0) return 0;
+
+    p->owned = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!p->owned || chain__shuffle(p->owned, n, seed) != 0) {
+        perror("chain: permutation");
+        free(p->owned);
+        p->owned = NULL;
+        return -1;
+    }
+    p->order = p->owned;
+    if (cached) chain__save(p, path, seed);
+    return 0;
+}
+
+static inline void chain_perm_free(chain_perm_t* p) {
+    if (p->map) munmap(p->map, p->map_size);
+    free(p->owned);
+    memset(p, 0, sizeof(*p));
+}
+
+// --- Layouts ---
+static inline size_t chain_stride(int layout) {
+    switch (layout) {
+        case CHAIN_LINE:
+        case CHAIN_PAGE_LINES: return CHAIN_LINE_SIZE;
+        case CHAIN_PAGE:
+        case CHAIN_PAGE_OFF: return CHAIN_PAGE_SIZE;
+        default: return sizeof(void*);
+    }
+}
+
+// Nodes visited by one trip round the chain
+static inline size_t chain_nodes(size_t size, int layout) {
+    return size / chain_stride(layout);
+}
+
+// Permutation length: pages for page_lines, nodes otherwise
+static inline size_t chain_perm_len(size_t size, int layout) {
+    return layout == CHAIN_PAGE_LINES ? size / CHAIN_PAGE_SIZE : chain_nodes(size, layout);
+}
+
+static inline char* chain_node(void* buf, int layout, size_t id) {
+    size_t off = id * chain_stride(layout);
+    if (layout == CHAIN_PAGE_OFF) off += (id % CHAIN_PAGE_LINES_N) * CHAIN_LINE_SIZE;
+    return (char*)buf + off;
+}
+
+// Line visiting order within page `page` of a page_lines chain
+static inline void chain__page_lines(uint8_t* lines, uint64_t seed, uint32_t page) {
+    chain_rng_t r;
+    chain_rng_seed(&r, seed ^ 0x5041474553ULL, page);
+    for (int i = 0; i < CHAIN_PAGE_LINES_N; i++) lines[i] = (uint8_t)i;
+    for (int i = CHAIN_PAGE_LINES_N; i > 1; i--) {
+        int j = (int)chain_rng_below(&r, i);
+        uint8_t t = lines[i - 1]; lines[i - 1] = lines[j]; lines[j] = t;
+    }
+}
+
+static inline size_t chain__page_head(uint64_t seed, uint32_t page) {
+    uint8_t lines[CHAIN_PAGE_LINES_N];
+    chain__page_lines(lines, seed, page);
+    return (size_t)page * CHAIN_PAGE_LINES_N + lines[0];
+}
+
+typedef struct {
+    char* buf;
+    int layout;
+    const chain_perm_t* perm;
+    size_t* next;       // index form (chain_link_index)
+    size_t chunk;
+} chain__link_t;
+
+#define CHAIN_LINK_CHUNK (256 * 1024)
+
+static void chain__link_chunk(void* ctx, size_t c) {
+    chain__link_t* l = (chain__link_t*)ctx;
+    const uint32_t* o = l->perm->order;
+    size_t n = l->perm->n;
+    size_t end = (c + 1) * l->chunk < n ? (c + 1) * l->chunk : n;
+    if (l->layout == CHAIN_PAGE_LINES) {
+        uint8_t lines[CHAIN_PAGE_LINES_N];
+        for (size_t i = c * l->chunk; i < end; i++) {
+            size_t first = (size_t)o[i] * CHAIN_PAGE_LINES_N;
+            chain__page_lines(lines, l->perm->seed, o[i]);
+            for (int k = 0; k + 1 < CHAIN_PAGE_LINES_N; k++)
+                *(void**)chain_node(l->buf, l->layout, first + lines[k]) =
+                    chain_node(l->buf, l->layout, first + lines[k + 1]);
+            size_t to = chain__page_head(l->perm->seed, o[i + 1 < n ? i + 1 : 0]);
+            *(void**)chain_node(l->buf, l->layout, first + lines[CHAIN_PAGE_LINES_N - 1]) =
+                chain_node(l->buf, l->layout, to);
+        }
+        return;
+    }
+    for (size_t i = c * l->chunk; i < end; i++) {
+        uint32_t to = o[i + 1 < n ? i + 1 : 0];
+        if (l->next) l->next[o[i]] = to;
+        else *(void**)chain_node(l->buf, l->layout, o[i]) = chain_node(l->buf, l->layout, to);
+    }
+}
+
+// Link the nodes of buf[0..size) in perm order; returns the head node
+static inline void* chain_link(void* buf, size_t size, int layout, const chain_perm_t* perm) {
+    if (perm->n != chain_perm_len(size, layout)) {
+        fprintf(stderr, "chain: permutation has %zu entries, %s layout needs %zu\n",
+                perm->n, chain_layout_name(layout), chain_perm_len(size, layout));
+        return NULL;
+    }
+    chain__link_t l = {(char*)buf, layout, perm, NULL, CHAIN_LINK_CHUNK};
+    if (layout == CHAIN_PAGE_LINES) l.chunk /= CHAIN_PAGE_LINES_N;  // chunk of pages
+    chain__parallel(chain__link_chunk, &l, (perm->n + l.chunk - 1) / l.chunk);
+    if (layout == CHAIN_PAGE_LINES)
+        return chain_node(buf, layout, chain__page_head(perm->seed, perm->order[0]));
+    return chain_node(buf, layout, perm->order[0]);
+}
+
+// Index form: next[i] is the node after i (for cur = list[cur] chases)
+static inline void chain_link_index(size_t* next, const chain_perm_t* perm) {
+    chain__link_t l = {NULL, CHAIN_ELEM, perm, next, CHAIN_LINK_CHUNK};
+    chain__parallel(chain__link_chunk, &l, (perm->n + l.chunk - 1) / l.chunk);
+}
+
+// Permutation + link in one call; returns the head or NULL
+static inline void* chain_build(void* buf, size_t size, int layout, uint64_t seed) {
+    chain_perm_t perm;
+    if (chain_perm(&perm, chain_perm_len(size, layout), seed) != 0) return NULL;
+    void* head = chain_link(buf, size, layout, &perm);
+    chain_perm_free(&perm);
+    return head;
+}
+
+#endif // UARCH_CHAIN_H
@@ -0,0 +1,315 @@
+/*
+  Checkpoint and resume for long sweeps.
+
+  A probe writes its CSV through a checkpoint: next to `out.csv` sits a
+  text log `out.csv.ckpt` holding the machine fingerprint, the probe's
+  configuration string and one line per completed sweep point with the
+  CSV length at that point:
+
+    uarch-ckpt 1
+    config prf start=10 stop=360 its=10000
+    fp microcode 0x2b000620
+    ...
+    done 42 18734 0
+    complete
+
+  Points are numbered by the probe and must complete in increasing order.
+  With resume set, ckpt_open() truncates the CSV to the last completed
+  point and ckpt_skip() tells the sweep which points to leave out. It
+  refuses (returns NULL) when the fingerprint or the configuration
+  changed in between, naming what differs: results from a different
+  microcode, kernel or THP setting must not be mixed into one file.
+
+  Probes whose results live in memory until the end (histograms, fitted
+  steps) pass that state to ckpt_done(); it goes to one of two slot files
+  (.ckpt.0 / .ckpt.1) written before the done line, so a crash in between
+  leaves the previous slot intact. ckpt_state() restores it.
+
+  The fingerprint has the fields of tools/uarch_db.py's, so a checkpoint
+  and the results database agree on what counts as the same machine.
+*/
+#ifndef UARCH_CKPT_H
+#define UARCH_CKPT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#define CKPT_VERSION 1
+#define CKPT_PATH_LEN 512
+#define CKPT_CONFIG_LEN 512
+#define CKPT_VALUE_LEN 128
+#define CKPT_FP_FIELDS 15
+
+typedef struct {
+    char key[CKPT_FP_FIELDS][24];
+    char value[CKPT_FP_FIELDS][CKPT_VALUE_LEN];
+    int n;
+} ckpt_fp_t;
+
+typedef struct {
+    FILE* out;          // the CSV
+    FILE* log;          // the .ckpt log
+    char csv_path[CKPT_PATH_LEN];
+    char log_path[CKPT_PATH_LEN + 8];
+    long last_point;    // last completed point, -1 if none
+    long offset;        // CSV length at last_point
+    int slot;           // state slot of last_point, -1 if none
+    int n_done;
+    int resumed;
+    int complete;       // resumed a finished run: nothing left to do
+} ckpt_t;
+
+// --- fingerprint ---
+static inline void ckpt__read_line(const char* path, char* out, size_t len) {
+    FILE* f = fopen(path, "r");
+    if (!f || !fgets(out, (int)len, f)) snprintf(out, len, "unknown");
+    if (f) fclose(f);
+    out[strcspn(out, "\n")] = '\0';
+}
+
+static inline void ckpt__add(ckpt_fp_t* fp, const char* key, const char* value) {
+    snprintf(fp->key[fp->n], sizeof(fp->key[0]), "%s", key);
+    snprintf(fp->value[fp->n], sizeof(fp->value[0]), "%s", value);
+    fp->n++;
+}
+
+// First "key : value" of /proc/cpuinfo
+static inline void ckpt__cpuinfo(const char* key, char* out, size_t len) {
+    char line[512];
+    snprintf(out, len, "unknown");
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    size_t klen = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        char* colon = strchr(line, ':');
+        if (!colon || strncmp(line, key, klen) != 0) continue;
+        const char* rest = line + klen;
+        while (rest < colon && (*rest == ' ' || *rest == '\t')) rest++;
+        if (rest != colon) continue;    // "model" must not match "model name"
+        colon++;
+        while (*colon == ' ') colon++;
+        snprintf(out, len, "%s", colon);
+        out[strcspn(out, "\n")] = '\0';
+        break;
+    }
+    fclose(f);
+}
+
+static inline void ckpt_fingerprint(ckpt_fp_t* fp) {
+    char v[CKPT_VALUE_LEN];
+    struct utsname u;
+    fp->n = 0;
+
+    if (gethostname(v, sizeof(v)) != 0) snprintf(v, sizeof(v), "unknown");
+    v[sizeof(v) - 1] = '\0';
+    v[strcspn(v, ".")] = '\0';
+    ckpt__add(fp, "host", v);
+    ckpt__cpuinfo("model name", v, sizeof(v)); ckpt__add(fp, "cpu_model", v);
+    ckpt__cpuinfo("cpu family", v, sizeof(v)); ckpt__add(fp, "cpu_family", v);
+    ckpt__cpuinfo("model", v, sizeof(v)); ckpt__add(fp, "cpu_model_id", v);
+    ckpt__cpuinfo("stepping", v, sizeof(v)); ckpt__add(fp, "stepping", v);
+    snprintf(v, sizeof(v), "%ld", sysconf(_SC_NPROCESSORS_ONLN)); ckpt__add(fp, "cpus", v);
+    ckpt__cpuinfo("microcode", v, sizeof(v)); ckpt__add(fp, "microcode", v);
+    ckpt__add(fp, "kernel", uname(&u) == 0 ? u.release : "unknown");
+    ckpt__read_line("/sys/class/dmi/id/bios_vendor", v, sizeof(v)); ckpt__add(fp, "bios_vendor", v);
+    ckpt__read_line("/sys/class/dmi/id/bios_version", v, sizeof(v)); ckpt__add(fp, "bios_version", v);
+    ckpt__read_line("/sys/class/dmi/id/bios_date", v, sizeof(v)); ckpt__add(fp, "bios_date", v);
+    ckpt__read_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor", v, sizeof(v));
+    ckpt__add(fp, "governor", v);
+    // "[always] madvise never" -> the selected mode
+    ckpt__read_line("/sys/kernel/mm/transparent_hugepage/enabled", v, sizeof(v));
+    char* lb = strchr(v, '[');
+    char* rb = lb ? strchr(lb, ']') : NULL;
+    if (lb && rb) {
+        *rb = '\0';
+        memmove(v, lb + 1, strlen(lb + 1) + 1);
+    }
+    ckpt__add(fp, "thp", v);
+    ckpt__read_line("/sys/devices/system/cpu/smt/control", v, sizeof(v)); ckpt__add(fp, "smt", v);
+    ckpt__read_line("/sys/devices/system/cpu/intel_pstate/no_turbo", v, sizeof(v));
+    ckpt__add(fp, "no_turbo", v);
+}
+
+// --- log ---
+static inline int ckpt__sync(FILE* f) {
+    return fflush(f) == 0 && fsync(fileno(f)) == 0 ? 0 : -1;
+}
+
+static inline void ckpt__slot_path(const ckpt_t* c, int slot, char* out, size_t len) {
+    snprintf(out, len, "%s.%c", c->log_path, (char)('0' + (slot & 1)));
+}
+
+// Check an existing log against this run; 0 if it may be resumed
+static inline int ckpt__load(ckpt_t* c, FILE* log, const char* config, const ckpt_fp_t* now) {
+    char line[CKPT_CONFIG_LEN + 64];
+    int version = 0, bad = 0;
+    if (!fgets(line, sizeof(line), log) || sscanf(line, "uarch-ckpt %d", &version) != 1 ||
+        version != CKPT_VERSION) {
+        fprintf(stderr, "ckpt: %s is not a version %d checkpoint\n", c->log_path, CKPT_VERSION);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), log)) {
+        if (!strchr(line, '\n')) break;     // torn last line
+        line[strcspn(line, "\n")] = '\0';
+        long point, offset;
+        int slot;
+        if (!strncmp(line, "config ", 7)) {
+            if (strcmp(line + 7, config) != 0) {
+                fprintf(stderr, "ckpt: configuration changed since the checkpoint\n"
+                                "  was: %s\n  now: %s\n", line + 7, config);
+                bad = 1;
+            }
+        } else if (!strncmp(line, "fp ", 3)) {
+            char* key = line + 3;
+            char* value = strchr(key, ' ');
+            if (!value) continue;
+            *value++ = '\0';
+            for (int i = 0; i < now->n; i++) {
+                if (strcmp(now->key[i], key) == 0 && strcmp(now->value[i], value) != 0) {
+                    fprintf(stderr, "ckpt: machine changed since the checkpoint: %s '%s' -> '%s'\n",
+                            key, value, now->value[i]);
+                    bad = 1;
+                }
+            }
+        } else if (sscanf(line, "done %ld %ld %d", &point, &offset, &slot) == 3) {
+            c->last_point = point;
+            c->offset = offset;
+            c->slot = slot;
+            c->n_done++;
+        } else if (!strcmp(line, "complete")) {
+            c->complete = 1;
+        }
+    }
+    if (bad) fprintf(stderr, "ckpt: refusing to mix results; run without --resume to start over\n");
+    return bad ? -1 : 0;
+}
+
+// Open `csv` for writing, resuming a previous run of the same
+// configuration on the same machine if `resume` is set. `config`
+// describes every parameter that changes the results. Returns the CSV
+// positioned for appending, or NULL.
+static inline FILE* ckpt_open(ckpt_t* c, const char* csv, const char* header,
+                              const char* config, int resume) {
+    memset(c, 0, sizeof(*c));
+    c->last_point = -1;
+    c->slot = -1;
+    snprintf(c->csv_path, sizeof(c->csv_path), "%s", csv);
+    snprintf(c->log_path, sizeof(c->log_path), "%s.ckpt", csv);
+    ckpt_fp_t now;
+    ckpt_fingerprint(&now);
+
+    FILE* old = resume ? fopen(c->log_path, "r") : NULL;
+    if (old) {
+        int ok = ckpt__load(c, old, config, &now) == 0;
+        fclose(old);
+        if (!ok) return NULL;
+    }
+    if (c->n_done > 0) {
+        c->out = fopen(csv, "r+");
+        if (!c->out || fseek(c->out, 0, SEEK_END) != 0 || ftell(c->out) < c->offset) {
+            fprintf(stderr, "ckpt: %s is missing or shorter than its checkpoint\n", csv);
+            if (c->out) fclose(c->out);
+            return NULL;
+        }
+        if (ftruncate(fileno(c->out), c->offset) != 0 || fseek(c->out, c->offset, SEEK_SET) != 0) {
+            perror("ckpt: truncate");
+            fclose(c->out);
+            return NULL;
+        }
+        c->log = fopen(c->log_path, "a");
+        c->resumed = 1;
+        if (c->complete) printf("ckpt: %s is already complete\n", csv);
+        else printf("ckpt: resuming %s after point %ld\n", csv, c->last_point);
+    } else {
+        c->out = fopen(csv, "w");
+        c->log = fopen(c->log_path, "w");
+        if (c->out) fputs(header, c->out);
+        if (c->log) {
+            fprintf(c->log, "uarch-ckpt %d\nconfig %s\n", CKPT_VERSION, config);
+            for (int i = 0; i < now.n; i++) fprintf(c->log, "fp %s %s\n", now.key[i], now.value[i]);
+            ckpt__sync(c->log);
+        }
+        // header-only CSV is the resume point before any sweep point
+        if (c->out) {
+            fflush(c->out);
+            c->offset = ftell(c->out);
+        }
+    }
+    if (!c->out || !c->log) {
+        perror("ckpt: open");
+        if (c->out) fclose(c->out);
+        if (c->log) fclose(c->log);
+        return NULL;
+    }
+    return c->out;
+}
+
+static inline int ckpt_skip(const ckpt_t* c, long point) {
+    return c->resumed && point <= c->last_point;
+}
+
+// Record `point` as complete: its CSV rows (and `state`, if any) are on disk
+static inline int ckpt_done(ckpt_t* c, long point, const void* state, size_t size) {
+    int slot = -1;
+    if (ckpt__sync(c->out) != 0) return -1;
+    long offset = ftell(c->out);
+    if (state) {
+        char path[CKPT_PATH_LEN + 16], tmp[CKPT_PATH_LEN + 24];
+        slot = c->n_done % 2;
+        ckpt__slot_path(c, slot, path, sizeof(path));
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        FILE* f = fopen(tmp, "wb");
+        int64_t head[2] = { (int64_t)point, (int64_t)size };
+        if (!f || fwrite(head, sizeof(head), 1, f) != 1 || fwrite(state, size, 1, f) != 1 ||
+            ckpt__sync(f) != 0) {
+            perror("ckpt: state");
+            if (f) fclose(f);
+            return -1;
+        }
+        fclose(f);
+        if (rename(tmp, path) != 0) return -1;
+    }
+    fprintf(c->log, "done %ld %ld %d\n", point, offset, slot);
+    if (ckpt__sync(c->log) != 0) return -1;
+    c->last_point = point;
+    c->offset = offset;
+    c->slot = slot;
+    c->n_done++;
+    return 0;
+}
+
+// Restore the state saved with the last completed point; 0 on success
+static inline int ckpt_state(const ckpt_t* c, void* state, size_t size) {
+    if (!c->resumed || c->slot < 0) return -1;
+    char path[CKPT_PATH_LEN + 16];
+    ckpt__slot_path(c, c->slot, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    int64_t head[2];
+    int ok = f && fread(head, sizeof(head), 1, f) == 1 && head[0] == c->last_point &&
+             head[1] == (int64_t)size && fread(state, size, 1, f) == 1;
+    if (f) fclose(f);
+    if (!ok) fprintf(stderr, "ckpt: no saved state for point %ld in %s\n", c->last_point, path);
+    return ok ? 0 : -1;
+}
+
+// Mark the sweep complete and close the CSV
+static inline void ckpt_close(ckpt_t* c) {
+    if (c->log) {
+        if (!c->complete) fputs("complete\n", c->log);
+        ckpt__sync(c->log);
+        fclose(c->log);
+    }
+    if (c->out) fclose(c->out);
+    for (int slot = 0; slot < 2; slot++) {
+        char path[CKPT_PATH_LEN + 16];
+        ckpt__slot_path(c, slot, path, sizeof(path));
+        remove(path);
+    }
+    c->log = c->out = NULL;
+}
+
+#endif // UARCH_CKPT_H
@@ -0,0 +1,400 @@
+/*
+  CPU selection inside the process's cpuset and CFS quota.
+
+  The probes used to pin to CPU 0 or 1 and the SMT tests to a hard-coded
+  sibling pair (0/56 on artemisia, 0/24 on sunbird). In a container the
+  cpuset may not contain those CPUs at all (sched_setaffinity fails), or
+  contain one hyperthread of a core whose sibling belongs to another
+  tenant. This header reads what the process may actually use:
+
+    allowed     sched_getaffinity(): the cgroup cpuset as the scheduler
+                applies it, plus any taskset / numactl on top
+    topology    sysfs thread_siblings_list, physical_package_id and the
+                cpuN/nodeM link of every allowed CPU; a core is "whole"
+                when all of its hardware threads are allowed, so no
+                other cpuset can run on its sibling
+    quota       cgroup v2 cpu.max or v1 cpu.cfs_quota_us / period, in
+                CPUs (0 = unlimited)
+    throttling  cgroup cpu.stat nr_throttled and throttled_usec (v2) or
+                throttled_time (v1, ns)
+
+  and picks from it:
+
+    cpu_pick()        one CPU on a whole core, off CPU 0's core (which
+                      takes most interrupts) when there is a choice
+    cpu_pick_pair()   two SMT siblings of one whole core, -1 without SMT
+    cpu_pick_cores()  one CPU per physical core, the cpu_pick() core and
+                      its NUMA node first
+    cpu_pin()         pins the calling thread and prefers memory on the
+                      CPU's node (set_mempolicy MPOL_PREFERRED, so a full
+                      node falls back instead of failing)
+    cpu_origin()      the affinity from before the first pin, for helper
+                      threads (the chain builders) that should spread over
+                      the cpuset rather than share the probe's one CPU
+
+  A busy-looping probe under a quota below one CPU gets throttled every
+  period, and a throttled window measures the quota, not the core.
+  cpu_throttle_read() before a timed window and cpu_throttled() after it
+  tell whether the cgroup was throttled in between; probes mark such a
+  sample invalid (or re-run it through NOISE_SAMPLE, which checks the
+  same counter). cpu_report() prints the throttling over the whole run.
+
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) ...
+*/
+#ifndef UARCH_CPU_H
+#define UARCH_CPU_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define CPU_CGROUP_ROOT "/sys/fs/cgroup"
+#define CPU_PATH_LEN 512
+#define CPU_MPOL_PREFERRED 1    // <numaif.h> MPOL_PREFERRED, without libnuma
+#define CPU_MAX_NODES 1024
+
+typedef struct {
+    int fd;                     // cgroup cpu.stat, -1 without a CPU controller
+    int v1;                     // throttled_time (ns) instead of throttled_usec
+} cpu_stat_t;
+
+typedef struct {
+    uint64_t nr_throttled;      // periods in which the cgroup ran out of quota
+    uint64_t throttled_us;
+} cpu_throttle_t;
+
+typedef struct {
+    cpu_set_t allowed;
+    int n_allowed;
+    short core[CPU_SETSIZE];    // lowest CPU of the core (its id), -1 if not allowed
+    short node[CPU_SETSIZE];    // NUMA node, -1 if unknown
+    short package[CPU_SETSIZE];
+    unsigned char smt[CPU_SETSIZE];     // hardware threads of the core
+    unsigned char whole[CPU_SETSIZE];   // all of them allowed
+    char cgroup[CPU_PATH_LEN];  // cgroup directory with the CPU controller
+    double quota;               // CPUs per period, 0 = unlimited
+    cpu_stat_t stat;
+    cpu_throttle_t start;       // at cpu_init()
+    uint64_t invalid;           // samples cpu_throttled() flagged
+} cpu_ctx_t;
+
+// "0-3,8,10-11" -> set; 0 if the file is missing or empty
+static inline int cpu_read_list(const char* path, cpu_set_t* set) {
+    char buf[4096], *save = NULL;
+    CPU_ZERO(set);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int n = 0;
+    if (fgets(buf, sizeof(buf), f)) {
+        for (char* tok = strtok_r(buf, ",\n", &save); tok; tok = strtok_r(NULL, ",\n", &save)) {
+            int lo, hi;
+            int k = sscanf(tok, "%d-%d", &lo, &hi);
+            if (k < 1) continue;
+            if (k == 1) hi = lo;
+            for (int c = lo; c <= hi && c < CPU_SETSIZE; c++, n++) CPU_SET(c, set);
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+// Affinity the process had before anything here pinned it. The first
+// cpu_init() or pin records it; until then it is the current affinity.
+static inline int cpu__origin(cpu_set_t* set, int record) {
+    static cpu_set_t origin;
+    static int have;
+    if (have) {
+        *set = origin;
+        return 0;
+    }
+    if (sched_getaffinity(0, sizeof(*set), set) != 0) return -1;
+    if (record) {
+        origin = *set;
+        have = 1;
+    }
+    return 0;
+}
+
+// Number of CPUs in the pre-pinning affinity; 0 if it cannot be read
+static inline int cpu_origin(cpu_set_t* set) {
+    return cpu__origin(set, 0) == 0 ? CPU_COUNT(set) : 0;
+}
+
+static inline long cpu__read_long(const char* path, long fallback) {
+    FILE* f = fopen(path, "r");
+    long v = fallback;
+    if (f && fscanf(f, "%ld", &v) != 1) v = fallback;
+    if (f) fclose(f);
+    return v;
+}
+
+// Directory of the cgroup holding our CPU controller; 1 for v1, 0 for v2,
+// -1 if there is none. A cgroup namespace shows "/" for our own group,
+// which is also where the controller files are mounted then.
+static inline int cpu__cgroup(char* dir, size_t len) {
+    char line[CPU_PATH_LEN], v1_path[CPU_PATH_LEN] = "", v2_path[CPU_PATH_LEN] = "";
+    char v1_ctrl[64] = "";
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    while (f && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char* ctrl = strchr(line, ':');
+        char* path = ctrl ? strchr(ctrl + 1, ':') : NULL;
+        if (!path) continue;
+        *path++ = '\0';
+        ctrl++;
+        if (!*ctrl) {
+            snprintf(v2_path, sizeof(v2_path), "%s", path);
+            continue;
+        }
+        // "cpu", "cpu,cpuacct" or "cpuacct,cpu"
+        char list[64], *save = NULL;
+        snprintf(list, sizeof(list), "%s", ctrl);
+        for (char* t = strtok_r(list, ",", &save); t; t = strtok_r(NULL, ",", &save))
+            if (!strcmp(t, "cpu")) {
+                snprintf(v1_ctrl, sizeof(v1_ctrl), "%s", ctrl);
+                snprintf(v1_path, sizeof(v1_path), "%s", path);
+            }
+    }
+    if (f) fclose(f);
+    if (!strcmp(v1_path, "/")) v1_path[0] = '\0';
+    if (!strcmp(v2_path, "/")) v2_path[0] = '\0';
+
+    char probe[CPU_PATH_LEN + 32];
+    if (v1_ctrl[0]) {
+        const char* mounts[] = {v1_ctrl, "cpu,cpuacct", "cpu"};
+        for (int m = 0; m < 3; m++)
+            for (int root = 0; root < 2; root++) {
+                snprintf(dir, len, CPU_CGROUP_ROOT "/%s%s", mounts[m], root ? "" : v1_path);
+                snprintf(probe, sizeof(probe), "%s/cpu.cfs_quota_us", dir);
+                if (access(probe, R_OK) == 0) return 1;
+            }
+    }
+    for (int root = 0; root < 2; root++) {
+        snprintf(dir, len, CPU_CGROUP_ROOT "%s", root ? "" : v2_path);
+        snprintf(probe, sizeof(probe), "%s/cpu.stat", dir);
+        if (access(probe, R_OK) == 0) return 0;
+    }
+    dir[0] = '\0';
+    return -1;
+}
+
+static inline int cpu_stat_open(cpu_stat_t* s, char* dir, size_t len) {
+    char buf[CPU_PATH_LEN], path[CPU_PATH_LEN + 16];
+    if (!dir) {
+        dir = buf;
+        len = sizeof(buf);
+    }
+    s->fd = -1;
+    s->v1 = cpu__cgroup(dir, len);
+    if (s->v1 < 0) return -1;
+    snprintf(path, sizeof(path), "%s/cpu.stat", dir);
+    s->fd = open(path, O_RDONLY);
+    return s->fd >= 0 ? 0 : -1;
+}
+
+// 0 and the counters, or -1 without a readable cpu.stat
+static inline int cpu_throttle_read(const cpu_stat_t* s, cpu_throttle_t* t) {
+    char buf[1024];
+    memset(t, 0, sizeof(*t));
+    if (s->fd < 0) return -1;
+    ssize_t n = pread(s->fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    char* save = NULL;
+    for (char* line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        unsigned long long v;
+        if (sscanf(line, "nr_throttled %llu", &v) == 1) t->nr_throttled = v;
+        else if (!s->v1 && sscanf(line, "throttled_usec %llu", &v) == 1) t->throttled_us = v;
+        else if (s->v1 && sscanf(line, "throttled_time %llu", &v) == 1) t->throttled_us = v / 1000;
+    }
+    return 0;
+}
+
+// 1 if the cgroup was throttled since `before`; counts the sample invalid
+static inline int cpu_throttled(cpu_ctx_t* c, const cpu_throttle_t* before) {
+    cpu_throttle_t now;
+    if (cpu_throttle_read(&c->stat, &now) != 0 || now.nr_throttled == before->nr_throttled) return 0;
+    c->invalid++;
+    return 1;
+}
+
+static inline int cpu__node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* d = opendir(path);
+    int node = -1;
+    struct dirent* e;
+    while (d && (e = readdir(d)))
+        if (!strncmp(e->d_name, "node", 4) && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    if (d) closedir(d);
+    return node;
+}
+
+static inline int cpu_init(cpu_ctx_t* c) {
+    memset(c, 0, sizeof(*c));
+    c->stat.fd = -1;
+    if (sched_getaffinity(0, sizeof(c->allowed), &c->allowed) != 0) return -1;
+    cpu_set_t origin;
+    cpu__origin(&origin, 1);
+    c->n_allowed = CPU_COUNT(&c->allowed);
+    char path[128];
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        c->core[cpu] = c->node[cpu] = c->package[cpu] = -1;
+        if (!CPU_ISSET(cpu, &c->allowed)) continue;
+        cpu_set_t sib;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (!cpu_read_list(path, &sib)) CPU_SET(cpu, &sib);
+        int first = -1, whole = 1;
+        for (int s = 0; s < CPU_SETSIZE; s++) {
+            if (!CPU_ISSET(s, &sib)) continue;
+            if (first < 0) first = s;
+            whole &= CPU_ISSET(s, &c->allowed) != 0;
+        }
+        c->core[cpu] = (short)first;
+        c->smt[cpu] = (unsigned char)CPU_COUNT(&sib);
+        c->whole[cpu] = (unsigned char)whole;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        c->package[cpu] = (short)cpu__read_long(path, -1);
+        c->node[cpu] = (short)cpu__node(cpu);
+    }
+
+    char dir[CPU_PATH_LEN], file[CPU_PATH_LEN + 32];
+    if (cpu_stat_open(&c->stat, dir, sizeof(dir)) == 0 || dir[0]) {
+        snprintf(c->cgroup, sizeof(c->cgroup), "%s", dir);
+        if (c->stat.v1) {
+            snprintf(file, sizeof(file), "%s/cpu.cfs_quota_us", dir);
+            long quota = cpu__read_long(file, -1);
+            snprintf(file, sizeof(file), "%s/cpu.cfs_period_us", dir);
+            long period = cpu__read_long(file, 0);
+            if (quota > 0 && period > 0) c->quota = (double)quota / period;
+        } else {
+            snprintf(file, sizeof(file), "%s/cpu.max", dir);
+            FILE* f = fopen(file, "r");
+            long quota = 0, period = 0;
+            if (f && fscanf(f, "%ld %ld", &quota, &period) == 2 && quota > 0)
+                c->quota = (double)quota / period;   // "max 100000" leaves quota 0
+            if (f) fclose(f);
+        }
+    }
+    cpu_throttle_read(&c->stat, &c->start);
+    return 0;
+}
+
+// Higher is better: whole core, off CPU 0's core, first thread of its core
+static inline int cpu__score(const cpu_ctx_t* c, int cpu) {
+    return 4 * c->whole[cpu] + 2 * (c->core[cpu] != 0) + (c->core[cpu] == cpu);
+}
+
+// Best single CPU to measure on; -1 if nothing is allowed
+static inline int cpu_pick(const cpu_ctx_t* c) {
+    int best = -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &c->allowed) && (best < 0 || cpu__score(c, cpu) > cpu__score(c, best)))
+            best = cpu;
+    return best;
+}
+
+// Two hardware threads of one whole core; -1 when no allowed core has two
+static inline int cpu_pick_pair(const cpu_ctx_t* c, int* a, int* b) {
+    int best = -1, second = -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &c->allowed) || c->core[cpu] != cpu || !c->whole[cpu] || c->smt[cpu] < 2) continue;
+        if (best >= 0 && cpu__score(c, cpu) <= cpu__score(c, best)) continue;
+        for (int s = cpu + 1; s < CPU_SETSIZE; s++)
+            if (CPU_ISSET(s, &c->allowed) && c->core[s] == cpu) {
+                best = cpu;
+                second = s;
+                break;
+            }
+    }
+    if (best < 0) return -1;
+    *a = best;
+    *b = second;
+    return 0;
+}
+
+// Up to n CPUs on distinct physical cores: cpu_pick() first, then whole
+// cores on its node, then the rest. Returns how many it found.
+static inline int cpu_pick_cores(const cpu_ctx_t* c, int n, int* out) {
+    int got = 0, first = cpu_pick(c);
+    if (first < 0 || n <= 0) return 0;
+    unsigned char used[CPU_SETSIZE] = {0};     // by core id
+    out[got++] = first;
+    used[c->core[first]] = 1;
+    for (int pass = 0; pass < 3 && got < n; pass++)
+        for (int cpu = 0; cpu < CPU_SETSIZE && got < n; cpu++) {
+            if (!CPU_ISSET(cpu, &c->allowed) || used[c->core[cpu]]) continue;
+            int local = c->node[cpu] == c->node[first];
+            if ((pass == 0 && !(local && c->whole[cpu])) || (pass == 1 && !local)) continue;
+            if (pass == 2 && local) continue;
+            out[got++] = cpu;
+            used[c->core[cpu]] = 1;
+        }
+    return got;
+}
+
+// Pin the calling thread to `cpu` and prefer its node for new memory;
+// worker threads can share one context. -1 with errno set on failure.
+static inline int cpu_pin(const cpu_ctx_t* c, int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &c->allowed)) {
+        errno = EINVAL;     // nothing picked, or outside our cpuset
+        return -1;
+    }
+    cpu_set_t set;
+    cpu__origin(&set, 1);
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) return -1;
+    int node = c->node[cpu];
+    if (node >= 0 && node < CPU_MAX_NODES) {
+        unsigned long mask[CPU_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+        mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+        // fails when cpuset.mems excludes the node; the default policy is still local
+        syscall(SYS_set_mempolicy, CPU_MPOL_PREFERRED, mask, (unsigned long)CPU_MAX_NODES);
+    }
+    return 0;
+}
+
+// `cpu` is the one pinned to, -1 for none
+static inline void cpu_print(const cpu_ctx_t* c, int cpu, FILE* out) {
+    fprintf(out, "cpu: ");
+    if (cpu >= 0)
+        fprintf(out, "CPU %d (core %d%s, node %d) of ", cpu, c->core[cpu],
+                c->whole[cpu] ? "" : ", sibling outside our cpuset", c->node[cpu]);
+    fprintf(out, "%d allowed", c->n_allowed);
+    if (c->quota > 0) fprintf(out, ", cgroup quota %.2f CPUs", c->quota);
+    if (c->stat.fd < 0) fprintf(out, ", no cpu.stat (throttling unchecked)");
+    fprintf(out, "\n");
+    if (c->quota > 0 && c->quota < 1)
+        fprintf(out, "cpu: WARNING quota below one CPU; busy loops will be throttled every period\n");
+}
+
+// Throttling since cpu_init(); 1 if any happened
+static inline int cpu_report(const cpu_ctx_t* c) {
+    cpu_throttle_t now;
+    if (cpu_throttle_read(&c->stat, &now) != 0 || now.nr_throttled == c->start.nr_throttled) return 0;
+    printf("cpu: WARNING CFS throttled in %llu periods (%.1f ms) during the run",
+           (unsigned long long)(now.nr_throttled - c->start.nr_throttled),
+           (now.throttled_us - c->start.throttled_us) / 1000.0);
+    if (c->invalid) printf("; %llu samples marked invalid", (unsigned long long)c->invalid);
+    printf("\n");
+    return 1;
+}
+
+static inline void cpu_close(cpu_ctx_t* c) {
+    if (c->stat.fd >= 0) close(c->stat.fd);
+    c->stat.fd = -1;
+}
+
+#endif // UARCH_CPU_H
@@ -0,0 +1,303 @@
+/*
+  Targeted eviction sets for one target line.
+
+  miss_lat.c and cache_inc.c used to push a target out of a cache level
+  by walking a buffer twice the size of that level on every sample. This
+  builds, once, a minimal set of lines congruent with the target at each
+  level (L1, L2, LLC) and evicts by walking just those lines.
+
+    1. Geometry from /sys/devices/system/cpu/cpu0/cache (data/unified only),
+       up to the highest level the caller asks for.
+    2. A pool of 2x the largest of those levels, backed by transparent huge
+       pages when possible so physical address bits below 2 MB are known.
+       The target is the first line of the pool. A caller that only needs
+       L1 and L2 sets does not pay for an LLC-sized pool.
+    3. For level L, candidates are pool lines at multiples of
+       stride = min(sets * line, page) from the target (per-slice sets for a
+       sliced LLC); enough of them are taken to cover every set that aliases
+       at that stride (LLC slices, or L2 index bits above a 4 KB page).
+    4. An eviction test primes the target, walks the lower levels' sets and
+       the candidate set, and times the reload against a threshold
+       calibrated between "hit in L" and "after all candidates".
+    5. Group-testing reduction: split the set into ways+1 groups and drop
+       any group whose removal still evicts, until `ways` lines remain.
+
+  If a level cannot be built (no huge pages for a large stride, noisy
+  timing, pool too small) evict_build() stops there and returns the
+  number of levels it did build; callers keep their buffer-walk fallback
+  for the rest.
+*/
+#ifndef UARCH_EVICT_H
+#define UARCH_EVICT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <x86intrin.h>
+
+#define EVICT_MAX_LEVELS 4
+#define EVICT_HUGE_PAGE (2u << 20)
+#define EVICT_MAX_CANDIDATES 8192
+#define EVICT_TEST_TRIALS 3         // majority vote per reduction step
+#define EVICT_CALIB_TRIALS 31       // median for hit/evicted calibration, final vote
+#define EVICT_ATTEMPTS 5            // reductions tried before a level is given up
+// Sets per LLC slice: an Intel-specific heuristic (2048 on Skylake-era
+// client and server parts). Other slice sizes, and other vendors, make the
+// LLC stride wrong and the LLC set may then fail to build.
+#define EVICT_SLICE_SETS 2048
+#define EVICT_MIN_GAP 3             // cycles between hit and evicted reload to trust the test
+
+typedef struct {
+    int level;
+    size_t size, line, ways, sets;
+} evict_geom_t;
+
+typedef struct {
+    evict_geom_t geom[EVICT_MAX_LEVELS];
+    int n_levels;
+
+    char* pool;
+    size_t pool_size;
+    char* raw;                      // mapping behind the 2 MB-aligned pool
+    size_t raw_size;
+    size_t page;                    // EVICT_HUGE_PAGE if THP is usable, else 4096
+    char* target;                   // first line of the pool
+
+    char** set[EVICT_MAX_LEVELS];   // minimal eviction set per level
+    int set_len[EVICT_MAX_LEVELS];
+    double hit[EVICT_MAX_LEVELS];   // calibrated reload cycles with the target in level i
+    double threshold[EVICT_MAX_LEVELS];
+    int built;                      // levels 0..built-1 have a set
+} evict_t;
+
+static inline size_t evict__read_sysfs(int index, const char* name) {
+    char path[128], text[32];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/%s", index, name);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    size_t v = 0;
+    if (fgets(text, sizeof(text), f)) {
+        char* end;
+        v = strtoull(text, &end, 10);
+        if (*end == 'K') v <<= 10;
+        else if (*end == 'M') v <<= 20;
+        else if (!strncmp(text, "Data", 4) || !strncmp(text, "Unified", 7)) v = 1;
+    }
+    fclose(f);
+    return v;
+}
+
+// Data and unified caches in level order; returns the number found
+static inline int evict_read_geometry(evict_geom_t* out, int max) {
+    int n = 0;
+    for (int index = 0; index < 8 && n < max; index++) {
+        size_t level = evict__read_sysfs(index, "level");
+        if (!level) break;
+        if (evict__read_sysfs(index, "type") != 1) continue;   // skip instruction caches
+        evict_geom_t* g = &out[n++];
+        g->level = (int)level;
+        g->size = evict__read_sysfs(index, "size");
+        g->line = evict__read_sysfs(index, "coherency_line_size");
+        g->ways = evict__read_sysfs(index, "ways_of_associativity");
+        g->sets = evict__read_sysfs(index, "number_of_sets");
+        if (!g->line) g->line = 64;
+        if (!g->sets && g->ways) g->sets = g->size / (g->ways * g->line);
+    }
+    return n;
+}
+
+// Size of the data or unified cache at `level` (1 = L1d), or the fallback
+static inline size_t evict_cache_size(int level, size_t fallback) {
+    evict_geom_t geom[EVICT_MAX_LEVELS];
+    int n = evict_read_geometry(geom, EVICT_MAX_LEVELS);
+    for (int i = 0; i < n; i++)
+        if (geom[i].level == level && geom[i].size) return geom[i].size;
+    return fallback;
+}
+
+static inline int evict__thp_usable(void) {
+    FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!f) return 0;
+    char text[128] = { 0 };
+    if (!fgets(text, sizeof(text), f)) text[0] = 0;
+    fclose(f);
+    return strstr(text, "[never]") == NULL;
+}
+
+// Reload time of one line, lfence/rdtscp bracketed
+static inline uint64_t evict__reload(const char* p) {
+    unsigned int aux;
+    _mm_lfence();
+    uint64_t t0 = __rdtscp(&aux);
+    (void)*(volatile const char*)p;
+    _mm_lfence();
+    uint64_t t1 = __rdtscp(&aux);
+    return t1 - t0;
+}
+
+// Forward then backward, so policies that protect recent lines still evict
+static inline void evict__walk(char* const* lines, int n) {
+    for (int i = 0; i < n; i++) (void)*(volatile char*)lines[i];
+    for (int i = n - 1; i >= 0; i--) (void)*(volatile char*)lines[i];
+}
+
+// Evict the target out of levels 0..level (0 = L1) using the built sets
+static inline void evict_level(const evict_t* ev, int level) {
+    if (level >= ev->built) level = ev->built - 1;
+    for (int l = 0; l <= level; l++) evict__walk(ev->set[l], ev->set_len[l]);
+}
+
+static inline void evict__prime(const evict_t* ev) {
+    for (int i = 0; i < 3; i++) (void)*(volatile char*)ev->target;
+}
+
+static int evict__cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Median reload after prime, lower-level eviction, and an optional extra set
+static inline double evict__median_reload(const evict_t* ev, int level, char* const* extra, int n_extra) {
+    uint64_t t[EVICT_CALIB_TRIALS];
+    for (int i = 0; i < EVICT_CALIB_TRIALS; i++) {
+        evict__prime(ev);
+        if (level > 0) evict_level(ev, level - 1);
+        if (extra) evict__walk(extra, n_extra);
+        t[i] = evict__reload(ev->target);
+    }
+    qsort(t, EVICT_CALIB_TRIALS, sizeof(uint64_t), evict__cmp_u64);
+    return (double)t[EVICT_CALIB_TRIALS / 2];
+}
+
+static inline int evict__evicts(const evict_t* ev, int level, char* const* lines, int n, int trials) {
+    int votes = 0;
+    for (int i = 0; i < trials; i++) {
+        evict__prime(ev);
+        if (level > 0) evict_level(ev, level - 1);
+        evict__walk(lines, n);
+        votes += evict__reload(ev->target) > ev->threshold[level];
+    }
+    return votes * 2 > trials;
+}
+
+// Read geometry up to cache level max_level (1 = L1, 0 = all levels) and
+// allocate the pool; pool_size 0 means 2x the largest of those levels
+static inline int evict_init(evict_t* ev, int max_level, size_t pool_size) {
+    memset(ev, 0, sizeof(*ev));
+    int n = evict_read_geometry(ev->geom, EVICT_MAX_LEVELS);
+    while (n && max_level > 0 && ev->geom[n - 1].level > max_level) n--;
+    ev->n_levels = n;
+    if (!ev->n_levels) {
+        fprintf(stderr, "evict: no cache geometry in sysfs\n");
+        return -1;
+    }
+    if (!pool_size) pool_size = 2 * ev->geom[ev->n_levels - 1].size;
+    pool_size = (pool_size + EVICT_HUGE_PAGE - 1) & ~(size_t)(EVICT_HUGE_PAGE - 1);
+
+    // Over-allocate by one huge page so the pool can start 2 MB aligned
+    char* raw = (char*)mmap(NULL, pool_size + EVICT_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        perror("mmap (evict pool)");
+        return -1;
+    }
+    ev->raw = raw;
+    ev->raw_size = pool_size + EVICT_HUGE_PAGE;
+    ev->pool = (char*)(((uintptr_t)raw + EVICT_HUGE_PAGE - 1) & ~(uintptr_t)(EVICT_HUGE_PAGE - 1));
+    ev->pool_size = pool_size;
+    ev->page = 4096;
+    if (evict__thp_usable() && madvise(ev->pool, pool_size, MADV_HUGEPAGE) == 0) ev->page = EVICT_HUGE_PAGE;
+    memset(ev->pool, 1, pool_size);
+    ev->target = ev->pool;
+    return 0;
+}
+
+// Build a minimal set for one level; 0 on success
+static inline int evict__build_level(evict_t* ev, int level, int verbose) {
+    const evict_geom_t* g = &ev->geom[level];
+    size_t span = g->sets * g->line;
+    // A sliced LLC hashes the bits above the per-slice index, so a larger
+    // stride does not narrow the slice: stop at the per-slice span
+    size_t index_span = g->sets > EVICT_SLICE_SETS ? EVICT_SLICE_SETS * g->line : span;
+    size_t stride = index_span < ev->page ? index_span : ev->page;
+    if (stride < g->line) stride = g->line;
+    size_t alias = span / stride ? span / stride : 1;
+    size_t want = 2 * g->ways * alias;
+    size_t avail = ev->pool_size / stride - 1;
+    if (want > avail) want = avail;
+    if (want > EVICT_MAX_CANDIDATES) want = EVICT_MAX_CANDIDATES;
+    if (want < g->ways) return -1;
+
+    char** cand = (char**)malloc(want * sizeof(char*));
+    for (size_t i = 0; i < want; i++) cand[i] = ev->target + (i + 1) * stride;
+    int n = (int)want;
+
+    // Calibrate, then group-testing reduction down to `ways` lines. A
+    // removal is only accepted if two tests agree and the result must pass
+    // a larger vote; a noisy attempt starts again from the full list.
+    char** work = (char**)malloc(want * sizeof(char*));
+    char** rest = (char**)malloc(want * sizeof(char*));
+    double far = 0;
+    int ok = 0;
+    for (int attempt = 0; attempt < EVICT_ATTEMPTS && !ok; attempt++) {
+        ev->hit[level] = evict__median_reload(ev, level, NULL, 0);
+        far = evict__median_reload(ev, level, cand, (int)want);
+        if (far < ev->hit[level] + EVICT_MIN_GAP) continue;
+        ev->threshold[level] = (ev->hit[level] + far) / 2;
+
+        memcpy(work, cand, want * sizeof(char*));
+        n = (int)want;
+        while (n > (int)g->ways) {
+            int groups = (int)g->ways + 1;
+            int removed = 0;
+            for (int grp = 0; grp < groups && !removed; grp++) {
+                int lo = (int)((long)n * grp / groups), hi = (int)((long)n * (grp + 1) / groups);
+                if (hi == lo) continue;
+                int m = 0;
+                for (int i = 0; i < n; i++) if (i < lo || i >= hi) rest[m++] = work[i];
+                if (evict__evicts(ev, level, rest, m, EVICT_TEST_TRIALS) &&
+                    evict__evicts(ev, level, rest, m, EVICT_TEST_TRIALS)) {
+                    memcpy(work, rest, m * sizeof(char*));
+                    n = m;
+                    removed = 1;
+                }
+            }
+            if (!removed) break;   // replacement needs more than `ways` lines
+        }
+        ok = evict__evicts(ev, level, work, n, EVICT_CALIB_TRIALS);
+    }
+    free(rest);
+    free(cand);
+    if (!ok) {
+        if (verbose) printf("  L%d: no stable eviction set from %zu candidates (hit %.0f, all candidates %.0f cycles)\n",
+                            g->level, want, ev->hit[level], far);
+        free(work);
+        return -1;
+    }
+    cand = work;
+
+    ev->set[level] = cand;
+    ev->set_len[level] = n;
+    if (verbose) printf("  L%d: %d-line eviction set (%zu ways, stride %zu KB), hit %.0f / evicted %.0f cycles\n",
+                        g->level, n, g->ways, stride >> 10, ev->hit[level], far);
+    return 0;
+}
+
+// Build sets for L1, L2, ... in order; returns how many levels were built
+static inline int evict_build(evict_t* ev, int verbose) {
+    for (int level = 0; level < ev->n_levels; level++) {
+        if (evict__build_level(ev, level, verbose) != 0) break;
+        ev->built = level + 1;
+    }
+    return ev->built;
+}
+
+static inline void evict_free(evict_t* ev) {
+    for (int l = 0; l < EVICT_MAX_LEVELS; l++) free(ev->set[l]);
+    if (ev->raw) munmap(ev->raw, ev->raw_size);
+    memset(ev, 0, sizeof(*ev));
+}
+
+#endif // UARCH_EVICT_H
@@ -0,0 +1,233 @@
+/*
+  Core-clock accounting for TSC-timed measurements.
+
+  rdtsc counts at the nominal frequency whatever the core is doing, so
+  "cycles" from TSC deltas are core cycles only when the core happens to
+  run at nominal. Turbo, P-states and a different nominal clock per host
+  make TSC results from artemisia and sunbird incomparable. This header:
+
+    freq_init(&f, cpu)      TSC rate against CLOCK_MONOTONIC; opens
+                            /dev/cpu/N/msr for APERF/MPERF if it can
+    freq_pin(&f, khz)       optional: fixes the clock through cpufreq,
+                            intel_pstate/amd-pstate min = max, otherwise
+                            the userspace governor + scaling_setspeed
+                            (root only; freq_restore() undoes it)
+    freq_warm(&f, ms)       spins until the core clock is steady (three
+                            consecutive windows within FREQ_STEADY_PCT)
+    freq_begin/freq_end     APERF/MPERF around one measurement
+    freq_core(&f, &s, tsc)  TSC ticks -> core cycles of that measurement
+    freq_ns(&f, tsc)        TSC ticks -> nanoseconds
+
+  MPERF ticks at the TSC rate, so dAPERF / dMPERF is core cycles per TSC
+  tick over exactly the measured window. Without MSR access (non-root,
+  most VMs) the ratio comes from timing a chain of dependent adds, one
+  per core cycle, against the TSC during freq_warm(); it then describes
+  the steady state rather than each window.
+*/
+#ifndef UARCH_FREQ_H
+#define UARCH_FREQ_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define FREQ_MSR_MPERF 0xE7
+#define FREQ_MSR_APERF 0xE8
+#define FREQ_WINDOW_ADDS (1 << 22)      // ~1-2 ms per warm-up window
+#define FREQ_STEADY_PCT 1.0
+#define FREQ_CPUFREQ "/sys/devices/system/cpu/cpu%d/cpufreq/%s"
+
+typedef struct {
+    int cpu;
+    int msr_fd;             // -1 without MSR access
+    double tsc_ghz;         // TSC ticks per ns
+    double ratio;           // steady core cycles per TSC tick (add-chain estimate)
+    double warm_ms;         // time freq_warm() needed to settle
+    int pinned;             // 1 governor, 2 min/max
+    char saved[3][32];      // governor or min/max as found
+} freq_ctx_t;
+
+typedef struct {
+    uint64_t aperf, mperf;
+    double ratio;           // core cycles per TSC tick over the window
+} freq_sample_t;
+
+static inline int freq__rdmsr(const freq_ctx_t* f, uint32_t msr, uint64_t* v) {
+    return f->msr_fd >= 0 && pread(f->msr_fd, v, sizeof(*v), msr) == sizeof(*v);
+}
+
+static inline double freq__pct(double a, double b) {
+    return 100.0 * (a > b ? a - b : b - a) / b;
+}
+
+static inline double freq__now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Core cycles per TSC tick: 8 dependent adds per iteration retire at one
+// per cycle, the loop counter runs alongside. Register-register adds:
+// newer cores fold `add reg, imm` chains at rename.
+static inline double freq__add_ratio(void) {
+    uint64_t x = 1, n = FREQ_WINDOW_ADDS / 8;
+    uint64_t t0 = __rdtsc();
+    do {
+        __asm__ __volatile__ (
+            "add %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\t"
+            "add %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\tadd %0, %0"
+            : "+r"(x));
+    } while (--n);
+    return (double)FREQ_WINDOW_ADDS / (double)(__rdtsc() - t0);
+}
+
+static inline int freq__sysfs_read(int cpu, const char* name, char* out, size_t len) {
+    char path[128];
+    snprintf(path, sizeof(path), FREQ_CPUFREQ, cpu, name);
+    FILE* fp = fopen(path, "r");
+    if (!fp) return -1;
+    int ok = fgets(out, (int)len, fp) != NULL;
+    fclose(fp);
+    if (!ok) return -1;
+    out[strcspn(out, "\n")] = '\0';
+    return 0;
+}
+
+static inline int freq__sysfs_write(int cpu, const char* name, const char* value) {
+    char path[128];
+    snprintf(path, sizeof(path), FREQ_CPUFREQ, cpu, name);
+    FILE* fp = fopen(path, "w");
+    if (!fp) return -1;
+    int ok = fputs(value, fp) >= 0;
+    return (fclose(fp) == 0 && ok) ? 0 : -1;
+}
+
+static inline int freq_init(freq_ctx_t* f, int cpu) {
+    memset(f, 0, sizeof(*f));
+    f->cpu = cpu;
+    char path[64];
+    uint64_t v;
+    snprintf(path, sizeof(path), "/dev/cpu/%d/msr", cpu);
+    f->msr_fd = open(path, O_RDONLY);
+    if (f->msr_fd >= 0 && !freq__rdmsr(f, FREQ_MSR_APERF, &v)) {
+        close(f->msr_fd);
+        f->msr_fd = -1;
+    }
+
+    // TSC rate over ~20 ms of wall clock
+    double n0 = freq__now_ns();
+    uint64_t t0 = __rdtsc();
+    while (freq__now_ns() - n0 < 2e7);
+    f->tsc_ghz = (double)(__rdtsc() - t0) / (freq__now_ns() - n0);
+    f->ratio = freq__add_ratio();
+    return 0;
+}
+
+static inline void freq_restore(freq_ctx_t* f) {
+    if (f->pinned == 2) {
+        // widen first, then narrow back to the saved range
+        freq__sysfs_write(f->cpu, "scaling_min_freq", f->saved[0]);
+        freq__sysfs_write(f->cpu, "scaling_max_freq", f->saved[1]);
+        freq__sysfs_write(f->cpu, "scaling_min_freq", f->saved[0]);
+    } else if (f->pinned == 1) {
+        freq__sysfs_write(f->cpu, "scaling_governor", f->saved[2]);
+    }
+    f->pinned = 0;
+}
+
+// Fix the core clock at `khz`; 0 on success
+static inline int freq_pin(freq_ctx_t* f, long khz) {
+    char driver[32], value[32];
+    snprintf(value, sizeof(value), "%ld", khz);
+    if (freq__sysfs_read(f->cpu, "scaling_driver", driver, sizeof(driver)) != 0) {
+        fprintf(stderr, "freq: no cpufreq for CPU %d\n", f->cpu);
+        return -1;
+    }
+    if (strstr(driver, "pstate")) {
+        // intel_pstate / amd-pstate (active mode) have no userspace governor
+        if (freq__sysfs_read(f->cpu, "scaling_min_freq", f->saved[0], sizeof(f->saved[0])) ||
+            freq__sysfs_read(f->cpu, "scaling_max_freq", f->saved[1], sizeof(f->saved[1])))
+            return -1;
+        // raise max first when going up so min never exceeds it
+        int up = khz > atol(f->saved[1]);
+        f->pinned = 2;
+        if (freq__sysfs_write(f->cpu, up ? "scaling_max_freq" : "scaling_min_freq", value) ||
+            freq__sysfs_write(f->cpu, up ? "scaling_min_freq" : "scaling_max_freq", value)) {
+            fprintf(stderr, "freq: cannot set %s min/max (root?)\n", driver);
+            freq_restore(f);
+            return -1;
+        }
+    } else {
+        if (freq__sysfs_read(f->cpu, "scaling_governor", f->saved[2], sizeof(f->saved[2])))
+            return -1;
+        f->pinned = 1;
+        if (freq__sysfs_write(f->cpu, "scaling_governor", "userspace") ||
+            freq__sysfs_write(f->cpu, "scaling_setspeed", value)) {
+            fprintf(stderr, "freq: cannot select the userspace governor (root?)\n");
+            freq_restore(f);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void freq_begin(const freq_ctx_t* f, freq_sample_t* s) {
+    if (freq__rdmsr(f, FREQ_MSR_APERF, &s->aperf)) freq__rdmsr(f, FREQ_MSR_MPERF, &s->mperf);
+}
+
+static inline void freq_end(const freq_ctx_t* f, freq_sample_t* s) {
+    uint64_t a, m;
+    s->ratio = f->ratio;
+    if (freq__rdmsr(f, FREQ_MSR_APERF, &a) && freq__rdmsr(f, FREQ_MSR_MPERF, &m) && m > s->mperf)
+        s->ratio = (double)(a - s->aperf) / (double)(m - s->mperf);
+}
+
+// Run until the core clock holds steady; returns the settled ratio
+static inline double freq_warm(freq_ctx_t* f, double max_ms) {
+    double t0 = freq__now_ns(), prev[2] = {0, 0};
+    for (;;) {
+        freq_sample_t s;
+        freq_begin(f, &s);
+        double r = freq__add_ratio();
+        freq_end(f, &s);
+        if (f->msr_fd >= 0) r = s.ratio;
+        int steady = prev[1] > 0 &&
+                     freq__pct(r, prev[0]) < FREQ_STEADY_PCT &&
+                     freq__pct(r, prev[1]) < FREQ_STEADY_PCT;
+        prev[1] = prev[0];
+        prev[0] = r;
+        f->warm_ms = (freq__now_ns() - t0) / 1e6;
+        if (steady || f->warm_ms >= max_ms) break;
+    }
+    f->ratio = prev[0];
+    return f->ratio;
+}
+
+static inline double freq_core(const freq_ctx_t* f, const freq_sample_t* s, double tsc) {
+    (void)f;
+    return tsc * s->ratio;
+}
+
+static inline double freq_ns(const freq_ctx_t* f, double tsc) {
+    return tsc / f->tsc_ghz;
+}
+
+static inline void freq_print(const freq_ctx_t* f) {
+    printf("freq: TSC %.3f GHz, core %.3f GHz (%.3f cycles/tick, %s), steady after %.1f ms%s\n",
+           f->tsc_ghz, f->tsc_ghz * f->ratio, f->ratio,
+           f->msr_fd >= 0 ? "APERF/MPERF" : "add-chain estimate", f->warm_ms,
+           f->pinned ? ", pinned" : "");
+}
+
+static inline void freq_close(freq_ctx_t* f) {
+    freq_restore(f);
+    if (f->msr_fd >= 0) close(f->msr_fd);
+    f->msr_fd = -1;
+}
+
+#endif // UARCH_FREQ_H
@@ -0,0 +1,109 @@
+/*
+  HDR-style latency histogram.
+
+  Log-linear buckets: values below 64 get one bucket each (exact cycle
+  counts for cache hits), larger values keep 5 significant bits (~3%
+  relative precision) up to 2^40. Recording is a couple of shifts and an
+  increment, so millions of samples cost nothing next to the measurement
+  and the tails stay visible instead of being averaged away.
+*/
+#ifndef UARCH_HIST_H
+#define UARCH_HIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_EXACT (2 * HIST_SUB)               // 0..63 are exact
+#define HIST_MAX_SHIFT 35                       // covers values below 2^40
+#define HIST_BUCKETS (HIST_EXACT + HIST_MAX_SHIFT * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min, max;
+    double sum;
+} hist_t;
+
+static inline void hist_init(hist_t* h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static inline int hist_index(uint64_t v) {
+    if (v < HIST_EXACT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    if (shift > HIST_MAX_SHIFT) return HIST_BUCKETS - 1;
+    return HIST_EXACT + (shift - 1) * HIST_SUB + (int)((v >> shift) - HIST_SUB);
+}
+
+// Inclusive value range of a bucket
+static inline void hist_bounds(int idx, uint64_t* lo, uint64_t* hi) {
+    if (idx < HIST_EXACT) {
+        *lo = *hi = (uint64_t)idx;
+        return;
+    }
+    int shift = (idx - HIST_EXACT) / HIST_SUB + 1;
+    uint64_t top = (uint64_t)((idx - HIST_EXACT) % HIST_SUB + HIST_SUB);
+    *lo = top << shift;
+    *hi = ((top + 1) << shift) - 1;
+}
+
+static inline void hist_record(hist_t* h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->total++;
+    h->sum += (double)v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+static inline void hist_merge(hist_t* dst, const hist_t* src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+static inline double hist_mean(const hist_t* h) {
+    return h->total ? h->sum / (double)h->total : 0.0;
+}
+
+// Value at percentile p (0..100): midpoint of the bucket holding that rank
+static inline double hist_percentile(const hist_t* h, double p) {
+    if (!h->total) return 0.0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)(h->total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t lo, hi;
+            hist_bounds(i, &lo, &hi);
+            return (lo + hi) / 2.0;
+        }
+    }
+    return (double)h->max;
+}
+
+static inline void hist_print(const hist_t* h, const char* label, FILE* out) {
+    fprintf(out, "%-10s n=%-9llu min %5llu | p50 %7.1f | p90 %7.1f | p99 %7.1f | p99.9 %7.1f | max %llu\n",
+            label, (unsigned long long)h->total, (unsigned long long)(h->total ? h->min : 0),
+            hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99),
+            hist_percentile(h, 99.9), (unsigned long long)h->max);
+}
+
+// One row per non-empty bucket: label,lo,hi,count
+static inline void hist_write_csv(const hist_t* h, const char* label, FILE* out) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (!h->counts[i]) continue;
+        uint64_t lo, hi;
+        hist_bounds(i, &lo, &hi);
+        fprintf(out, "%s,%llu,%llu,%llu\n", label, (unsigned long long)lo,
+                (unsigned long long)hi, (unsigned long long)h->counts[i]);
+    }
+}
+
+#endif // UARCH_HIST_H
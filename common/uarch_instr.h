@@ -0,0 +1,481 @@
+/*
+  Hot-path instrumentation for services, built on the probe timers.
+
+  The probes' rdtsc brackets and log-linear histograms, packaged so an
+  application can time its own regions in production:
+
+    INSTR_SCOPE("parse");           times the rest of the enclosing block
+    instr_region_t r = instr_begin(&site);  ...  instr_end(&r);
+
+  Each thread records into its own block of histograms (uarch_hist.h
+  buckets), one per site: single writer, relaxed stores, no locks and no
+  shared cache lines on the hot path. A background aggregator sums the
+  blocks every interval and writes the per-site deltas as records to a
+  shared-memory ring (shm_open), which another process reads with
+  instr_ring_attach()/instr_ring_next() while the service runs.
+
+  instr_init() flags:
+    INSTR_FENCES      lfence around each rdtsc (timer_begin/timer_end) so
+                      the region cannot overlap its neighbours
+    INSTR_PMC         also sum a per-thread core-cycle counter (rdpmc, the
+                      uarch_timer.h counter) over each timed region; needs
+                      perf_event_paranoid <= 2 and a PMU, ignored otherwise
+    INSTR_SAMPLE(k)   time one region in 2^k per thread and site, count the
+                      rest
+
+  One rdtsc alone costs 20-40 cycles (more under a hypervisor), so a
+  region timed every time costs 50-100. Counting is a few cycles, and
+  INSTR_SAMPLE(4) brings the average below 20 cycles per region without
+  fences. The histograms then hold the timed regions and `entered` counts
+  all of them.
+
+  instr_calibrate() measures the instrumentation the way timer_init()
+  does: the median empty-region reading (the bias, subtracted from every
+  sample) and the median cost per empty region in back-to-back batches at
+  the current flags, converted to core cycles with uarch_freq.h.
+
+  The registry, thread list and per-thread pointer are weak symbols, so a
+  service that includes this header from several translation units still
+  gets one registry per process. Sites beyond INSTR_MAX_SITES share an
+  unreported cell with the calibration.
+  Blocks of exited threads stay in the list (their counts are part of the
+  totals) and are reused by new threads.
+*/
+#ifndef UARCH_INSTR_H
+#define UARCH_INSTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <x86intrin.h>
+
+#include "uarch_freq.h"
+#include "uarch_hist.h"
+#include "uarch_timer.h"
+
+#ifndef INSTR_MAX_SITES
+#define INSTR_MAX_SITES 32
+#endif
+#define INSTR_NAME_LEN 48
+#define INSTR_RING_RECORDS 256
+#define INSTR_RING_MAGIC "UAINSTR1"
+#define INSTR_CALIB_BATCH 1000
+#define INSTR_CALIB_BATCHES 101
+
+// instr_init() flags
+#define INSTR_FENCES 1
+#define INSTR_PMC 2
+
+typedef struct {
+    const char* name;
+    int id;                     // -1 until first use
+} instr_site_t;
+
+#define INSTR_SAMPLE(k) (((k) & 31) << 8)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;             // timed regions
+    uint64_t sum;               // ticks
+    uint64_t pmc_sum;           // core cycles (INSTR_PMC)
+    uint64_t entered;           // all regions, timed or not
+} instr_cell_t;
+
+typedef struct instr_thread {
+    instr_cell_t cell[INSTR_MAX_SITES + 1];     // the last is the calibration site
+    struct instr_thread* next;
+    int in_use;
+    int pmc;                    // counter opened for this thread
+    timer_ctx_t timer;
+} instr_thread_t;
+
+typedef struct {
+    instr_cell_t* cell;         // NULL when this region is not timed
+    uint64_t t0, p0;
+    int pmc;                    // rdpmc index + 1, 0 without a counter
+} instr_region_t;
+
+// One ring record: a site's counts over one aggregation interval
+typedef struct {
+    uint64_t seq;               // 2n+1 while written, 2n+2 when record n is complete
+    uint64_t t_ns;              // CLOCK_REALTIME at the drain
+    uint32_t site;
+    char name[INSTR_NAME_LEN];
+    uint64_t total, sum, pmc_sum, entered;
+    uint64_t counts[HIST_BUCKETS];
+} instr_record_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t record_size, capacity;
+    double ticks_per_ns;        // TSC rate, for converting sum and buckets
+    double bias, cost_cycles;   // from instr_calibrate()
+    uint32_t sample_shift;
+    uint64_t head;              // records written so far
+    instr_record_t rec[];
+} instr_ring_t;
+
+typedef struct {
+    int flags;
+    int nsites;
+    uint64_t sample_mask;
+    uint64_t bias;              // ticks subtracted from every sample
+    double cost_ticks, cost_cycles;
+    freq_ctx_t freq;
+    const char* names[INSTR_MAX_SITES];
+    instr_thread_t* threads;
+    // aggregator
+    pthread_t agg;
+    int agg_running;
+    volatile int agg_stop;
+    int interval_ms;
+    instr_ring_t* ring;
+    size_t ring_size;
+    uint64_t (*last)[HIST_BUCKETS + 4];
+} instr_global_t;
+
+__attribute__((weak)) instr_global_t instr__g;
+__attribute__((weak)) __thread instr_thread_t* instr__self;
+__attribute__((weak)) pthread_mutex_t instr__lock = PTHREAD_MUTEX_INITIALIZER;     // site registration
+__attribute__((weak)) pthread_key_t instr__key;
+__attribute__((weak)) pthread_once_t instr__key_once = PTHREAD_ONCE_INIT;
+
+// --- registration (cold paths) ---
+static inline void instr__register(instr_site_t* site) {
+    pthread_mutex_lock(&instr__lock);
+    if (site->id < 0) {
+        int id = instr__g.nsites < INSTR_MAX_SITES ? instr__g.nsites : INSTR_MAX_SITES;
+        if (id < INSTR_MAX_SITES) {
+            instr__g.names[id] = site->name;
+            __atomic_store_n(&instr__g.nsites, id + 1, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&instr__lock);
+}
+
+static inline void instr__release(void* self) {
+    instr_thread_t* t = (instr_thread_t*)self;
+    if (t->pmc) timer_close(&t->timer);
+    t->pmc = 0;
+    __atomic_store_n(&t->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static inline void instr__make_key(void) {
+    pthread_key_create(&instr__key, instr__release);
+}
+
+// Claim a free block or push a new one onto the lock-free list
+static inline instr_thread_t* instr__attach(void) {
+    instr_thread_t* t;
+    for (t = __atomic_load_n(&instr__g.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        int free_ = 0;
+        if (__atomic_compare_exchange_n(&t->in_use, &free_, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+    if (!t) {
+        t = (instr_thread_t*)calloc(1, sizeof(*t));
+        if (!t) return NULL;
+        t->in_use = 1;
+        t->next = __atomic_load_n(&instr__g.threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&instr__g.threads, &t->next, t, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    if (instr__g.flags & INSTR_PMC) {
+        timer_ctx_t tc;
+        if (timer_init(&tc, 1) == TIMER_PMC) {
+            t->timer = tc;
+            t->pmc = 1;
+        } else {
+            __atomic_fetch_and(&instr__g.flags, ~INSTR_PMC, __ATOMIC_RELAXED);     // say so once
+        }
+    }
+    pthread_once(&instr__key_once, instr__make_key);
+    pthread_setspecific(instr__key, t);
+    instr__self = t;
+    return t;
+}
+
+// --- hot path ---
+static inline uint64_t instr__tsc(void) {
+    if (instr__g.flags & INSTR_FENCES) {
+        _mm_lfence();
+        uint64_t v = __rdtsc();
+        _mm_lfence();
+        return v;
+    }
+    return __rdtsc();
+}
+
+static inline void instr__bump(uint64_t* p, uint64_t by) {
+    __atomic_store_n(p, *p + by, __ATOMIC_RELAXED);    // single writer
+}
+
+static inline void instr__record(instr_cell_t* c, uint64_t ticks, uint64_t pmc) {
+    uint64_t v = ticks > instr__g.bias ? ticks - instr__g.bias : 0;
+    instr__bump(&c->counts[hist_index(v)], 1);
+    instr__bump(&c->total, 1);
+    instr__bump(&c->sum, v);
+    if (pmc) instr__bump(&c->pmc_sum, pmc);
+}
+
+static inline instr_region_t instr_begin(instr_site_t* site) {
+    instr_region_t r = {NULL, 0, 0, 0};
+    instr_thread_t* self = instr__self;
+    if (__builtin_expect(site->id < 0, 0)) instr__register(site);
+    if (__builtin_expect(!self, 0) && !(self = instr__attach())) return r;
+    instr_cell_t* c = &self->cell[site->id];
+    uint64_t n = c->entered;
+    instr__bump(&c->entered, 1);
+    if (n & instr__g.sample_mask) return r;
+    r.cell = c;
+    if (self->pmc) {
+        r.pmc = (int)self->timer.pmc + 1;
+        r.p0 = __rdpmc(r.pmc - 1);
+    }
+    r.t0 = instr__tsc();
+    return r;
+}
+
+static inline void instr_end(instr_region_t* r) {
+    if (!r->cell) return;
+    uint64_t t1 = instr__tsc();
+    uint64_t pmc = r->pmc ? __rdpmc(r->pmc - 1) - r->p0 : 0;
+    instr__record(r->cell, t1 - r->t0, pmc);
+}
+
+#define INSTR__CAT2(a, b) a##b
+#define INSTR__CAT(a, b) INSTR__CAT2(a, b)
+
+// Time from here to the end of the enclosing block
+#define INSTR_SCOPE(name) \
+    static instr_site_t INSTR__CAT(instr__site_, __LINE__) = {name, -1}; \
+    instr_region_t INSTR__CAT(instr__region_, __LINE__) __attribute__((cleanup(instr_end))) = \
+        instr_begin(&INSTR__CAT(instr__site_, __LINE__))
+
+// --- calibration ---
+static int instr__cmp(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Bias and per-region cost of the current flags; returns the cost in core cycles
+static inline double instr_calibrate(void) {
+    static instr_site_t calib = {"instr.calibration", INSTR_MAX_SITES};
+    double s[INSTR_CALIB_BATCHES];
+    instr__g.bias = 0;
+    if (!instr__self && !instr__attach()) return -1;
+
+    // bias: what an empty region reads (timer_calibrate's median)
+    uint64_t* raw = (uint64_t*)malloc(TIMER_CALIB_SAMPLES * sizeof(uint64_t));
+    if (!raw) return -1;
+    for (int i = 0; i < TIMER_CALIB_SAMPLES; i++) {
+        uint64_t a = instr__tsc();
+        raw[i] = instr__tsc() - a;
+    }
+    qsort(raw, TIMER_CALIB_SAMPLES, sizeof(uint64_t), timer__cmp_u64);
+    instr__g.bias = raw[TIMER_CALIB_SAMPLES / 2];
+    free(raw);
+
+    // cost: serialized brackets around batches of back-to-back empty regions
+    for (int b = 0; b < INSTR_CALIB_BATCHES; b++) {
+        uint64_t t0 = timer_start_serial();
+        for (int i = 0; i < INSTR_CALIB_BATCH; i++) {
+            instr_region_t r = instr_begin(&calib);
+            __asm__ __volatile__ ("" ::: "memory");
+            instr_end(&r);
+        }
+        s[b] = (double)(timer_end_serial() - t0) / INSTR_CALIB_BATCH;
+    }
+    qsort(s, INSTR_CALIB_BATCHES, sizeof(double), instr__cmp);
+    instr__g.cost_ticks = s[INSTR_CALIB_BATCHES / 2];
+    instr__g.cost_cycles = instr__g.cost_ticks * instr__g.freq.ratio;
+    return instr__g.cost_cycles;
+}
+
+// --- aggregation ---
+static inline void instr__snapshot(int site, uint64_t* out) {
+    memset(out, 0, (HIST_BUCKETS + 4) * sizeof(uint64_t));
+    for (instr_thread_t* t = __atomic_load_n(&instr__g.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        const instr_cell_t* c = &t->cell[site];
+        for (int i = 0; i < HIST_BUCKETS; i++) out[i] += __atomic_load_n(&c->counts[i], __ATOMIC_RELAXED);
+        out[HIST_BUCKETS] += __atomic_load_n(&c->total, __ATOMIC_RELAXED);
+        out[HIST_BUCKETS + 1] += __atomic_load_n(&c->sum, __ATOMIC_RELAXED);
+        out[HIST_BUCKETS + 2] += __atomic_load_n(&c->pmc_sum, __ATOMIC_RELAXED);
+        out[HIST_BUCKETS + 3] += __atomic_load_n(&c->entered, __ATOMIC_RELAXED);
+    }
+}
+
+// Append every site's counts since the previous drain to the ring
+static inline void instr_drain(void) {
+    instr_ring_t* ring = instr__g.ring;
+    uint64_t now[HIST_BUCKETS + 4];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int n = __atomic_load_n(&instr__g.nsites, __ATOMIC_ACQUIRE);
+    for (int s = 0; s < n && ring; s++) {
+        instr__snapshot(s, now);
+        uint64_t* last = instr__g.last[s];
+        if (now[HIST_BUCKETS + 3] == last[HIST_BUCKETS + 3]) continue;
+        uint64_t seq = ring->head;
+        instr_record_t* r = &ring->rec[seq % ring->capacity];
+        __atomic_store_n(&r->seq, 2 * seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        r->t_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        r->site = (uint32_t)s;
+        snprintf(r->name, sizeof(r->name), "%s", instr__g.names[s]);
+        for (int i = 0; i < HIST_BUCKETS; i++) r->counts[i] = now[i] - last[i];
+        r->total = now[HIST_BUCKETS] - last[HIST_BUCKETS];
+        r->sum = now[HIST_BUCKETS + 1] - last[HIST_BUCKETS + 1];
+        r->pmc_sum = now[HIST_BUCKETS + 2] - last[HIST_BUCKETS + 2];
+        r->entered = now[HIST_BUCKETS + 3] - last[HIST_BUCKETS + 3];
+        __atomic_store_n(&r->seq, 2 * seq + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->head, seq + 1, __ATOMIC_RELEASE);
+        memcpy(last, now, sizeof(now));
+    }
+}
+
+static inline void* instr__aggregator(void* arg) {
+    (void)arg;
+    while (!instr__g.agg_stop) {
+        struct timespec d = {instr__g.interval_ms / 1000, (instr__g.interval_ms % 1000) * 1000000L};
+        nanosleep(&d, NULL);
+        instr_drain();
+    }
+    return NULL;
+}
+
+// Create the ring /dev/shm/<shm_name> and drain into it every interval_ms; 0 on success
+static inline int instr_start(const char* shm_name, int interval_ms) {
+    size_t size = sizeof(instr_ring_t) + INSTR_RING_RECORDS * sizeof(instr_record_t);
+    int fd = shm_open(shm_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("instr: shm_open");
+        return -1;
+    }
+    void* p = ftruncate(fd, (off_t)size) == 0 ?
+              mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    instr__g.last = (uint64_t(*)[HIST_BUCKETS + 4])calloc(INSTR_MAX_SITES, sizeof(*instr__g.last));
+    if (p == MAP_FAILED || !instr__g.last) {
+        perror("instr: ring");
+        if (p != MAP_FAILED) munmap(p, size);
+        free(instr__g.last);
+        instr__g.last = NULL;
+        return -1;
+    }
+    instr_ring_t* ring = (instr_ring_t*)p;
+    ring->record_size = sizeof(instr_record_t);
+    ring->capacity = INSTR_RING_RECORDS;
+    ring->ticks_per_ns = instr__g.freq.tsc_ghz;
+    ring->bias = (double)instr__g.bias;
+    ring->cost_cycles = instr__g.cost_cycles;
+    ring->sample_shift = (uint32_t)__builtin_popcountll(instr__g.sample_mask);
+    memcpy(ring->magic, INSTR_RING_MAGIC, 8);       // last: readers check it
+    instr__g.ring = ring;
+    instr__g.ring_size = size;
+    instr__g.interval_ms = interval_ms > 0 ? interval_ms : 1000;
+    instr__g.agg_stop = 0;
+    if (pthread_create(&instr__g.agg, NULL, instr__aggregator, NULL) != 0) return -1;
+    instr__g.agg_running = 1;
+    return 0;
+}
+
+// Stop the aggregator after a final drain and unmap the ring (the shm object stays)
+static inline void instr_stop(void) {
+    if (instr__g.agg_running) {
+        instr__g.agg_stop = 1;
+        pthread_join(instr__g.agg, NULL);
+        instr__g.agg_running = 0;
+    }
+    instr_drain();
+    if (instr__g.ring) munmap(instr__g.ring, instr__g.ring_size);
+    free(instr__g.last);
+    instr__g.ring = NULL;
+    instr__g.last = NULL;
+}
+
+// Select flags, measure the clock and the instrumentation cost
+static inline void instr_init(int flags) {
+    instr__g.flags = flags & (INSTR_FENCES | INSTR_PMC);
+    instr__g.sample_mask = (1ull << ((flags >> 8) & 31)) - 1;
+    freq_init(&instr__g.freq, 0);
+    instr_calibrate();
+}
+
+static inline void instr_print_overhead(FILE* out) {
+    fprintf(out, "instr: %.1f cycles (%.1f ticks) per region, timing 1 in %llu, %llu ticks bias, "
+            "fences %s, rdpmc %s\n", instr__g.cost_cycles, instr__g.cost_ticks,
+            (unsigned long long)instr__g.sample_mask + 1, (unsigned long long)instr__g.bias,
+            instr__g.flags & INSTR_FENCES ? "on" : "off",
+            instr__self && instr__self->pmc ? "on" : "off");
+}
+
+// --- reading the ring from another process ---
+typedef struct {
+    const instr_ring_t* ring;
+    size_t size;
+    uint64_t next;              // next record to read
+    uint64_t lost;              // overwritten before they were read
+} instr_reader_t;
+
+static inline int instr_ring_attach(instr_reader_t* rd, const char* shm_name) {
+    memset(rd, 0, sizeof(*rd));
+    int fd = shm_open(shm_name, O_RDONLY, 0);
+    struct stat st;
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(instr_ring_t)) {
+        close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    rd->ring = (const instr_ring_t*)p;
+    rd->size = (size_t)st.st_size;
+    if (memcmp(rd->ring->magic, INSTR_RING_MAGIC, 8) || rd->ring->record_size != sizeof(instr_record_t)) {
+        munmap(p, rd->size);
+        rd->ring = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Copy the next complete record; 1 if one was read, 0 if none is ready
+static inline int instr_ring_next(instr_reader_t* rd, instr_record_t* out) {
+    const instr_ring_t* ring = rd->ring;
+    for (;;) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (rd->next >= head) return 0;
+        if (head - rd->next > ring->capacity) {
+            rd->lost += head - ring->capacity - rd->next;
+            rd->next = head - ring->capacity;
+        }
+        const instr_record_t* r = &ring->rec[rd->next % ring->capacity];
+        uint64_t want = 2 * rd->next + 2;
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) == want) {
+            memcpy(out, r, sizeof(*out));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&r->seq, __ATOMIC_RELAXED) == want) {
+                rd->next++;
+                return 1;
+            }
+        }
+        rd->lost++;             // overwritten while we looked
+        rd->next++;
+    }
+}
+
+static inline void instr_ring_detach(instr_reader_t* rd) {
+    if (rd->ring) munmap((void*)rd->ring, rd->size);
+    rd->ring = NULL;
+}
+
+#endif // UARCH_INSTR_H
@@ -0,0 +1,238 @@
+/*
+  Minimal x86-64 code emitter shared by the JIT-based probes.
+
+  Same idea as the ADD_BYTE/ADD_DWORD macros in prf_size.c, wrapped in a
+  small struct so several routines can be generated into one buffer.
+  Register numbers follow the hardware encoding (rax=0 ... r15=15).
+*/
+#ifndef UARCH_JIT_H
+#define UARCH_JIT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+enum {
+    JIT_RAX = 0, JIT_RCX, JIT_RDX, JIT_RBX, JIT_RSP, JIT_RBP, JIT_RSI, JIT_RDI,
+    JIT_R8, JIT_R9, JIT_R10, JIT_R11, JIT_R12, JIT_R13, JIT_R14, JIT_R15
+};
+
+typedef struct {
+    unsigned char* buf;
+    size_t pos;
+    size_t cap;
+} jit_t;
+
+// Allocate an RWX buffer; MAP_NORESERVE so sparse layouts only commit touched pages
+static inline unsigned char* jit_alloc(size_t size) {
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap (jit)");
+        return NULL;
+    }
+    return (unsigned char*)p;
+}
+
+static inline void jit_release(unsigned char* buf, size_t size) {
+    if (buf) munmap(buf, size);
+}
+
+static inline void jit_init(jit_t* j, unsigned char* buf, size_t cap) {
+    j->buf = buf;
+    j->pos = 0;
+    j->cap = cap;
+}
+
+static inline unsigned char* jit_here(const jit_t* j) { return j->buf + j->pos; }
+
+static inline void jit_check(jit_t* j, size_t n) {
+    if (j->pos + n > j->cap) {
+        fprintf(stderr, "jit: code buffer overflow (%zu/%zu)\n", j->pos + n, j->cap);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline void jit_byte(jit_t* j, uint8_t v)   { jit_check(j, 1); j->buf[j->pos++] = v; }
+static inline void jit_dword(jit_t* j, uint32_t v) { jit_check(j, 4); memcpy(j->buf + j->pos, &v, 4); j->pos += 4; }
+static inline void jit_qword(jit_t* j, uint64_t v) { jit_check(j, 8); memcpy(j->buf + j->pos, &v, 8); j->pos += 8; }
+
+// Move the cursor to an absolute offset (used for spaced layouts)
+static inline void jit_seek(jit_t* j, size_t pos) {
+    jit_check(j, pos > j->pos ? pos - j->pos : 0);
+    j->pos = pos;
+}
+
+// Pad with single-byte NOPs up to the next multiple of align
+static inline void jit_align(jit_t* j, size_t align) {
+    while (((uintptr_t)(j->buf + j->pos)) % align) jit_byte(j, 0x90);
+}
+
+// Patch a rel32 field at fixup so that it lands on target (offsets into buf)
+static inline void jit_patch_rel32(jit_t* j, size_t fixup, size_t target) {
+    int32_t rel = (int32_t)((int64_t)target - (int64_t)(fixup + 4));
+    memcpy(j->buf + fixup, &rel, 4);
+}
+
+// --- Common instructions ---
+
+static inline void jit_rex_w(jit_t* j, int reg, int rm) {
+    jit_byte(j, 0x48 | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0));
+}
+
+static inline void jit_modrm_mem(jit_t* j, int reg, int base, int32_t disp) {
+    // [base + disp32]; rsp/r12 need a SIB byte
+    jit_byte(j, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == JIT_RSP) jit_byte(j, 0x24);
+    jit_dword(j, (uint32_t)disp);
+}
+
+// mov reg, imm64
+static inline void jit_mov_imm64(jit_t* j, int reg, uint64_t imm) {
+    jit_byte(j, 0x48 | ((reg & 8) ? 1 : 0));
+    jit_byte(j, 0xB8 | (reg & 7));
+    jit_qword(j, imm);
+}
+
+// mov dst, src (64-bit)
+static inline void jit_mov_rr(jit_t* j, int dst, int src) {
+    jit_rex_w(j, src, dst);
+    jit_byte(j, 0x89);
+    jit_byte(j, 0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+// mov dst, [base + disp] (64-bit load)
+static inline void jit_load64(jit_t* j, int dst, int base, int32_t disp) {
+    jit_rex_w(j, dst, base);
+    jit_byte(j, 0x8B);
+    jit_modrm_mem(j, dst, base, disp);
+}
+
+// mov [base + disp], src (64-bit store)
+static inline void jit_store64(jit_t* j, int base, int32_t disp, int src) {
+    jit_rex_w(j, src, base);
+    jit_byte(j, 0x89);
+    jit_modrm_mem(j, src, base, disp);
+}
+
+// --- [base + index*2^scale + disp32] operands (index = JIT_NO_INDEX for none; rsp is not an index) ---
+#define JIT_NO_INDEX (-1)
+
+static inline void jit_rex_mem(jit_t* j, int w, int reg, int base, int index) {
+    uint8_t rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0)
+                | ((index >= 0 && (index & 8)) ? 2 : 0) | ((base & 8) ? 1 : 0);
+    if (rex != 0x40) jit_byte(j, rex);
+}
+
+static inline void jit_modrm_idx(jit_t* j, int reg, int base, int index, int scale, int32_t disp) {
+    if (index < 0) {
+        jit_modrm_mem(j, reg, base, disp);
+        return;
+    }
+    jit_byte(j, 0x84 | ((reg & 7) << 3));
+    jit_byte(j, (uint8_t)((scale << 6) | ((index & 7) << 3) | (base & 7)));
+    jit_dword(j, (uint32_t)disp);
+}
+
+// mov dst, qword [mem]
+static inline void jit_load64_idx(jit_t* j, int dst, int base, int index, int scale, int32_t disp) {
+    jit_rex_mem(j, 1, dst, base, index);
+    jit_byte(j, 0x8B);
+    jit_modrm_idx(j, dst, base, index, scale, disp);
+}
+
+// mov dst32, dword [mem] (zero-extends)
+static inline void jit_load32_idx(jit_t* j, int dst, int base, int index, int scale, int32_t disp) {
+    jit_rex_mem(j, 0, dst, base, index);
+    jit_byte(j, 0x8B);
+    jit_modrm_idx(j, dst, base, index, scale, disp);
+}
+
+// movzx dst32, byte [mem]
+static inline void jit_load8_idx(jit_t* j, int dst, int base, int index, int scale, int32_t disp) {
+    jit_rex_mem(j, 0, dst, base, index);
+    jit_byte(j, 0x0F); jit_byte(j, 0xB6);
+    jit_modrm_idx(j, dst, base, index, scale, disp);
+}
+
+// mov qword [mem], src
+static inline void jit_store64_idx(jit_t* j, int base, int index, int scale, int32_t disp, int src) {
+    jit_rex_mem(j, 1, src, base, index);
+    jit_byte(j, 0x89);
+    jit_modrm_idx(j, src, base, index, scale, disp);
+}
+
+// mov byte [mem], src8 (al/cl/dl/bl or r8b-r15b)
+static inline void jit_store8_idx(jit_t* j, int base, int index, int scale, int32_t disp, int src) {
+    jit_rex_mem(j, 0, src, base, index);
+    jit_byte(j, 0x88);
+    jit_modrm_idx(j, src, base, index, scale, disp);
+}
+
+// add byte/qword [mem], imm8 (width 1 or 8)
+static inline void jit_add_mem_imm8(jit_t* j, int width, int base, int index, int scale, int32_t disp, int8_t imm) {
+    jit_rex_mem(j, width == 8, 0, base, index);
+    jit_byte(j, width == 8 ? 0x83 : 0x80);
+    jit_modrm_idx(j, 0, base, index, scale, disp);
+    jit_byte(j, (uint8_t)imm);
+}
+
+// movnti qword [mem], src
+static inline void jit_movnti64_idx(jit_t* j, int base, int index, int scale, int32_t disp, int src) {
+    jit_rex_mem(j, 1, src, base, index);
+    jit_byte(j, 0x0F); jit_byte(j, 0xC3);
+    jit_modrm_idx(j, src, base, index, scale, disp);
+}
+
+// add reg, imm32 (sign-extended)
+static inline void jit_add_imm(jit_t* j, int reg, int32_t imm) {
+    jit_rex_w(j, 0, reg);
+    jit_byte(j, 0x81);
+    jit_byte(j, 0xC0 | (reg & 7));
+    jit_dword(j, (uint32_t)imm);
+}
+
+// dec reg (64-bit)
+static inline void jit_dec(jit_t* j, int reg) {
+    jit_rex_w(j, 0, reg);
+    jit_byte(j, 0xFF);
+    jit_byte(j, 0xC8 | (reg & 7));
+}
+
+// jnz rel32 back to an offset already emitted
+static inline void jit_jnz_back(jit_t* j, size_t target) {
+    jit_byte(j, 0x0F); jit_byte(j, 0x85);
+    size_t fix = j->pos;
+    jit_dword(j, 0);
+    jit_patch_rel32(j, fix, target);
+}
+
+// jmp rel32 to an arbitrary offset (returns fixup position)
+static inline size_t jit_jmp_rel32(jit_t* j, size_t target) {
+    jit_byte(j, 0xE9);
+    size_t fix = j->pos;
+    jit_dword(j, 0);
+    jit_patch_rel32(j, fix, target);
+    return fix;
+}
+
+// push/pop for callee-saved registers
+static inline void jit_push(jit_t* j, int reg) {
+    if (reg & 8) jit_byte(j, 0x41);
+    jit_byte(j, 0x50 | (reg & 7));
+}
+
+static inline void jit_pop(jit_t* j, int reg) {
+    if (reg & 8) jit_byte(j, 0x41);
+    jit_byte(j, 0x58 | (reg & 7));
+}
+
+static inline void jit_ret(jit_t* j) { jit_byte(j, 0xC3); }
+
+static inline void jit_finish(jit_t* j) {
+    __builtin___clear_cache((char*)j->buf, (char*)j->buf + j->pos);
+}
+
+#endif // UARCH_JIT_H
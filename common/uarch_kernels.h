@@ -0,0 +1,194 @@
+/*
+  JIT'd memory access kernels for the cache and prefetch probes.
+
+  A C loop such as `buf[(i * st) % n]` or `array[(i*stride) & mask]++`
+  measures whatever the compiler emits around the access: here a 64-bit
+  divide, elsewhere volatile spills that change with -O level. These
+  kernels are generated at run time so the hot loop is fixed: KERN_UNROLL
+  copies of the access followed by one counter decrement and branch.
+
+    kern_strided  op [cursor + k*stride]; cursor += UNROLL*stride
+                  one pass touches `count` slots from base, then restarts
+    kern_gather   op [base + table[k]] with uint32 byte offsets; the
+                  sequential offset read is the only extra memory op
+    kern_chase    mov rax, [rax]            (pointer chase), or
+                  mov rax, [base + rax*8]   (index chase, KERN_CHASE_INDEX)
+
+  Every kernel is called as kern_run(k, base, aux, reps) and performs
+  reps * k->per_rep accesses. aux is the offset table for gather and the
+  start index for an index chase. Zero-initialize a kern_t; rebuilding
+  one reuses its code buffer.
+*/
+#ifndef UARCH_KERNELS_H
+#define UARCH_KERNELS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "uarch_jit.h"
+
+#define KERN_UNROLL 16
+#define KERN_CODE_SIZE 4096
+
+enum { KERN_LOAD, KERN_STORE, KERN_RMW, KERN_NT };
+enum { KERN_CHASE_PTR, KERN_CHASE_INDEX };
+
+typedef uint64_t (*kern_fn_t)(void* base, const void* aux, uint64_t reps);
+
+typedef struct {
+    unsigned char* code;
+    kern_fn_t fn;
+    size_t per_rep;     // memory accesses per rep
+} kern_t;
+
+static inline int kern__alloc(kern_t* k) {
+    if (!k->code) {
+        k->code = jit_alloc(KERN_CODE_SIZE);
+        if (!k->code) return -1;
+    }
+    k->fn = (kern_fn_t)k->code;
+    return 0;
+}
+
+// One access of the given op/width; rax is the data register
+static inline void kern__op(jit_t* j, int op, int width, int base, int index, int32_t disp) {
+    switch (op) {
+        case KERN_LOAD:
+            if (width == 1) jit_load8_idx(j, JIT_RAX, base, index, 0, disp);
+            else jit_load64_idx(j, JIT_RAX, base, index, 0, disp);
+            break;
+        case KERN_STORE:
+            if (width == 1) jit_store8_idx(j, base, index, 0, disp, JIT_RAX);
+            else jit_store64_idx(j, base, index, 0, disp, JIT_RAX);
+            break;
+        case KERN_RMW:
+            jit_add_mem_imm8(j, width, base, index, 0, disp, 1);
+            break;
+        case KERN_NT:
+            jit_movnti64_idx(j, base, index, 0, disp, JIT_RAX);
+            break;
+    }
+}
+
+static inline int kern__check(int op, int width) {
+    if ((width != 1 && width != 8) || (op == KERN_NT && width != 8)) {
+        fprintf(stderr, "kern: unsupported op %d at width %d\n", op, width);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void kern__epilogue(jit_t* j, int op) {
+    if (op == KERN_NT) { jit_byte(j, 0x0F); jit_byte(j, 0xAE); jit_byte(j, 0xF8); }  // sfence
+    jit_ret(j);
+    jit_finish(j);
+}
+
+// Strided walk of `count` slots per rep, width 1 or 8 bytes; 0 on success
+static inline int kern_strided(kern_t* k, int op, int width, size_t stride, size_t count) {
+    if (kern__check(op, width) || !count) return -1;
+    if (stride * KERN_UNROLL > INT32_MAX) {
+        fprintf(stderr, "kern: stride %zu too large for disp32\n", stride);
+        return -1;
+    }
+    if (kern__alloc(k)) return -1;
+    jit_t j;
+    jit_init(&j, k->code, KERN_CODE_SIZE);
+
+    // rdi = base, rdx = reps -> r8; rdx = cursor, rcx = inner count
+    jit_mov_rr(&j, JIT_R8, JIT_RDX);
+    jit_mov_imm64(&j, JIT_RAX, 0);
+    jit_align(&j, 16);
+    size_t outer = j.pos;
+    jit_mov_rr(&j, JIT_RDX, JIT_RDI);
+    size_t blocks = count / KERN_UNROLL;
+    if (blocks) {
+        jit_mov_imm64(&j, JIT_RCX, blocks);
+        jit_align(&j, 16);
+        size_t inner = j.pos;
+        for (int u = 0; u < KERN_UNROLL; u++)
+            kern__op(&j, op, width, JIT_RDX, JIT_NO_INDEX, (int32_t)(u * stride));
+        jit_add_imm(&j, JIT_RDX, (int32_t)(KERN_UNROLL * stride));
+        jit_dec(&j, JIT_RCX);
+        jit_jnz_back(&j, inner);
+    }
+    for (size_t u = 0; u < count % KERN_UNROLL; u++)
+        kern__op(&j, op, width, JIT_RDX, JIT_NO_INDEX, (int32_t)(u * stride));
+    jit_dec(&j, JIT_R8);
+    jit_jnz_back(&j, outer);
+    kern__epilogue(&j, op);
+    k->per_rep = count;
+    return 0;
+}
+
+// Table-driven walk of `count` uint32 byte offsets per rep (8-byte ops)
+static inline int kern_gather(kern_t* k, int op, size_t count) {
+    if (kern__check(op, 8) || !count) return -1;
+    if (kern__alloc(k)) return -1;
+    jit_t j;
+    jit_init(&j, k->code, KERN_CODE_SIZE);
+
+    // rdi = base, rsi = table, rdx = reps -> r8; rdx = table cursor, r9 = inner count
+    jit_mov_rr(&j, JIT_R8, JIT_RDX);
+    jit_mov_imm64(&j, JIT_RAX, 0);
+    jit_align(&j, 16);
+    size_t outer = j.pos;
+    jit_mov_rr(&j, JIT_RDX, JIT_RSI);
+    size_t blocks = count / KERN_UNROLL;
+    if (blocks) {
+        jit_mov_imm64(&j, JIT_R9, blocks);
+        jit_align(&j, 16);
+        size_t inner = j.pos;
+        for (int u = 0; u < KERN_UNROLL; u++) {
+            jit_load32_idx(&j, JIT_RCX, JIT_RDX, JIT_NO_INDEX, 0, u * 4);
+            kern__op(&j, op, 8, JIT_RDI, JIT_RCX, 0);
+        }
+        jit_add_imm(&j, JIT_RDX, KERN_UNROLL * 4);
+        jit_dec(&j, JIT_R9);
+        jit_jnz_back(&j, inner);
+    }
+    for (size_t u = 0; u < count % KERN_UNROLL; u++) {
+        jit_load32_idx(&j, JIT_RCX, JIT_RDX, JIT_NO_INDEX, 0, (int32_t)(u * 4));
+        kern__op(&j, op, 8, JIT_RDI, JIT_RCX, 0);
+    }
+    jit_dec(&j, JIT_R8);
+    jit_jnz_back(&j, outer);
+    kern__epilogue(&j, op);
+    k->per_rep = count;
+    return 0;
+}
+
+// Dependent chase, KERN_UNROLL hops per rep; returns the final pointer/index
+static inline int kern_chase(kern_t* k, int mode) {
+    if (kern__alloc(k)) return -1;
+    jit_t j;
+    jit_init(&j, k->code, KERN_CODE_SIZE);
+
+    // Pointer: rax = base. Index: rax = aux (start index), rdi = array
+    jit_mov_rr(&j, JIT_RAX, mode == KERN_CHASE_INDEX ? JIT_RSI : JIT_RDI);
+    jit_align(&j, 16);
+    size_t loop = j.pos;
+    for (int u = 0; u < KERN_UNROLL; u++) {
+        if (mode == KERN_CHASE_INDEX) jit_load64_idx(&j, JIT_RAX, JIT_RDI, JIT_RAX, 3, 0);
+        else jit_load64(&j, JIT_RAX, JIT_RAX, 0);
+    }
+    jit_dec(&j, JIT_RDX);
+    jit_jnz_back(&j, loop);
+    jit_ret(&j);
+    jit_finish(&j);
+    k->per_rep = KERN_UNROLL;
+    return 0;
+}
+
+static inline uint64_t kern_run(const kern_t* k, void* base, const void* aux, uint64_t reps) {
+    return reps ? k->fn(base, aux, reps) : 0;
+}
+
+static inline void kern_free(kern_t* k) {
+    jit_release(k->code, KERN_CODE_SIZE);
+    k->code = NULL;
+    k->fn = NULL;
+}
+
+#endif // UARCH_KERNELS_H
@@ -0,0 +1,328 @@
+/*
+  OS-noise isolation for the timed windows of the probes.
+
+  The probes pin themselves to one CPU (cpu_pick() of uarch_cpu.h), and
+  nothing notices when a context switch, IRQ or SMI lands inside a timed
+  window. With isolation enabled:
+
+    noise_init()    picks a quiet CPU and pins to it: the first of
+                    /sys/devices/system/cpu/isolated, then nohz_full, else
+                    the allowed CPU with the fewest interrupts so far
+                    (CPU 0 only if it is the only choice)
+    NOISE_SAMPLE()  brackets a timed statement with interference checks
+                    and re-runs it while the window was contaminated:
+                      - voluntary / involuntary context switches
+                        (getrusage(RUSAGE_THREAD))
+                      - interrupts on our CPU (/proc/interrupts column);
+                        the local timer tick (LOC) is only counted on a
+                        nohz_full CPU, elsewhere it lands in every window
+                        longer than a tick and is a fixed, small bias
+                      - SMIs (MSR_SMI_COUNT 0x34 via /dev/cpu/N/msr,
+                        needs root and the msr module; skipped otherwise)
+                      - CFS throttling of our cgroup (cpu.stat
+                        nr_throttled, see uarch_cpu.h): the window
+                        measured the quota rather than the core
+    noise_floor()   a sysjitter-style loop that reads the TSC back to back
+                    and counts the gaps above a threshold: the fraction of
+                    time the host steals from a pinned thread
+    noise_report()  redo counts per cause
+
+  The checks run outside the timed region. A zero-initialized noise_ctx_t
+  is disabled: NOISE_SAMPLE then runs the statement once with no checks,
+  so probes can wrap their windows unconditionally.
+*/
+#ifndef UARCH_NOISE_H
+#define UARCH_NOISE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <x86intrin.h>
+
+#include "uarch_cpu.h"
+
+#ifndef NOISE_MAX_RETRIES
+#define NOISE_MAX_RETRIES 8
+#endif
+#define NOISE_MSR_SMI_COUNT 0x34
+#define NOISE_IRQ_BUF (256 * 1024)
+#define NOISE_GAP_NS 1000       // noise_floor: gaps longer than this are interference
+
+enum { NOISE_VCSW, NOISE_IVCSW, NOISE_IRQ, NOISE_SMI, NOISE_THROTTLE, NOISE_NUM_CAUSES };
+
+typedef struct {
+    int enabled;
+    int cpu;
+    const char* why;    // how the CPU was picked
+    int msr_fd;         // -1 without MSR access
+    int irq_fd;         // /proc/interrupts, -1 if unreadable
+    int irq_col;        // our column in /proc/interrupts
+    int count_tick;     // count LOC too (tickless CPU)
+    cpu_stat_t stat;    // cgroup cpu.stat, fd -1 without a CPU controller
+    char* irq_buf;
+    uint64_t samples, redone, gave_up;
+    uint64_t causes[NOISE_NUM_CAUSES];
+} noise_ctx_t;
+
+typedef struct {
+    long nvcsw, nivcsw;
+    uint64_t irqs, smi;
+    cpu_throttle_t throttle;
+} noise_snap_t;
+
+typedef struct {
+    double seconds;
+    double stolen_frac;     // fraction of wall time in gaps
+    double max_gap_us;
+    double events_per_s;
+} noise_floor_t;
+
+// Column of `cpu` in the /proc/interrupts header, or -1
+static inline int noise__irq_column(const char* header, int cpu) {
+    char want[32];
+    snprintf(want, sizeof(want), "CPU%d", cpu);
+    int col = 0;
+    for (const char* p = header; *p && *p != '\n';) {
+        while (*p == ' ') p++;
+        if (!*p || *p == '\n') break;
+        size_t len = strcspn(p, " \n");
+        if (len == strlen(want) && !strncmp(p, want, len)) return col;
+        col++;
+        p += len;
+    }
+    return -1;
+}
+
+static inline ssize_t noise__read_irqs(noise_ctx_t* n) {
+    ssize_t len = pread(n->irq_fd, n->irq_buf, NOISE_IRQ_BUF - 1, 0);
+    if (len < 0) return -1;
+    n->irq_buf[len] = '\0';
+    return len;
+}
+
+// Interrupts taken by column `col` so far, summed over every source line
+static inline uint64_t noise__irq_sum(const char* text, int col, int count_tick) {
+    uint64_t total = 0;
+    const char* line = strchr(text, '\n');      // skip the header
+    while (line && *++line) {
+        const char* p = strchr(line, ':');
+        const char* eol = strchr(line, '\n');
+        if (!p || (eol && p > eol)) { line = eol; continue; }
+        if (!count_tick && p - line >= 3 && !strncmp(p - 3, "LOC", 3)) { line = eol; continue; }
+        p++;
+        for (int c = 0; c <= col; c++) {
+            char* end;
+            unsigned long long v = strtoull(p, &end, 10);
+            if (end == p) break;    // rows like ERR/MIS have one column
+            if (c == col) total += v;
+            p = end;
+        }
+        line = eol;
+    }
+    return total;
+}
+
+static inline int noise__try_pin(int cpu) {
+    cpu_set_t set;
+    cpu__origin(&set, 1);
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+static inline int noise__first(const cpu_set_t* set) {
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, set) && noise__try_pin(c) == 0) return c;
+    return -1;
+}
+
+// Pick and pin the quietest CPU; returns it, or -1
+static inline int noise_pick_cpu(noise_ctx_t* n) {
+    cpu_set_t set;
+    int cpu;
+    if (cpu_read_list("/sys/devices/system/cpu/isolated", &set) &&
+        (cpu = noise__first(&set)) >= 0) {
+        n->why = "isolated";
+        return cpu;
+    }
+    if (cpu_read_list("/sys/devices/system/cpu/nohz_full", &set) &&
+        (cpu = noise__first(&set)) >= 0) {
+        n->why = "nohz_full";
+        return cpu;
+    }
+
+    // Least-interrupted allowed CPU, preferring anything over CPU 0
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+    int best = -1;
+    uint64_t best_irqs = UINT64_MAX;
+    int have_irqs = n->irq_fd >= 0 && noise__read_irqs(n) > 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &set)) continue;
+        int col = have_irqs ? noise__irq_column(n->irq_buf, c) : -1;
+        uint64_t irqs = col >= 0 ? noise__irq_sum(n->irq_buf, col, 1) : UINT64_MAX - 1;
+        if (c == 0 && CPU_COUNT(&set) > 1) irqs = UINT64_MAX - 1;
+        if (best < 0 || irqs < best_irqs) {
+            best = c;
+            best_irqs = irqs;
+        }
+    }
+    if (best < 0 || noise__try_pin(best) != 0) return -1;
+    n->why = have_irqs ? "fewest interrupts" : "first allowed";
+    return best;
+}
+
+static inline int noise__read_smi(const noise_ctx_t* n, uint64_t* v) {
+    return n->msr_fd >= 0 && pread(n->msr_fd, v, sizeof(*v), NOISE_MSR_SMI_COUNT) == sizeof(*v);
+}
+
+// Enable isolation: pick/pin a CPU and open the counters; 0 on success
+static inline int noise_init(noise_ctx_t* n) {
+    memset(n, 0, sizeof(*n));
+    n->msr_fd = -1;
+    n->irq_col = -1;
+    cpu_stat_open(&n->stat, NULL, 0);
+    n->irq_fd = open("/proc/interrupts", O_RDONLY);
+    n->irq_buf = (char*)malloc(NOISE_IRQ_BUF);
+    if (!n->irq_buf) return -1;
+    n->cpu = noise_pick_cpu(n);
+    if (n->cpu < 0) {
+        fprintf(stderr, "noise: could not pin to any CPU\n");
+        return -1;
+    }
+    if (n->irq_fd >= 0 && noise__read_irqs(n) > 0)
+        n->irq_col = noise__irq_column(n->irq_buf, n->cpu);
+    cpu_set_t nohz;
+    n->count_tick = cpu_read_list("/sys/devices/system/cpu/nohz_full", &nohz) &&
+                    CPU_ISSET(n->cpu, &nohz);
+
+    char path[64];
+    uint64_t v;
+    snprintf(path, sizeof(path), "/dev/cpu/%d/msr", n->cpu);
+    n->msr_fd = open(path, O_RDONLY);
+    if (n->msr_fd >= 0 && !noise__read_smi(n, &v)) {
+        close(n->msr_fd);
+        n->msr_fd = -1;
+    }
+    n->enabled = 1;
+    printf("noise: pinned to CPU %d (%s); checking csw%s%s%s\n", n->cpu, n->why,
+           n->irq_col < 0 ? "" : n->count_tick ? ", irqs" : ", irqs except the tick",
+           n->stat.fd >= 0 ? ", cfs throttling" : "",
+           n->msr_fd >= 0 ? ", smi" : " (no MSR access for SMIs)");
+    return 0;
+}
+
+static inline void noise_snap(noise_ctx_t* n, noise_snap_t* s) {
+    if (!n->enabled) return;
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    s->nvcsw = ru.ru_nvcsw;
+    s->nivcsw = ru.ru_nivcsw;
+    s->irqs = n->irq_col >= 0 && noise__read_irqs(n) > 0 ? noise__irq_sum(n->irq_buf, n->irq_col, n->count_tick) : 0;
+    s->smi = 0;
+    noise__read_smi(n, &s->smi);
+    cpu_throttle_read(&n->stat, &s->throttle);
+}
+
+// Compare against the snapshot taken before the window; 1 if it was clean
+static inline int noise_clean(noise_ctx_t* n, const noise_snap_t* before) {
+    if (!n->enabled) return 1;
+    noise_snap_t after;
+    noise_snap(n, &after);
+    int hit[NOISE_NUM_CAUSES] = {
+        after.nvcsw != before->nvcsw,
+        after.nivcsw != before->nivcsw,
+        after.irqs != before->irqs,
+        after.smi != before->smi,
+        after.throttle.nr_throttled != before->throttle.nr_throttled,
+    };
+    int dirty = 0;
+    for (int c = 0; c < NOISE_NUM_CAUSES; c++) {
+        n->causes[c] += hit[c];
+        dirty |= hit[c];
+    }
+    n->samples++;
+    n->redone += dirty;
+    return !dirty;
+}
+
+// Run `stmt` (a timed window) until it completes without interference,
+// at most NOISE_MAX_RETRIES times; the last attempt is kept either way
+#define NOISE_SAMPLE(n, stmt) do {                                          \
+    noise_snap_t noise_s__;                                                 \
+    int noise_try__ = 0;                                                    \
+    for (;;) {                                                              \
+        noise_snap((n), &noise_s__);                                        \
+        stmt;                                                               \
+        if (noise_clean((n), &noise_s__)) break;                            \
+        if (++noise_try__ == NOISE_MAX_RETRIES) { (n)->gave_up++; break; }  \
+    }                                                                       \
+} while (0)
+
+// Back-to-back TSC reads for `seconds`; gaps over NOISE_GAP_NS are time
+// the kernel, interrupts or SMM took from this CPU
+static inline void noise_floor(double seconds, noise_floor_t* out) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t start = __rdtsc();
+
+    // TSC ticks per ns from a short calibration spin
+    uint64_t c0 = __rdtsc();
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    do clock_gettime(CLOCK_MONOTONIC, &b);
+    while ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec) < 1e7);
+    double ticks_per_ns = (double)(__rdtsc() - c0) /
+                          ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec));
+    uint64_t gap_ticks = (uint64_t)(NOISE_GAP_NS * ticks_per_ns);
+    uint64_t end = start + (uint64_t)(seconds * 1e9 * ticks_per_ns);
+
+    uint64_t prev = __rdtsc(), stolen = 0, max_gap = 0, events = 0;
+    while (prev < end) {
+        uint64_t now = __rdtsc();
+        uint64_t gap = now - prev;
+        if (gap > gap_ticks) {
+            stolen += gap;
+            events++;
+            if (gap > max_gap) max_gap = gap;
+        }
+        prev = now;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    out->seconds = wall;
+    out->stolen_frac = (double)stolen / (double)(prev - start);
+    out->max_gap_us = max_gap / ticks_per_ns / 1000.0;
+    out->events_per_s = events / wall;
+}
+
+static inline void noise_print_floor(const noise_floor_t* f) {
+    printf("noise floor: %.4f%% of time stolen, %.1f events/s, longest gap %.1f us (%.1f s sampled)\n",
+           100.0 * f->stolen_frac, f->events_per_s, f->max_gap_us, f->seconds);
+}
+
+static inline void noise_report(const noise_ctx_t* n) {
+    if (!n->enabled) return;
+    printf("noise: %llu windows, %llu redone (vcsw %llu, ivcsw %llu, irq %llu, smi %llu, throttled %llu), "
+           "%llu kept after %d tries\n",
+           (unsigned long long)n->samples, (unsigned long long)n->redone,
+           (unsigned long long)n->causes[NOISE_VCSW], (unsigned long long)n->causes[NOISE_IVCSW],
+           (unsigned long long)n->causes[NOISE_IRQ], (unsigned long long)n->causes[NOISE_SMI],
+           (unsigned long long)n->causes[NOISE_THROTTLE],
+           (unsigned long long)n->gave_up, NOISE_MAX_RETRIES);
+}
+
+static inline void noise_close(noise_ctx_t* n) {
+    if (n->msr_fd >= 0) close(n->msr_fd);
+    if (n->irq_fd > 0) close(n->irq_fd);
+    if (n->stat.fd > 0) close(n->stat.fd);
+    free(n->irq_buf);
+    memset(n, 0, sizeof(*n));
+}
+
+#endif // UARCH_NOISE_H
@@ -0,0 +1,161 @@
+/*
+  Cycle timers for single-access measurements.
+
+  The probes' cpuid + rdtsc / rdtscp + cpuid pair serializes fully but costs
+  ~100 cycles (far more under a hypervisor, where cpuid traps) and its
+  jitter swamps a 4-5 cycle L1 hit. Two tighter options:
+
+    TIMER_TSC   lfence; rdtsc; lfence  ...  rdtscp; lfence
+                Orders the measured load against both reads without cpuid.
+                Counts TSC ticks (nominal frequency, not core cycles).
+    TIMER_PMC   lfence; rdpmc; lfence  ...  lfence; rdpmc; lfence
+                Core cycles from a user-readable perf_event counter
+                (needs perf_event_paranoid <= 2 and a PMU, i.e. no VM
+                without vPMU). Falls back to TIMER_TSC when unavailable.
+
+  timer_init() measures the empty-bracket cost (median of many) so
+  timer_load() can return the access latency with the overhead removed.
+  timer_start_serial()/timer_end_serial() keep the original pair for code
+  that brackets whole loops.
+*/
+#ifndef UARCH_TIMER_H
+#define UARCH_TIMER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <x86intrin.h>
+
+#define TIMER_CALIB_SAMPLES 10001
+
+enum { TIMER_TSC, TIMER_PMC };
+
+typedef struct {
+    int mode;
+    int fd;                             // perf_event fd (TIMER_PMC)
+    struct perf_event_mmap_page* page;  // user page with the counter index
+    uint32_t pmc;                       // rdpmc index
+    double overhead;                    // median empty-bracket cost
+} timer_ctx_t;
+
+// --- Serialized pair used throughout the probes ---
+static inline uint64_t timer_start_serial(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t timer_end_serial(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+// --- Tight brackets ---
+static inline uint64_t timer_begin(const timer_ctx_t* t) {
+    uint64_t v;
+    _mm_lfence();
+    v = t->mode == TIMER_PMC ? __rdpmc((int)t->pmc) : __rdtsc();
+    _mm_lfence();
+    return v;
+}
+
+static inline uint64_t timer_end(const timer_ctx_t* t) {
+    uint64_t v;
+    if (t->mode == TIMER_PMC) {
+        _mm_lfence();
+        v = __rdpmc((int)t->pmc);
+    } else {
+        unsigned int aux;
+        v = __rdtscp(&aux);
+    }
+    _mm_lfence();
+    return v;
+}
+
+static int timer__cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static inline double timer_calibrate(timer_ctx_t* t) {
+    uint64_t* s = (uint64_t*)malloc(TIMER_CALIB_SAMPLES * sizeof(uint64_t));
+    for (int i = 0; i < TIMER_CALIB_SAMPLES; i++) {
+        uint64_t a = timer_begin(t);
+        uint64_t b = timer_end(t);
+        s[i] = b - a;
+    }
+    qsort(s, TIMER_CALIB_SAMPLES, sizeof(uint64_t), timer__cmp_u64);
+    t->overhead = (double)s[TIMER_CALIB_SAMPLES / 2];
+    free(s);
+    return t->overhead;
+}
+
+// Open a user-readable core-cycle counter; 0 on success
+static inline int timer__open_pmc(timer_ctx_t* t) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) return -1;
+    void* p = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    struct perf_event_mmap_page* page = (struct perf_event_mmap_page*)p;
+    if (!page->cap_user_rdpmc || !page->index) {
+        munmap(p, (size_t)sysconf(_SC_PAGESIZE));
+        close(fd);
+        return -1;
+    }
+    t->fd = fd;
+    t->page = page;
+    t->pmc = page->index - 1;
+    return 0;
+}
+
+// Pick the counter (PMC if asked for and available) and calibrate overhead
+static inline int timer_init(timer_ctx_t* t, int want_pmc) {
+    memset(t, 0, sizeof(*t));
+    t->fd = -1;
+    t->mode = TIMER_TSC;
+    if (want_pmc) {
+        if (timer__open_pmc(t) == 0) t->mode = TIMER_PMC;
+        else fprintf(stderr, "timer: rdpmc unavailable, using lfence/rdtscp brackets\n");
+    }
+    timer_calibrate(t);
+    return t->mode;
+}
+
+static inline const char* timer_name(const timer_ctx_t* t) {
+    return t->mode == TIMER_PMC ? "rdpmc core cycles" : "lfence/rdtscp TSC ticks";
+}
+
+// Latency of one load with the bracket overhead removed (never negative)
+static inline uint64_t timer_load(const timer_ctx_t* t, const volatile void* p) {
+    uint64_t a = timer_begin(t);
+    (void)*(const volatile char*)p;
+    uint64_t b = timer_end(t);
+    double d = (double)(b - a) - t->overhead;
+    return d > 0 ? (uint64_t)(d + 0.5) : 0;
+}
+
+static inline void timer_close(timer_ctx_t* t) {
+    if (t->page) munmap(t->page, (size_t)sysconf(_SC_PAGESIZE));
+    if (t->fd >= 0) close(t->fd);
+    t->page = NULL;
+    t->fd = -1;
+}
+
+#endif // UARCH_TIMER_H
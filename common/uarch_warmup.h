@@ -0,0 +1,105 @@
+/*
+  Steady-state warm-up detection.
+
+  A fixed warm-up (one call, ACCESSES_PER_RUN steps, DISCARD runs) is
+  either too short for the prefetchers, predictors and page tables to
+  train, or wastes time. Instead, time warm-up batches of the measured
+  work and feed them in until the timing has settled:
+
+    warmup_t w;
+    warmup_init(&w, WARMUP_WINDOW);
+    do {
+        uint64_t t0 = timer_start_serial();
+        work();
+        t = timer_end_serial() - t0;
+    } while (warmup_feed(&w, t));
+
+  Settled means the medians of the two halves of the last `window`
+  batches agree within WARMUP_TOL_PCT (robust to the odd interrupted
+  batch). Once settled, the change point is located after the fact: the
+  first of two consecutive batches within WARMUP_TOL_PCT of the steady
+  median. Batches before it are w.warm_batches, the warm-up the work
+  actually needed: a measure of prefetcher/predictor training time in
+  itself.
+  w.batches counts everything fed, including the confirming window.
+  Noisy work that never settles stops after WARMUP_MAX_BATCHES with
+  w.settled = 0.
+*/
+#ifndef UARCH_WARMUP_H
+#define UARCH_WARMUP_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARMUP_WINDOW 8
+#define WARMUP_TOL_PCT 2.0
+#define WARMUP_MAX_BATCHES 256
+
+typedef struct {
+    int window;
+    int batches;            // batches fed
+    int warm_batches;       // batches before the change point
+    int settled;
+    double steady;          // median of the settled window
+    double total;           // sum of everything fed (same unit as the samples)
+    double warm_total;      // sum up to the change point
+    double hist[WARMUP_MAX_BATCHES];
+} warmup_t;
+
+static inline int warmup__cmp(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static inline double warmup__median(const double* v, int n) {
+    double tmp[WARMUP_MAX_BATCHES];
+    memcpy(tmp, v, n * sizeof(*v));
+    qsort(tmp, n, sizeof(*tmp), warmup__cmp);
+    return n % 2 ? tmp[n / 2] : 0.5 * (tmp[n / 2 - 1] + tmp[n / 2]);
+}
+
+static inline int warmup__near(double x, double ref) {
+    double d = x > ref ? x - ref : ref - x;
+    return 100.0 * d <= WARMUP_TOL_PCT * (ref > 0 ? ref : -ref);
+}
+
+static inline void warmup_init(warmup_t* w, int window) {
+    memset(w, 0, sizeof(*w));
+    w->window = window < 2 ? 2 : window > WARMUP_MAX_BATCHES ? WARMUP_MAX_BATCHES : window;
+}
+
+// Feed one batch timing; returns 1 while more warm-up is needed
+static inline int warmup_feed(warmup_t* w, double sample) {
+    w->hist[w->batches++] = sample;
+    w->total += sample;
+    if (w->batches < w->window && w->batches < WARMUP_MAX_BATCHES) return 1;
+
+    const double* win = w->hist + w->batches - w->window;
+    int half = w->window / 2;
+    double early = warmup__median(win, half);
+    double late = warmup__median(win + half, w->window - half);
+    w->settled = warmup__near(early, late);
+    if (!w->settled && w->batches < WARMUP_MAX_BATCHES) return 1;
+
+    // change point: first two consecutive batches at the steady level
+    w->steady = warmup__median(win, w->window);
+    w->warm_batches = w->batches - w->window;     // no quiet pair: the window start
+    for (int i = 0; i + 1 < w->batches; i++) {
+        if (warmup__near(w->hist[i], w->steady) && warmup__near(w->hist[i + 1], w->steady)) {
+            w->warm_batches = i;
+            break;
+        }
+    }
+    w->warm_total = 0;
+    for (int i = 0; i < w->warm_batches; i++) w->warm_total += w->hist[i];
+    return 0;
+}
+
+static inline void warmup_print(const warmup_t* w, const char* what) {
+    printf("warm-up %s: %d batches before steady state (%.4g per batch), %d fed%s\n", what,
+           w->warm_batches, w->steady, w->batches, w->settled ? "" : ", never settled");
+}
+
+#endif // UARCH_WARMUP_H
@@ -0,0 +1,96 @@
+/*
+  Fleet agent
+
+  Runs the short latency, bandwidth, mispredict and frequency probes of
+  common/uarch_agent.h every --interval seconds under a CPU share
+  (--cpu-pct) and a memory cap (--mem-mb), and rewrites
+  <dir>/uarch_agent.prom for node_exporter's textfile collector after
+  every cycle (<dir>/uarch_agent.om with --openmetrics). Cycles rotate
+  over the CPUs the process may run on and give way when the host gets
+  busy. SIGINT / SIGTERM stop it after the current probe.
+
+  Build: gcc -O2 -pthread -o agent agent.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <signal.h>
+
+#include "../../common/uarch_agent.h"
+
+static agent_cfg_t cfg;
+static int verbose = 0;
+
+static void handle_args(int argc, char** argv) {
+    static struct option long_options[] = {
+        {"dir",          required_argument, NULL, 'd'},
+        {"interval",     required_argument, NULL, 'i'},
+        {"cpu-pct",      required_argument, NULL, 'c'},
+        {"mem-mb",       required_argument, NULL, 'm'},
+        {"max-load",     required_argument, NULL, 'l'},
+        {"max-pressure", required_argument, NULL, 'p'},
+        {"cycles",       required_argument, NULL, 'n'},
+        {"openmetrics",  no_argument,       NULL, 'o'},
+        {"idle",         no_argument,       NULL, 'I'},
+        {"verbose",      no_argument,       NULL, 'v'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'd': cfg.dir = optarg; break;
+            case 'i': cfg.interval_s = atof(optarg); break;
+            case 'c': cfg.cpu_pct = atof(optarg); break;
+            case 'm': cfg.mem_bytes = (size_t)atol(optarg) << 20; break;
+            case 'l': cfg.max_load = atof(optarg); break;
+            case 'p': cfg.max_pressure = atof(optarg); break;
+            case 'n': cfg.cycles = atol(optarg); break;
+            case 'o': cfg.openmetrics = 1; break;
+            case 'I': cfg.sched_idle = 1; break;
+            case 'v': verbose = 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [--dir path] [--interval s] [--cpu-pct pct] [--mem-mb mb]\n"
+                                "       [--max-load tasks_per_cpu] [--max-pressure pct] [--cycles n]\n"
+                                "       [--openmetrics] [--idle] [--verbose]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (cfg.cpu_pct <= 0 || cfg.cpu_pct > 100 || cfg.mem_bytes < AGENT_MIN_MEM) {
+        fprintf(stderr, "--cpu-pct must be in (0, 100] and --mem-mb at least 1\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char** argv) {
+    cfg = agent_defaults();
+    handle_args(argc, argv);
+
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+    agent_t* a = malloc(sizeof(agent_t));
+    if (!a || agent_start(a, &cfg) != 0) {
+        fprintf(stderr, "agent failed to start\n");
+        return 1;
+    }
+    struct timespec poll = {1, 0};
+    uint64_t seen = 0;
+    while (!agent_done(a)) {
+        if (sigtimedwait(&stop, NULL, &poll) > 0) break;
+        if (verbose && a->cycles != seen) {
+            seen = a->cycles;
+            fprintf(stderr, "agent: %lu cycles, %.3f s CPU\n", (unsigned long)seen, a->cpu_s);
+        }
+    }
+    agent_stop(a);
+    printf("agent: %lu cycles, %.3f s CPU, yields", (unsigned long)a->cycles, a->cpu_s);
+    for (int y = 0; y < AGENT_NUM_YIELDS; y++)
+        printf(" %s %lu", agent_yield_names[y], (unsigned long)a->yields[y]);
+    printf("\n");
+    free(a);
+    return 0;
+}
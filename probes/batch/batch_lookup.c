@@ -0,0 +1,325 @@
+/*
+  MLP-aware batch lookup benchmark
+
+  Models a hash lookup as: hash the key -> bucket line -> follow HOPS
+  dependent `next` pointers through random lines. cache_levels.c times one
+  such chain at a time; here K lookups are kept in flight in one thread:
+
+    plain  K cursors advanced round-robin; the OoO window overlaps them
+    swpf   plain, plus a prefetch of the bucket K lookups ahead
+    group  group prefetching: K lookups move stage by stage, every stage
+           prefetches the next line of all K before any is dereferenced
+    amac   asynchronous memory access chaining: a ring of K lookup states,
+           each visit dereferences a line prefetched on the previous visit,
+           prefetches the next one, and refills finished slots immediately
+
+  Reports ns per lookup vs K and working set (TSC calibrated against
+  CLOCK_MONOTONIC) and the best K per variant and working set.
+
+  Build: gcc -O2 -o batch_lookup batch_lookup.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_cpu.h"
+#include "../../common/uarch_evict.h"
+#include "../../common/uarch_freq.h"
+
+#define MAX_K 32
+#define HOPS 3                  // dependent lines per lookup after the bucket
+#define LOOKUPS (1 << 18)       // lookups per measurement
+#define MIN_WS (16 << 10)
+
+typedef struct {
+    uint64_t next;              // index of the next node in this chain
+    uint64_t pad[7];
+} __attribute__((aligned(64))) node_t;
+
+typedef uint64_t (*lookup_fn)(const node_t* nodes, uint64_t n_nodes, const uint64_t* keys, int n, int k);
+
+static int reps = 3;
+static int hops = HOPS;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+static inline uint64_t next_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Multiply-shift hash of the key onto a bucket index
+static inline uint64_t bucket(uint64_t key, uint64_t n_nodes) {
+    return (uint64_t)(((unsigned __int128)(key * 0x9E3779B97F4A7C15ull) * n_nodes) >> 64);
+}
+
+// ============================================================
+// Variants. Each returns a checksum of the final node indices so the
+// work cannot be elided and the variants can be checked against each other.
+// ============================================================
+static uint64_t lookup_plain(const node_t* nodes, uint64_t n_nodes, const uint64_t* keys, int n, int k) {
+    uint64_t cur[MAX_K], sum = 0;
+    int left[MAX_K], issued = 0, active = 0;
+    for (int s = 0; s < k; s++) {
+        left[s] = 0;
+        if (issued < n) { cur[s] = bucket(keys[issued++], n_nodes); left[s] = hops + 1; active++; }
+    }
+    while (active) {
+        for (int s = 0; s < k; s++) {
+            if (!left[s]) continue;
+            cur[s] = nodes[cur[s]].next;
+            if (--left[s] == 0) {
+                sum += cur[s];
+                if (issued < n) { cur[s] = bucket(keys[issued++], n_nodes); left[s] = hops + 1; }
+                else active--;
+            }
+        }
+    }
+    return sum;
+}
+
+static uint64_t lookup_swpf(const node_t* nodes, uint64_t n_nodes, const uint64_t* keys, int n, int k) {
+    uint64_t cur[MAX_K], sum = 0;
+    int left[MAX_K], issued = 0, active = 0;
+    for (int s = 0; s < k; s++) {
+        left[s] = 0;
+        if (issued < n) { cur[s] = bucket(keys[issued++], n_nodes); left[s] = hops + 1; active++; }
+    }
+    while (active) {
+        for (int s = 0; s < k; s++) {
+            if (!left[s]) continue;
+            cur[s] = nodes[cur[s]].next;
+            if (--left[s] == 0) {
+                sum += cur[s];
+                if (issued < n) {
+                    // Bucket of the lookup one batch ahead
+                    if (issued + k < n) _mm_prefetch((const char*)&nodes[bucket(keys[issued + k], n_nodes)], _MM_HINT_T0);
+                    cur[s] = bucket(keys[issued++], n_nodes);
+                    left[s] = hops + 1;
+                } else active--;
+            }
+        }
+    }
+    return sum;
+}
+
+static uint64_t lookup_group(const node_t* nodes, uint64_t n_nodes, const uint64_t* keys, int n, int k) {
+    uint64_t cur[MAX_K], sum = 0;
+    for (int base = 0; base < n; base += k) {
+        int g = n - base < k ? n - base : k;
+        for (int s = 0; s < g; s++) {
+            cur[s] = bucket(keys[base + s], n_nodes);
+            _mm_prefetch((const char*)&nodes[cur[s]], _MM_HINT_T0);
+        }
+        for (int h = 0; h <= hops; h++) {
+            for (int s = 0; s < g; s++) {
+                cur[s] = nodes[cur[s]].next;
+                if (h < hops) _mm_prefetch((const char*)&nodes[cur[s]], _MM_HINT_T0);
+            }
+        }
+        for (int s = 0; s < g; s++) sum += cur[s];
+    }
+    return sum;
+}
+
+static uint64_t lookup_amac(const node_t* nodes, uint64_t n_nodes, const uint64_t* keys, int n, int k) {
+    uint64_t cur[MAX_K], sum = 0;
+    int left[MAX_K], issued = 0, active = 0;
+    for (int s = 0; s < k; s++) {
+        left[s] = 0;
+        if (issued < n) {
+            cur[s] = bucket(keys[issued++], n_nodes);
+            _mm_prefetch((const char*)&nodes[cur[s]], _MM_HINT_T0);
+            left[s] = hops + 1;
+            active++;
+        }
+    }
+    int s = 0;
+    while (active) {
+        if (left[s]) {
+            cur[s] = nodes[cur[s]].next;        // prefetched on the previous visit
+            if (--left[s]) {
+                _mm_prefetch((const char*)&nodes[cur[s]], _MM_HINT_T0);
+            } else {
+                sum += cur[s];
+                if (issued < n) {
+                    cur[s] = bucket(keys[issued++], n_nodes);
+                    _mm_prefetch((const char*)&nodes[cur[s]], _MM_HINT_T0);
+                    left[s] = hops + 1;
+                } else active--;
+            }
+        }
+        if (++s == k) s = 0;
+    }
+    return sum;
+}
+
+static const struct { const char* name; lookup_fn fn; } variants[] = {
+    { "plain", lookup_plain },
+    { "swpf",  lookup_swpf },
+    { "group", lookup_group },
+    { "amac",  lookup_amac },
+};
+#define N_VARIANTS (int)(sizeof(variants) / sizeof(variants[0]))
+
+static const int k_values[] = { 1, 2, 3, 4, 6, 8, 10, 12, 16, 20, 24, 32 };
+#define N_K (int)(sizeof(k_values) / sizeof(k_values[0]))
+
+// Random `next` links; every node is a line, so each hop is one line fill
+static node_t* build_nodes(size_t bytes, uint64_t* n_nodes) {
+    uint64_t n = bytes / sizeof(node_t);
+    node_t* nodes = mmap(NULL, n * sizeof(node_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (nodes == MAP_FAILED) {
+        perror("mmap (nodes)");
+        exit(EXIT_FAILURE);
+    }
+    madvise(nodes, n * sizeof(node_t), MADV_HUGEPAGE);
+    for (uint64_t i = 0; i < n; i++) nodes[i].next = next_rand() % n;
+    *n_nodes = n;
+    return nodes;
+}
+
+static void run_working_set(FILE* csv, size_t bytes, const uint64_t* keys, double ghz, const char* only) {
+    uint64_t n_nodes;
+    node_t* nodes = build_nodes(bytes, &n_nodes);
+
+    printf("\n[working set %zu KB] ns per lookup\n", bytes >> 10);
+    printf("  %3s", "K");
+    for (int v = 0; v < N_VARIANTS; v++) printf(" %8s", variants[v].name);
+    printf("\n");
+
+    double best_ns[N_VARIANTS];
+    int best_k[N_VARIANTS];
+    uint64_t reference = 0;
+    for (int v = 0; v < N_VARIANTS; v++) { best_ns[v] = 1e30; best_k[v] = 0; }
+
+    for (int ki = 0; ki < N_K; ki++) {
+        int k = k_values[ki];
+        printf("  %3d", k);
+        for (int v = 0; v < N_VARIANTS; v++) {
+            if (only && strcmp(only, variants[v].name)) { printf(" %8s", "-"); continue; }
+            uint64_t sum = variants[v].fn(nodes, n_nodes, keys, LOOKUPS, k);   // warm up
+            if (!reference) reference = sum;
+            if (sum != reference) fprintf(stderr, "checksum mismatch: %s K=%d\n", variants[v].name, k);
+
+            uint64_t best = UINT64_MAX;
+            for (int r = 0; r < reps; r++) {
+                uint64_t start = start_timer();
+                sum = variants[v].fn(nodes, n_nodes, keys, LOOKUPS, k);
+                uint64_t t = end_timer() - start;
+                if (t < best) best = t;
+            }
+            double cycles = (double)best / LOOKUPS;
+            double ns = cycles / ghz;
+            if (ns < best_ns[v]) { best_ns[v] = ns; best_k[v] = k; }
+            printf(" %8.2f", ns);
+            fprintf(csv, "%s,%zu,%d,%.3f,%.3f\n", variants[v].name, bytes, k, ns, cycles);
+            fflush(csv);
+        }
+        printf("\n");
+    }
+
+    printf("  best:");
+    for (int v = 0; v < N_VARIANTS; v++) {
+        if (best_k[v]) printf(" %s K=%d (%.2f ns)", variants[v].name, best_k[v], best_ns[v]);
+    }
+    printf("\n");
+    munmap(nodes, n_nodes * sizeof(node_t));
+}
+
+void handle_args(int argc, char* argv[], const char** only, size_t* ws) {
+    static struct option long_options[] = {
+        {"variant", required_argument, NULL, 'v'},
+        {"ws-kb",   required_argument, NULL, 'w'},
+        {"hops",    required_argument, NULL, 'h'},
+        {"reps",    required_argument, NULL, 'r'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'v': *only = optarg; break;
+            case 'w': *ws = strtoull(optarg, NULL, 10) << 10; break;
+            case 'h': sscanf(optarg, "%d", &hops); break;
+            case 'r': sscanf(optarg, "%d", &reps); break;
+            default:
+                fprintf(stderr, "Usage: %s [--variant plain|swpf|group|amac] [--ws-kb N] [--hops N] [--reps N]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (hops < 0) hops = 0;
+    if (reps < 1) reps = 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Pin process to a single CPU core
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    const char* only = NULL;
+    size_t custom_ws = 0;
+    handle_args(argc, argv, &only, &custom_ws);
+
+    freq_ctx_t freq;
+    freq_init(&freq, sched_getcpu());
+    double ghz = freq.tsc_ghz;
+    size_t l1 = evict_cache_size(1, 48 << 10);
+    size_t l2 = evict_cache_size(2, 2 << 20);
+    size_t l3 = evict_cache_size(3, 32 << 20);
+
+    // Half of each level, then well past the LLC
+    size_t sets[4];
+    int n_sets = 0;
+    if (custom_ws) {
+        sets[n_sets++] = custom_ws < MIN_WS ? MIN_WS : custom_ws;
+    } else {
+        sets[n_sets++] = l1 / 2;
+        sets[n_sets++] = l2 / 2;
+        if (l3 / 2 > 2 * l2) sets[n_sets++] = l3 / 2;
+        sets[n_sets++] = 4 * l3 > (256u << 20) ? 4 * l3 : (256u << 20);
+    }
+
+    uint64_t* keys = malloc(LOOKUPS * sizeof(uint64_t));
+    for (int i = 0; i < LOOKUPS; i++) keys[i] = next_rand();
+
+    FILE* csv = fopen("batch_lookup.csv", "w");
+    if (!csv) { perror("fopen failed"); return 1; }
+    fprintf(csv, "variant,working_set,k,ns_per_lookup,cycles_per_lookup\n");
+
+    printf("Batch Lookup Benchmark\n");
+    printf("======================\n");
+    printf("TSC %.3f GHz, %d hops per lookup after the bucket, %d lookups per point\n", ghz, hops, LOOKUPS);
+
+    for (int i = 0; i < n_sets; i++) run_working_set(csv, sets[i], keys, ghz, only);
+
+    printf("\nData saved to batch_lookup.csv\n");
+    fclose(csv);
+    free(keys);
+    freq_close(&freq);
+    cpu_report(&cpus);
+    return 0;
+}
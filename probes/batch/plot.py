@@ -0,0 +1,41 @@
+import sys
+import pandas as pd
+import matplotlib.pyplot as plt
+
+def plot_batch(csv_filename, machine_name):
+    try:
+        data = pd.read_csv(csv_filename)
+    except FileNotFoundError:
+        print(f"Error: File '{csv_filename}' not found.")
+        return
+
+    sets = sorted(data['working_set'].unique())
+    plt.style.use('seaborn-v0_8-whitegrid')
+    fig, axes = plt.subplots(1, len(sets), figsize=(6 * len(sets), 5), squeeze=False)
+
+    print(f"{'working set':>14} {'variant':>8} {'best K':>7} {'ns/lookup':>10}")
+    for ax, ws in zip(axes[0], sets):
+        subset = data[data['working_set'] == ws]
+        for variant, group in subset.groupby('variant', sort=False):
+            ax.plot(group['k'], group['ns_per_lookup'], marker='o', markersize=4, label=variant)
+            best = group.loc[group['ns_per_lookup'].idxmin()]
+            print(f"{ws >> 10:>11} KB {variant:>8} {int(best['k']):>7} {best['ns_per_lookup']:>10.2f}")
+        ax.set_yscale('log')
+        ax.set_xlabel('Lookups in flight (K)')
+        ax.set_ylabel('ns per lookup')
+        ax.set_title(f'{ws >> 10} KB working set', fontsize=13, weight='bold')
+        ax.grid(True, which='both', linestyle='--', alpha=0.7)
+        ax.legend()
+
+    fig.suptitle(f'Batch Lookup Cost vs Batch Size ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'batch_lookup.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nPlot saved as '{output_filename}'")
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <batch_lookup.csv> [machine_name]")
+    else:
+        machine = sys.argv[2] if len(sys.argv) > 2 else 'Unknown'
+        plot_batch(sys.argv[1], machine)
@@ -0,0 +1,596 @@
+/*
+  Branch predictor deep-dive
+
+  Extends the alternating-vs-random comparison from has_branch_pred.c and the
+  single-subtraction penalty from depth.c into five measurements:
+    period   - longest repeating pattern a single branch can learn
+    history  - how many intervening branches a correlation survives
+    count    - how many static conditional branches are tracked
+    indirect - distinct targets one indirect call site can predict
+    rsb      - return stack buffer depth
+  and reports the misprediction penalty as a per-sample distribution.
+
+  Build: gcc -O2 -o bpred bpred.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_jit.h"
+#include "../../common/uarch_cpu.h"
+
+#define PATTERN_LEN 65536      // length of the random outcome buffers
+#define PENALTY_SAMPLES 2000   // samples for the penalty distribution
+#define PENALTY_ITERS 4096     // branches per penalty sample
+#define CHAIN_NODES 2048       // L1-resident chain for the load-resolved branch
+#define CODE_SIZE (4 * 1024 * 1024)
+
+static int reps = 20;          // passes over the pattern buffer per point
+static int penalty_samples = PENALTY_SAMPLES;
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+// Simple xorshift so patterns do not depend on libc rand()
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+static inline uint64_t next_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// First index from which `run` consecutive values exceed the threshold, or -1
+static int find_knee(const double* y, int n, double thresh, int run) {
+    for (int i = 0; i + run <= n; i++) {
+        int ok = 1;
+        for (int r = 0; r < run; r++) {
+            if (y[i + r] <= thresh) { ok = 0; break; }
+        }
+        if (ok) return i;
+    }
+    return -1;
+}
+
+static FILE* csv;
+
+static void record(const char* test, long param, double cycles, double extra) {
+    fprintf(csv, "%s,%ld,%.4f,%.4f\n", test, param, cycles, extra);
+    fflush(csv);
+}
+
+// ============================================================
+// Penalty distribution
+// ============================================================
+
+// One conditional branch per byte; the asm keeps the branch out of
+// the compiler's reach (no cmov, no if-conversion)
+static uint64_t run_bytes(const uint8_t* bits, size_t n) {
+    uint64_t start = start_timer();
+    for (size_t i = 0; i < n; i++) {
+        __asm__ volatile("test %0, %0\n\t"
+                         "jz 1f\n\t"
+                         "nop\n"
+                         "1:" :: "r"((uint32_t)bits[i]) : "cc");
+    }
+    return end_timer() - start;
+}
+
+typedef struct PNode {
+    struct PNode* next;
+    uint32_t bit;
+} PNode;
+
+// Same branch, but its condition comes out of a dependent L1-resident load
+static uint64_t run_chain(PNode* p, size_t n) {
+    uint64_t start = start_timer();
+    for (size_t i = 0; i < n; i++) {
+        __asm__ volatile("test %0, %0\n\t"
+                         "jz 1f\n\t"
+                         "nop\n"
+                         "1:" :: "r"(p->bit) : "cc");
+        p = p->next;
+    }
+    __asm__ volatile("" : "+r"(p));
+    return end_timer() - start;
+}
+
+static PNode* make_chain(PNode* nodes, int n, int random_bits) {
+    int* idx = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) idx[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = next_rand() % (i + 1);
+        int t = idx[i]; idx[i] = idx[j]; idx[j] = t;
+    }
+    for (int i = 0; i < n; i++) {
+        nodes[idx[i]].next = &nodes[idx[(i + 1) % n]];
+        nodes[idx[i]].bit = random_bits ? (uint32_t)(next_rand() & 1) : 1;
+    }
+    PNode* head = &nodes[idx[0]];
+    free(idx);
+    return head;
+}
+
+static double report_distribution(const char* context, double* samples, int n) {
+    qsort(samples, n, sizeof(double), cmp_double);
+    double p5 = samples[n * 5 / 100];
+    double p50 = samples[n / 2];
+    double p95 = samples[n * 95 / 100];
+    printf("  %-5s p5 %6.2f | p50 %6.2f | p95 %6.2f | min %6.2f | max %6.2f cycles\n",
+           context, p5, p50, p95, samples[0], samples[n - 1]);
+    return p50;
+}
+
+// Returns the median penalty of the ALU-resolved branch
+static double test_penalty(uint8_t* random_bits, uint8_t* ones) {
+    FILE* pcsv = fopen("bpred_penalty.csv", "w");
+    if (!pcsv) { perror("fopen failed"); exit(EXIT_FAILURE); }
+    fprintf(pcsv, "context,sample,penalty_cycles\n");
+
+    double* alu = malloc(penalty_samples * sizeof(double));
+    double* load = malloc(penalty_samples * sizeof(double));
+
+    PNode* rnodes = malloc(CHAIN_NODES * sizeof(PNode));
+    PNode* pnodes = malloc(CHAIN_NODES * sizeof(PNode));
+    PNode* rhead = make_chain(rnodes, CHAIN_NODES, 1);
+    PNode* phead = make_chain(pnodes, CHAIN_NODES, 0);
+
+    // Warm up both paths once
+    run_bytes(random_bits, PATTERN_LEN);
+    run_chain(rhead, CHAIN_NODES);
+
+    for (int s = 0; s < penalty_samples; s++) {
+        // Slide through the random buffer so no sample repeats a window
+        size_t off = ((size_t)s * PENALTY_ITERS) % (PATTERN_LEN - PENALTY_ITERS);
+        uint64_t t_rand = run_bytes(random_bits + off, PENALTY_ITERS);
+        uint64_t t_pred = run_bytes(ones, PENALTY_ITERS);
+        // Half of the random outcomes are mispredicted on average
+        alu[s] = ((double)t_rand - (double)t_pred) / (PENALTY_ITERS * 0.5);
+
+        // The chain is short enough to be learned, so re-draw its bits and
+        // walk it exactly once per sample
+        for (int i = 0; i < CHAIN_NODES; i++) rnodes[i].bit = (uint32_t)(next_rand() & 1);
+        t_rand = run_chain(rhead, CHAIN_NODES);
+        t_pred = run_chain(phead, CHAIN_NODES);
+        load[s] = ((double)t_rand - (double)t_pred) / (CHAIN_NODES * 0.5);
+
+        fprintf(pcsv, "alu,%d,%.3f\n", s, alu[s]);
+        fprintf(pcsv, "load,%d,%.3f\n", s, load[s]);
+    }
+    fclose(pcsv);
+
+    printf("\n[penalty] misprediction penalty distribution (%d samples)\n", penalty_samples);
+    double median = report_distribution("alu", alu, penalty_samples);
+    report_distribution("load", load, penalty_samples);
+
+    free(alu); free(load); free(rnodes); free(pnodes);
+    return median;
+}
+
+// ============================================================
+// Pattern period
+// ============================================================
+static void test_period(uint8_t* buf, double penalty) {
+    static const int periods[] = {
+        2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 40, 48, 64, 80, 96, 128,
+        160, 192, 256, 320, 384, 512, 640, 768, 1024, 1536, 2048, 3072, 4096,
+        6144, 8192
+    };
+    const int n = sizeof(periods) / sizeof(periods[0]);
+    double cycles[sizeof(periods) / sizeof(periods[0])];
+    double rate[sizeof(periods) / sizeof(periods[0])];
+    double baseline = 0;
+
+    for (int p = 0; p < n; p++) {
+        int period = periods[p];
+        size_t len = (PATTERN_LEN / period) * period;
+
+        // Random bits for one period, tiled; force both outcomes into every period
+        uint8_t one[8192];
+        for (int i = 0; i < period; i++) one[i] = (uint8_t)(next_rand() & 1);
+        one[0] = 0;
+        one[period - 1] = 1;
+        for (size_t i = 0; i < len; i++) buf[i] = one[i % period];
+
+        run_bytes(buf, len);
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < reps; r++) {
+            uint64_t t = run_bytes(buf, len);
+            if (t < best) best = t;
+        }
+        cycles[p] = (double)best / len;
+        // Short periods are trivially learned; the cheapest of them is the baseline
+        if (period <= 8 && (p == 0 || cycles[p] < baseline)) baseline = cycles[p];
+    }
+
+    printf("\n[period] Period | Cycles/branch | Mispredict rate\n");
+    for (int p = 0; p < n; p++) {
+        rate[p] = (cycles[p] - baseline) / penalty;
+        printf("  %6d | %13.3f | %6.3f\n", periods[p], cycles[p], rate[p]);
+        record("period", periods[p], cycles[p], cycles[p] - baseline);
+    }
+
+    int k = find_knee(rate, n, 0.10, 2);
+    if (k > 0) printf("  -> patterns up to period ~%d are learned (>10%% mispredicts at %d)\n", periods[k - 1], periods[k]);
+    else if (k < 0) printf("  -> every tested period was learned\n");
+}
+
+// ============================================================
+// Global history length
+// ============================================================
+
+// Branch A (random) ... D always-taken fillers ... branch B.
+// B either repeats A's outcome (correlated) or reads its own random bit.
+static void emit_history(jit_t* j, int fillers, int correlated) {
+    jit_byte(j, 0x31); jit_byte(j, 0xC9);                       // xor ecx, ecx
+    jit_byte(j, 0x45); jit_byte(j, 0x31); jit_byte(j, 0xC9);    // xor r9d, r9d
+    jit_align(j, 16);
+    size_t top = j->pos;
+    jit_byte(j, 0x0F); jit_byte(j, 0xB6); jit_byte(j, 0x04); jit_byte(j, 0x0F);                    // movzx eax, byte [rdi+rcx]
+    jit_byte(j, 0x44); jit_byte(j, 0x0F); jit_byte(j, 0xB6); jit_byte(j, 0x04); jit_byte(j, 0x0A); // movzx r8d, byte [rdx+rcx]
+    jit_byte(j, 0x85); jit_byte(j, 0xC0);                       // test eax, eax   (branch A)
+    jit_byte(j, 0x74); jit_byte(j, 0x01); jit_byte(j, 0x90);    // jz +1; nop
+    for (int i = 0; i < fillers; i++) {
+        jit_byte(j, 0x45); jit_byte(j, 0x85); jit_byte(j, 0xC9); // test r9d, r9d (always zero)
+        jit_byte(j, 0x74); jit_byte(j, 0x01); jit_byte(j, 0x90); // jz +1 (always taken); nop
+    }
+    if (correlated) { jit_byte(j, 0x90); jit_byte(j, 0x85); jit_byte(j, 0xC0); }  // nop; test eax, eax
+    else { jit_byte(j, 0x45); jit_byte(j, 0x85); jit_byte(j, 0xC0); }             // test r8d, r8d
+    jit_byte(j, 0x74); jit_byte(j, 0x01); jit_byte(j, 0x90);    // jz +1; nop      (branch B)
+    jit_byte(j, 0x48); jit_byte(j, 0xFF); jit_byte(j, 0xC1);    // inc rcx
+    jit_byte(j, 0x48); jit_byte(j, 0x39); jit_byte(j, 0xF1);    // cmp rcx, rsi
+    jit_byte(j, 0x0F); jit_byte(j, 0x82);                       // jb top
+    size_t fix = j->pos;
+    jit_dword(j, 0);
+    jit_patch_rel32(j, fix, top);
+    jit_ret(j);
+}
+
+static uint64_t time_history(unsigned char* code, int fillers, int correlated,
+                             const uint8_t* a, const uint8_t* b) {
+    typedef void (*fn_t)(const uint8_t*, size_t, const uint8_t*);
+    jit_t j;
+    jit_init(&j, code, CODE_SIZE);
+    emit_history(&j, fillers, correlated);
+    jit_finish(&j);
+    fn_t fn = (fn_t)code;
+
+    fn(a, PATTERN_LEN, b);
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < reps; r++) {
+        uint64_t start = start_timer();
+        fn(a, PATTERN_LEN, b);
+        uint64_t t = end_timer() - start;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static void test_history(unsigned char* code, const uint8_t* a, const uint8_t* b, double penalty) {
+    static const int depths[] = {
+        0, 1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128, 160, 192, 256, 320,
+        384, 512, 640, 768, 1024
+    };
+    const int n = sizeof(depths) / sizeof(depths[0]);
+    double rate[sizeof(depths) / sizeof(depths[0])];
+
+    // An independent B mispredicts half the time; the saving of the
+    // correlated B over it, in penalties, is how much of that half it avoids
+    printf("\n[history] Fillers | Correlated | Independent | Saving (cycles/iter) | B mispredict rate\n");
+    for (int d = 0; d < n; d++) {
+        double corr = (double)time_history(code, depths[d], 1, a, b) / PATTERN_LEN;
+        double indep = (double)time_history(code, depths[d], 0, a, b) / PATTERN_LEN;
+        double saving = indep - corr;
+        rate[d] = 0.5 - saving / penalty;
+        printf("  %7d | %10.2f | %11.2f | %20.2f | %6.3f\n", depths[d], corr, indep, saving, rate[d]);
+        record("history", depths[d], corr, saving);
+    }
+
+    // The correlation is lost once B mispredicts more than half as often as a coin flip
+    int k = find_knee(rate, n, 0.25, 2);
+    if (k > 0) printf("  -> correlation survives ~%d intervening branches (lost by %d)\n", depths[k - 1], depths[k]);
+    else if (k < 0) printf("  -> correlation survived every tested distance\n");
+}
+
+// ============================================================
+// Number of tracked conditional branches
+// ============================================================
+static void test_count(unsigned char* code) {
+    static const int counts[] = {
+        16, 32, 64, 128, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+        6144, 8192, 12288, 16384
+    };
+    const int n = sizeof(counts) / sizeof(counts[0]);
+    const int max_branches = 16384;
+    double extra[sizeof(counts) / sizeof(counts[0])];
+
+    // Four rows of per-branch outcomes; row k is used on call k % 4
+    uint8_t* rows = malloc(4 * (size_t)max_branches);
+    for (size_t i = 0; i < 4 * (size_t)max_branches; i++) rows[i] = (uint8_t)(next_rand() & 1);
+
+    typedef void (*fn_t)(const uint8_t*);
+    // The baseline runs the same branches on rows + 0 every call: a fixed,
+    // learnable direction per branch, so only the branch count varies
+    printf("\n[count] Branches | Pattern cycles/branch | Fixed row | Extra\n");
+    for (int c = 0; c < n; c++) {
+        int branches = counts[c];
+        jit_t j;
+        jit_init(&j, code, CODE_SIZE);
+        for (int i = 0; i < branches; i++) {
+            jit_align(&j, 16);
+            jit_byte(&j, 0x80); jit_byte(&j, 0xBF); jit_dword(&j, (uint32_t)i); jit_byte(&j, 0x00); // cmp byte [rdi+i], 0
+            jit_byte(&j, 0x74); jit_byte(&j, 0x01); jit_byte(&j, 0x90);                            // je +1; nop
+        }
+        jit_ret(&j);
+        jit_finish(&j);
+        fn_t fn = (fn_t)code;
+
+        int calls = (1 << 22) / branches;
+        if (calls < 64) calls = 64;
+        uint64_t best_pat = UINT64_MAX, best_fixed = UINT64_MAX;
+        for (int r = 0; r < reps / 4 + 2; r++) {
+            uint64_t start = start_timer();
+            for (int k = 0; k < calls; k++) fn(rows + (size_t)(k & 3) * max_branches);
+            uint64_t t = end_timer() - start;
+            if (t < best_pat) best_pat = t;
+
+            start = start_timer();
+            for (int k = 0; k < calls; k++) fn(rows);
+            t = end_timer() - start;
+            if (t < best_fixed) best_fixed = t;
+        }
+        double pat = (double)best_pat / ((double)calls * branches);
+        double base = (double)best_fixed / ((double)calls * branches);
+        extra[c] = pat - base;
+        printf("  %8d | %21.3f | %9.3f | %6.3f\n", branches, pat, base, extra[c]);
+        record("count", branches, pat, extra[c]);
+    }
+
+    int k = find_knee(extra, n, extra[0] + 0.5, 2);
+    if (k > 0) printf("  -> ~%d static branches tracked before patterns are lost\n", counts[k - 1]);
+    else if (k < 0) printf("  -> every tested branch count was tracked\n");
+    free(rows);
+}
+
+// ============================================================
+// Indirect target capacity of one call site
+// ============================================================
+static void test_indirect(unsigned char* code) {
+    static const int targets[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 512, 1024 };
+    const int n = sizeof(targets) / sizeof(targets[0]);
+    const int max_targets = 1024;
+    const size_t seq_len = 16384;
+    double extra[sizeof(targets) / sizeof(targets[0])];
+
+    // Loop with a single call site; stubs live 64 bytes apart after it
+    jit_t j;
+    jit_init(&j, code, CODE_SIZE);
+    jit_byte(&j, 0x31); jit_byte(&j, 0xC9);                                        // xor ecx, ecx
+    jit_align(&j, 16);
+    size_t top = j.pos;
+    jit_byte(&j, 0x48); jit_byte(&j, 0x8B); jit_byte(&j, 0x04); jit_byte(&j, 0xCF); // mov rax, [rdi+rcx*8]
+    jit_byte(&j, 0xFF); jit_byte(&j, 0xD0);                                        // call rax
+    jit_byte(&j, 0x48); jit_byte(&j, 0xFF); jit_byte(&j, 0xC1);                    // inc rcx
+    jit_byte(&j, 0x48); jit_byte(&j, 0x39); jit_byte(&j, 0xF1);                    // cmp rcx, rsi
+    jit_byte(&j, 0x0F); jit_byte(&j, 0x82);                                        // jb top
+    size_t fix = j.pos;
+    jit_dword(&j, 0);
+    jit_patch_rel32(&j, fix, top);
+    jit_ret(&j);
+    jit_align(&j, 4096);
+    unsigned char* stubs = jit_here(&j);
+    for (int t = 0; t < max_targets; t++) {
+        jit_seek(&j, (size_t)(stubs - code) + (size_t)t * 64);
+        jit_ret(&j);
+    }
+    jit_finish(&j);
+
+    typedef void (*fn_t)(void* const*, size_t);
+    fn_t fn = (fn_t)code;
+    void** seq = malloc(seq_len * sizeof(void*));
+    int perm[1024];
+
+    printf("\n[indirect] Targets | Cycles/call | Extra\n");
+    double base = 0;
+    for (int c = 0; c < n; c++) {
+        int count = targets[c];
+        for (int i = 0; i < count; i++) perm[i] = i;
+        for (int i = count - 1; i > 0; i--) {
+            int r = next_rand() % (i + 1);
+            int t = perm[i]; perm[i] = perm[r]; perm[r] = t;
+        }
+        size_t len = (seq_len / count) * count;
+        for (size_t i = 0; i < len; i++) seq[i] = stubs + (size_t)perm[i % count] * 64;
+
+        fn(seq, len);
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < reps; r++) {
+            uint64_t start = start_timer();
+            fn(seq, len);
+            uint64_t t = end_timer() - start;
+            if (t < best) best = t;
+        }
+        double cycles = (double)best / len;
+        if (c == 0) base = cycles;
+        extra[c] = cycles - base;
+        printf("  %7d | %11.3f | %6.3f\n", count, cycles, extra[c]);
+        record("indirect", count, cycles, extra[c]);
+    }
+
+    int k = find_knee(extra, n, 1.0, 2);
+    if (k > 0) printf("  -> one call site predicts a %d-target rotation (fails at %d)\n", targets[k - 1], targets[k]);
+    else if (k < 0) printf("  -> every tested rotation was predicted\n");
+    free(seq);
+}
+
+// ============================================================
+// Return stack buffer depth
+// ============================================================
+
+// Recursive R(depth): both recursive call sites fall through to one shared
+// ret, so its target alternates per level and the BTB fallback used on RSB
+// underflow always guesses wrong.
+static void test_rsb(unsigned char* code, double penalty) {
+    jit_t j;
+    jit_init(&j, code, CODE_SIZE);
+    size_t entry = j.pos;
+    jit_byte(&j, 0xFF); jit_byte(&j, 0xCF);                                        // dec edi
+    jit_byte(&j, 0x74); size_t jz_leaf = j.pos; jit_byte(&j, 0);                   // jz leaf
+    jit_byte(&j, 0xF7); jit_byte(&j, 0xC7); jit_dword(&j, 1);                      // test edi, 1
+    jit_byte(&j, 0x75); size_t jnz_odd = j.pos; jit_byte(&j, 0);                   // jnz odd
+    jit_byte(&j, 0xE8); size_t c1 = j.pos; jit_dword(&j, 0);                       // call R
+    jit_patch_rel32(&j, c1, entry);
+    jit_byte(&j, 0xEB); size_t jmp_done = j.pos; jit_byte(&j, 0);                  // jmp done
+    size_t odd = j.pos;
+    jit_byte(&j, 0xE8); size_t c2 = j.pos; jit_dword(&j, 0);                       // odd: call R
+    jit_patch_rel32(&j, c2, entry);
+    size_t done = j.pos;
+    jit_ret(&j);                                                                   // done: ret
+    size_t leaf = j.pos;
+    jit_ret(&j);                                                                   // leaf: ret
+    code[jz_leaf] = (unsigned char)(leaf - (jz_leaf + 1));
+    code[jnz_odd] = (unsigned char)(odd - (jnz_odd + 1));
+    code[jmp_done] = (unsigned char)(done - (jmp_done + 1));
+    jit_finish(&j);
+
+    typedef void (*fn_t)(int);
+    fn_t fn = (fn_t)code;
+    const int calls = 20000;
+    const int max_depth = 80;
+    double per_level[80];
+
+    printf("\n[rsb] Depth | Cycles/level\n");
+    for (int depth = 1; depth <= max_depth; depth++) {
+        for (int k = 0; k < calls / 10; k++) fn(depth);
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < reps / 4 + 2; r++) {
+            uint64_t start = start_timer();
+            for (int k = 0; k < calls; k++) fn(depth);
+            uint64_t t = end_timer() - start;
+            if (t < best) best = t;
+        }
+        per_level[depth - 1] = (double)best / ((double)calls * depth);
+        printf("  %5d | %8.3f\n", depth, per_level[depth - 1]);
+        record("rsb", depth, per_level[depth - 1], per_level[depth - 1] - per_level[0]);
+    }
+
+    // Marginal cost of one more level: flat while the RSB holds every return
+    // address, one extra mispredict per level once it overflows
+    double marginal[80];
+    marginal[0] = per_level[0];
+    for (int d = 1; d < max_depth; d++) {
+        marginal[d] = per_level[d] * (d + 1) - per_level[d - 1] * d;
+    }
+    double sorted[8];
+    memcpy(sorted, marginal + 1, sizeof(sorted));
+    qsort(sorted, 8, sizeof(double), cmp_double);
+    double base = sorted[4];
+
+    double rise[80];
+    for (int d = 0; d < max_depth; d++) rise[d] = marginal[d] - base;
+    int k = find_knee(rise + 1, max_depth - 1, penalty * 0.5, 3);
+    if (k >= 0) printf("  -> return stack buffer holds ~%d entries\n", k + 1);
+    else printf("  -> no RSB overflow observed up to depth %d\n", max_depth);
+}
+
+void handle_args(int argc, char* argv[], const char** only) {
+    static struct option long_options[] = {
+        {"test",    required_argument, NULL, 't'},
+        {"reps",    required_argument, NULL, 'r'},
+        {"samples", required_argument, NULL, 's'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 't': *only = optarg; break;
+            case 'r': sscanf(optarg, "%d", &reps); break;
+            case 's': sscanf(optarg, "%d", &penalty_samples); break;
+            default:
+                fprintf(stderr, "Usage: %s [--test period|history|count|indirect|rsb|penalty] [--reps N] [--samples N]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    static const char* tests[] = { "period", "history", "count", "indirect", "rsb", "penalty" };
+    int known = !*only;
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]) && !known; i++) known = !strcmp(*only, tests[i]);
+    if (!known) {
+        fprintf(stderr, "Unknown test '%s'; expected period, history, count, indirect, rsb or penalty\n", *only);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Pin process to a single CPU core
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    const char* only = NULL;
+    handle_args(argc, argv, &only);
+    if (reps < 1) reps = 1;
+    if (penalty_samples < 20) penalty_samples = 20;
+
+    uint8_t* random_a = malloc(PATTERN_LEN);
+    uint8_t* random_b = malloc(PATTERN_LEN);
+    uint8_t* ones = malloc(PATTERN_LEN);
+    uint8_t* scratch = malloc(PATTERN_LEN);
+    unsigned char* code = jit_alloc(CODE_SIZE);
+    if (!random_a || !random_b || !ones || !scratch || !code) {
+        fprintf(stderr, "Failed to allocate buffers\n");
+        return 1;
+    }
+    for (int i = 0; i < PATTERN_LEN; i++) {
+        random_a[i] = (uint8_t)(next_rand() & 1);
+        random_b[i] = (uint8_t)(next_rand() & 1);
+        ones[i] = 1;
+    }
+
+    csv = fopen("bpred_results.csv", "w");
+    if (!csv) { perror("fopen failed"); return 1; }
+    fprintf(csv, "test,param,cycles,extra_cycles\n");
+
+    printf("Branch Predictor Deep-Dive\n");
+    printf("==========================\n");
+
+    // The penalty is needed to turn extra cycles into mispredict rates
+    double penalty = test_penalty(random_a, ones);
+    if (penalty < 1.0) penalty = 1.0;
+
+    if (!only || !strcmp(only, "period"))   test_period(scratch, penalty);
+    if (!only || !strcmp(only, "history"))  test_history(code, random_a, random_b, penalty);
+    if (!only || !strcmp(only, "count"))    test_count(code);
+    if (!only || !strcmp(only, "indirect")) test_indirect(code);
+    if (!only || !strcmp(only, "rsb"))      test_rsb(code, penalty);
+
+    fclose(csv);
+    jit_release(code, CODE_SIZE);
+    free(random_a); free(random_b); free(ones); free(scratch);
+
+    printf("\nData saved to bpred_results.csv and bpred_penalty.csv\n");
+    cpu_report(&cpus);
+    return 0;
+}
@@ -0,0 +1,70 @@
+import sys
+import pandas as pd
+import matplotlib.pyplot as plt
+
+PANELS = [
+    ("period", "Pattern period", "Cycles per branch", True),
+    ("history", "Always-taken branches between A and B", "Saving from correlation (cycles)", True),
+    ("count", "Static conditional branches", "Extra cycles per branch", True),
+    ("indirect", "Targets rotated through one call site", "Extra cycles per call", True),
+    ("rsb", "Call depth", "Cycles per level", False),
+]
+
+def plot_bpred(csv_filename, penalty_filename, machine_name):
+    try:
+        data = pd.read_csv(csv_filename)
+    except FileNotFoundError:
+        print(f"Error: File '{csv_filename}' not found.")
+        return
+
+    plt.style.use('seaborn-v0_8-whitegrid')
+    fig, axes = plt.subplots(2, 3, figsize=(18, 10))
+    axes = axes.flatten()
+
+    for ax, (test, xlabel, ylabel, logx) in zip(axes, PANELS):
+        subset = data[data['test'] == test]
+        if subset.empty:
+            ax.set_visible(False)
+            continue
+        # period and rsb read best as absolute cycles, the others as deltas
+        column = 'cycles' if test in ('period', 'rsb') else 'extra_cycles'
+        ax.plot(subset['param'], subset[column], marker='o', markersize=4, color='teal')
+        if logx:
+            ax.set_xscale('log', base=2)
+        ax.set_xlabel(xlabel)
+        ax.set_ylabel(ylabel)
+        ax.set_title(test, fontsize=13, weight='bold')
+        ax.grid(True, which='both', linestyle='--', alpha=0.7)
+
+    # Last panel: penalty distribution
+    ax = axes[-1]
+    try:
+        penalty = pd.read_csv(penalty_filename)
+        for context, color in (('alu', 'teal'), ('load', 'darkorange')):
+            values = penalty[penalty['context'] == context]['penalty_cycles']
+            if values.empty:
+                continue
+            lo, hi = values.quantile(0.01), values.quantile(0.99)
+            values = values[(values >= lo) & (values <= hi)]
+            ax.hist(values, bins=60, alpha=0.6, color=color,
+                    label=f"{context} (median {values.median():.1f})")
+        ax.set_xlabel('Misprediction penalty (cycles)')
+        ax.set_ylabel('Samples')
+        ax.set_title('penalty', fontsize=13, weight='bold')
+        ax.legend()
+    except FileNotFoundError:
+        ax.set_visible(False)
+
+    fig.suptitle(f'Branch Predictor Deep-Dive ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'bpred_analysis.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nAnalysis plot saved as '{output_filename}'")
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <bpred_results.csv> [bpred_penalty.csv] [machine_name]")
+    else:
+        penalty_file = sys.argv[2] if len(sys.argv) > 2 else 'bpred_penalty.csv'
+        machine = sys.argv[3] if len(sys.argv) > 3 else 'Unknown'
+        plot_bpred(sys.argv[1], penalty_file, machine)
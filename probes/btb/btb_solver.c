@@ -0,0 +1,427 @@
+/*
+  BTB geometry solver
+
+  Replaces the three 5.4 probes (btb.c, btb_up.c, btb_assoc.c). Those reused a
+  handful of C functions as targets, so many "branches" shared one BTB entry.
+  Here every measured branch is a unique JIT'd instruction at a controlled
+  address: block i sits at base + i * spacing and branches to block i + 1.
+
+  Sweep: branch type (direct jmp, taken jcc, indirect jmp) x spacing x count.
+  From the cycles-per-branch curves it infers, per type:
+    levels / entries  - steps in the dense-spacing curve
+    ways              - capacity once every branch maps to one set
+    set-index bits    - how far capacity halves as spacing doubles
+    tag bits          - spacing at which distinct branches start to alias
+  each with a 0..1 confidence score.
+
+  Build: gcc -O2 -o btb_solver btb_solver.c -lm
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_jit.h"
+#include "../../common/uarch_ckpt.h"
+#include "../../common/uarch_cpu.h"
+
+#define MAX_COUNT 16384           // largest number of branches in one chain
+#define MAX_SPACING_LOG2 30       // 1 GiB between branches
+#define SPAN_LIMIT (16ull << 30)  // virtual span of one layout (MAP_NORESERVE)
+#define SPARSE_MAX_COUNT 64       // cap when every branch sits on its own page
+#define BRANCHES_PER_POINT (1 << 20)
+#define MAX_LEVELS 3
+
+enum { T_DIRECT, T_COND, T_INDIRECT, T_COUNT };
+static const char* type_names[T_COUNT] = { "direct", "cond", "indirect" };
+static const int min_spacing_log2[T_COUNT] = { 3, 3, 4 };  // block sizes 5, 6 and 9 bytes
+
+static int reps = 5;
+static int resume = 0;
+
+// Checkpoint point of one (type, spacing) row group, increasing in sweep order
+#define SWEEP_POINT(type, sl) ((long)(type) * (MAX_SPACING_LOG2 + 1) + (sl))
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// --- Chain generation ---
+//
+// Blocks 0..count-1 each hold one measured branch to the next block; block
+// `count` is the loop tail:  dec rsi; jz exit; cmp eax, eax; jmp rdx; exit: ret
+// (cmp eax, eax re-sets ZF for the taken-jcc chain). Arguments:
+// rdi = indirect target table, rsi = iterations, rdx = block 0.
+typedef void (*chain_fn)(void* const* table, uint64_t iters, void* entry);
+
+static void emit_chain(unsigned char* code, size_t span, int type, int count,
+                       size_t spacing, void** table) {
+    jit_t j;
+    jit_init(&j, code, span);
+    for (int i = 0; i < count; i++) {
+        size_t here = (size_t)i * spacing;
+        size_t next = here + spacing;
+        jit_seek(&j, here);
+        switch (type) {
+            case T_DIRECT:
+                jit_jmp_rel32(&j, next);                                     // jmp next
+                break;
+            case T_COND: {
+                jit_byte(&j, 0x0F); jit_byte(&j, 0x84);                      // jz next (ZF always set)
+                size_t fix = j.pos;
+                jit_dword(&j, 0);
+                jit_patch_rel32(&j, fix, next);
+                break;
+            }
+            case T_INDIRECT:
+                jit_load64(&j, JIT_RAX, JIT_RDI, i * 8);                     // mov rax, [rdi + 8i]
+                jit_byte(&j, 0xFF); jit_byte(&j, 0xE0);                      // jmp rax
+                table[i] = code + next;
+                break;
+        }
+    }
+    jit_seek(&j, (size_t)count * spacing);
+    jit_dec(&j, JIT_RSI);                                                    // dec rsi
+    jit_byte(&j, 0x74); jit_byte(&j, 0x04);                                  // jz exit
+    jit_byte(&j, 0x39); jit_byte(&j, 0xC0);                                  // cmp eax, eax
+    jit_byte(&j, 0xFF); jit_byte(&j, 0xE2);                                  // jmp rdx
+    jit_ret(&j);                                                             // exit: ret
+    __builtin___clear_cache((char*)code, (char*)code + (size_t)count * spacing + 16);
+}
+
+// Entry stub: set ZF and fall into block 0
+static unsigned char* make_entry(unsigned char* stub, unsigned char* block0) {
+    jit_t j;
+    jit_init(&j, stub, 64);
+    jit_byte(&j, 0x39); jit_byte(&j, 0xC0);                                  // cmp eax, eax
+    jit_mov_imm64(&j, JIT_RAX, (uint64_t)(uintptr_t)block0);
+    jit_byte(&j, 0xFF); jit_byte(&j, 0xE0);                                  // jmp rax
+    jit_finish(&j);
+    return stub;
+}
+
+static double measure_chain(unsigned char* code, unsigned char* stub, int count, void** table) {
+    chain_fn fn = (chain_fn)make_entry(stub, code);
+    uint64_t iters = BRANCHES_PER_POINT / count;
+    if (iters < 16) iters = 16;
+
+    fn(table, iters, code);
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < reps; r++) {
+        uint64_t start = start_timer();
+        fn(table, iters, code);
+        uint64_t t = end_timer() - start;
+        if (t < best) best = t;
+    }
+    return (double)best / ((double)iters * count);
+}
+
+// --- Step detection ---
+//
+// Walks a cycles-per-branch curve (counts ascending) and records every point
+// where it rises above the median of the current plateau for two consecutive
+// counts. The first two points are skipped: with only a couple of branches
+// the loop tail dominates the cost per branch.
+typedef struct {
+    int n_steps;
+    int capacity[MAX_LEVELS];   // last count before the step
+    double height[MAX_LEVELS];
+    double conf[MAX_LEVELS];
+} steps_t;
+
+static double plateau_median(const double* y, int from, int to) {
+    double tmp[256];
+    int n = 0;
+    for (int i = from; i < to && n < 256; i++) tmp[n++] = y[i];
+    qsort(tmp, n, sizeof(double), cmp_double);
+    return tmp[n / 2];
+}
+
+static steps_t find_steps(const int* counts, const double* y, int n) {
+    steps_t s;
+    memset(&s, 0, sizeof(s));
+    int start = n > 4 ? 2 : 0;
+    for (int i = start + 1; i + 1 < n && s.n_steps < MAX_LEVELS; i++) {
+        double level = plateau_median(y, start, i);
+        double thresh = fmax(0.4, 0.2 * level);
+        if (y[i] > level + thresh && y[i + 1] > level + thresh) {
+            double height = fmin(y[i], y[i + 1]) - level;
+            s.capacity[s.n_steps] = counts[i - 1];
+            s.height[s.n_steps] = height;
+            // A step exactly at the threshold scores 0, three thresholds ~0.86
+            double c = 1.0 - exp(-(height / thresh - 1.0));
+            s.conf[s.n_steps] = c < 0 ? 0 : c;
+            s.n_steps++;
+            start = i;
+            i++;
+        }
+    }
+    return s;
+}
+
+// --- Results ---
+typedef struct {
+    int n_spacings;
+    int spacing_log2[MAX_SPACING_LOG2 + 1];
+    steps_t steps[MAX_SPACING_LOG2 + 1];
+    int max_count[MAX_SPACING_LOG2 + 1];
+} sweep_t;
+
+static FILE* geo;
+
+static void report(const char* type, int level, const char* param, double value,
+                   const char* bound, double conf) {
+    printf("  %-8s L%d %-15s %10.0f  (%s, confidence %.2f)\n", type, level, param, value, bound, conf);
+    fprintf(geo, "%s,%d,%s,%.0f,%s,%.3f\n", type, level, param, value, bound, conf);
+}
+
+static int ilog2(uint64_t v) { int r = 0; while (v > 1) { v >>= 1; r++; } return r; }
+
+// Levels and entries come from the 64-byte-spacing curve (one branch per line,
+// so no two branches share a fetch block). Ways, index and tag bits are solved
+// for the first level: at every spacing the first step is its capacity.
+static void solve(int type, const sweep_t* sw) {
+    const char* name = type_names[type];
+    int ref = 0;
+    for (int s = 0; s < sw->n_spacings; s++) {
+        if (sw->spacing_log2[s] == 6) ref = s;
+    }
+    const steps_t* dense = &sw->steps[ref];
+
+    printf("\n[%s] inferred geometry\n", name);
+    if (dense->n_steps == 0) {
+        printf("  %s: no capacity step found up to %d branches\n", name, sw->max_count[ref]);
+        report(name, 0, "entries", sw->max_count[ref], "lower", 0.2);
+        return;
+    }
+    for (int lvl = 0; lvl < dense->n_steps; lvl++) {
+        report(name, lvl, "entries", dense->capacity[lvl], "exact", dense->conf[lvl]);
+    }
+
+    int entries = dense->capacity[0];
+    int cap[MAX_SPACING_LOG2 + 1];
+    double conf[MAX_SPACING_LOG2 + 1];
+    for (int s = 0; s < sw->n_spacings; s++) {
+        const steps_t* st = &sw->steps[s];
+        cap[s] = st->n_steps ? st->capacity[0] : -1;
+        conf[s] = st->n_steps ? st->conf[0] : 0;
+    }
+
+    // Index granularity: largest spacing from the reference up that still
+    // keeps >= 3/4 of the entries
+    int g = ref;
+    for (int s = ref + 1; s < sw->n_spacings; s++) {
+        if (cap[s] >= entries * 3 / 4) g = s;
+        else if (cap[s] >= 0) break;
+    }
+
+    // Ways: once every branch maps to one set, capacity stops shrinking.
+    // The floor is the first spacing whose next three neighbours stay within
+    // a factor of 1.5 of it; ways is the median over that window.
+    int floor_s = -1;
+    double plateau[4];
+    int n_plateau = 0;
+    for (int s = g + 1; s < sw->n_spacings && floor_s < 0; s++) {
+        if (cap[s] <= 0) continue;
+        n_plateau = 0;
+        plateau[n_plateau++] = cap[s];
+        for (int t = s + 1; t < sw->n_spacings && n_plateau < 4; t++) {
+            if (cap[t] <= 0) continue;
+            if (cap[t] * 2 > cap[s] * 3 || cap[t] * 3 < cap[s] * 2) break;
+            plateau[n_plateau++] = cap[t];
+        }
+        if (n_plateau >= 3 || (n_plateau >= 2 && s + 2 >= sw->n_spacings)) floor_s = s;
+    }
+    if (floor_s < 0) {
+        printf("  %s: capacity never settled as spacing grew; ways/sets unresolved\n", name);
+        return;
+    }
+    qsort(plateau, n_plateau, sizeof(double), cmp_double);
+    int ways = (int)plateau[n_plateau / 2];
+    if (ways < 1) ways = 1;
+    double spread = (plateau[n_plateau - 1] - plateau[0]) / (double)ways;
+    double plateau_conf = conf[floor_s] * (spread <= 0.25 ? 1.0 : 0.6) * (n_plateau >= 3 ? 1.0 : 0.6);
+
+    // Sets from entries / ways; the floor should land where sets x granularity predicts
+    int sets = entries / ways;
+    if (sets < 1) sets = 1;
+    int index_lo = sw->spacing_log2[g];
+    int index_bits = ilog2((uint64_t)sets);
+    int observed_floor = sw->spacing_log2[floor_s];
+    int off = abs(index_lo + index_bits - observed_floor);
+
+    // Ways, sets and index are one fit (entries = sets x ways, floor at the
+    // top index bit), so they share one confidence
+    double fit_conf = fmin(plateau_conf, conf[ref]) * (off == 0 ? 1.0 : off == 1 ? 0.5 : 0.2);
+    report(name, 0, "ways", ways, "exact", fit_conf);
+    report(name, 0, "index_low_bit", index_lo, "exact", fit_conf);
+    report(name, 0, "set_index_bits", index_bits, "exact", fit_conf);
+
+    // Tags: past the index bits, distinct branches only conflict once their
+    // stored tags also match, which collapses capacity well below `ways`
+    int collapse = -1;
+    for (int s = floor_s + 1; s < sw->n_spacings; s++) {
+        if (cap[s] > 0 && cap[s] * 2 <= ways) { collapse = s; break; }
+    }
+    if (collapse >= 0) {
+        report(name, 0, "tag_bits", sw->spacing_log2[collapse] - observed_floor, "exact", conf[collapse]);
+    } else {
+        int last = sw->spacing_log2[sw->n_spacings - 1];
+        report(name, 0, "tag_bits", last - observed_floor + 1, "lower", 0.2);
+    }
+}
+
+// Every finished spacing is checkpointed together with all sweeps so far,
+// so a resumed run can still solve the geometry of the skipped ones
+static void sweep_type(int type, ckpt_t* ckpt, sweep_t* sweeps, int max_count) {
+    FILE* csv = ckpt->out;
+    sweep_t* sw = &sweeps[type];
+    static int counts[256];
+    int n_counts = 0;
+    // Four points per octave from 2 branches up
+    for (double c = 2; c <= max_count; c *= 1.189207) {
+        int v = (int)(c + 0.5);
+        if (n_counts == 0 || v != counts[n_counts - 1]) counts[n_counts++] = v;
+    }
+
+    void** table = malloc((MAX_COUNT + 1) * sizeof(void*));
+    unsigned char* stub = jit_alloc(4096);
+    double* y = malloc(n_counts * sizeof(double));
+    if (!ckpt_skip(ckpt, SWEEP_POINT(type, min_spacing_log2[type]))) sw->n_spacings = 0;
+
+    printf("\n[%s] Spacing | Branches -> cycles/branch\n", type_names[type]);
+    for (int sl = min_spacing_log2[type]; sl <= MAX_SPACING_LOG2; sl++) {
+        if (ckpt_skip(ckpt, SWEEP_POINT(type, sl))) continue;
+        size_t spacing = (size_t)1 << sl;
+        int limit = max_count;
+        if (spacing >= 4096 && limit > SPARSE_MAX_COUNT) limit = SPARSE_MAX_COUNT;
+        while (limit > 2 && (uint64_t)(limit + 1) * spacing > SPAN_LIMIT) limit /= 2;
+
+        size_t span = (size_t)(limit + 1) * spacing + 4096;
+        unsigned char* code = jit_alloc(span);
+        if (!code) break;
+
+        int n = 0;
+        printf("  %10zu |", spacing);
+        for (int c = 0; c < n_counts && counts[c] <= limit; c++) {
+            emit_chain(code, span, type, counts[c], spacing, table);
+            y[n] = measure_chain(code, stub, counts[c], table);
+            fprintf(csv, "%s,%zu,%d,%.4f\n", type_names[type], spacing, counts[c], y[n]);
+            n++;
+        }
+        fflush(csv);
+        jit_release(code, span);
+
+        int idx = sw->n_spacings++;
+        sw->spacing_log2[idx] = sl;
+        sw->max_count[idx] = counts[n - 1];
+        sw->steps[idx] = find_steps(counts, y, n);
+        for (int k = 0; k < sw->steps[idx].n_steps; k++) printf(" step@%d", sw->steps[idx].capacity[k]);
+        printf("%s\n", sw->steps[idx].n_steps ? "" : " (flat)");
+        if (ckpt_done(ckpt, SWEEP_POINT(type, sl), sweeps, T_COUNT * sizeof(sweep_t)) != 0) exit(EXIT_FAILURE);
+    }
+
+    free(y);
+    free(table);
+    jit_release(stub, 4096);
+}
+
+void handle_args(int argc, char* argv[], int* only, int* max_count) {
+    static struct option long_options[] = {
+        {"type",      required_argument, NULL, 't'},
+        {"max-count", required_argument, NULL, 'm'},
+        {"reps",      required_argument, NULL, 'r'},
+        {"resume",    no_argument,       NULL, 'R'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 't':
+                *only = -1;
+                for (int t = 0; t < T_COUNT; t++) if (!strcmp(optarg, type_names[t])) *only = t;
+                if (*only < 0) {
+                    fprintf(stderr, "Unknown type '%s'; expected", optarg);
+                    for (int t = 0; t < T_COUNT; t++) fprintf(stderr, " %s", type_names[t]);
+                    fprintf(stderr, "\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'm': sscanf(optarg, "%d", max_count); break;
+            case 'r': sscanf(optarg, "%d", &reps); break;
+            case 'R': resume = 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [--type direct|cond|indirect] [--max-count N] [--reps N] [--resume]\n",
+                        argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (*max_count > MAX_COUNT) *max_count = MAX_COUNT;
+    if (*max_count < 8) *max_count = 8;
+    if (reps < 1) reps = 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Pin process to a single CPU core
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    int only = -1, max_count = MAX_COUNT;
+    handle_args(argc, argv, &only, &max_count);
+
+    // The sweep is checkpointed per (type, spacing); the geometry is
+    // re-solved from the saved sweeps on every run
+    char config[128];
+    snprintf(config, sizeof(config), "btb_solver type=%d max_count=%d reps=%d", only, max_count, reps);
+    ckpt_t ckpt;
+    static sweep_t sweeps[T_COUNT];
+    FILE* csv = ckpt_open(&ckpt, "btb_sweep.csv", "type,spacing,count,cycles_per_branch\n", config, resume);
+    if (!csv) return 1;
+    if (ckpt.resumed && ckpt_state(&ckpt, sweeps, sizeof(sweeps)) != 0) return 1;
+    geo = fopen("btb_geometry.csv", "w");
+    if (!geo) { perror("fopen failed"); return 1; }
+    fprintf(geo, "type,level,param,value,bound,confidence\n");
+
+    printf("BTB Geometry Solver\n");
+    printf("===================\n");
+
+    for (int t = 0; t < T_COUNT; t++) {
+        if (only >= 0 && t != only) continue;
+        sweep_type(t, &ckpt, sweeps, max_count);
+    }
+
+    printf("\n=== Inferred BTB geometry ===\n");
+    for (int t = 0; t < T_COUNT; t++) {
+        if (only >= 0 && t != only) continue;
+        solve(t, &sweeps[t]);
+    }
+
+    ckpt_close(&ckpt);
+    fclose(geo);
+    printf("\nSweep saved to btb_sweep.csv, geometry to btb_geometry.csv\n");
+    cpu_report(&cpus);
+    return 0;
+}
@@ -0,0 +1,51 @@
+import sys
+import numpy as np
+import pandas as pd
+import matplotlib.pyplot as plt
+
+def plot_btb(sweep_file, geometry_file, machine_name):
+    try:
+        df = pd.read_csv(sweep_file)
+    except FileNotFoundError:
+        print(f"Error: File '{sweep_file}' not found.")
+        return
+
+    types = [t for t in ('direct', 'cond', 'indirect') if t in df['type'].unique()]
+    fig, axes = plt.subplots(1, len(types), figsize=(7 * len(types), 6), squeeze=False)
+
+    for ax, branch_type in zip(axes[0], types):
+        subset = df[df['type'] == branch_type]
+        grid = subset.pivot_table(index='spacing', columns='count', values='cycles_per_branch')
+        # Clip at the 98th percentile so one noisy point does not wash out the colour scale
+        vmax = np.nanpercentile(grid.values, 98)
+        im = ax.imshow(grid.values, aspect='auto', origin='lower', cmap='viridis',
+                       vmin=np.nanmin(grid.values), vmax=vmax)
+        ax.set_xticks(range(0, len(grid.columns), 4))
+        ax.set_xticklabels([str(c) for c in grid.columns[::4]], rotation=45)
+        ax.set_yticks(range(len(grid.index)))
+        ax.set_yticklabels([f"2^{int(np.log2(s))}" for s in grid.index], fontsize=8)
+        ax.set_xlabel('Branches in chain')
+        ax.set_ylabel('Spacing between branches (bytes)')
+        ax.set_title(f'{branch_type} branches', fontsize=13, weight='bold')
+        fig.colorbar(im, ax=ax, label='Cycles per branch')
+
+    fig.suptitle(f'BTB Capacity vs Spacing ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'btb_geometry.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nHeatmap saved as '{output_filename}'")
+
+    try:
+        geo = pd.read_csv(geometry_file)
+        print("\nInferred geometry:")
+        print(geo.to_string(index=False))
+    except FileNotFoundError:
+        pass
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <btb_sweep.csv> [btb_geometry.csv] [machine_name]")
+    else:
+        geometry = sys.argv[2] if len(sys.argv) > 2 else 'btb_geometry.csv'
+        machine = sys.argv[3] if len(sys.argv) > 3 else 'Unknown'
+        plot_btb(sys.argv[1], geometry, machine)
@@ -0,0 +1,47 @@
+/*
+  Quick calibration demo
+
+  Prints the coarse machine model of common/uarch_calib.h: cache levels
+  and latencies, line size, DRAM latency, per-core read bandwidth and SMT
+  topology. The first run on a machine measures (~100-200 ms); later
+  runs read the cached model for the same fingerprint.
+
+  Build: gcc -O2 -pthread -o calib calib.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "../../common/uarch_calib.h"
+
+static int flags = 0;
+
+static void handle_args(int argc, char** argv) {
+    static struct option long_options[] = {
+        {"fresh",   no_argument, NULL, 'f'},
+        {"no-save", no_argument, NULL, 'n'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'f': flags |= CALIB_FRESH; break;
+            case 'n': flags |= CALIB_NO_SAVE; break;
+            default:
+                fprintf(stderr, "Usage: %s [--fresh] [--no-save]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    handle_args(argc, argv);
+    calib_t model;
+    if (calib_quick(&model, flags) != 0) {
+        fprintf(stderr, "calibration failed\n");
+        return 1;
+    }
+    calib_print(&model, stdout);
+    return 0;
+}
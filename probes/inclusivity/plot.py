@@ -0,0 +1,53 @@
+import sys
+import pandas as pd
+import matplotlib.pyplot as plt
+
+LEVELS = [('frac_private', 'private', 'seagreen'), ('frac_llc', 'LLC', 'goldenrod'), ('frac_dram', 'DRAM', 'firebrick')]
+
+def stacked(ax, x, subset, xlabel, title):
+    bottom = None
+    for column, label, color in LEVELS:
+        values = subset[column].values * 100
+        ax.bar(x, values, bottom=bottom, color=color, label=label)
+        bottom = values if bottom is None else bottom + values
+    ax.set_xlabel(xlabel)
+    ax.set_ylabel("Core A's reloads served from (%)")
+    ax.set_title(title, fontsize=13, weight='bold')
+    ax.legend()
+
+def plot_inclusivity(csv_filename, machine_name):
+    try:
+        data = pd.read_csv(csv_filename)
+    except FileNotFoundError:
+        print(f"Error: File '{csv_filename}' not found.")
+        return
+
+    plt.style.use('seaborn-v0_8-whitegrid')
+    fig, (ax_llc, ax_sf) = plt.subplots(1, 2, figsize=(16, 6))
+
+    llc = data[data['test'] == 'llc']
+    if not llc.empty:
+        stacked(ax_llc, [f"{p:g}" for p in llc['param']], llc,
+                'Bytes streamed by core B (x LLC size)', 'LLC thrashed from another core')
+    sf = data[data['test'] == 'sf']
+    if not sf.empty:
+        stacked(ax_sf, [f"{int(p) >> 10}" for p in sf['param']], sf,
+                'Aggregate private footprint (KB)', 'Snoop-filter pressure')
+
+    for row in data[data['test'] == 'calibration'].itertuples():
+        print(f"calibration {['private', 'LLC', 'DRAM'][int(row.param)]}: {row.avg_cycles:.0f} cycles")
+    for row in data[data['test'] == 'backinv'].itertuples():
+        print(f"back-invalidation: {row.extra:.1f} cycles per line held by core A")
+
+    fig.suptitle(f'Cross-Core Inclusivity ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'xcore_inclusivity.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nPlot saved as '{output_filename}'")
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <xcore_incl.csv> [machine_name]")
+    else:
+        machine = sys.argv[2] if len(sys.argv) > 2 else 'Unknown'
+        plot_inclusivity(sys.argv[1], machine)
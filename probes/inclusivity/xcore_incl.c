@@ -0,0 +1,466 @@
+/*
+  Cross-core cache inclusivity / snoop-filter probe
+
+  cache_inc.c thrashes the LLC from the same core that owns the target,
+  which evicts the target from its own L1/L2 too and so cannot separate an
+  inclusive LLC from a non-inclusive one. Here the roles are split:
+
+    core A  installs a target set (fits comfortably in its L2) and later
+            times a reload of every target line
+    core B  streams X bytes through the LLC in between
+    helpers (optional) hold private working sets to fill the snoop filter
+
+  Tests:
+    llc      X swept from 1/4 to 2x the LLC. With an inclusive LLC, B's
+             stream evicts the targets from the LLC and back-invalidates
+             them out of A's L2, so A's reload goes to DRAM. With a
+             non-inclusive LLC the targets stay private.
+    backinv  B's stream time with A holding half an L2 of lines vs with
+             A's lines flushed; the difference per A line is the
+             back-invalidation cost paid by the evicting core.
+    sf       B and the helpers repeatedly read private sets of Y bytes each,
+             Y from 1/8 to 2x their L2. Past 1x the lines keep cycling
+             through their L2s and allocate snoop-filter entries faster
+             than private data alone could; the aggregate footprint at
+             which A starts losing lines bounds the snoop-filter coverage.
+
+  Every reload is classified per line against thresholds calibrated on
+  core A (private hit / LLC hit / DRAM).
+
+  Build: gcc -O2 -pthread -o xcore_incl xcore_incl.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_cpu.h"
+#include "../../common/uarch_evict.h"
+
+#define LINE 64
+#define TARGET_LINES 512        // 32 KB target set, well inside any L2
+#define TARGET_REGION (2 << 20) // targets are scattered over one 2 MB page
+#define MAX_HELPERS 64
+#define TRIALS 5
+
+enum { CMD_NONE, CMD_STREAM, CMD_HOLD, CMD_QUIT };
+enum { LVL_PRIVATE, LVL_LLC, LVL_DRAM };
+
+static cpu_ctx_t cpus;
+static int cpu_a = -1, cpu_b = -1;     // -1: picked from our cpuset, on different physical cores
+static int helpers[MAX_HELPERS], n_helpers = 0;
+static int trials = TRIALS;
+static size_t l2_size, llc_size;
+
+// --- Shared state between the measuring thread (A) and the workers ---
+static pthread_barrier_t start_barrier, done_barrier;
+static volatile int command = CMD_NONE;
+static volatile size_t stream_bytes, hold_bytes;
+static volatile uint64_t stream_cycles;
+static volatile uint64_t sink;
+
+static char* target_region;
+static char* targets[TARGET_LINES];
+static double thresh_private, thresh_llc;
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+static char* alloc_touched(size_t bytes) {
+    char* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    madvise(p, bytes, MADV_HUGEPAGE);
+    memset(p, 1, bytes);   // real pages, not the shared zero page
+    return p;
+}
+
+static void pin_to(int cpu) {
+    if (cpu_pin(&cpus, cpu) != 0) {
+        fprintf(stderr, "Failed to pin to CPU %d\n", cpu);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static uint64_t read_lines(const char* buf, size_t bytes) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < bytes; i += LINE) sum += *(volatile const char*)(buf + i);
+    return sum;
+}
+
+// ============================================================
+// Worker threads: core B plus the helper cores
+// ============================================================
+typedef struct {
+    int cpu;
+    int is_b;
+    char* buf;
+} worker_t;
+
+static void* worker_func(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    pin_to(w->cpu);
+    for (;;) {
+        pthread_barrier_wait(&start_barrier);
+        int cmd = command;
+        if (cmd == CMD_QUIT) break;
+        if (cmd == CMD_STREAM && w->is_b) {
+            uint64_t start = start_timer();
+            sink += read_lines(w->buf, stream_bytes);
+            stream_cycles = end_timer() - start;
+        } else if (cmd == CMD_HOLD) {
+            // Several passes so the set ends up resident in this core's L2
+            for (int pass = 0; pass < 4; pass++) sink += read_lines(w->buf, hold_bytes);
+        }
+        pthread_barrier_wait(&done_barrier);
+    }
+    return NULL;
+}
+
+// Run one command on all workers and wait for it to finish
+static void run_workers(int cmd) {
+    command = cmd;
+    pthread_barrier_wait(&start_barrier);
+    if (cmd != CMD_QUIT) pthread_barrier_wait(&done_barrier);
+}
+
+// ============================================================
+// Core A: target set, reload timing and classification
+// ============================================================
+static void build_targets(void) {
+    target_region = alloc_touched(TARGET_REGION);
+    size_t slots = TARGET_REGION / LINE;
+    uint64_t rng = 0x2545F4914F6CDD1Dull;
+    char* used = calloc(slots, 1);
+    for (int i = 0; i < TARGET_LINES; i++) {
+        size_t s;
+        do {
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            s = rng % slots;
+        } while (used[s]);
+        used[s] = 1;
+        targets[i] = target_region + s * LINE;
+    }
+    free(used);
+}
+
+static void prime_targets(void) {
+    for (int pass = 0; pass < 4; pass++)
+        for (int i = 0; i < TARGET_LINES; i++) sink += *(volatile char*)targets[i];
+}
+
+static void flush_targets(void) {
+    for (int i = 0; i < TARGET_LINES; i++) _mm_clflush(targets[i]);
+    _mm_mfence();
+}
+
+// Per-line reload latency (rdtscp ... lfence brackets)
+static void time_reload(double* lat) {
+    unsigned int aux;
+    for (int i = 0; i < TARGET_LINES; i++) {
+        _mm_lfence();
+        uint64_t t0 = __rdtscp(&aux);
+        sink += *(volatile char*)targets[i];
+        _mm_lfence();
+        uint64_t t1 = __rdtscp(&aux);
+        lat[i] = (double)(t1 - t0);
+    }
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* v, int n) {
+    qsort(v, n, sizeof(double), cmp_double);
+    return v[n / 2];
+}
+
+typedef struct { double avg, frac[3]; } reload_t;
+
+static reload_t classify(const double* lat) {
+    reload_t r = { 0, { 0, 0, 0 } };
+    for (int i = 0; i < TARGET_LINES; i++) {
+        r.avg += lat[i];
+        int lvl = lat[i] < thresh_private ? LVL_PRIVATE : lat[i] < thresh_llc ? LVL_LLC : LVL_DRAM;
+        r.frac[lvl] += 1.0;
+    }
+    r.avg /= TARGET_LINES;
+    for (int l = 0; l < 3; l++) r.frac[l] /= TARGET_LINES;
+    return r;
+}
+
+// Median per-line latency on core A for the three reference states
+static void calibrate(char* evict_private, size_t evict_bytes, double* levels) {
+    double lat[TARGET_LINES], samples[TRIALS * 3];
+    for (int state = 0; state < 3; state++) {
+        int n = 0;
+        for (int t = 0; t < trials && n < TRIALS * 3; t++) {
+            prime_targets();
+            if (state == LVL_LLC) sink += read_lines(evict_private, evict_bytes);
+            if (state == LVL_DRAM) flush_targets();
+            time_reload(lat);
+            samples[n++] = median(lat, TARGET_LINES);
+        }
+        levels[state] = median(samples, n);
+    }
+    thresh_private = (levels[LVL_PRIVATE] + levels[LVL_LLC]) / 2;
+    thresh_llc = (levels[LVL_LLC] + levels[LVL_DRAM]) / 2;
+}
+
+static reload_t median_trial(reload_t* r, int n) {
+    double avg[TRIALS * 4];
+    for (int i = 0; i < n; i++) avg[i] = r[i].avg;
+    double m = median(avg, n);
+    for (int i = 0; i < n; i++) if (r[i].avg == m) return r[i];
+    return r[0];
+}
+
+static void record(FILE* csv, const char* test, double param, reload_t r, double extra) {
+    fprintf(csv, "%s,%.4f,%.2f,%.3f,%.3f,%.3f,%.3f\n", test, param, r.avg,
+            r.frac[LVL_PRIVATE], r.frac[LVL_LLC], r.frac[LVL_DRAM], extra);
+    fflush(csv);
+}
+
+// ============================================================
+// Tests
+// ============================================================
+static int test_llc(FILE* csv, size_t max_stream) {
+    static const double ratios[] = { 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0 };
+    double lat[TARGET_LINES];
+    reload_t runs[TRIALS * 4];
+    int inclusive = 0;
+
+    printf("\n[llc] core B streams X bytes, core A reloads its %d KB target set\n", TARGET_LINES * LINE >> 10);
+    printf("  X/LLC | avg cycles | private |   LLC  |  DRAM\n");
+    for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++) {
+        size_t bytes = (size_t)(ratios[r] * llc_size);
+        if (bytes > max_stream) break;
+        stream_bytes = bytes;
+        int n = 0;
+        for (int t = 0; t < trials && n < TRIALS * 4; t++) {
+            prime_targets();
+            run_workers(CMD_STREAM);
+            time_reload(lat);
+            runs[n++] = classify(lat);
+        }
+        reload_t m = median_trial(runs, n);
+        printf("  %5.2f | %10.1f | %6.1f%% | %5.1f%% | %5.1f%%\n", ratios[r], m.avg,
+               100 * m.frac[LVL_PRIVATE], 100 * m.frac[LVL_LLC], 100 * m.frac[LVL_DRAM]);
+        record(csv, "llc", ratios[r], m, 0);
+        if (ratios[r] >= 2.0 && m.frac[LVL_PRIVATE] < 0.5) inclusive = 1;
+    }
+    printf("  -> %s\n", inclusive
+           ? "inclusive LLC: streaming on another core back-invalidates A's private lines"
+           : "non-inclusive LLC: A's private lines survive another core thrashing the LLC");
+    return inclusive;
+}
+
+static void test_backinv(FILE* csv, char* hold_buf, size_t max_stream) {
+    size_t hold = l2_size / 2;
+    size_t lines = hold / LINE;
+    uint64_t with_lines[TRIALS * 4], without[TRIALS * 4];
+    stream_bytes = 2 * llc_size < max_stream ? 2 * llc_size : max_stream;
+
+    int n = 0;
+    for (int t = 0; t < trials && n < TRIALS * 4; t++) {
+        for (int pass = 0; pass < 4; pass++) sink += read_lines(hold_buf, hold);
+        run_workers(CMD_STREAM);
+        with_lines[n] = stream_cycles;
+
+        for (size_t i = 0; i < hold; i += LINE) _mm_clflush(hold_buf + i);
+        _mm_mfence();
+        run_workers(CMD_STREAM);
+        without[n] = stream_cycles;
+        n++;
+    }
+    double a[TRIALS * 4], b[TRIALS * 4];
+    for (int i = 0; i < n; i++) { a[i] = (double)with_lines[i]; b[i] = (double)without[i]; }
+    double t_with = median(a, n), t_without = median(b, n);
+    double per_line = (t_with - t_without) / lines;
+
+    printf("\n[backinv] B streams %zu MB; A holds %zu KB vs nothing\n", stream_bytes >> 20, hold >> 10);
+    printf("  stream cycles: %.0f with A's lines, %.0f without -> %.1f cycles per A line\n",
+           t_with, t_without, per_line);
+    reload_t r = { t_with / (stream_bytes / LINE), { 0, 0, 0 } };
+    record(csv, "backinv", (double)hold, r, per_line);
+}
+
+static void test_sf(FILE* csv) {
+    static const double fractions[] = { 0.125, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0 };
+    double lat[TARGET_LINES];
+    reload_t runs[TRIALS * 4];
+    int cores = 1 + n_helpers;
+    double capacity = 0;
+
+    printf("\n[sf] core B + %d helper(s) read Y bytes each, A reloads\n", n_helpers);
+    printf("  Y/L2 | aggregate KB | avg cycles | private |   LLC  |  DRAM\n");
+    for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+        hold_bytes = (size_t)(fractions[f] * l2_size);
+        size_t aggregate = hold_bytes * cores + TARGET_LINES * LINE;
+        int n = 0;
+        for (int t = 0; t < trials && n < TRIALS * 4; t++) {
+            prime_targets();
+            run_workers(CMD_HOLD);
+            time_reload(lat);
+            runs[n++] = classify(lat);
+        }
+        reload_t m = median_trial(runs, n);
+        printf("  %4.2f | %12zu | %10.1f | %6.1f%% | %5.1f%% | %5.1f%%\n", fractions[f], aggregate >> 10,
+               m.avg, 100 * m.frac[LVL_PRIVATE], 100 * m.frac[LVL_LLC], 100 * m.frac[LVL_DRAM]);
+        record(csv, "sf", (double)aggregate, m, fractions[f]);
+        if (!capacity && m.frac[LVL_PRIVATE] < 0.75) capacity = (double)aggregate;
+    }
+    size_t private_total = l2_size * cores + TARGET_LINES * LINE;
+    if (capacity)
+        printf("  -> A starts losing lines at ~%.0f KB aggregate (%.2fx the private L2 total): "
+               "snoop-filter coverage\n", capacity / 1024, capacity / private_total);
+    else
+        printf("  -> no loss up to %zu KB aggregate (2x the private L2 total); add --helpers to push further\n",
+               (size_t)(2 * l2_size * cores + TARGET_LINES * LINE) >> 10);
+}
+
+static int parse_cpu_list(const char* s, int* out, int max) {
+    int n = 0;
+    while (*s && n < max) {
+        char* end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s) break;
+        if (*end == '-') { s = end + 1; hi = strtol(s, &end, 10); }
+        for (long c = lo; c <= hi && n < max; c++) out[n++] = (int)c;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+void handle_args(int argc, char* argv[], const char** only, size_t* llc_override) {
+    static struct option long_options[] = {
+        {"test",    required_argument, NULL, 't'},
+        {"cpu-a",   required_argument, NULL, 'a'},
+        {"cpu-b",   required_argument, NULL, 'b'},
+        {"helpers", required_argument, NULL, 'h'},
+        {"llc-kb",  required_argument, NULL, 'l'},
+        {"trials",  required_argument, NULL, 'n'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 't': *only = optarg; break;
+            case 'a': sscanf(optarg, "%d", &cpu_a); break;
+            case 'b': sscanf(optarg, "%d", &cpu_b); break;
+            case 'h': n_helpers = parse_cpu_list(optarg, helpers, MAX_HELPERS); break;
+            case 'l': *llc_override = strtoull(optarg, NULL, 10) << 10; break;
+            case 'n': sscanf(optarg, "%d", &trials); break;
+            default:
+                fprintf(stderr, "Usage: %s [--test llc|backinv|sf] [--cpu-a N] [--cpu-b N] "
+                        "[--helpers 2,3,8-11] [--llc-kb N] [--trials N]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (trials < 1) trials = 1;
+    if (trials > TRIALS * 3) trials = TRIALS * 3;
+}
+
+int main(int argc, char* argv[]) {
+    const char* only = NULL;
+    size_t llc_override = 0;
+    handle_args(argc, argv, &only, &llc_override);
+
+    if (cpu_init(&cpus) != 0) {
+        perror("cpu_init failed");
+        return 1;
+    }
+    int picked[3];
+    int n_picked = cpu_pick_cores(&cpus, 3, picked);
+    for (int i = 0; i < n_picked && cpu_a < 0; i++)
+        if (picked[i] != cpu_b) cpu_a = picked[i];
+    for (int i = 0; i < n_picked && cpu_b < 0; i++)
+        if (picked[i] != cpu_a) cpu_b = picked[i];
+    if (cpu_a < 0 || cpu_b < 0 || !CPU_ISSET(cpu_a, &cpus.allowed) ||
+        !CPU_ISSET(cpu_b, &cpus.allowed) || cpu_a == cpu_b) {
+        fprintf(stderr, "Need two distinct allowed CPUs (got A=%d, B=%d); see --cpu-a/--cpu-b\n", cpu_a, cpu_b);
+        return 1;
+    }
+    if (cpus.core[cpu_a] == cpus.core[cpu_b])
+        fprintf(stderr, "Warning: CPUs %d and %d are SMT siblings of one core; A and B share its L1/L2\n",
+                cpu_a, cpu_b);
+    pin_to(cpu_a);
+
+    l2_size = evict_cache_size(2, 2 << 20);
+    llc_size = llc_override ? llc_override : evict_cache_size(3, 32 << 20);
+    size_t max_stream = 2 * llc_size;
+
+    printf("Cross-Core Inclusivity / Snoop-Filter Probe\n");
+    printf("===========================================\n");
+    printf("A = CPU %d, B = CPU %d, %d helper(s); L2 %zu KB, LLC %zu KB\n",
+           cpu_a, cpu_b, n_helpers, l2_size >> 10, llc_size >> 10);
+
+    build_targets();
+    size_t evict_bytes = 4 * l2_size;
+    char* evict_private = alloc_touched(evict_bytes);
+    char* hold_buf = alloc_touched(l2_size);
+
+    int n_workers = 1 + n_helpers;
+    worker_t* workers = calloc(n_workers, sizeof(worker_t));
+    pthread_t* threads = calloc(n_workers, sizeof(pthread_t));
+    workers[0].cpu = cpu_b;
+    workers[0].is_b = 1;
+    workers[0].buf = alloc_touched(max_stream);
+    for (int h = 0; h < n_helpers; h++) {
+        workers[1 + h].cpu = helpers[h];
+        workers[1 + h].buf = alloc_touched(2 * l2_size);
+    }
+    pthread_barrier_init(&start_barrier, NULL, n_workers + 1);
+    pthread_barrier_init(&done_barrier, NULL, n_workers + 1);
+    for (int w = 0; w < n_workers; w++) pthread_create(&threads[w], NULL, worker_func, &workers[w]);
+
+    double levels[3];
+    calibrate(evict_private, evict_bytes, levels);
+    printf("Calibrated reload on A: private %.0f, LLC %.0f, DRAM %.0f cycles (thresholds %.0f / %.0f)\n",
+           levels[LVL_PRIVATE], levels[LVL_LLC], levels[LVL_DRAM], thresh_private, thresh_llc);
+    if (levels[LVL_LLC] < levels[LVL_PRIVATE] * 1.1 || levels[LVL_DRAM] < levels[LVL_LLC] * 1.1)
+        printf("Warning: calibrated levels overlap; per-line classification will be unreliable\n");
+
+    FILE* csv = fopen("xcore_incl.csv", "w");
+    if (!csv) { perror("fopen failed"); return 1; }
+    fprintf(csv, "test,param,avg_cycles,frac_private,frac_llc,frac_dram,extra\n");
+    for (int l = 0; l < 3; l++) {
+        reload_t r = { levels[l], { l == 0, l == 1, l == 2 } };
+        record(csv, "calibration", l, r, 0);
+    }
+
+    if (!only || !strcmp(only, "llc"))     test_llc(csv, max_stream);
+    if (!only || !strcmp(only, "backinv")) test_backinv(csv, hold_buf, max_stream);
+    if (!only || !strcmp(only, "sf"))      test_sf(csv);
+
+    run_workers(CMD_QUIT);
+    for (int w = 0; w < n_workers; w++) pthread_join(threads[w], NULL);
+    pthread_barrier_destroy(&start_barrier);
+    pthread_barrier_destroy(&done_barrier);
+
+    printf("\nData saved to xcore_incl.csv\n");
+    fclose(csv);
+    cpu_report(&cpus);
+    return 0;
+}
@@ -0,0 +1,77 @@
+import sys
+import pandas as pd
+import matplotlib.pyplot as plt
+
+def plot_stlf(csv_filename, machine_name):
+    try:
+        data = pd.read_csv(csv_filename)
+    except FileNotFoundError:
+        print(f"Error: File '{csv_filename}' not found.")
+        return
+
+    plt.style.use('seaborn-v0_8-whitegrid')
+    fig, axes = plt.subplots(2, 2, figsize=(16, 12))
+
+    # Forwarding matrix: load at the store's start address
+    ax = axes[0][0]
+    fwd = data[data['case'].str.startswith('forward') & (data['case'] != 'forward_same_base')
+               & (data['offset'] == 0)]
+    grid = fwd.pivot_table(index='store_size', columns='load_size', values='cycles')
+    im = ax.imshow(grid.values, origin='lower', cmap='magma_r')
+    ax.set_xticks(range(len(grid.columns)))
+    ax.set_xticklabels([f"{c}B" for c in grid.columns])
+    ax.set_yticks(range(len(grid.index)))
+    ax.set_yticklabels([f"{r}B" for r in grid.index])
+    for y in range(grid.shape[0]):
+        for x in range(grid.shape[1]):
+            ax.text(x, y, f"{grid.values[y, x]:.1f}", ha='center', va='center', fontsize=9, color='teal')
+    ax.set_xlabel('Load size')
+    ax.set_ylabel('Store size')
+    ax.set_title('Store -> load latency (cycles)', fontsize=13, weight='bold')
+    fig.colorbar(im, ax=ax)
+
+    # Misaligned same-size pairs
+    ax = axes[0][1]
+    align = data[data['case'].str.startswith('align')]
+    for size, group in align.groupby('store_size'):
+        ax.plot(range(len(group)), group['cycles'], marker='o', label=f"{size}B")
+        ax.set_xticks(range(len(group)))
+        ax.set_xticklabels(group['alignment'], rotation=45)
+    ax.set_xlabel('Base offset (bytes)')
+    ax.set_ylabel('Cycles per store/load pair')
+    ax.set_title('Alignment (line and page splits)', fontsize=13, weight='bold')
+    ax.legend()
+
+    # Narrow stores feeding one wide load
+    ax = axes[1][0]
+    narrow = data[(data['case'] == 'narrow') & (data['alignment'] == 0)]
+    labels = [f"{r.store_size}Bx{r.offset}->{r.load_size}B" for r in narrow.itertuples()]
+    ax.bar(labels, narrow['cycles'], color='darkorange')
+    ax.set_ylabel('Cycles per sequence')
+    ax.set_title('Narrow stores, wide load', fontsize=13, weight='bold')
+    ax.tick_params(axis='x', rotation=45)
+
+    # Remaining penalties
+    ax = axes[1][1]
+    misc = data[data['case'].str.startswith(('4k_alias', 'split', 'disamb'))
+                & ~data['case'].str.endswith(('control', 'never'))]
+    labels = [f"{r.case} {r.store_size}B" if r.case.startswith('split') else
+              (f"{r.case} 1/{r.offset}" if r.case == 'disamb_random' else r.case)
+              for r in misc.itertuples()]
+    ax.barh(labels, misc['penalty'], color='teal')
+    ax.set_xscale('symlog')
+    ax.set_xlabel('Penalty (cycles; per alias event for disamb_random)')
+    ax.set_title('Aliasing, splits, disambiguation', fontsize=13, weight='bold')
+
+    fig.suptitle(f'Store Forwarding and Disambiguation ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'stlf_analysis.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nAnalysis plot saved as '{output_filename}'")
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <stlf_penalties.csv> [machine_name]")
+    else:
+        machine = sys.argv[2] if len(sys.argv) > 2 else 'Unknown'
+        plot_stlf(sys.argv[1], machine)
@@ -0,0 +1,544 @@
+/*
+  Store-to-load forwarding and memory-disambiguation probe
+
+  Every case is a JIT'd loop whose loop-carried chain runs through memory:
+  the value loaded by one pair is the data of the next store. Cycles per
+  pair therefore equal the store->load latency, and any forwarding failure
+  shows up as extra latency.
+
+  Cases (rows of stlf_penalties.csv):
+    forward    store size x load size x load offset inside the store
+    align      same-size store/load at a misaligned base (line/page split)
+    narrow     k narrow stores followed by one wide load over all of them
+               (the serialization pattern: byte/word stores, 8/16/32B read)
+    4k_alias   load 4096 bytes away from the store vs 4096+64 control
+    split      load-only / store-only throughput with line and page splits
+    disamb     late-address store followed by a load that aliases with
+               probability p: cycles per iteration for always, never and
+               each p, penalties per iteration against never
+
+  Cross-domain conversions (vmovq) needed for 16/32-byte ops are timed on
+  their own and subtracted, so `cycles` is memory latency only.
+
+  Cores that rename memory (a load at the same base+displacement as an
+  older store gets its value at register speed) would otherwise report
+  ~0.5 cycles for plain pairs. Loads therefore address through an index
+  register that is ANDed with the previous load's value: always zero, but
+  only known once that value arrives, so the pair has to go through the
+  store buffer. The AND is one cycle and is subtracted like the conversions.
+  16-byte cases use SSE encodings when the CPU has no AVX.
+
+  Build: gcc -O2 -o stlf stlf.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_jit.h"
+#include "../../common/uarch_cpu.h"
+
+#define UNROLL 16
+#define OPS_PER_POINT (1 << 18)
+#define CODE_SIZE (1 << 20)
+#define BUF_SIZE (4 * 4096)
+#define BASE_OFFSET 4096          // measured accesses start one page in
+#define DISAMB_LEN 4096           // length of the alias pattern table
+
+static int reps = 7;
+static int have_avx;
+static FILE* csv;
+static double fwd_base;           // 8B->8B aligned forwarding latency
+static int fwd_ok;                // fwd_base looks like forwarding, not renaming
+
+// Plausible 8B->8B forwarding latency; below it the pair was still renamed
+#define FWD_MIN_CYCLES 2.5
+#define FWD_MAX_CYCLES 10.0
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+// ============================================================
+// Emitters: the chained value lives in rax (<= 8 bytes) or xmm0/ymm0
+// ============================================================
+typedef struct {
+    jit_t j;
+    int in_vec;     // value currently in xmm0/ymm0 rather than rax
+    int nomem;      // emit only the domain conversions (overhead control)
+    int same_base;  // load through rdi like the store (AMD-style memory renaming key)
+    int indexed;    // load through [rdx + rcx], rcx = rcx & previous value
+    int links;      // ANDs emitted into the chain (one cycle each)
+} gen_t;
+
+static void to_vec(gen_t* g) {
+    if (g->in_vec) return;
+    if (have_avx) {  // vmovq xmm0, rax
+        jit_byte(&g->j, 0xC4); jit_byte(&g->j, 0xE1); jit_byte(&g->j, 0xF9); jit_byte(&g->j, 0x6E); jit_byte(&g->j, 0xC0);
+    } else {         // movq xmm0, rax
+        jit_byte(&g->j, 0x66); jit_byte(&g->j, 0x48); jit_byte(&g->j, 0x0F); jit_byte(&g->j, 0x6E); jit_byte(&g->j, 0xC0);
+    }
+    g->in_vec = 1;
+}
+
+static void to_gpr(gen_t* g) {
+    if (!g->in_vec) return;
+    if (have_avx) {  // vmovq rax, xmm0
+        jit_byte(&g->j, 0xC4); jit_byte(&g->j, 0xE1); jit_byte(&g->j, 0xF9); jit_byte(&g->j, 0x7E); jit_byte(&g->j, 0xC0);
+    } else {         // movq rax, xmm0
+        jit_byte(&g->j, 0x66); jit_byte(&g->j, 0x48); jit_byte(&g->j, 0x0F); jit_byte(&g->j, 0x7E); jit_byte(&g->j, 0xC0);
+    }
+    g->in_vec = 0;
+}
+
+// [rdi + disp32] or [rdx + disp32] with rax/xmm0 as the register operand
+static void modrm_base(jit_t* j, int rm, int32_t disp) {
+    jit_byte(j, 0x80 | rm);
+    jit_dword(j, (uint32_t)disp);
+}
+
+// [rdx + rcx + disp32] with rax/xmm0 as the register operand
+static void modrm_indexed(jit_t* j, int32_t disp) {
+    jit_byte(j, 0x84);
+    jit_byte(j, (JIT_RCX << 3) | JIT_RDX);
+    jit_dword(j, (uint32_t)disp);
+}
+
+static void emit_store(gen_t* g, int size, int32_t disp) {
+    jit_t* j = &g->j;
+    if (size <= 8) to_gpr(g); else to_vec(g);
+    if (g->nomem) return;
+    switch (size) {
+        case 1:  jit_byte(j, 0x88); break;                                   // mov [m8], al
+        case 2:  jit_byte(j, 0x66); jit_byte(j, 0x89); break;                // mov [m16], ax
+        case 4:  jit_byte(j, 0x89); break;                                   // mov [m32], eax
+        case 8:  jit_byte(j, 0x48); jit_byte(j, 0x89); break;                // mov [m64], rax
+        case 16:
+            if (have_avx) { jit_byte(j, 0xC5); jit_byte(j, 0xFA); jit_byte(j, 0x7F); }        // vmovdqu [m128], xmm0
+            else { jit_byte(j, 0xF3); jit_byte(j, 0x0F); jit_byte(j, 0x7F); }                 // movdqu [m128], xmm0
+            break;
+        case 32: jit_byte(j, 0xC5); jit_byte(j, 0xFE); jit_byte(j, 0x7F); break; // vmovdqu [m256], ymm0
+    }
+    modrm_base(j, JIT_RDI, disp);
+}
+
+static void emit_load(gen_t* g, int size, int32_t disp) {
+    jit_t* j = &g->j;
+    int indexed = g->indexed && !g->same_base;
+    // and ecx, eax: ties the load address to the value the stores just wrote.
+    // A GPR load after a vector store takes the value out with vmovq first
+    // (the conversion the control times anyway); vector loads are left
+    // alone, no core renames vector store/load pairs.
+    if (indexed && g->in_vec && size <= 8) to_gpr(g);
+    if (indexed && !g->in_vec) {
+        jit_byte(j, 0x21); jit_byte(j, 0xC1);
+        g->links++;
+    }
+    if (g->nomem) {
+        if (size <= 8) to_gpr(g); else to_vec(g);
+        return;
+    }
+    switch (size) {
+        case 1:  jit_byte(j, 0x0F); jit_byte(j, 0xB6); break;                // movzx eax, [m8]
+        case 2:  jit_byte(j, 0x0F); jit_byte(j, 0xB7); break;                // movzx eax, [m16]
+        case 4:  jit_byte(j, 0x8B); break;                                   // mov eax, [m32]
+        case 8:  jit_byte(j, 0x48); jit_byte(j, 0x8B); break;                // mov rax, [m64]
+        case 16:
+            if (have_avx) { jit_byte(j, 0xC5); jit_byte(j, 0xFA); jit_byte(j, 0x6F); }        // vmovdqu xmm0, [m128]
+            else { jit_byte(j, 0xF3); jit_byte(j, 0x0F); jit_byte(j, 0x6F); }                 // movdqu xmm0, [m128]
+            break;
+        case 32: jit_byte(j, 0xC5); jit_byte(j, 0xFE); jit_byte(j, 0x6F); break; // vmovdqu ymm0, [m256]
+    }
+    // Stores address through rdi, loads through rdx (a copy of rdi), plus
+    // rcx when indexed; same_base keeps the renamer's key for comparison
+    if (g->same_base) modrm_base(j, JIT_RDI, disp);
+    else if (indexed) modrm_indexed(j, disp);
+    else modrm_base(j, JIT_RDX, disp);
+    g->in_vec = size > 8;
+}
+
+static void gen_begin(gen_t* g, unsigned char* code, int nomem, size_t* top) {
+    jit_init(&g->j, code, CODE_SIZE);
+    g->in_vec = 0;
+    g->nomem = nomem;
+    g->same_base = 0;
+    g->indexed = 0;
+    g->links = 0;
+    jit_byte(&g->j, 0x31); jit_byte(&g->j, 0xC0);                        // xor eax, eax
+    jit_byte(&g->j, 0x31); jit_byte(&g->j, 0xC9);                        // xor ecx, ecx
+    jit_mov_rr(&g->j, JIT_RDX, JIT_RDI);                                  // mov rdx, rdi
+    jit_align(&g->j, 16);
+    *top = g->j.pos;
+}
+
+static void gen_end(gen_t* g, size_t top) {
+    to_gpr(g);   // every iteration starts and ends with the value in rax
+    jit_dec(&g->j, JIT_RSI);                                              // dec rsi
+    jit_jnz_back(&g->j, top);                                             // jnz top
+    if (have_avx) {
+        jit_byte(&g->j, 0xC5); jit_byte(&g->j, 0xF8); jit_byte(&g->j, 0x77);  // vzeroupper
+    }
+    jit_ret(&g->j);
+    jit_finish(&g->j);
+}
+
+typedef void (*loop_fn)(uint8_t* base, uint64_t iters, const uint64_t* table);
+
+static double time_loop(unsigned char* code, uint8_t* base, uint64_t iters, const uint64_t* table) {
+    loop_fn fn = (loop_fn)code;
+    fn(base, iters, table);
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < reps; r++) {
+        uint64_t start = start_timer();
+        fn(base, iters, table);
+        uint64_t t = end_timer() - start;
+        if (t < best) best = t;
+    }
+    return (double)best / iters;
+}
+
+// A store/load chain described by `pairs` (size, offset) entries
+typedef struct { int st_size, st_off, ld_size, ld_off; } pair_t;
+
+static void emit_pairs(gen_t* g, const pair_t* p, int n_pairs, int narrow_k) {
+    for (int u = 0; u < UNROLL; u++) {
+        for (int i = 0; i < n_pairs; i++) {
+            // narrow_k > 1: k consecutive stores cover one wide load
+            int k = narrow_k > 1 ? narrow_k : 1;
+            for (int s = 0; s < k; s++) emit_store(g, p[i].st_size, p[i].st_off + s * p[i].st_size);
+            emit_load(g, p[i].ld_size, p[i].ld_off);
+        }
+    }
+}
+
+// Latency per store->load pair, net of any domain conversions and index ANDs
+static double measure_pairs(unsigned char* code, uint8_t* base, const pair_t* p, int narrow_k, int same_base) {
+    uint64_t iters = OPS_PER_POINT / UNROLL;
+    size_t top;
+    gen_t g;
+
+    gen_begin(&g, code, 0, &top);
+    g.same_base = same_base;
+    g.indexed = 1;
+    emit_pairs(&g, p, 1, narrow_k);
+    gen_end(&g, top);
+    double with_mem = time_loop(code, base, iters, NULL);
+    int links = g.links;
+
+    // The control leaves the ANDs out of the chain: they are subtracted as
+    // one cycle each instead, since without the load nothing consumes rcx
+    gen_begin(&g, code, 1, &top);
+    g.same_base = same_base;
+    emit_pairs(&g, p, 1, narrow_k);
+    gen_end(&g, top);
+    double conversions = time_loop(code, base, iters, NULL);
+
+    return (with_mem - conversions - links) / UNROLL;
+}
+
+static void record(const char* kase, int st, int ld, int off, int align, double cycles) {
+    double penalty = fwd_ok ? cycles - fwd_base : NAN;
+    fprintf(csv, "%s,%d,%d,%d,%d,%.3f,%.3f\n", kase, st, ld, off, align, cycles, penalty);
+    fflush(csv);
+}
+
+// 16-byte cases fall back to SSE encodings; 32-byte ones need AVX
+static int size_ok(int size) { return size <= 16 || (size == 32 && have_avx); }
+
+// ============================================================
+// Cases
+// ============================================================
+static const int sizes[] = { 1, 2, 4, 8, 16, 32 };
+#define N_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+static void test_forward(unsigned char* code, uint8_t* buf) {
+    uint8_t* base = buf + BASE_OFFSET + 128;
+    pair_t base_pair = { 8, 0, 8, 0 };
+    fwd_base = measure_pairs(code, base, &base_pair, 1, 0);
+    fwd_ok = fwd_base >= FWD_MIN_CYCLES && fwd_base <= FWD_MAX_CYCLES;
+    double renamed = measure_pairs(code, base, &base_pair, 1, 1);
+    fprintf(csv, "forward_same_base,8,8,0,0,%.3f,%.3f\n", renamed, fwd_ok ? renamed - fwd_base : NAN);
+    printf("\n8B->8B: %.2f cycles with a value-dependent address, %.2f through the store's base register\n",
+           fwd_base, renamed);
+    if (!fwd_ok)
+        fprintf(stderr, "warning: 8B->8B baseline of %.2f cycles is outside [%.1f, %.1f]; "
+                "penalties are written as nan\n", fwd_base, FWD_MIN_CYCLES, FWD_MAX_CYCLES);
+
+    printf("\n[forward] store->load latency, aligned, load at store start (cycles)\n");
+    printf("  store\\load");
+    for (int l = 0; l < N_SIZES; l++) if (size_ok(sizes[l])) printf(" %6d", sizes[l]);
+    printf("\n");
+
+    for (int s = 0; s < N_SIZES; s++) {
+        int st = sizes[s];
+        if (!size_ok(st)) continue;
+        printf("  %10d", st);
+        for (int l = 0; l < N_SIZES; l++) {
+            int ld = sizes[l];
+            if (!size_ok(ld)) continue;
+            // Offsets: start, one byte in, middle, flush with the end
+            int offsets[4] = { 0, 1, st / 2, st - ld };
+            for (int o = 0; o < 4; o++) {
+                int off = offsets[o];
+                if (off < 0 || off >= st) continue;
+                int dup = 0;
+                for (int q = 0; q < o; q++) if (offsets[q] == off) dup = 1;
+                if (dup) continue;
+                pair_t p = { st, 0, ld, off };
+                double cycles = measure_pairs(code, base, &p, 1, 0);
+                record(off + ld <= st ? "forward" : "forward_partial", st, ld, off, 0, cycles);
+                if (off == 0) printf(" %6.1f", cycles);
+            }
+        }
+        printf("\n");
+    }
+    printf("  (loads larger than the store, or straddling its end, are partial overlaps;\n"
+           "   entries near 1 cycle or below mean the core renamed the pair instead of forwarding)\n");
+}
+
+static void test_align(unsigned char* code, uint8_t* buf) {
+    static const int aligns[] = { 0, 1, 4, 8, 16, 32, 48, 56, 60, 62, 63, 4092 };
+    printf("\n[align] same-size store/load at base offset (cycles)\n");
+    printf("  offset");
+    for (int s = 2; s < N_SIZES; s++) if (size_ok(sizes[s])) printf(" %6dB", sizes[s]);
+    printf("\n");
+    for (size_t a = 0; a < sizeof(aligns) / sizeof(aligns[0]); a++) {
+        printf("  %6d", aligns[a]);
+        for (int s = 2; s < N_SIZES; s++) {
+            int sz = sizes[s];
+            if (!size_ok(sz)) continue;
+            pair_t p = { sz, 0, sz, 0 };
+            double cycles = measure_pairs(code, buf + BASE_OFFSET + aligns[a], &p, 1, 0);
+            int split = (aligns[a] % 64) + sz > 64;
+            record(split ? "align_split" : "align", sz, sz, 0, aligns[a], cycles);
+            printf(" %7.1f", cycles);
+        }
+        printf("\n");
+    }
+}
+
+static void test_narrow(unsigned char* code, uint8_t* buf) {
+    static const int aligns[] = { 0, 1, 3, 60 };
+    printf("\n[narrow] k narrow stores then one wide load over them (cycles per sequence)\n");
+    printf("  store x k -> load | offset:");
+    for (size_t a = 0; a < sizeof(aligns) / sizeof(aligns[0]); a++) printf(" %6d", aligns[a]);
+    printf("\n");
+    for (int s = 0; s < 3; s++) {              // 1, 2, 4 byte stores
+        for (int l = 3; l < N_SIZES; l++) {    // 8, 16, 32 byte loads
+            int st = sizes[s], ld = sizes[l];
+            if (!size_ok(ld)) continue;
+            int k = ld / st;
+            if (k > 32) continue;
+            printf("  %2dB x %2d -> %2dB     |        ", st, k, ld);
+            for (size_t a = 0; a < sizeof(aligns) / sizeof(aligns[0]); a++) {
+                pair_t p = { st, 0, ld, 0 };
+                double cycles = measure_pairs(code, buf + BASE_OFFSET + aligns[a], &p, k, 0);
+                record("narrow", st, ld, k, aligns[a], cycles);
+                printf(" %6.1f", cycles);
+            }
+            printf("\n");
+        }
+    }
+}
+
+// Store the chained value to [rdi], load it back from [rdi + dist]. The
+// load address goes through the AND on the previous load, so the load
+// issues next to a store whose data is still on its way, and each pair
+// is on the critical path; cycles per pair net of the AND.
+static double alias_loop(unsigned char* code, uint8_t* base, int32_t dist) {
+    gen_t g;
+    size_t top;
+    gen_begin(&g, code, 0, &top);
+    g.indexed = 1;
+    for (int u = 0; u < UNROLL; u++) {
+        emit_store(&g, 8, 0);
+        emit_load(&g, 8, dist);
+    }
+    gen_end(&g, top);
+    return (time_loop(code, base, OPS_PER_POINT / UNROLL, NULL) - g.links) / UNROLL;
+}
+
+static void test_4k_alias(unsigned char* code, uint8_t* buf) {
+    uint8_t* base = buf + 128;
+    double alias = alias_loop(code, base, 4096);
+    double control = alias_loop(code, base, 4096 + 64);
+    printf("\n[4k_alias] dependent load 4096B past the store: %.2f cycles/pair vs %.2f at 4096+64 (%+.2f)\n",
+           alias, control, alias - control);
+    fprintf(csv, "4k_alias,8,8,4096,0,%.3f,%.3f\n", alias, alias - control);
+    fprintf(csv, "4k_alias_control,8,8,4160,0,%.3f,0.000\n", control);
+}
+
+// Throughput of independent loads or stores at a given offset
+static double split_loop(unsigned char* code, uint8_t* base, int size, int is_store) {
+    gen_t g;
+    size_t top;
+    gen_begin(&g, code, 0, &top);
+    if (size > 8) to_vec(&g);
+    for (int u = 0; u < UNROLL * 4; u++) {
+        if (is_store) emit_store(&g, size, 0);
+        else {
+            emit_load(&g, size, 0);
+        }
+    }
+    gen_end(&g, top);
+    return time_loop(code, base, OPS_PER_POINT / (UNROLL * 4), NULL) / (UNROLL * 4);
+}
+
+static void test_split(unsigned char* code, uint8_t* buf) {
+    printf("\n[split] cycles per independent op: aligned | line split | page split\n");
+    for (int s = 3; s < N_SIZES; s++) {
+        int sz = sizes[s];
+        if (!size_ok(sz)) continue;
+        for (int is_store = 0; is_store < 2; is_store++) {
+            double aligned = split_loop(code, buf + BASE_OFFSET, sz, is_store);
+            double line = split_loop(code, buf + BASE_OFFSET + 64 - sz / 2, sz, is_store);
+            double page = split_loop(code, buf + BASE_OFFSET + 4096 - sz / 2, sz, is_store);
+            const char* kind = is_store ? "store" : "load";
+            printf("  %-5s %2dB: %6.2f | %6.2f (+%.2f) | %6.2f (+%.2f)\n", kind, sz,
+                   aligned, line, line - aligned, page, page - aligned);
+            fprintf(csv, "split_%s_line,%d,%d,%d,%d,%.3f,%.3f\n", kind, sz, sz, 0, 64 - sz / 2, line, line - aligned);
+            fprintf(csv, "split_%s_page,%d,%d,%d,%d,%.3f,%.3f\n", kind, sz, sz, 0, 4096 - sz / 2, page, page - aligned);
+        }
+    }
+}
+
+// Late-address store (imul chain on the offset) then a load from [rdi].
+// rdx holds per-iteration store offsets: 0 aliases the load, 64 does not.
+static void test_disamb(unsigned char* code, uint8_t* buf) {
+    jit_t j;
+    jit_init(&j, code, CODE_SIZE);
+    jit_byte(&j, 0x31); jit_byte(&j, 0xC9);                                          // xor ecx, ecx
+    jit_byte(&j, 0x31); jit_byte(&j, 0xC0);                                          // xor eax, eax
+    jit_byte(&j, 0x49); jit_byte(&j, 0xC7); jit_byte(&j, 0xC1); jit_dword(&j, 1);    // mov r9, 1
+    jit_align(&j, 16);
+    size_t top = j.pos;
+    jit_byte(&j, 0x4C); jit_byte(&j, 0x8B); jit_byte(&j, 0x04); jit_byte(&j, 0xCA);  // mov r8, [rdx + rcx*8]
+    for (int k = 0; k < 4; k++) {
+        jit_byte(&j, 0x4D); jit_byte(&j, 0x0F); jit_byte(&j, 0xAF); jit_byte(&j, 0xC1); // imul r8, r9
+    }
+    jit_byte(&j, 0x4A); jit_byte(&j, 0x89); jit_byte(&j, 0x04); jit_byte(&j, 0x07);  // mov [rdi + r8], rax
+    jit_byte(&j, 0x48); jit_byte(&j, 0x8B); jit_byte(&j, 0x07);                      // mov rax, [rdi]
+    jit_byte(&j, 0x48); jit_byte(&j, 0xFF); jit_byte(&j, 0xC1);                      // inc rcx
+    jit_byte(&j, 0x48); jit_byte(&j, 0x81); jit_byte(&j, 0xE1); jit_dword(&j, DISAMB_LEN - 1); // and rcx, LEN-1
+    jit_dec(&j, JIT_RSI);
+    jit_jnz_back(&j, top);
+    jit_ret(&j);
+    jit_finish(&j);
+
+    uint64_t* table = malloc(DISAMB_LEN * sizeof(uint64_t));
+    uint8_t* base = buf + BASE_OFFSET;
+    const uint64_t iters = OPS_PER_POINT;
+    uint64_t rng = 0x2545F4914F6CDD1Dull;
+
+    for (int i = 0; i < DISAMB_LEN; i++) table[i] = 64;
+    double never = time_loop(code, base, iters, table);
+    for (int i = 0; i < DISAMB_LEN; i++) table[i] = 0;
+    double always = time_loop(code, base, iters, table);
+
+    printf("\n[disamb] late-address store, load aliases with probability p\n");
+    printf("  never aliases: %.2f cycles/iter, always aliases: %.2f cycles/iter\n", never, always);
+    fprintf(csv, "disamb_never,8,8,0,0,%.3f,0.000\n", never);
+    fprintf(csv, "disamb_always,8,8,0,0,%.3f,%.3f\n", always, always - never);
+
+    // Extra cycles per iteration, not per alias event: once the predictor
+    // starts holding the load back every iteration pays, so dividing by
+    // the alias rate does not give a per-event cost
+    static const int inv_p[] = { 256, 64, 16, 4 };
+    for (size_t q = 0; q < sizeof(inv_p) / sizeof(inv_p[0]); q++) {
+        int hits = 0;
+        for (int i = 0; i < DISAMB_LEN; i++) {
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            table[i] = (rng % inv_p[q] == 0) ? 0 : 64;
+            hits += table[i] == 0;
+        }
+        if (hits == 0) table[0] = 0;
+        double cycles = time_loop(code, base, iters, table);
+        printf("  p = 1/%-3d: %.2f cycles/iter (%+.2f vs never)\n", inv_p[q], cycles, cycles - never);
+        fprintf(csv, "disamb_random,8,8,%d,0,%.3f,%.3f\n", inv_p[q], cycles, cycles - never);
+    }
+    free(table);
+}
+
+void handle_args(int argc, char* argv[], const char** only) {
+    static struct option long_options[] = {
+        {"test", required_argument, NULL, 't'},
+        {"reps", required_argument, NULL, 'r'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 't': *only = optarg; break;
+            case 'r': sscanf(optarg, "%d", &reps); break;
+            default:
+                fprintf(stderr, "Usage: %s [--test forward|align|narrow|4k_alias|split|disamb] [--reps N]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (reps < 1) reps = 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Pin process to a single CPU core
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    const char* only = NULL;
+    handle_args(argc, argv, &only);
+
+    have_avx = __builtin_cpu_supports("avx");
+    uint8_t* buf;
+    if (posix_memalign((void**)&buf, 4096, BUF_SIZE) != 0) {
+        perror("posix_memalign failed");
+        return 1;
+    }
+    memset(buf, 0, BUF_SIZE);
+    unsigned char* code = jit_alloc(CODE_SIZE);
+    if (!code) return 1;
+
+    csv = fopen("stlf_penalties.csv", "w");
+    if (!csv) { perror("fopen failed"); return 1; }
+    fprintf(csv, "case,store_size,load_size,offset,alignment,cycles,penalty\n");
+
+    printf("Store Forwarding / Memory Disambiguation Probe\n");
+    printf("==============================================\n");
+    if (!have_avx) printf("(no AVX: 32-byte cases skipped, 16-byte cases use SSE)\n");
+
+    // The forward matrix sets fwd_base, which every penalty is relative to
+    test_forward(code, buf);
+    if (!only || !strcmp(only, "align"))    test_align(code, buf);
+    if (!only || !strcmp(only, "narrow"))   test_narrow(code, buf);
+    if (!only || !strcmp(only, "4k_alias")) test_4k_alias(code, buf);
+    if (!only || !strcmp(only, "split"))    test_split(code, buf);
+    if (!only || !strcmp(only, "disamb"))   test_disamb(code, buf);
+
+    if (fwd_ok)
+        printf("\nBaseline 8B->8B forwarding latency: %.2f cycles; penalties are relative to it.\n", fwd_base);
+    else
+        printf("\nBaseline 8B->8B latency of %.2f cycles is not plausible forwarding; penalties not computed.\n", fwd_base);
+    printf("Data saved to stlf_penalties.csv\n");
+
+    fclose(csv);
+    jit_release(code, CODE_SIZE);
+    free(buf);
+    cpu_report(&cpus);
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+  Memory-level parallelism probe
+
+  Runs K independent pointer chains (K = 1..32) interleaved in one JIT'd
+  loop, the same `mov r,[r]` chase rob_size.c uses, and watches how the
+  time per access falls as K grows. Once every outstanding miss slot is
+  busy, adding chains stops helping: the K where effective MLP saturates
+  is the number of miss-handling entries for that level.
+
+    l2    working set in L2  -> L1 misses in flight  (L1 fill buffers)
+    l3    working set in LLC -> L2 misses in flight  (L2 MSHRs / superqueue)
+    dram  working set >> LLC -> same L2 limit, plus memory-side queuing
+
+  All chains walk one random single-cycle permutation of cache lines, with
+  heads spaced evenly around the cycle (found by walking it once from the
+  first line), so the footprint does not change with K and no chain runs
+  into lines another one has just fetched. Chains 0..12 live in registers, the rest in stack slots.
+
+  Build: gcc -O2 -o mlp mlp.c
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <x86intrin.h>
+
+#include "../../common/uarch_jit.h"
+#include "../../common/uarch_cpu.h"
+#include "../../common/uarch_evict.h"
+
+#define MAX_CHAINS 32
+#define LINE 64
+#define CODE_SIZE (64 * 1024)
+#define ACCESSES_PER_POINT (1 << 20)
+#define SATURATION 0.9          // knee: first K reaching 90% of peak MLP
+
+static int reps = 5;
+static int max_chains = MAX_CHAINS;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+// Registers that carry chains (rax is scratch for stack-slot chains, r15 counts)
+static const int chain_regs[] = {
+    JIT_RCX, JIT_RDX, JIT_RBX, JIT_RSI, JIT_RDI, JIT_RBP,
+    JIT_R8, JIT_R9, JIT_R10, JIT_R11, JIT_R12, JIT_R13, JIT_R14
+};
+#define N_CHAIN_REGS (int)(sizeof(chain_regs) / sizeof(chain_regs[0]))
+
+// --- Timing Functions ---
+static inline uint64_t start_timer(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return __rdtsc();
+}
+
+static inline uint64_t end_timer(void) {
+    uint32_t aux, eax, ebx, ecx, edx;
+    uint64_t t = __rdtscp(&aux);
+    __asm__ __volatile__ ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    return t;
+}
+
+static inline uint64_t next_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// One pointer per line, linked in a random single cycle (Sattolo's shuffle)
+static void** build_cycle(size_t bytes, size_t* n_lines) {
+    size_t n = bytes / LINE;
+    void** buf = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        perror("mmap (chain)");
+        exit(EXIT_FAILURE);
+    }
+    madvise(buf, bytes, MADV_HUGEPAGE);   // keep TLB misses out of the DRAM points
+
+    size_t* idx = malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) idx[i] = i;
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = next_rand() % i;
+        size_t t = idx[i]; idx[i] = idx[j]; idx[j] = t;
+    }
+    const size_t stride = LINE / sizeof(void*);
+    for (size_t i = 0; i < n; i++)
+        buf[i * stride] = &buf[idx[i] * stride];
+    free(idx);
+    *n_lines = n;
+    return buf;
+}
+
+// void fn(void** heads, uint64_t steps): each step advances all K chains once
+static void make_routine(unsigned char* code, int k) {
+    static const int saved[] = { JIT_RBX, JIT_RBP, JIT_R12, JIT_R13, JIT_R14, JIT_R15 };
+    const int n_saved = sizeof(saved) / sizeof(saved[0]);
+    int in_regs = k < N_CHAIN_REGS ? k : N_CHAIN_REGS;
+    int in_slots = k - in_regs;
+    int frame = ((in_slots * 8 + 15) / 16) * 16;
+    jit_t j;
+    jit_init(&j, code, CODE_SIZE);
+
+    for (int i = 0; i < n_saved; i++) jit_push(&j, saved[i]);
+    jit_mov_rr(&j, JIT_R15, JIT_RSI);                  // step counter
+    jit_mov_rr(&j, JIT_RAX, JIT_RDI);                  // heads array
+    if (frame) jit_add_imm(&j, JIT_RSP, -frame);
+    for (int c = in_regs; c < k; c++) {
+        jit_load64(&j, JIT_RCX, JIT_RAX, c * 8);       // copy via rcx; its own head is loaded below
+        jit_store64(&j, JIT_RSP, (c - in_regs) * 8, JIT_RCX);
+    }
+    for (int c = 0; c < in_regs; c++) jit_load64(&j, chain_regs[c], JIT_RAX, c * 8);
+
+    jit_align(&j, 16);
+    size_t top = j.pos;
+    for (int c = 0; c < in_regs; c++) jit_load64(&j, chain_regs[c], chain_regs[c], 0);  // mov r, [r]
+    for (int c = 0; c < in_slots; c++) {
+        jit_load64(&j, JIT_RAX, JIT_RSP, c * 8);       // mov rax, [rsp + slot]
+        jit_load64(&j, JIT_RAX, JIT_RAX, 0);           // mov rax, [rax]
+        jit_store64(&j, JIT_RSP, c * 8, JIT_RAX);      // mov [rsp + slot], rax
+    }
+    jit_dec(&j, JIT_R15);
+    jit_jnz_back(&j, top);
+
+    if (frame) jit_add_imm(&j, JIT_RSP, frame);
+    for (int i = n_saved - 1; i >= 0; i--) jit_pop(&j, saved[i]);
+    jit_ret(&j);
+    jit_finish(&j);
+}
+
+typedef void (*chase_fn)(void** heads, uint64_t steps);
+
+typedef struct { size_t pos; int k, c; } head_pos_t;
+
+static int cmp_head_pos(const void* a, const void* b) {
+    size_t x = ((const head_pos_t*)a)->pos, y = ((const head_pos_t*)b)->pos;
+    return (x > y) - (x < y);
+}
+
+// heads[k][c]: the node c * n_lines / k hops from buf[0] along the cycle,
+// for every K, collected in a single walk
+static void find_heads(void** buf, size_t n_lines, void* heads[][MAX_CHAINS]) {
+    head_pos_t want[MAX_CHAINS * (MAX_CHAINS + 1) / 2];
+    int n = 0;
+    for (int k = 1; k <= max_chains; k++)
+        for (int c = 0; c < k; c++)
+            want[n++] = (head_pos_t){ (size_t)c * n_lines / k, k, c };
+    qsort(want, n, sizeof(want[0]), cmp_head_pos);
+
+    void** node = buf;
+    size_t pos = 0;
+    for (int i = 0; i < n; i++) {
+        while (pos < want[i].pos) { node = (void**)*node; pos++; }
+        heads[want[i].k][want[i].c] = node;
+    }
+}
+
+// Cycles per step with K chains (a step issues one access per chain)
+static double time_chains(unsigned char* code, void** heads, int k) {
+    make_routine(code, k);
+    chase_fn fn = (chase_fn)code;
+    uint64_t steps = ACCESSES_PER_POINT / k;
+    fn(heads, steps);   // warm the lines and the TLB
+
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < reps; r++) {
+        uint64_t start = start_timer();
+        fn(heads, steps);
+        uint64_t t = end_timer() - start;
+        if (t < best) best = t;
+    }
+    return (double)best / steps;
+}
+
+static void run_level(FILE* csv, unsigned char* code, const char* level, size_t bytes) {
+    size_t n_lines;
+    void** buf = build_cycle(bytes, &n_lines);
+    static void* heads[MAX_CHAINS + 1][MAX_CHAINS];
+    find_heads(buf, n_lines, heads);
+    double latency = 0, mlp[MAX_CHAINS + 1] = { 0 }, peak = 0;
+
+    printf("\n[%s] working set %zu KB\n", level, bytes >> 10);
+    printf("  chains | cycles/step | cycles/access | effective MLP\n");
+    for (int k = 1; k <= max_chains; k++) {
+        double per_step = time_chains(code, heads[k], k);
+        double per_access = per_step / k;
+        if (k == 1) latency = per_step;
+        mlp[k] = latency / per_access;
+        if (mlp[k] > peak) peak = mlp[k];
+        printf("  %6d | %11.1f | %13.2f | %6.2f\n", k, per_step, per_access, mlp[k]);
+        fprintf(csv, "%s,%zu,%d,%.3f,%.3f,%.3f\n", level, bytes, k, per_step, per_access, mlp[k]);
+        fflush(csv);
+    }
+
+    int knee = max_chains;
+    for (int k = 1; k <= max_chains; k++) {
+        if (mlp[k] >= SATURATION * peak) { knee = k; break; }
+    }
+    printf("  latency %.1f cycles, peak MLP %.1f, saturates at ~%d chains\n", latency, peak, knee);
+    munmap(buf, bytes);
+}
+
+void handle_args(int argc, char* argv[], const char** only) {
+    static struct option long_options[] = {
+        {"level",      required_argument, NULL, 'l'},
+        {"max-chains", required_argument, NULL, 'k'},
+        {"reps",       required_argument, NULL, 'r'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'l': *only = optarg; break;
+            case 'k': sscanf(optarg, "%d", &max_chains); break;
+            case 'r': sscanf(optarg, "%d", &reps); break;
+            default:
+                fprintf(stderr, "Usage: %s [--level l2|l3|dram] [--max-chains N] [--reps N]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (max_chains < 1) max_chains = 1;
+    if (max_chains > MAX_CHAINS) max_chains = MAX_CHAINS;
+    if (reps < 1) reps = 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Pin process to a single CPU core
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    const char* only = NULL;
+    handle_args(argc, argv, &only);
+
+    size_t l1 = evict_cache_size(1, 48 << 10);
+    size_t l2 = evict_cache_size(2, 2 << 20);
+    size_t l3 = evict_cache_size(3, 32 << 20);
+
+    unsigned char* code = jit_alloc(CODE_SIZE);
+    if (!code) return 1;
+
+    FILE* csv = fopen("mlp.csv", "w");
+    if (!csv) { perror("fopen failed"); return 1; }
+    fprintf(csv, "level,working_set,chains,cycles_per_step,cycles_per_access,mlp\n");
+
+    printf("Memory-Level Parallelism Probe\n");
+    printf("==============================\n");
+    printf("L1d %zu KB, L2 %zu KB, L3 %zu KB\n", l1 >> 10, l2 >> 10, l3 >> 10);
+
+    // Half of each level keeps conflict misses from leaking to the next one
+    size_t l2_set = l2 / 2 > 4 * l1 ? l2 / 2 : l2 * 3 / 4;
+    size_t l3_set = l3 / 2 > 4 * l2 ? l3 / 2 : 0;
+    size_t dram_set = 4 * l3 > (256u << 20) ? 4 * l3 : (256u << 20);
+
+    if (!only || !strcmp(only, "l2")) run_level(csv, code, "l2", l2_set);
+    if ((!only || !strcmp(only, "l3")) && l3_set) run_level(csv, code, "l3", l3_set);
+    if (!only || !strcmp(only, "dram")) run_level(csv, code, "dram", dram_set);
+
+    printf("\nThe l2 knee estimates the L1 fill buffers; the l3/dram knees the L2 MSHRs.\n");
+    printf("Data saved to mlp.csv\n");
+
+    fclose(csv);
+    jit_release(code, CODE_SIZE);
+    cpu_report(&cpus);
+    return 0;
+}
@@ -0,0 +1,48 @@
+import sys
+import pandas as pd
+import matplotlib.pyplot as plt
+
+def plot_mlp(csv_filename, machine_name):
+    try:
+        data = pd.read_csv(csv_filename)
+    except FileNotFoundError:
+        print(f"Error: File '{csv_filename}' not found.")
+        return
+
+    plt.style.use('seaborn-v0_8-whitegrid')
+    fig, (ax_mlp, ax_cost) = plt.subplots(1, 2, figsize=(16, 6))
+
+    for level, group in data.groupby('level', sort=False):
+        label = f"{level} ({group['working_set'].iloc[0] >> 10} KB)"
+        ax_mlp.plot(group['chains'], group['mlp'], marker='o', markersize=4, label=label)
+        ax_cost.plot(group['chains'], group['cycles_per_access'], marker='o', markersize=4, label=label)
+        # Same saturation rule as mlp.c: first K reaching 90% of the peak
+        knee = group[group['mlp'] >= 0.9 * group['mlp'].max()]['chains'].iloc[0]
+        ax_mlp.axvline(knee, linestyle='--', alpha=0.5, color=ax_mlp.lines[-1].get_color())
+        print(f"{level}: peak MLP {group['mlp'].max():.1f}, saturates at ~{knee} chains")
+
+    limit = data['chains'].max()
+    ax_mlp.plot([1, limit], [1, limit], color='gray', linestyle=':', label='ideal')
+    ax_mlp.set_xlabel('Independent pointer chains')
+    ax_mlp.set_ylabel('Effective MLP (latency / cycles per access)')
+    ax_mlp.set_title('Memory-level parallelism', fontsize=13, weight='bold')
+    ax_mlp.legend()
+
+    ax_cost.set_yscale('log')
+    ax_cost.set_xlabel('Independent pointer chains')
+    ax_cost.set_ylabel('Cycles per access')
+    ax_cost.set_title('Amortized access cost', fontsize=13, weight='bold')
+    ax_cost.legend()
+
+    fig.suptitle(f'Fill Buffer / MSHR Count ({machine_name})', fontsize=16, weight='bold')
+    plt.tight_layout()
+    output_filename = 'mlp_analysis.png'
+    plt.savefig(output_filename, dpi=300)
+    print(f"\nAnalysis plot saved as '{output_filename}'")
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(f"Usage: python {sys.argv[0]} <mlp.csv> [machine_name]")
+    else:
+        machine = sys.argv[2] if len(sys.argv) > 2 else 'Unknown'
+        plot_mlp(sys.argv[1], machine)
@@ -6,6 +6,15 @@
 #include <inttypes.h>
 #include <sched.h>
 #include <time.h>
+#include <getopt.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_chain.h"
+#include "../../../common/uarch_noise.h"
+#include "../../../common/uarch_freq.h"
+#include "../../../common/uarch_cpu.h"
 
 #define MAX_BUF (128 * 1024 * 1024)
 #define MIN_BUF (4 * 1024)
@@ -33,86 +42,163 @@ static inline uint64_t rdtscp_serial(uint32_t* aux) {
     return t;
 }
 
-void shuffle(size_t *array, size_t n) {
-    if (n > 1) {
-        for (size_t i = 0; i < n - 1; i++) {
-            size_t j = i + rand() / (RAND_MAX / (n - i) + 1);
-            size_t t = array[j];
-            array[j] = array[i];
-            array[i] = t;
+// Chain layouts to sweep (see uarch_chain.h). line vs page_lines is the
+// same lines in a different page order: their difference is page-walk cost.
+static int layouts[CHAIN_NUM_LAYOUTS] = {CHAIN_ELEM, CHAIN_LINE, CHAIN_PAGE_LINES, CHAIN_PAGE_OFF};
+static int num_layouts = 4;
+static int isolate = 0;     // --isolate: quiet CPU, redo disturbed measurements
+static long pin_khz = 0;    // --pin-khz: fix the core clock through cpufreq
+
+static void parse_layouts(char* list) {
+    num_layouts = 0;
+    for (char* tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int l = chain_layout_parse(tok);
+        if (l < 0 || num_layouts == CHAIN_NUM_LAYOUTS) {
+            fprintf(stderr, "Unknown or repeated layout '%s' (elem, line, page_lines, page, page_off)\n", tok);
+            exit(EXIT_FAILURE);
         }
+        layouts[num_layouts++] = l;
     }
 }
 
-int main(void) {
+void handle_args(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"layout", required_argument, NULL, 'l'},
+        {"isolate", no_argument, NULL, 'i'},
+        {"pin-khz", required_argument, NULL, 'k'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'l': parse_layouts(optarg); break;
+            case 'i': isolate = 1; break;
+            case 'k': pin_khz = atol(optarg); break;
+            default: exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static int has_layout(int layout) {
+    for (int i = 0; i < num_layouts; i++)
+        if (layouts[i] == layout) return 1;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
     // Pin process to a single CPU core
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
-    srand(time(NULL));
+    handle_args(argc, argv);
+
+    // Re-pin to an isolated/quiet CPU and report how noisy it is
+    noise_ctx_t noise = {0};
+    if (isolate) {
+        if (noise_init(&noise) != 0) return 1;
+        noise_floor_t floor;
+        noise_floor(1.0, &floor);
+        noise_print_floor(&floor);
+    }
+
     FILE *fp = fopen("cache_hierarchy_data.csv", "w");
     if (!fp) { perror("fopen failed"); return 1; }
 
-    fprintf(fp, "working_set_size_bytes,time_per_access_cycles\n");
+    fprintf(fp, "working_set_size_bytes,layout,time_per_access_cycles,core_cycles_per_access,ns_per_access,valid\n");
     printf("Running pointer-chasing benchmark...\n");
 
-    // Sweep in powers of two
-    for (size_t buf_size = MIN_BUF; buf_size <= MAX_BUF; buf_size <<= 1) {
-        size_t num_elements = buf_size / sizeof(void*);
+    // Dependent loads only: mov rax, [rax] unrolled
+    kern_t chase = {0};
+    if (kern_chase(&chase, KERN_CHASE_PTR) != 0) return 1;
 
-        // Allocate 64-byte aligned memory
-        void** array;
-        if (posix_memalign((void**)&array, 64, buf_size) != 0) {
-            perror("posix_memalign failed");
-            return 1;
-        }
-
-        size_t* indices = (size_t*)malloc(num_elements * sizeof(size_t));
-        if (!indices) { perror("malloc failed"); free(array); return 1; }
-
-        // Create random permutation
-        for (size_t i = 0; i < num_elements; i++) indices[i] = i;
-        shuffle(indices, num_elements);
-
-        // Create circular linked list
-        for (size_t i = 0; i < num_elements - 1; i++) {
-            array[indices[i]] = (void*)&array[indices[i+1]];
-        }
-        array[indices[num_elements - 1]] = (void*)&array[indices[0]];
-
-        // Multiple measurements
-        double total_cycles = 0;
-        for (int iter = 0; iter < ITERATIONS; iter++) {
-            void** p = array;
-            unsigned aux;
+    // Allocate page-aligned memory once; each size relinks its prefix.
+    // The page layouts reason about 4 KB pages, so keep THP out of it.
+    void** array;
+    if (posix_memalign((void**)&array, 4096, MAX_BUF) != 0) {
+        perror("posix_memalign failed");
+        return 1;
+    }
+    madvise(array, MAX_BUF, MADV_NOHUGEPAGE);
 
-            // Ensure enough traversals
-            size_t traversals = (num_elements < 100000) ? 100000 : num_elements;
+    // TSC ticks -> core cycles and ns; settle the clock before measuring
+    freq_ctx_t freq;
+    freq_init(&freq, sched_getcpu());
+    if (pin_khz && freq_pin(&freq, pin_khz) != 0) { free(array); return 1; }
+    freq_warm(&freq, 2000);
+    freq_print(&freq);
 
-            uint64_t start = rdtsc_serial();
-            for (size_t i = 0; i < traversals; i++) {
-                p = (void**)*p; // pointer chase
+    // Sweep in powers of two
+    for (size_t buf_size = MIN_BUF; buf_size <= MAX_BUF; buf_size <<= 1) {
+        double lat[CHAIN_NUM_LAYOUTS] = {0};
+        for (int li = 0; li < num_layouts; li++) {
+            int layout = layouts[li];
+            size_t num_elements = chain_nodes(buf_size, layout);
+
+            // Circular linked list in random order (permutation cached on disk)
+            void** head = chain_build(array, buf_size, layout, CHAIN_SEED);
+            if (!head) { free(array); freq_close(&freq); return 1; }
+
+            // Multiple measurements; CFS-throttled ones are left out of the
+            // average, and a point with no clean measurement is marked invalid
+            double total_cycles = 0, total_core = 0, all_cycles = 0, all_core = 0;
+            int clean = 0;
+            for (int iter = 0; iter < ITERATIONS; iter++) {
+                unsigned aux;
+
+                // Ensure enough traversals
+                size_t traversals = (num_elements < 100000) ? 100000 : num_elements;
+                traversals -= traversals % chase.per_rep;
+
+                uint64_t start, end;
+                freq_sample_t fs;
+                cpu_throttle_t thr;
+                NOISE_SAMPLE(&noise, {
+                    cpu_throttle_read(&cpus.stat, &thr);
+                    freq_begin(&freq, &fs);
+                    start = rdtsc_serial();
+                    kern_run(&chase, head, NULL, traversals / chase.per_rep); // pointer chase
+                    end = rdtscp_serial(&aux);
+                    freq_end(&freq, &fs);
+                });
+
+                double cycles = (double)(end - start) / traversals;
+                double core = freq_core(&freq, &fs, (double)(end - start)) / traversals;
+                all_cycles += cycles;
+                all_core += core;
+                if (cpu_throttled(&cpus, &thr)) continue;
+                total_cycles += cycles;
+                total_core += core;
+                clean++;
             }
-            asm volatile("" : "+r" (p)); // prevent optimization
-            uint64_t end = rdtscp_serial(&aux);
 
-            total_cycles += (double)(end - start) / traversals;
+            int valid = clean > 0;
+            double avg_cycles = valid ? total_cycles / clean : all_cycles / ITERATIONS;
+            double avg_core = valid ? total_core / clean : all_core / ITERATIONS;
+            double avg_ns = freq_ns(&freq, avg_cycles);
+            lat[layout] = avg_core;
+            printf("Size: %9zu bytes, Layout: %-10s Latency: %8.2f TSC, %8.2f core cycles, %7.2f ns%s\n",
+                   buf_size, chain_layout_name(layout), avg_cycles, avg_core, avg_ns,
+                   valid ? "" : " (INVALID: throttled)");
+            fprintf(fp, "%zu,%s,%.2f,%.2f,%.3f,%d\n", buf_size, chain_layout_name(layout),
+                    avg_cycles, avg_core, avg_ns, valid);
         }
-
-        double avg_cycles = total_cycles / ITERATIONS;
-        printf("Size: %9zu bytes, Latency: %8.2f cycles\n", buf_size, avg_cycles);
-        fprintf(fp, "%zu,%.2f\n", buf_size, avg_cycles);
-
-        free(array);
-        free(indices);
+        // Same lines, TLB-friendly page order: the gap is the page walk
+        if (has_layout(CHAIN_LINE) && has_layout(CHAIN_PAGE_LINES))
+            printf("Size: %9zu bytes, with TLB %8.2f, TLB-less %8.2f, page walk %8.2f cycles\n",
+                   buf_size, lat[CHAIN_LINE], lat[CHAIN_PAGE_LINES],
+                   lat[CHAIN_LINE] - lat[CHAIN_PAGE_LINES]);
     }
+    free(array);
 
     fclose(fp);
+    kern_free(&chase);
+    noise_report(&noise);
+    noise_close(&noise);
+    freq_close(&freq);
     printf("Data written to cache_hierarchy_data.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
@@ -5,10 +5,17 @@
 #include <x86intrin.h>
 #include <sched.h>
 
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_cpu.h"
+
 #define ARRAY_SIZE (128 * 1024 * 1024)
 #define NUM_ACCESSES 1000000 // A good number for a single run
+#ifndef MAX_STRIDE
 #define MAX_STRIDE 65536
+#endif
+#ifndef NUM_RUNS
 #define NUM_RUNS 50 // Collect 50 raw data points per stride
+#endif
 
 // --- Timing Harness ---
 static inline uint64_t rdtscp_serial(uint32_t* aux) {
@@ -20,11 +27,10 @@ static inline uint64_t rdtscp_serial(uint32_t* aux) {
 
 int main() {
     // Pin process to a single CPU core
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed"); return 1;
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
     }
 
     char* array = (char*)malloc(ARRAY_SIZE);
@@ -34,32 +40,35 @@ int main() {
     if (!csv) { perror("fopen failed"); free(array); return 1; }
     fprintf(csv, "stride_bytes,run,avg_cycles_per_access\n");
 
+    // Byte RMW at i*stride; one pass covers the array at most once and
+    // repeats until at least NUM_ACCESSES accesses per run
+    kern_t kern = {0};
+
     printf("Running cache line size benchmark with %d runs per stride...\n", NUM_RUNS);
 
     for (size_t stride = 1; stride <= MAX_STRIDE; stride *= 2) {
         printf("  Testing stride: %zu bytes\n", stride);
+        size_t per_pass = ARRAY_SIZE / stride < NUM_ACCESSES ? ARRAY_SIZE / stride : NUM_ACCESSES;
+        size_t passes = (NUM_ACCESSES + per_pass - 1) / per_pass;
+        if (kern_strided(&kern, KERN_RMW, 1, stride, per_pass) != 0) return 1;
         for (int run = 0; run < NUM_RUNS; ++run) {
             // "Warm up" to ensure pages are mapped
-            for (size_t i = 0; i < NUM_ACCESSES; i++) {
-                array[(i * stride) & (ARRAY_SIZE - 1)]++;
-            }
+            kern_run(&kern, array, NULL, passes);
 
             uint32_t aux;
             uint64_t start = rdtscp_serial(&aux);
-            for (size_t i = 0; i < NUM_ACCESSES; i++) {
-                array[(i * stride) & (ARRAY_SIZE - 1)]++;
-            }
+            kern_run(&kern, array, NULL, passes);
             uint64_t end = rdtscp_serial(&aux);
 
-            asm volatile("" : "+m" (array[0])); // Prevent loop optimization
-
-            double avg_cycles = (double)(end - start) / NUM_ACCESSES;
+            double avg_cycles = (double)(end - start) / (passes * per_pass);
             fprintf(csv, "%zu,%d,%.2f\n", stride, run, avg_cycles);
         }
     }
 
     fclose(csv);
+    kern_free(&kern);
     free(array);
     printf("\nRaw data saved to cache_line_raw_data.csv\n");
+    cpu_report(&cpus);
     return 0;
 }
@@ -13,12 +13,88 @@ def filter_outliers(series, sigma=2.5):
     upper = mean + sigma * std
     return series[(series >= lower) & (series <= upper)]
 
+HIST_LEVELS = {
+    'l1_hit': 'L1 Hit',
+    'l2_hit': 'L2 Hit (L1 miss)',
+    'l3_hit': 'L3 Hit (L1+L2 miss)',
+    'ram_access': 'RAM Access (all miss)'
+}
+
+def hist_percentile(lo, hi, counts, p):
+    """Percentile from HDR buckets (bucket midpoint, like the C side)."""
+    cum = np.cumsum(counts)
+    rank = int(p / 100.0 * (cum[-1] - 1)) + 1
+    i = int(np.searchsorted(cum, rank))
+    return (lo[i] + hi[i]) / 2.0
+
+def plot_latency_hist(df):
+    """Plot the --hires output: per-level HDR histograms with tails."""
+    print("=" * 70)
+    print("CACHE LATENCY DISTRIBUTIONS (--hires)")
+    print("=" * 70)
+
+    colors = ['#2ecc71', '#3498db', '#f39c12', '#e74c3c']
+    fig, (ax_pdf, ax_ccdf) = plt.subplots(2, 1, figsize=(16, 12))
+
+    for i, (level, name) in enumerate(HIST_LEVELS.items()):
+        d = df[df['level'] == level].sort_values('lo')
+        if d.empty:
+            continue
+        lo = d['lo'].to_numpy(dtype=float)
+        hi = d['hi'].to_numpy(dtype=float)
+        counts = d['count'].to_numpy(dtype=float)
+        total = counts.sum()
+        pct = {p: hist_percentile(lo, hi, counts, p) for p in (50, 90, 99, 99.9)}
+        print(f"{name:25s}: p50={pct[50]:8.1f}  p90={pct[90]:8.1f}  "
+              f"p99={pct[99]:8.1f}  p99.9={pct[99.9]:8.1f}  max={hi[-1]:.0f}  (n={total:.0f})")
+
+        # Buckets widen with magnitude, so plot density per cycle; +1 keeps
+        # the exact zero bucket on the log axis
+        width = hi - lo + 1
+        ax_pdf.step(lo + 1, counts / width / total, where='post', color=colors[i],
+                    linewidth=1.5, label=f'{name} (p50={pct[50]:.0f}, p99={pct[99]:.0f})')
+        ax_pdf.axvline(pct[50] + 1, color=colors[i], linestyle='--', alpha=0.7)
+
+        # Fraction of samples slower than each bucket's upper bound
+        ccdf = 1.0 - np.cumsum(counts) / total
+        keep = ccdf > 0
+        ax_ccdf.step(hi[keep] + 1, ccdf[keep], where='post', color=colors[i],
+                     linewidth=1.5, label=name)
+
+    ax_pdf.set_xscale('log')
+    ax_pdf.set_yscale('log')
+    ax_pdf.set_xlabel("Latency + 1 (cycles, overhead subtracted)", fontsize=12, weight='bold')
+    ax_pdf.set_ylabel("Density (fraction per cycle)", fontsize=12, weight='bold')
+    ax_pdf.set_title("Cache Hierarchy Latency Distribution (Sunbird)", fontsize=14, weight='bold')
+    ax_pdf.legend(loc='upper right', fontsize=10)
+    ax_pdf.grid(True, which='both', alpha=0.3)
+
+    ax_ccdf.set_xscale('log')
+    ax_ccdf.set_yscale('log')
+    ax_ccdf.set_xlabel("Latency + 1 (cycles)", fontsize=12, weight='bold')
+    ax_ccdf.set_ylabel("P(latency > x)", fontsize=12, weight='bold')
+    ax_ccdf.set_title("Tail Latency (CCDF)", fontsize=14, weight='bold')
+    ax_ccdf.legend(loc='lower left', fontsize=10)
+    ax_ccdf.grid(True, which='both', alpha=0.3)
+
+    print("=" * 70)
+    plt.tight_layout()
+    output_filename = 'cache_latency_hist.png'
+    plt.savefig(output_filename, dpi=300, bbox_inches='tight')
+    print(f"\n Plot saved as '{output_filename}'")
+
 def plot_cache_latency(csv_filename):
     try:
         df = pd.read_csv(csv_filename)
     except FileNotFoundError:
         print(f"Error: File '{csv_filename}' not found.")
         return
+    if 'valid' in df:
+        df = df[df['valid'] != 0]   # CFS-throttled runs
+
+    if 'level' in df.columns:
+        plot_latency_hist(df)
+        return
 
     print("=" * 70)
     print("CACHE LATENCY MEASUREMENT RESULTS")
@@ -118,5 +194,6 @@ if __name__ == "__main__":
     if len(sys.argv) != 2:
         print(f"Usage: python {sys.argv[0]} <csv_file>")
         print(f"Example: python {sys.argv[0]} cache_latency_data.csv")
+        print(f"         python {sys.argv[0]} cache_latency_hist.csv  (--hires output)")
     else:
         plot_cache_latency(sys.argv[1])
\ No newline at end of file
@@ -7,8 +7,11 @@
 #include <inttypes.h>
 #include <string.h>
 
+#include "../../../common/uarch_evict.h"
+#include "../../../common/uarch_cpu.h"
+
 #define NUM_RUNS 5000
-// 128MB buffer larger than L3 cache
+// 128MB buffer larger than L3 cache (fallback when no LLC eviction set is built)
 #define L3_EVICT_BUFFER_SIZE (128 * 1024 * 1024)
 
 // Intel-recommended timing harness
@@ -34,21 +37,28 @@ void thrash_l3(volatile char* buf) {
 
 int main() {
     // Pin to single CPU core
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
     
-    // Allocate eviction buffer
-    volatile char* evict_buffer = malloc(L3_EVICT_BUFFER_SIZE);
-    if (!evict_buffer) {
-        perror("malloc failed");
-        return 1;
+    // Minimal eviction sets for the target line, built once
+    evict_t ev;
+    if (evict_init(&ev, 0, 0) != 0) return 1;
+    printf("Building eviction sets...\n");
+    int llc_set = evict_build(&ev, 1) == ev.n_levels;
+
+    // Allocate eviction buffer only if the LLC set could not be built
+    volatile char* evict_buffer = NULL;
+    if (!llc_set) {
+        evict_buffer = malloc(L3_EVICT_BUFFER_SIZE);
+        if (!evict_buffer) {
+            perror("malloc failed");
+            return 1;
+        }
+        memset((void*)evict_buffer, 1, L3_EVICT_BUFFER_SIZE);
     }
-    memset((void*)evict_buffer, 1, L3_EVICT_BUFFER_SIZE);
 
     FILE* csv = fopen("inclusivity_data.csv", "w");
     if (!csv) {
@@ -58,7 +68,8 @@ int main() {
     }
     fprintf(csv, "run,initial_hit_time,probe_after_evict_time\n");
 
-    volatile int target = 42;
+    volatile int* target = (volatile int*)ev.target;
+    *target = 42;
     int sink;
 
     printf("Running LLC inclusivity test (%d iterations)...\n", NUM_RUNS);
@@ -66,18 +77,19 @@ int main() {
     
     for (int i = 0; i < NUM_RUNS; ++i) {
         // 1. PRIME: Load target into L1 and measure hit time
-        sink = target;  // Warm up
+        sink = *target;  // Warm up
         uint64_t start = start_timer();
-        sink = target;
+        sink = *target;
         uint64_t end = end_timer();
         uint64_t initial_hit = end - start;
 
-        // 2. EVICT: Thrash L3 cache
-        thrash_l3(evict_buffer);
+        // 2. EVICT: walk the target's eviction sets down to the LLC
+        if (llc_set) evict_level(&ev, ev.n_levels - 1);
+        else thrash_l3(evict_buffer);
 
         // 3. PROBE: Access target again and measure
         start = start_timer();
-        sink = target;
+        sink = *target;
         end = end_timer();
         uint64_t probed_time = end - start;
         
@@ -91,6 +103,7 @@ int main() {
 
     fclose(csv);
     free((void*)evict_buffer);
+    evict_free(&ev);
     
     printf("\n Test complete!\n");
     printf("Data saved to inclusivity_data.csv\n");
@@ -98,5 +111,6 @@ int main() {
     // Prevent optimization of sink
     if (sink == -1) printf("%d", sink);
     
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
@@ -1,3 +1,31 @@
+/*
+  Cache hierarchy heatmap engine.
+
+  Sweeps working-set size x stride x access type x access order x page size
+  x thread count and writes one tidy row per point, so plot.py can slice
+  any 2D plane.
+
+    access   load | store | rmw | nt (movnti streaming store)
+    order    seq      contiguous 8 B elements (stride ignored)
+             strided  slots 0, s, 2s, ... wrapping at the working set
+             page     strided slots shuffled within each 4 KB page
+             random   all slots shuffled (one pass visits each once)
+    page     4k | 2m (hugetlbfs, else THP) | 1g (hugetlbfs only)
+    threads  N private working sets, thread t pinned to physical core
+             t % cores of our cpuset (cpu_pick_cores())
+
+  Sizes are log-linear (MIN:MAX:STEPS gives STEPS evenly spaced points per
+  octave) or an explicit list, so knees such as 48K or 1.25M fall on the
+  grid. Each point runs a JIT'd kernel from common/uarch_kernels.h
+  (unrolled 8-byte ops, no index arithmetic); the shuffled orders read
+  their offsets from a sequential table, which adds one streaming load per
+  access. A run is whole passes over the working set, at least --accesses.
+
+  Build: gcc -O2 -pthread -o benchmark benchmark.c
+  Usage: ./benchmark [--sizes 4K:128M:4] [--strides 8,64,4096]
+                     [--access load,rmw] [--order strided,random]
+                     [--page 4k,2m] [--threads 1,2] [--accesses N] [--out f]
+*/
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
@@ -5,18 +33,65 @@
 #include <x86intrin.h>
 #include <sched.h>
 #include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-// Array size range: 4 KB to 128 MB
-#define MAX_ARRAY_SIZE (128 * 1024 * 1024)
-#define MIN_ARRAY_SIZE (4 * 1024)
+#include "../../../common/uarch_kernels.h"
+#include "../../../common/uarch_cpu.h"
 
-// Stride range: 8 bytes to 1024 bytes
-#define MIN_STRIDE 8
-#define MAX_STRIDE 1024
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
 
-// Fixed number of accesses for consistent timing
+#define MAX_POINTS 256
+#define PAGE_4K (4 * 1024)
+#define PAGE_2M (2 * 1024 * 1024)
+#define PAGE_1G (1024 * 1024 * 1024)
+
+// Default fixed number of accesses for consistent timing
 #define NUM_ACCESSES 1000000
 
+enum { ACC_LOAD, ACC_STORE, ACC_RMW, ACC_NT, NUM_ACC };
+enum { ORD_SEQ, ORD_STRIDED, ORD_PAGE, ORD_RANDOM, NUM_ORD };
+enum { PG_4K, PG_2M, PG_1G, NUM_PG };
+
+static const char* acc_names[NUM_ACC] = {"load", "store", "rmw", "nt"};
+static const char* ord_names[NUM_ORD] = {"seq", "strided", "page", "random"};
+static const char* pg_names[NUM_PG] = {"4k", "2m", "1g"};
+
+// Sweep axes (filled by handle_args)
+static size_t sizes[MAX_POINTS];
+static int n_sizes = 0;
+static size_t strides[MAX_POINTS];
+static int n_strides = 0;
+static const int kern_ops[NUM_ACC] = {KERN_LOAD, KERN_STORE, KERN_RMW, KERN_NT};
+static int accs[NUM_ACC], n_accs = 0;
+static int ords[NUM_ORD], n_ords = 0;
+static int pgs[NUM_PG], n_pgs = 0;
+static int thread_counts[MAX_POINTS], n_thread_counts = 0;
+static size_t num_accesses = NUM_ACCESSES;
+static const char* out_name = "cache_heatmap.csv";
+
+// Current measurement point, shared by the worker threads
+typedef struct {
+    char* bufs[MAX_POINTS];     // one private working set per thread
+    int threads;
+    kern_t kern;                // access kernel for this point
+    uint64_t passes;            // kernel reps (passes over the working set)
+    size_t step;                // stride in bytes
+    size_t slots;               // accesses per pass
+    uint32_t* table;            // shuffled byte offsets (page/random)
+    pthread_barrier_t barrier;
+    uint64_t cycles[MAX_POINTS];
+} job_t;
+
+static job_t job;
+static cpu_ctx_t cpus;
+static int cores[MAX_POINTS], n_cores = 0;
+static uint64_t rand_state = 0x9E3779B97F4A7C15ULL;
+
 // Timing with serialization
 static inline uint64_t rdtsc_begin(void) {
     uint32_t eax, ebx, ecx, edx;
@@ -31,89 +106,311 @@ static inline uint64_t rdtsc_end(void) {
     return t;
 }
 
-int main(void) {
-    // Pin to core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity");
+static inline uint64_t next_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+static void* worker(void* arg) {
+    int t = (int)(intptr_t)arg;
+    cpu_pin(&cpus, cores[t % n_cores]);
+
+    char* buf = job.bufs[t];
+    kern_run(&job.kern, buf, job.table, 1);
+
+    pthread_barrier_wait(&job.barrier);
+    uint64_t start = rdtsc_begin();
+    kern_run(&job.kern, buf, job.table, job.passes);
+    uint64_t end = rdtsc_end();
+
+    job.cycles[t] = end - start;
+    return NULL;
+}
+
+// Average cycles per access across all threads for the current job
+static double measure(void) {
+    pthread_t tids[MAX_POINTS];
+    pthread_barrier_init(&job.barrier, NULL, (unsigned)job.threads);
+    for (int t = 0; t < job.threads; t++)
+        pthread_create(&tids[t], NULL, worker, (void*)(intptr_t)t);
+    uint64_t total = 0;
+    for (int t = 0; t < job.threads; t++) {
+        pthread_join(tids[t], NULL);
+        total += job.cycles[t];
+    }
+    pthread_barrier_destroy(&job.barrier);
+    return (double)total / job.threads / (job.passes * job.slots);
+}
+
+// Fill job.table with the slot offsets of the given order
+static void build_table(int order) {
+    for (size_t k = 0; k < job.slots; k++) job.table[k] = (uint32_t)(k * job.step);
+    if (order == ORD_RANDOM) {
+        for (size_t k = job.slots - 1; k > 0; k--) {
+            size_t r = next_rand() % (k + 1);
+            uint32_t tmp = job.table[k]; job.table[k] = job.table[r]; job.table[r] = tmp;
+        }
+    } else if (order == ORD_PAGE) {
+        // Shuffle each run of slots that shares a 4 KB page
+        size_t lo = 0;
+        while (lo < job.slots) {
+            size_t hi = lo;
+            while (hi < job.slots && job.table[hi] / PAGE_4K == job.table[lo] / PAGE_4K) hi++;
+            for (size_t k = hi - 1; k > lo; k--) {
+                size_t r = lo + next_rand() % (k - lo + 1);
+                uint32_t tmp = job.table[k]; job.table[k] = job.table[r]; job.table[r] = tmp;
+            }
+            lo = hi;
+        }
+    }
+}
+
+// Map a touched buffer backed by the requested page size; NULL if unavailable
+static char* alloc_pages(size_t size, int pg, size_t* mapped) {
+    void* p = MAP_FAILED;
+    if (pg == PG_4K) {
+        *mapped = (size + PAGE_4K - 1) & ~(size_t)(PAGE_4K - 1);
+        p = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) madvise(p, *mapped, MADV_NOHUGEPAGE);
+    } else {
+        size_t page = pg == PG_2M ? PAGE_2M : (size_t)PAGE_1G;
+        int shift = pg == PG_2M ? 21 : 30;
+        *mapped = (size + page - 1) & ~(page - 1);
+        p = mmap(NULL, *mapped, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (p == MAP_FAILED && pg == PG_2M) {
+            // No hugetlbfs pages reserved: ask for transparent huge pages
+            size_t raw = *mapped + PAGE_2M;
+            char* r = mmap(NULL, raw, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (r != MAP_FAILED) {
+                char* aligned = (char*)(((uintptr_t)r + PAGE_2M - 1) & ~(uintptr_t)(PAGE_2M - 1));
+                if (aligned > r) munmap(r, aligned - r);
+                munmap(aligned + *mapped, (r + raw) - (aligned + *mapped));
+                madvise(aligned, *mapped, MADV_HUGEPAGE);
+                fprintf(stderr, "2m: hugetlbfs unavailable, using transparent huge pages\n");
+                p = aligned;
+            }
+        }
+    }
+    if (p == MAP_FAILED) return NULL;
+    memset(p, 0xAB, size);
+    return p;
+}
+
+// Parse "48K", "1.5M", "2G" or plain bytes
+static size_t parse_size(const char* s) {
+    char* end;
+    double v = strtod(s, &end);
+    switch (*end) {
+        case 'k': case 'K': v *= 1024; break;
+        case 'm': case 'M': v *= 1024 * 1024; break;
+        case 'g': case 'G': v *= 1024.0 * 1024 * 1024; break;
+    }
+    return (size_t)v;
+}
+
+static void parse_sizes(char* arg) {
+    n_sizes = 0;
+    if (strchr(arg, ':')) {
+        // MIN:MAX[:STEPS] - STEPS linear points per octave, rounded to 64 B
+        char* min_s = strtok(arg, ":");
+        char* max_s = strtok(NULL, ":");
+        char* steps_s = strtok(NULL, ":");
+        size_t lo = parse_size(min_s), hi = max_s ? parse_size(max_s) : lo;
+        if (lo < 64) lo = 64;
+        size_t steps = steps_s ? strtoul(steps_s, NULL, 10) : 1;
+        if (!steps) steps = 1;
+        for (size_t base = lo; base <= hi && n_sizes < MAX_POINTS; base *= 2) {
+            for (size_t k = 0; k < steps && n_sizes < MAX_POINTS; k++) {
+                size_t s = (base * (steps + k) / steps) & ~(size_t)63;
+                if (s > hi) break;
+                sizes[n_sizes++] = s;
+            }
+        }
+    } else {
+        for (char* tok = strtok(arg, ","); tok && n_sizes < MAX_POINTS; tok = strtok(NULL, ","))
+            sizes[n_sizes++] = parse_size(tok);
+    }
+}
+
+// Parse a comma list of names into enum values
+static int parse_names(char* arg, const char** names, int count, int* out, const char* what) {
+    int n = 0;
+    for (char* tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        int found = -1;
+        for (int k = 0; k < count; k++)
+            if (!strcmp(tok, names[k])) found = k;
+        if (found < 0) {
+            fprintf(stderr, "Unknown %s '%s'\n", what, tok);
+            exit(EXIT_FAILURE);
+        }
+        if (n < count) out[n++] = found;
+    }
+    return n;
+}
+
+void handle_args(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"sizes", required_argument, NULL, 's'},
+        {"strides", required_argument, NULL, 'S'},
+        {"access", required_argument, NULL, 'a'},
+        {"order", required_argument, NULL, 'o'},
+        {"page", required_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'},
+        {"accesses", required_argument, NULL, 'n'},
+        {"out", required_argument, NULL, 'O'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 's': parse_sizes(optarg); break;
+            case 'S':
+                n_strides = 0;
+                for (char* tok = strtok(optarg, ","); tok && n_strides < MAX_POINTS; tok = strtok(NULL, ","))
+                    strides[n_strides++] = parse_size(tok);
+                break;
+            case 'a': n_accs = parse_names(optarg, acc_names, NUM_ACC, accs, "access"); break;
+            case 'o': n_ords = parse_names(optarg, ord_names, NUM_ORD, ords, "order"); break;
+            case 'p': n_pgs = parse_names(optarg, pg_names, NUM_PG, pgs, "page size"); break;
+            case 't':
+                n_thread_counts = 0;
+                for (char* tok = strtok(optarg, ","); tok && n_thread_counts < MAX_POINTS; tok = strtok(NULL, ",")) {
+                    int t = atoi(tok);
+                    if (t < 1 || t > MAX_POINTS) {
+                        fprintf(stderr, "Thread count must be 1..%d\n", MAX_POINTS);
+                        exit(EXIT_FAILURE);
+                    }
+                    thread_counts[n_thread_counts++] = t;
+                }
+                break;
+            case 'n': num_accesses = strtoull(optarg, NULL, 10); break;
+            case 'O': out_name = optarg; break;
+            default: exit(EXIT_FAILURE);
+        }
+    }
+
+    // Defaults reproduce the original RMW/strided/4K sweep, 4 sizes per octave
+    if (!n_sizes) { char d[] = "4K:128M:4"; parse_sizes(d); }
+    if (!n_strides) for (size_t s = 8; s <= 1024; s *= 2) strides[n_strides++] = s;
+    if (!n_accs) accs[n_accs++] = ACC_RMW;
+    if (!n_ords) ords[n_ords++] = ORD_STRIDED;
+    if (!n_pgs) pgs[n_pgs++] = PG_4K;
+    if (!n_thread_counts) thread_counts[n_thread_counts++] = 1;
+    if (!num_accesses) num_accesses = NUM_ACCESSES;
+
+    for (int k = 0; k < n_strides; k++) {
+        if (strides[k] < 8 || strides[k] % 8) {
+            fprintf(stderr, "Strides must be multiples of 8 bytes\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    handle_args(argc, argv);
+    if (cpu_init(&cpus) != 0 || (n_cores = cpu_pick_cores(&cpus, MAX_POINTS, cores)) == 0) {
+        perror("cpu_init failed");
         return 1;
     }
 
-    // Allocate maximum array size
-    char* array = malloc(MAX_ARRAY_SIZE);
-    if (!array) {
+    size_t max_size = 0, max_stride = 8;
+    int max_threads = 1;
+    for (int k = 0; k < n_sizes; k++) if (sizes[k] > max_size) max_size = sizes[k];
+    for (int k = 0; k < n_strides; k++) if (strides[k] > max_stride) max_stride = strides[k];
+    for (int k = 0; k < n_thread_counts; k++) if (thread_counts[k] > max_threads) max_threads = thread_counts[k];
+    if (max_size > UINT32_MAX) {
+        fprintf(stderr, "Working sets are limited to 4 GB\n");
+        return 1;
+    }
+
+    job.table = malloc((max_size / 8 + 1) * sizeof(uint32_t));
+    if (!job.table) {
         perror("malloc");
         return 1;
     }
-    
-    // Initialize array to ensure pages are mapped
-    memset(array, 0xAB, MAX_ARRAY_SIZE);
 
-    FILE* csv = fopen("cache_heatmap.csv", "w");
+    FILE* csv = fopen(out_name, "w");
     if (!csv) {
         perror("fopen");
-        free(array);
         return 1;
     }
-    
-    fprintf(csv, "array_size_kb,stride_bytes,avg_cycles_per_access\n");
+    fprintf(csv, "page,threads,access,order,size_bytes,stride_bytes,cycles_per_access\n");
 
     printf("============================================================\n");
     printf("Cache Hierarchy Heatmap Generation\n");
     printf("============================================================\n");
-    printf("Array sizes: %d KB to %d MB\n", MIN_ARRAY_SIZE/1024, MAX_ARRAY_SIZE/1024/1024);
-    printf("Strides: %d to %d bytes\n", MIN_STRIDE, MAX_STRIDE);
-    printf("Accesses per measurement: %d\n", NUM_ACCESSES);
+    printf("Array sizes: %zu B to %zu KB (%d points)\n", sizes[0], max_size / 1024, n_sizes);
+    printf("Strides: %d points up to %zu bytes\n", n_strides, max_stride);
+    printf("Access types: %d, orders: %d, page sizes: %d, thread counts: %d\n",
+           n_accs, n_ords, n_pgs, n_thread_counts);
+    printf("Accesses per measurement: %zu\n", num_accesses);
+    printf("Threads spread over %d physical core(s)%s\n", n_cores,
+           max_threads > n_cores ? "; larger thread counts share cores" : "");
+    cpu_print(&cpus, -1, stdout);
     printf("============================================================\n\n");
 
-    int test_count = 0;
-    int total_tests = 0;
-    
-    // Count total tests for progress
-    for (size_t size = MIN_ARRAY_SIZE; size <= MAX_ARRAY_SIZE; size *= 2) {
-        for (size_t stride = MIN_STRIDE; stride <= MAX_STRIDE; stride *= 2) {
-            total_tests++;
-        }
-    }
-
-    // Iterate through array sizes (powers of 2)
-    for (size_t size = MIN_ARRAY_SIZE; size <= MAX_ARRAY_SIZE; size *= 2) {
-        printf("Testing array size: %6zu KB  ", size / 1024);
-        
-        // Iterate through stride sizes (powers of 2)
-        for (size_t stride = MIN_STRIDE; stride <= MAX_STRIDE; stride *= 2) {
-            test_count++;
-            
-            // Warm-up: touch all pages in working set
-            volatile size_t dummy = 0;
-            for (size_t i = 0; i < NUM_ACCESSES / 10; i++) {
-                dummy += array[(i * stride) & (size - 1)];
-            }
+    for (int pi = 0; pi < n_pgs; pi++) {
+        int pg = pgs[pi];
 
-            // Measurement
-            uint64_t start = rdtsc_begin();
-            for (size_t i = 0; i < NUM_ACCESSES; i++) {
-                array[(i * stride) & (size - 1)]++;
+        // One private working set per thread for the largest thread count
+        size_t mapped[MAX_POINTS];
+        int ok = 1;
+        for (int t = 0; t < max_threads; t++) {
+            job.bufs[t] = alloc_pages(max_size, pg, &mapped[t]);
+            if (!job.bufs[t]) {
+                fprintf(stderr, "%s: cannot map %zu KB with this page size, skipping\n",
+                        pg_names[pg], max_size / 1024);
+                for (int u = 0; u < t; u++) munmap(job.bufs[u], mapped[u]);
+                ok = 0;
+                break;
             }
-            uint64_t end = rdtsc_end();
+        }
+        if (!ok) continue;
 
-            // Prevent optimization
-            __asm__ __volatile__("" : "+m" (array[0]));
+        for (int ti = 0; ti < n_thread_counts; ti++) {
+            job.threads = thread_counts[ti];
+            for (int si = 0; si < n_sizes; si++) {
+                printf("[%s, %d thr] Testing array size: %8zu B  ", pg_names[pg], job.threads, sizes[si]);
+                fflush(stdout);
+                for (int oi = 0; oi < n_ords; oi++) {
+                    int order = ords[oi];
+                    // The sequential order has no stride axis
+                    int n_st = order == ORD_SEQ ? 1 : n_strides;
+                    for (int sti = 0; sti < n_st; sti++) {
+                        job.step = order == ORD_SEQ ? 8 : strides[sti];
+                        if (job.step > sizes[si]) continue;
+                        job.slots = sizes[si] / job.step;
+                        job.passes = (num_accesses + job.slots - 1) / job.slots;
+                        int table_order = order == ORD_PAGE || order == ORD_RANDOM;
+                        if (table_order) build_table(order);
 
-            double avg_cycles = (double)(end - start) / NUM_ACCESSES;
-            fprintf(csv, "%zu,%zu,%.3f\n", size / 1024, stride, avg_cycles);
+                        for (int ai = 0; ai < n_accs; ai++) {
+                            int op = kern_ops[accs[ai]];
+                            int rc = table_order ? kern_gather(&job.kern, op, job.slots)
+                                                 : kern_strided(&job.kern, op, 8, job.step, job.slots);
+                            if (rc != 0) return 1;
+                            double cycles = measure();
+                            fprintf(csv, "%s,%d,%s,%s,%zu,%zu,%.3f\n", pg_names[pg], job.threads,
+                                    acc_names[accs[ai]], ord_names[order], sizes[si], job.step, cycles);
+                        }
+                    }
+                }
+                printf("done\n");
+            }
         }
-        
-        printf("[%3d/%3d tests complete]\n", test_count, total_tests);
+
+        for (int t = 0; t < max_threads; t++) munmap(job.bufs[t], mapped[t]);
     }
 
     fclose(csv);
-    free(array);
+    kern_free(&job.kern);
+    free(job.table);
 
     printf("\n============================================================\n");
-    printf("Test complete! Data saved to cache_heatmap.csv\n");
+    printf("Test complete! Data saved to %s\n", out_name);
     printf("============================================================\n");
     printf("\nExpected patterns:\n");
     printf("- Low latency plateau: Data fits in L1 cache\n");
@@ -121,7 +418,8 @@ int main(void) {
     printf("- Second step up: Exceeds L2, now in L3\n");
     printf("- High latency: Exceeds L3, accessing RAM\n");
     printf("- Vertical bands: Stride effects on cache line utilization\n");
-    printf("\nRun: python3 plot_cache_heatmap.py cache_heatmap.csv\n");
+    printf("\nRun: python3 plot.py %s [--x stride_bytes] [--y size_bytes] [--fix access=rmw]\n", out_name);
 
+    cpu_report(&cpus);
     return 0;
-}
\ No newline at end of file
+}
@@ -1,488 +0,0 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h>
-#include <string.h>
-#include <x86intrin.h>
-#include <sys/mman.h>
-
-// Generate many unique function targets
-#define MAX_FUNCTIONS 64  // Reduced for spacing tests
-#define NUM_RUNS 100000
-#define WARMUP_RUNS 1000
-
-// Function template - we'll generate many of these
-#define DECLARE_FUNC(n) \
-    __attribute__((noinline)) void func##n() { \
-        volatile int x = n; \
-        x = x + 1; \
-        __asm__ volatile("" ::: "memory"); \
-    }
-
-// Generate 32 unique functions (enough for spacing tests)
-DECLARE_FUNC(0) DECLARE_FUNC(1) DECLARE_FUNC(2) DECLARE_FUNC(3) DECLARE_FUNC(4)
-DECLARE_FUNC(5) DECLARE_FUNC(6) DECLARE_FUNC(7) DECLARE_FUNC(8) DECLARE_FUNC(9)
-DECLARE_FUNC(10) DECLARE_FUNC(11) DECLARE_FUNC(12) DECLARE_FUNC(13) DECLARE_FUNC(14)
-DECLARE_FUNC(15) DECLARE_FUNC(16) DECLARE_FUNC(17) DECLARE_FUNC(18) DECLARE_FUNC(19)
-DECLARE_FUNC(20) DECLARE_FUNC(21) DECLARE_FUNC(22) DECLARE_FUNC(23) DECLARE_FUNC(24)
-DECLARE_FUNC(25) DECLARE_FUNC(26) DECLARE_FUNC(27) DECLARE_FUNC(28) DECLARE_FUNC(29)
-DECLARE_FUNC(30) DECLARE_FUNC(31)
-
-// Array to hold function pointers
-void (*functions[MAX_FUNCTIONS])(void);
-
-// Base function array
-void (*base_funcs[32])(void) = {
-    func0, func1, func2, func3, func4, func5, func6, func7, func8, func9,
-    func10, func11, func12, func13, func14, func15, func16, func17, func18, func19,
-    func20, func21, func22, func23, func24, func25, func26, func27, func28, func29,
-    func30, func31
-};
-
-// Generate functions at specific spacing using runtime code generation
-void* generate_spaced_functions(int num_funcs, int spacing) {
-    int total_size = num_funcs * spacing + 4096;
-    
-    void* code = mmap(NULL, total_size, PROT_READ | PROT_WRITE | PROT_EXEC,
-                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (code == MAP_FAILED) {
-        perror("mmap");
-        return NULL;
-    }
-    
-    uint8_t* code_ptr = (uint8_t*)code;
-    
-    // Generate simple functions at exact spacing intervals
-    for (int i = 0; i < num_funcs; i++) {
-        uint8_t* func_start = code_ptr + (i * spacing);
-        functions[i] = (void(*)(void))func_start;
-        
-        // Simple function: mov eax, immediate; ret
-        func_start[0] = 0xB8; // mov eax, imm32
-        *(uint32_t*)(func_start + 1) = i; // immediate value = i
-        func_start[5] = 0xC3; // ret
-        
-        // Fill rest with NOPs to maintain spacing
-        for (int j = 6; j < spacing; j++) {
-            func_start[j] = 0x90; // NOP
-        }
-    }
-    
-    __builtin___clear_cache(code, (char*)code + total_size);
-    return code;
-}
-
-// Alternative: Use existing functions but try to control their spacing
-void init_functions_linear() {
-    // Use functions in order (they should be relatively close in memory)
-    for (int i = 0; i < 32; i++) {
-        functions[i] = base_funcs[i];
-    }
-}
-
-// Test BTB behavior with current function arrangement
-uint64_t measure_performance(int num_branches) {
-    uint64_t min_cycles = UINT64_MAX;
-    unsigned int aux;
-    
-    // Warmup
-    for (int w = 0; w < WARMUP_RUNS; w++) {
-        for (int j = 0; j < num_branches; j++) {
-            functions[j]();
-        }
-    }
-    
-    // Measurement runs
-    for (int run = 0; run < NUM_RUNS; run++) {
-        // Serialize execution and flush pipeline
-        __asm__ volatile("cpuid" ::: "eax", "ebx", "ecx", "edx", "memory");
-        
-        uint64_t start = __rdtscp(&aux);
-        
-        // The actual test loop - indirect branches
-        for (int j = 0; j < num_branches; j++) {
-            functions[j](); // This is the indirect branch we're measuring
-        }
-        
-        uint64_t end = __rdtscp(&aux);
-        __asm__ volatile("cpuid" ::: "eax", "ebx", "ecx", "edx", "memory");
-        
-        uint64_t cycles = end - start;
-        if (cycles < min_cycles) min_cycles = cycles;
-    }
-    
-    return min_cycles;
-}
-
-int main() {
-    printf("BTB Set Size Detection via Function Spacing\n");
-    printf("===========================================\n\n");
-    
-    int num_branches = 32; // Increase to stress BTB more
-    
-    printf("Testing different function spacings to find BTB set indexing...\n");
-    printf("(Using %d branches to stress BTB)\n\n", num_branches);
-    
-    FILE *fp = fopen("btb_spacing_results.csv", "w");
-    if (!fp) { perror("fopen"); return 1; }
-    fprintf(fp, "Spacing,Branches,Cycles,Cycles_Per_Branch,Address_Range\n");
-    
-    printf("Spacing\t\tBranches\tCycles\t\tCycles/Branch\tRelative\n");
-    printf("-------\t\t--------\t------\t\t-------------\t--------\n");
-    
-    uint64_t baseline_cycles = 0;
-    void* code_base = NULL;
-    
-    // Test different spacings (powers of 2) - extended range for tag detection
-    for (int power = 4; power <= 22; power++) { // Up to 4MB spacing
-        int spacing = 1 << power; // 2^power bytes
-        
-        // Calculate total memory needed
-        size_t total_memory = (size_t)num_branches * spacing + 4096;
-        if (total_memory > 1024 * 1024 * 400) { // Skip if > 400MB
-            printf("Skipping %d bytes spacing (would need %zu MB)\n", 
-                   spacing, total_memory / (1024 * 1024));
-            continue;
-        }
-        
-        // Generate functions at this spacing
-        if (code_base) {
-            munmap(code_base, num_branches * (1 << (power-1)) + 4096);
-        }
-        code_base = generate_spaced_functions(num_branches, spacing);
-        
-        if (!code_base) {
-            printf("Failed to generate code at spacing %d\n", spacing);
-            continue;
-        }
-        
-        // Measure performance
-        uint64_t cycles = measure_performance(num_branches);
-        double cycles_per_branch = (double)cycles / num_branches;
-        
-        if (power == 4) baseline_cycles = cycles;
-        double relative = (double)cycles / baseline_cycles;
-        
-        // Calculate address range being used
-        uintptr_t start_addr = (uintptr_t)functions[0];
-        uintptr_t end_addr = (uintptr_t)functions[num_branches-1];
-        uint64_t address_range = end_addr - start_addr;
-        
-        
-        printf("%s%d\t\t%lu\t\t%.1f\t\t%.2fx\n", 
-               (spacing >= 1024) ? "K " : " ", 
-               (spacing >= 1024) ? spacing/1024 : spacing,
-               cycles, cycles_per_branch, relative);
-               
-        fprintf(fp, "%d,%d,%lu,%.1f,%lu\n", 
-                spacing, num_branches, cycles, cycles_per_branch, address_range);
-        
-        // Look for significant performance jumps
-        if (relative > 1.5 && power > 4) {
-            printf("*** Potential BTB set conflict at %d-byte spacing ***\n", spacing);
-            
-            // Calculate potential set size
-            int prev_spacing = 1 << (power - 1);
-            printf("    -> BTB may use %d-bit set index (sets = %d)\n", 
-                   power - 6, 1 << (power - 6)); // Assuming 64-byte granularity
-        }
-        
-        // Look for second performance jump (tag conflicts)
-        if (relative > 2.5 && power > 10) {
-            printf("*** Potential BTB tag conflict at %d-byte spacing ***\n", spacing);
-            printf("    -> BTB tag bits may be limited\n");
-        }
-        
-        // Format spacing nicely
-        if (spacing >= 1024) {
-            printf("%dK\t\t", spacing / 1024);
-        } else {
-            printf("%d\t\t", spacing);
-        }
-        
-        // Print function addresses for analysis
-        printf("    Function addresses: ");
-        for (int i = 0; i < 4 && i < num_branches; i++) {
-            printf("%p ", (void*)functions[i]);
-        }
-        printf("...\n");
-        
-        // Also show the address differences to verify spacing
-        if (num_branches > 1) {
-            uintptr_t diff = (uintptr_t)functions[1] - (uintptr_t)functions[0];
-            printf("    Actual spacing: %lu bytes (expected: %d)\n", diff, spacing);
-        }
-        
-        fflush(stdout);
-    }
-    
-    if (code_base) {
-        munmap(code_base, num_branches * (1 << 13) + 4096); // Safe cleanup
-    }
-    
-    printf("\n=== Analysis of Your Results ===\n");
-    printf("Your BTB shows very consistent performance (4.0 cycles/branch)\n");
-    printf("across all spacings from 64+ bytes. This suggests:\n\n");
-    
-    printf("1. **No BTB conflicts detected** in the range tested\n");
-    printf("2. **BTB is large enough** to handle 16 functions at these spacings\n");
-    printf("3. **Efficient prediction** - 4 cycles/branch is quite good\n\n");
-    
-    printf("To find BTB limits, try:\n");
-    printf("- **Increase number of branches** (32, 64, 128 functions)\n");
-    printf("- **Reduce spacing** to force more conflicts (4, 8 byte spacing)\n");
-    printf("- **Use unpredictable patterns** to stress the BTB\n\n");
-    
-    printf("The slight performance improvement from 16→64 bytes suggests\n");
-    printf("better cache line alignment or reduced instruction cache pressure.\n");
-    
-    fclose(fp);
-    printf("\nDetailed results written to btb_spacing_results.csv\n");
-    
-    return 0;
-}
-
-// #include <stdio.h>
-// #include <stdlib.h>
-// #include <stdint.h>
-// #include <string.h>
-// #include <x86intrin.h>
-// #include <sys/mman.h>
-
-// // Generate many unique function targets
-// #define MAX_FUNCTIONS 64  // Reduced for spacing tests
-// #define NUM_RUNS 100000
-// #define WARMUP_RUNS 1000
-
-// // Function template - we'll generate many of these
-// #define DECLARE_FUNC(n) \
-//     __attribute__((noinline)) void func##n() { \
-//         volatile int x = n; \
-//         x = x + 1; \
-//         __asm__ volatile("" ::: "memory"); \
-//     }
-
-// // Generate 32 unique functions (enough for spacing tests)
-// DECLARE_FUNC(0) DECLARE_FUNC(1) DECLARE_FUNC(2) DECLARE_FUNC(3) DECLARE_FUNC(4)
-// DECLARE_FUNC(5) DECLARE_FUNC(6) DECLARE_FUNC(7) DECLARE_FUNC(8) DECLARE_FUNC(9)
-// DECLARE_FUNC(10) DECLARE_FUNC(11) DECLARE_FUNC(12) DECLARE_FUNC(13) DECLARE_FUNC(14)
-// DECLARE_FUNC(15) DECLARE_FUNC(16) DECLARE_FUNC(17) DECLARE_FUNC(18) DECLARE_FUNC(19)
-// DECLARE_FUNC(20) DECLARE_FUNC(21) DECLARE_FUNC(22) DECLARE_FUNC(23) DECLARE_FUNC(24)
-// DECLARE_FUNC(25) DECLARE_FUNC(26) DECLARE_FUNC(27) DECLARE_FUNC(28) DECLARE_FUNC(29)
-// DECLARE_FUNC(30) DECLARE_FUNC(31)
-
-// // Array to hold function pointers
-// void (*functions[MAX_FUNCTIONS])(void);
-
-// // Base function array
-// void (*base_funcs[32])(void) = {
-//     func0, func1, func2, func3, func4, func5, func6, func7, func8, func9,
-//     func10, func11, func12, func13, func14, func15, func16, func17, func18, func19,
-//     func20, func21, func22, func23, func24, func25, func26, func27, func28, func29,
-//     func30, func31
-// };
-
-// // Generate functions at specific spacing using runtime code generation
-// void* generate_spaced_functions(int num_funcs, int spacing) {
-//     int total_size = num_funcs * spacing + 4096;
-    
-//     void* code = mmap(NULL, total_size, PROT_READ | PROT_WRITE | PROT_EXEC,
-//                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-//     if (code == MAP_FAILED) {
-//         perror("mmap");
-//         return NULL;
-//     }
-    
-//     uint8_t* code_ptr = (uint8_t*)code;
-    
-//     // Generate simple functions at exact spacing intervals
-//     for (int i = 0; i < num_funcs; i++) {
-//         uint8_t* func_start = code_ptr + (i * spacing);
-//         functions[i] = (void(*)(void))func_start;
-        
-//         // Simple function: mov eax, immediate; ret
-//         func_start[0] = 0xB8; // mov eax, imm32
-//         *(uint32_t*)(func_start + 1) = i; // immediate value = i
-//         func_start[5] = 0xC3; // ret
-        
-//         // Fill rest with NOPs to maintain spacing
-//         for (int j = 6; j < spacing; j++) {
-//             func_start[j] = 0x90; // NOP
-//         }
-//     }
-    
-//     __builtin___clear_cache(code, (char*)code + total_size);
-//     return code;
-// }
-
-// // Alternative: Use existing functions but try to control their spacing
-// void init_functions_linear() {
-//     // Use functions in order (they should be relatively close in memory)
-//     for (int i = 0; i < 32; i++) {
-//         functions[i] = base_funcs[i];
-//     }
-// }
-
-// // Test BTB behavior with current function arrangement
-// uint64_t measure_performance(int num_branches) {
-//     uint64_t min_cycles = UINT64_MAX;
-//     unsigned int aux;
-    
-//     // Warmup
-//     for (int w = 0; w < WARMUP_RUNS; w++) {
-//         for (int j = 0; j < num_branches; j++) {
-//             functions[j]();
-//         }
-//     }
-    
-//     // Measurement runs
-//     for (int run = 0; run < NUM_RUNS; run++) {
-//         // Serialize execution and flush pipeline
-//         __asm__ volatile("cpuid" ::: "eax", "ebx", "ecx", "edx", "memory");
-        
-//         uint64_t start = __rdtscp(&aux);
-        
-//         // The actual test loop - indirect branches
-//         for (int j = 0; j < num_branches; j++) {
-//             functions[j](); // This is the indirect branch we're measuring
-//         }
-        
-//         uint64_t end = __rdtscp(&aux);
-//         __asm__ volatile("cpuid" ::: "eax", "ebx", "ecx", "edx", "memory");
-        
-//         uint64_t cycles = end - start;
-//         if (cycles < min_cycles) min_cycles = cycles;
-//     }
-    
-//     return min_cycles;
-// }
-
-// int main() {
-//     printf("BTB Set Size Detection via Function Spacing\n");
-//     printf("===========================================\n\n");
-    
-//     int num_branches = 32; // Increase to stress BTB more
-    
-//     printf("Testing different function spacings to find BTB set indexing...\n");
-//     printf("(Using %d branches to stress BTB)\n\n", num_branches);
-    
-//     FILE *fp = fopen("btb_spacing_results.csv", "w");
-//     if (!fp) { perror("fopen"); return 1; }
-//     fprintf(fp, "Spacing,Branches,Cycles,Cycles_Per_Branch,Address_Range\n");
-    
-//     printf("Spacing\t\tBranches\tCycles\t\tCycles/Branch\tRelative\n");
-//     printf("-------\t\t--------\t------\t\t-------------\t--------\n");
-    
-//     uint64_t baseline_cycles = 0;
-//     void* code_base = NULL;
-    
-//     // Test different spacings (powers of 2) - extended range for tag detection
-//     for (int power = 4; power <= 20; power++) { // Up to 1MB spacing
-//         int spacing = 1 << power; // 2^power bytes
-        
-//         // Calculate total memory needed
-//         size_t total_memory = (size_t)num_branches * spacing + 4096;
-//         if (total_memory > 1024 * 1024 * 200) { // Skip if > 200MB
-//             printf("Skipping %d bytes spacing (would need %zu MB)\n", 
-//                    spacing, total_memory / (1024 * 1024));
-//             continue;
-//         }
-        
-//         // Generate functions at this spacing
-//         if (code_base) {
-//             munmap(code_base, num_branches * (1 << (power-1)) + 4096);
-//         }
-//         code_base = generate_spaced_functions(num_branches, spacing);
-        
-//         if (!code_base) {
-//             printf("Failed to generate code at spacing %d\n", spacing);
-//             continue;
-//         }
-        
-//         // Measure performance
-//         uint64_t cycles = measure_performance(num_branches);
-//         double cycles_per_branch = (double)cycles / num_branches;
-        
-//         if (power == 4) baseline_cycles = cycles;
-//         double relative = (double)cycles / baseline_cycles;
-        
-//         // Calculate address range being used
-//         uintptr_t start_addr = (uintptr_t)functions[0];
-//         uintptr_t end_addr = (uintptr_t)functions[num_branches-1];
-//         uint64_t address_range = end_addr - start_addr;
-        
-        
-//         printf("%s%d\t\t%lu\t\t%.1f\t\t%.2fx\n", 
-//                (spacing >= 1024) ? "K " : " ", 
-//                (spacing >= 1024) ? spacing/1024 : spacing,
-//                cycles, cycles_per_branch, relative);
-               
-//         fprintf(fp, "%d,%d,%lu,%.1f,%lu\n", 
-//                 spacing, num_branches, cycles, cycles_per_branch, address_range);
-        
-//         // Look for significant performance jumps
-//         if (relative > 1.5 && power > 4) {
-//             printf("*** Potential BTB set conflict at %d-byte spacing ***\n", spacing);
-            
-//             // Calculate potential set size
-//             int prev_spacing = 1 << (power - 1);
-//             printf("    -> BTB may use %d-bit set index (sets = %d)\n", 
-//                    power - 6, 1 << (power - 6)); // Assuming 64-byte granularity
-//         }
-        
-//         // Look for second performance jump (tag conflicts)
-//         if (relative > 2.5 && power > 10) {
-//             printf("*** Potential BTB tag conflict at %d-byte spacing ***\n", spacing);
-//             printf("    -> BTB tag bits may be limited\n");
-//         }
-        
-//         // Format spacing nicely
-//         if (spacing >= 1024) {
-//             printf("%dK\t\t", spacing / 1024);
-//         } else {
-//             printf("%d\t\t", spacing);
-//         }
-        
-//         // Print function addresses for analysis
-//         printf("    Function addresses: ");
-//         for (int i = 0; i < 4 && i < num_branches; i++) {
-//             printf("%p ", (void*)functions[i]);
-//         }
-//         printf("...\n");
-        
-//         // Also show the address differences to verify spacing
-//         if (num_branches > 1) {
-//             uintptr_t diff = (uintptr_t)functions[1] - (uintptr_t)functions[0];
-//             printf("    Actual spacing: %lu bytes (expected: %d)\n", diff, spacing);
-//         }
-        
-//         fflush(stdout);
-//     }
-    
-//     if (code_base) {
-//         munmap(code_base, num_branches * (1 << 13) + 4096); // Safe cleanup
-//     }
-    
-//     printf("\n=== Analysis of Your Results ===\n");
-//     printf("Your BTB shows very consistent performance (4.0 cycles/branch)\n");
-//     printf("across all spacings from 64+ bytes. This suggests:\n\n");
-    
-//     printf("1. **No BTB conflicts detected** in the range tested\n");
-//     printf("2. **BTB is large enough** to handle 16 functions at these spacings\n");
-//     printf("3. **Efficient prediction** - 4 cycles/branch is quite good\n\n");
-    
-//     printf("To find BTB limits, try:\n");
-//     printf("- **Increase number of branches** (32, 64, 128 functions)\n");
-//     printf("- **Reduce spacing** to force more conflicts (4, 8 byte spacing)\n");
-//     printf("- **Use unpredictable patterns** to stress the BTB\n\n");
-    
-//     printf("The slight performance improvement from 16→64 bytes suggests\n");
-//     printf("better cache line alignment or reduced instruction cache pressure.\n");
-    
-//     fclose(fp);
-//     printf("\nDetailed results written to btb_spacing_results.csv\n");
-    
-//     return 0;
-// }
-
-
-
@@ -7,6 +7,9 @@
 #include <sched.h>
 #include <sys/mman.h>
 
+#include "../../../common/uarch_chain.h"
+#include "../../../common/uarch_cpu.h"
+
 #define MAX_FILLERS 600
 #define ITERATIONS 100000
 #define NUM_RUNS 5
@@ -26,19 +29,9 @@ static inline uint64_t end_timer(void) {
 }
 
 // --- Pointer-Chasing Setup ---
+// One random cycle through every element (cached on disk across runs)
 void init_dbuf(void **dbuf, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        dbuf[i] = &dbuf[(i + 1) % size];
-    }
-    
-    // Shuffle for random access pattern
-    srand(42);
-    for (size_t i = size - 1; i > 0; i--) {
-        size_t j = rand() % (i + 1);
-        void* temp = dbuf[i]; 
-        dbuf[i] = dbuf[j]; 
-        dbuf[j] = temp;
-    }
+    if (!chain_build(dbuf, size * sizeof(void*), CHAIN_ELEM, CHAIN_SEED)) exit(EXIT_FAILURE);
 }
 
 // --- Code Generation with Better Dependency Chain ---
@@ -101,11 +94,12 @@ void make_routine(unsigned char* code_buf, void* p1, int filler_count) {
 }
 
 int main() {
-    // Pin to core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    sched_setaffinity(0, sizeof(set), &set);
+    // Pin to one core of our cpuset
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
     
     // Allocate large buffer for pointer chasing
     const size_t dbuf_size = 256 * 1024 * 1024;
@@ -188,5 +182,6 @@ int main() {
     munmap(code_buf, 8192);
     free(dbuf);
     
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
@@ -15,6 +15,10 @@
 #include <sched.h>
 #include <stdint.h>
 
+#include "../../../common/uarch_chain.h"
+#include "../../../common/uarch_ckpt.h"
+#include "../../../common/uarch_cpu.h"
+
 #define ADD_BYTE(val) do{ibuf[pbuf] = (val); pbuf++;} while(0)
 #define ADD_WORD(val) do{*(unsigned short*)(&ibuf[pbuf]) = (val); pbuf+=2;} while(0)
 #define ADD_DWORD(val) do{*(unsigned int*)(&ibuf[pbuf]) = (val); pbuf+=4;} while(0)
@@ -29,6 +33,7 @@ static bool plot_mode;
 static int start_icount = 10;
 static int stop_icount = 180;
 static int instr_type = 0;
+static bool resume;  // --resume: continue an interrupted sweep
 
 // --- Test Definitions ---
 struct test_info { int flags; const char *desc; };
@@ -153,11 +158,9 @@ inline unsigned long long int rdtsc_fenced() {
 }
 
 void init_dbuf(void **dbuf, int size) {
-    // Create a single circular linked list
-    for (int i = 0; i < size - 1; i++) {
-        dbuf[i] = &dbuf[i + 1];
-    }
-    dbuf[size - 1] = &dbuf[0];  // Close the loop
+    // Create a single circular linked list in random order, so the chase
+    // misses instead of streaming behind the prefetchers
+    if (!chain_build(dbuf, (size_t)size * sizeof(void*), CHAIN_ELEM, CHAIN_SEED)) exit(EXIT_FAILURE);
 }
 
 void handle_args(int argc, char *argv[]) {
@@ -166,6 +169,7 @@ void handle_args(int argc, char *argv[]) {
         {"start", required_argument, NULL, 'i'},
         {"stop",  required_argument, NULL, 'j'},
         {"iter",  required_argument, NULL, 'n'},
+        {"resume", no_argument, NULL, 'r'},
         {0, 0, 0, 0}
     };
     int optval = 0;
@@ -175,6 +179,7 @@ void handle_args(int argc, char *argv[]) {
             case 'i': sscanf(optarg, "%d", &start_icount); break;
             case 'j': sscanf(optarg, "%d", &stop_icount); break;
             case 'n': sscanf(optarg, "%d", &its); break;
+            case 'r': resume = true; break;
             default: exit(EXIT_FAILURE);
         }
     }
@@ -184,12 +189,10 @@ void handle_args(int argc, char *argv[]) {
 }
 
 int main(int argc, char *argv[]) {
-    // Pin to CPU 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
-        perror("sched_setaffinity failed"); 
+    // Pin to one core of our cpuset
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
     
@@ -214,12 +217,19 @@ int main(int argc, char *argv[]) {
     typedef void(*routine_t)(void*, void*);
     routine_t routine = (routine_t)ibuf;
     
-    FILE *fp = fopen("prf_raw_data.csv", "w");
-    fprintf(fp, "ICOUNT,CYCLES\n");
+    // One checkpoint per ICOUNT; --resume skips the completed ones
+    char config[128];
+    snprintf(config, sizeof(config), "prf test=%d start=%d stop=%d its=%d unroll=%d samples=%d",
+             instr_type, start_icount, stop_icount, its, unroll, outer_its);
+    ckpt_t ckpt;
+    FILE *fp = ckpt_open(&ckpt, "prf_raw_data.csv", "ICOUNT,CYCLES\n", config, resume);
+    if (!fp) return 1;
+    if (ckpt.complete) { ckpt_close(&ckpt); return 0; }
     printf("Running PRF benchmark (test: %s)...\n", name);
     printf("Expected PRF sizes: Haswell ~168, Sapphire Rapids ~332\n\n");
     
     for (int icount = start_icount; icount <= stop_icount; icount += 2) {
+        if (ckpt_skip(&ckpt, icount)) continue;
         make_routine(ibuf, dbuf1, dbuf2, icount, instr_type);
         
         // Warmup
@@ -237,13 +247,14 @@ int main(int argc, char *argv[]) {
             double scaled_diff = (double)diff / its / unroll;
             fprintf(fp, "%d,%.2f\n", icount, scaled_diff);
         }
+        if (ckpt_done(&ckpt, icount, NULL, 0) != 0) return 1;
         
         if (icount % 20 == 0) {
             printf("  Progress: ICOUNT = %d\n", icount);
         }
     }
     
-    fclose(fp);
+    ckpt_close(&ckpt);
     free(dbuf1);
     free(dbuf2);
     free(ibuf);
@@ -251,5 +262,6 @@ int main(int argc, char *argv[]) {
     printf("\nRaw data written to prf_raw_data.csv\n");
     printf("Run your analysis script to find the PRF size.\n");
     
+    cpu_report(&cpus);
     return 0;
 }
\ No newline at end of file
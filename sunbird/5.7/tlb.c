@@ -8,8 +8,12 @@
 #include <sys/mman.h>
 #include <x86intrin.h>
 
+#include "../../common/uarch_warmup.h"
+#include "../../common/uarch_cpu.h"
+
 #define CACHE_LINE_SIZE 64
 #define ACCESSES_PER_RUN (1 << 20)
+#define WARMUP_BATCH (1 << 14)  // accesses per warm-up batch
 
 typedef struct {
     void *next;
@@ -54,7 +58,7 @@ void measure_tlb(size_t page_size, size_t max_pages) {
     }
     // --- THP MODIFICATION END ---
 
-    printf("NumPages, TotalSize_MiB, Cycles_per_Access\n");
+    printf("NumPages, TotalSize_MiB, Cycles_per_Access, Warmup_Batches\n");
 
     for (size_t num_pages = 2; num_pages <= max_pages; num_pages+=2) {
         size_t stride = page_size / sizeof(Node);
@@ -75,9 +79,16 @@ void measure_tlb(size_t page_size, size_t max_pages) {
         uint64_t start, end;
         volatile Node *current = &nodes[0];
 
-        for(int i = 0; i < ACCESSES_PER_RUN; i++) {
-            current = current->next;
-        }
+        // Walk until the TLBs and paging-structure caches settle
+        warmup_t warm;
+        warmup_init(&warm, WARMUP_WINDOW);
+        do {
+            start = __rdtscp(&junk);
+            for(int i = 0; i < WARMUP_BATCH; i++) {
+                current = current->next;
+            }
+            end = __rdtscp(&junk);
+        } while (warmup_feed(&warm, (double)(end - start) / WARMUP_BATCH));
 
         start = __rdtscp(&junk);
         for(int i = 0; i < ACCESSES_PER_RUN; i++) {
@@ -88,7 +99,7 @@ void measure_tlb(size_t page_size, size_t max_pages) {
         double cycles_per_access = (double)(end - start) / ACCESSES_PER_RUN;
         double total_size_mib = (double)(num_pages * page_size) / (1024 * 1024);
 
-        printf("%zu, %.2f, %.2f\n", num_pages, total_size_mib, cycles_per_access);
+        printf("%zu, %.2f, %.2f, %d\n", num_pages, total_size_mib, cycles_per_access, warm.warm_batches);
         free(page_indices);
         //  if (num_pages < 16) {
         //     num_pages += 2;
@@ -101,17 +112,16 @@ void measure_tlb(size_t page_size, size_t max_pages) {
 }
 
 int main() {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(1, &cpuset);
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
     measure_tlb(4096, 1024);
     measure_tlb(2 * 1024 * 1024, 512);
 
+    cpu_report(&cpus);
     return 0;
 }
 
@@ -8,6 +8,8 @@
 #include <sys/mman.h>
 #include <x86intrin.h>
 
+#include "../../common/uarch_cpu.h"
+
 #define CACHE_LINE_SIZE 64
 #define ACCESSES_PER_RUN (1 << 22) // Increased for more stable measurements
 #define MAX_ASSOCIATIVITY_TO_TEST 128
@@ -106,11 +108,9 @@ void measure_tlb_associativity(size_t page_size, int num_sets_in_tlb) {
 
 
 int main() {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(1, &cpuset);
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == -1) {
-        perror("sched_setaffinity failed");
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0 || cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
         return 1;
     }
 
@@ -130,5 +130,6 @@ int main() {
     //measure_tlb_associativity(2 * 1024 * 1024, 32);
 
 
+    cpu_report(&cpus);
     return 0;
 }
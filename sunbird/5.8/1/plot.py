@@ -44,26 +44,33 @@ def main():
     
     # Read CSV
     df = pd.read_csv(csvfile)
+    if 'valid' in df:
+        df = df[df['valid'] != 0]   # CFS-throttled points
     
     # Extract data
     filler_counts = df['filler_count'].values
     avg_cycles = df['avg_cycles'].values
     min_cycles = df['min_cycles'].values
     max_cycles = df['max_cycles'].values
+    # rob_size --filler load|store measures the load/store buffer instead
+    filler = df['filler'].iloc[0] if 'filler' in df.columns else 'alu'
+    structure = {'alu': 'ROB', 'load': 'Load Buffer', 'store': 'Store Buffer'}[filler]
     
     # Find the knee point
     knee_x, smoothed, dy, ddy = find_knee(filler_counts, avg_cycles)
     
     print("\n" + "="*60)
-    print(f"ROB SIZE ANALYSIS - {machine_name}")
+    print(f"{structure.upper()} SIZE ANALYSIS - {machine_name}")
     print("="*60)
-    print(f"\nDetected ROB Size (Knee Point): ~{int(knee_x)} entries")
+    print(f"\nDetected {structure} Size (Knee Point): ~{int(knee_x)} entries")
     print(f"\nData points: {len(df)}")
     print(f"Filler count range: {filler_counts[0]} to {filler_counts[-1]}")
     print(f"Cycle range: {avg_cycles.min():.2f} to {avg_cycles.max():.2f}")
     
     # Architecture detection
-    if 190 <= knee_x <= 200:
+    if filler != 'alu':
+        arch = "n/a (architecture table is for ROB sizes)"
+    elif 190 <= knee_x <= 200:
         arch = "Haswell (192 ROB entries)"
     elif 350 <= knee_x <= 360:
         arch = "Ice Lake/Sunny Cove (352 ROB entries)"
@@ -88,12 +95,12 @@ def main():
                      alpha=0.2, color='blue', label='Min-Max Range')
     plt.xlabel('Filler Instruction Count', fontsize=12)
     plt.ylabel('Cycles per Iteration', fontsize=12)
-    plt.title('ROB Size Detection (Sunbird)', fontsize=13)
+    plt.title(f'{structure} Size Detection (Sunbird)', fontsize=13)
     plt.grid(True, linestyle='--', alpha=0.6)
     plt.legend(loc='upper left')
     
     # Add annotation for knee
-    plt.annotate(f'ROB Size\n~{int(knee_x)} entries', 
+    plt.annotate(f'{structure} Size\n~{int(knee_x)} entries', 
                 xy=(knee_x, smoothed[np.argmin(np.abs(filler_counts - knee_x))]),
                 xytext=(knee_x + 50, smoothed[np.argmin(np.abs(filler_counts - knee_x))] + 5),
                 arrowprops=dict(arrowstyle='->', color='red', lw=2),
@@ -102,7 +109,7 @@ def main():
     plt.tight_layout()
     
     # Save figure
-    outname = f"rob_analysis_{machine_name.lower()}.png"
+    outname = f"{structure.lower().replace(' ', '_')}_analysis_{machine_name.lower()}.png"
     plt.savefig(outname, dpi=300, bbox_inches='tight')
     print(f"Plot saved as {outname}")
     
@@ -114,7 +121,7 @@ def main():
     print(f"{'Max cycles':<30} {avg_cycles.max():>15.2f}")
     print(f"{'Cycles at knee point':<30} {smoothed[np.argmin(np.abs(filler_counts - knee_x))]:>15.2f}")
     print(f"{'Increase factor':<30} {avg_cycles.max() / avg_cycles.min():>15.2f}x")
-    print(f"{'Detected ROB size':<30} {int(knee_x):>15} entries")
+    print(f"{'Detected ' + structure + ' size':<30} {int(knee_x):>15} entries")
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
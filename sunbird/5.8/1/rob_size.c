@@ -3,13 +3,36 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <getopt.h>
 #include <x86intrin.h>
 #include <sched.h>
 #include <sys/mman.h>
 
+#include "../../../common/uarch_chain.h"
+#include "../../../common/uarch_noise.h"
+#include "../../../common/uarch_cpu.h"
+#include "../../../common/uarch_warmup.h"
+
+#ifndef MAX_FILLERS
 #define MAX_FILLERS 600
+#endif
 #define ITERATIONS 100000
+#ifndef NUM_RUNS
 #define NUM_RUNS 5
+#endif
+#define SCRATCH_SLOTS 64   // filler loads/stores rotate over one L1-resident page
+#define FILLER_MAX_BYTES 7 // longest filler encoding (mov with [rbx + disp32])
+#define CODE_OVERHEAD 128  // prologue, chase, loop control and epilogue
+#define CODE_SIZE (((size_t)MAX_FILLERS * FILLER_MAX_BYTES + CODE_OVERHEAD + 4095) & ~(size_t)4095)
+
+// Filler kinds: ALU adds find the ROB, L1-hit loads the load buffer,
+// stores the store buffer (whichever structure fills first stalls issue)
+enum { FILLER_ALU, FILLER_LOAD, FILLER_STORE };
+static const char* filler_names[] = { "alu", "load", "store" };
+static const char* filler_structs[] = { "ROB", "load buffer", "store buffer" };
+static const char* filler_csvs[] = { "robsize.csv", "lbsize.csv", "sbsize.csv" };
+int filler = FILLER_ALU;
+int isolate = 0;    // --isolate: quiet CPU, redo disturbed runs
 
 // --- Timing Functions ---
 static inline uint64_t start_timer(void) {
@@ -26,23 +49,13 @@ static inline uint64_t end_timer(void) {
 }
 
 // --- Pointer-Chasing Setup ---
+// One random cycle through every element (cached on disk across runs)
 void init_dbuf(void **dbuf, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        dbuf[i] = &dbuf[(i + 1) % size];
-    }
-    
-    // Shuffle for random access pattern
-    srand(42);
-    for (size_t i = size - 1; i > 0; i--) {
-        size_t j = rand() % (i + 1);
-        void* temp = dbuf[i]; 
-        dbuf[i] = dbuf[j]; 
-        dbuf[j] = temp;
-    }
+    if (!chain_build(dbuf, size * sizeof(void*), CHAIN_ELEM, CHAIN_SEED)) exit(EXIT_FAILURE);
 }
 
 // --- Code Generation with Better Dependency Chain ---
-void make_routine(unsigned char* code_buf, void* p1, int filler_count) {
+void make_routine(unsigned char* code_buf, void* p1, void* scratch, int filler_count) {
     int pos = 0;
     
     // Prologue: push rbp; mov rbp, rsp; push rbx
@@ -55,6 +68,11 @@ void make_routine(unsigned char* code_buf, void* p1, int filler_count) {
     *(uintptr_t*)(code_buf + pos) = (uintptr_t)p1;
     pos += 8;
     
+    // mov rbx, scratch (base for load/store fillers; rbx is saved above)
+    code_buf[pos++] = 0x48; code_buf[pos++] = 0xBB;
+    *(uintptr_t*)(code_buf + pos) = (uintptr_t)scratch;
+    pos += 8;
+    
     // mov rax, ITERATIONS
     code_buf[pos++] = 0x48; code_buf[pos++] = 0xB8;
     *(uintptr_t*)(code_buf + pos) = ITERATIONS;
@@ -76,8 +94,25 @@ void make_routine(unsigned char* code_buf, void* p1, int filler_count) {
     code_buf[pos++] = 0x48; code_buf[pos++] = 0x31; code_buf[pos++] = 0xD2; // xor rdx, rdx
     
     for (int i = 0; i < filler_count; ++i) {
-        // add rdx, 1 (creates dependency chain)
-        code_buf[pos++] = 0x48; code_buf[pos++] = 0x83; code_buf[pos++] = 0xC2; code_buf[pos++] = 0x01;
+        int32_t disp = (i % SCRATCH_SLOTS) * 8;
+        switch (filler) {
+            case FILLER_LOAD:
+                // mov rdx, [rbx + disp32] (L1 hit, independent of rcx)
+                code_buf[pos++] = 0x48; code_buf[pos++] = 0x8B; code_buf[pos++] = 0x93;
+                *(int32_t*)(code_buf + pos) = disp;
+                pos += 4;
+                break;
+            case FILLER_STORE:
+                // mov [rbx + disp32], rdx
+                code_buf[pos++] = 0x48; code_buf[pos++] = 0x89; code_buf[pos++] = 0x93;
+                *(int32_t*)(code_buf + pos) = disp;
+                pos += 4;
+                break;
+            default:
+                // add rdx, 1 (creates dependency chain)
+                code_buf[pos++] = 0x48; code_buf[pos++] = 0x83; code_buf[pos++] = 0xC2; code_buf[pos++] = 0x01;
+                break;
+        }
     }
     
     // Use rdx to prevent dead code elimination
@@ -100,12 +135,49 @@ void make_routine(unsigned char* code_buf, void* p1, int filler_count) {
     code_buf[pos++] = 0xC3;
 }
 
-int main() {
-    // Pin to core 0
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    CPU_SET(0, &set);
-    sched_setaffinity(0, sizeof(set), &set);
+void handle_args(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"filler", required_argument, NULL, 'f'},
+        {"isolate", no_argument, NULL, 'i'},
+        {0, 0, 0, 0}
+    };
+    int optval = 0;
+    while ((optval = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (optval) {
+            case 'f':
+                if (!strcmp(optarg, "alu")) filler = FILLER_ALU;
+                else if (!strcmp(optarg, "load")) filler = FILLER_LOAD;
+                else if (!strcmp(optarg, "store")) filler = FILLER_STORE;
+                else {
+                    fprintf(stderr, "Unknown filler '%s' (alu|load|store)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'i': isolate = 1; break;
+            default: exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    handle_args(argc, argv);
+    
+    // Pin to one core of our cpuset, or to an isolated/quiet core with --isolate
+    noise_ctx_t noise = {0};
+    cpu_ctx_t cpus;
+    if (cpu_init(&cpus) != 0) {
+        perror("cpu_init failed");
+        return 1;
+    }
+    if (isolate) {
+        if (noise_init(&noise) != 0) return 1;
+        noise_floor_t floor;
+        noise_floor(1.0, &floor);
+        noise_print_floor(&floor);
+    } else if (cpu_pin(&cpus, cpu_pick(&cpus)) != 0) {
+        fprintf(stderr, "cpu_pin failed: %s\n", strerror(errno));
+        return 1;
+    }
     
     // Allocate large buffer for pointer chasing
     const size_t dbuf_size = 256 * 1024 * 1024;
@@ -120,7 +192,7 @@ int main() {
     init_dbuf(dbuf, num_elements);
     
     // Allocate executable memory
-    unsigned char* code_buf = (unsigned char*)mmap(NULL, 8192,
+    unsigned char* code_buf = (unsigned char*)mmap(NULL, CODE_SIZE,
         PROT_READ | PROT_WRITE | PROT_EXEC,
         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     
@@ -130,10 +202,13 @@ int main() {
         return 1;
     }
     
-    FILE* csv = fopen("robsize.csv", "w");
-    fprintf(csv, "filler_count,avg_cycles,min_cycles,max_cycles\n");
+    // Small scratch area for load/store fillers, kept hot in L1
+    static uint64_t scratch[SCRATCH_SLOTS] __attribute__((aligned(64)));
+    
+    FILE* csv = fopen(filler_csvs[filler], "w");
+    fprintf(csv, "filler_count,avg_cycles,min_cycles,max_cycles,filler,warmup_runs,valid\n");
     
-    printf("ROB Size Benchmark\n");
+    printf("ROB Size Benchmark (%s fillers -> %s)\n", filler_names[filler], filler_structs[filler]);
     printf("==================\n");
     printf("Filler Count | Avg Cycles | Min | Max\n");
     printf("-------------+------------+-----+-----\n");
@@ -142,50 +217,78 @@ int main() {
         void* p1 = dbuf;
         
         // Clear code buffer
-        memset(code_buf, 0, 8192);
+        memset(code_buf, 0, CODE_SIZE);
         
         // Generate routine
-        make_routine(code_buf, p1, icount);
+        make_routine(code_buf, p1, scratch, icount);
         void(*routine)() = (void(*)())code_buf;
         
-        // Warm up
-        routine();
+        // Warm up until the run time settles
+        warmup_t warm;
+        warmup_init(&warm, WARMUP_WINDOW / 2);
+        uint64_t t0;
+        do {
+            t0 = start_timer();
+            routine();
+        } while (warmup_feed(&warm, (double)(end_timer() - t0)));
         
-        // Multiple runs to reduce noise
-        uint64_t min_cycles = UINT64_MAX;
-        uint64_t max_cycles = 0;
-        uint64_t total_cycles = 0;
+        // Multiple runs to reduce noise; CFS-throttled runs are dropped, and
+        // a point with no clean run keeps them but is marked invalid
+        uint64_t min_cycles = UINT64_MAX, all_min = UINT64_MAX;
+        uint64_t max_cycles = 0, all_max = 0;
+        uint64_t total_cycles = 0, all_total = 0;
+        int clean = 0;
         
         for (int run = 0; run < NUM_RUNS; ++run) {
-            uint64_t start = start_timer();
-            routine();
-            uint64_t end = end_timer();
+            uint64_t start, end;
+            cpu_throttle_t thr;
+            NOISE_SAMPLE(&noise, {
+                cpu_throttle_read(&cpus.stat, &thr);
+                start = start_timer();
+                routine();
+                end = end_timer();
+            });
             
             uint64_t cycles = end - start;
+            if (cycles < all_min) all_min = cycles;
+            if (cycles > all_max) all_max = cycles;
+            all_total += cycles;
+            if (cpu_throttled(&cpus, &thr)) continue;
             if (cycles < min_cycles) min_cycles = cycles;
             if (cycles > max_cycles) max_cycles = cycles;
             total_cycles += cycles;
+            clean++;
         }
         
-        double avg_cycles = (double)total_cycles / (NUM_RUNS * ITERATIONS);
+        int valid = clean > 0;
+        if (!valid) {
+            min_cycles = all_min;
+            max_cycles = all_max;
+            total_cycles = all_total;
+            clean = NUM_RUNS;
+        }
+        double avg_cycles = (double)total_cycles / (clean * ITERATIONS);
         double min_per_iter = (double)min_cycles / ITERATIONS;
         double max_per_iter = (double)max_cycles / ITERATIONS;
         
-        printf("%12d | %10.2f | %3.0f | %3.0f\n", 
-               icount, avg_cycles, min_per_iter, max_per_iter);
+        printf("%12d | %10.2f | %3.0f | %3.0f%s\n", 
+               icount, avg_cycles, min_per_iter, max_per_iter, valid ? "" : " (INVALID: throttled)");
         
-        fprintf(csv, "%d,%.2f,%.2f,%.2f\n", 
-                icount, avg_cycles, min_per_iter, max_per_iter);
+        fprintf(csv, "%d,%.2f,%.2f,%.2f,%s,%d,%d\n",
+                icount, avg_cycles, min_per_iter, max_per_iter, filler_names[filler], warm.warm_batches, valid);
         fflush(csv);
     }
     
     printf("\n=== Analysis ===\n");
     printf("Look for a sharp increase ('knee') in avg_cycles.\n");
-    printf("The knee occurs approximately at ROB size.\n");
-    printf("Data saved to robsize.csv\n");
+    printf("The knee occurs approximately at the %s size.\n", filler_structs[filler]);
+    printf("Data saved to %s\n", filler_csvs[filler]);
     
+    noise_report(&noise);
+    noise_close(&noise);
+    cpu_report(&cpus);
     fclose(csv);
-    munmap(code_buf, 8192);
+    munmap(code_buf, CODE_SIZE);
     free(dbuf);
     
     return 0;
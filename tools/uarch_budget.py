@@ -0,0 +1,343 @@
+"""Time-budgeted runs: the best characterization a plan can give in N minutes.
+
+  python3 tools/uarch_budget.py plans/rob_fillers.toml --budget 10m
+
+Takes the plan files of uarch_plan.py and runs their points into the same
+<out>/<probe>/<point>/rep<N>/ layout, but instead of a fixed
+`repetitions` it decides as it goes which point gets the next run:
+
+  1. pilot: every grid point runs PILOT_REPS times, interleaved, which
+     gives the cost of a run and a first spread for each metric;
+  2. after that the point whose next run buys the most precision per
+     second runs again. Precision is the half-width of the 95% t-interval
+     on the mean of the per-run medians (uarch_metrics extractors),
+     relative to the mean. The gain of one more run is the expected drop
+     in that half-width, down to the target, summed over the point's
+     metrics and scaled by the probe's `weight` (default 1). Half-widths
+     are compared through x / (1 + x), so a 700% metric still outranks a
+     5% one without swamping everything else;
+  3. points at a knee, where neighbours along a numeric grid axis differ
+     by more than KNEE_STEP in some metric, count KNEE_WEIGHT times.
+     Knees fitted inside one run (rob_knee_entries, tlb_reach_pages...)
+     move between runs when they are uncertain, so their own spread
+     pulls in samples;
+  4. a point stops once every metric is within `target` (plan or probe,
+     default 2%), a probe once all its points have; the run ends when
+     nothing is left or no remaining run fits the budget.
+
+A point's first run may take at most an equal share of what is left
+among the pilot runs still to do, so one slow probe cannot starve the rest;
+a run killed by that cap or by the deadline is not repeated.
+
+The budget comes from --budget or the plan's `budget` ("600", "90s",
+"10m", "1h") and covers builds too. Runs already in the output
+directory count as samples, so a second invocation refines the first.
+The closing report, also written to <out>/budget.json, gives n, mean,
+half-width and achieved precision for every metric of every point, and
+whether the target was met.
+"""
+import argparse
+import json
+import math
+import os
+import re
+import sys
+import time
+from collections import defaultdict
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import uarch_db  # noqa: E402
+import uarch_metrics  # noqa: E402
+import uarch_plan  # noqa: E402
+
+DEFAULT_TARGET = 0.02
+PILOT_REPS = 2
+KNEE_STEP = 0.20
+KNEE_WEIGHT = 2.0
+MAX_FAILURES = 2
+
+# --- statistics ---
+def parse_budget(text):
+    m = re.fullmatch(r"\s*([0-9.]+)\s*([smh]?)\s*", str(text))
+    if not m:
+        sys.exit(f"cannot read budget '{text}' (e.g. 600, 90s, 10m, 1h)")
+    return float(m.group(1)) * {"": 1, "s": 1, "m": 60, "h": 3600}[m.group(2)]
+
+_T975 = {}
+
+def t975(df):
+    """Two-sided 95% quantile of Student's t, by bisection on its tail."""
+    if df not in _T975:
+        lo, hi = 0.0, 100.0
+        for _ in range(60):
+            t = 0.5 * (lo + hi)
+            p = uarch_db.betainc(df / 2, 0.5, df / (df + t * t))
+            lo, hi = (t, hi) if p > 0.05 else (lo, t)
+        _T975[df] = 0.5 * (lo + hi)
+    return _T975[df]
+
+def halfwidth(values, n=None):
+    """95% half-width of the mean; with `n`, as if the same spread had n samples."""
+    n = n or len(values)
+    if len(values) < 2:
+        return float("inf")
+    _, var = uarch_db.mean_var(values)
+    return t975(n - 1) * math.sqrt(var / n)
+
+def relative(hw, mean):
+    if hw == 0:
+        return 0.0
+    return hw / abs(mean) if mean else float("inf")
+
+# --- points ---
+class Point:
+    def __init__(self, probe, defines, args, target):
+        self.probe = probe
+        self.defines = defines
+        self.args = args
+        self.target = target
+        self.name = uarch_plan.point_name(probe, defines, args)
+        self.runs = 0               # next repetition index
+        self.seconds = []           # wall time of every run, failed ones too
+        self.failures = 0
+        self.ok = 0
+        self.values = defaultdict(list)     # metric -> per-run medians
+        self.knee = False
+
+    def load(self, point_dir):
+        """Account for one finished repetition; False if it did not succeed."""
+        try:
+            with open(os.path.join(point_dir, "point.json")) as f:
+                record = json.load(f)
+        except (OSError, ValueError):
+            return False
+        self.runs += 1
+        self.seconds.append(record.get("seconds", 0.0))
+        if record.get("returncode") == "timeout":
+            self.failures = MAX_FAILURES    # would not fit next time either
+            return False
+        if record.get("returncode") != 0:
+            self.failures += 1
+            return False
+        self.ok += 1
+        for name in record.get("outputs", []) + ["stdout.txt"]:
+            path = os.path.join(point_dir, name)
+            if not os.path.isfile(path) or not uarch_metrics.kind_of(path):
+                continue
+            for metric, samples in (uarch_metrics.extract(path) or {}).items():
+                self.values[metric].append(uarch_metrics.median(samples))
+        return True
+
+    def cost(self):
+        return sum(self.seconds) / len(self.seconds) if self.seconds else None
+
+    def precision(self, metric):
+        values = self.values[metric]
+        return relative(halfwidth(values), sum(values) / len(values))
+
+    def met(self):
+        return bool(self.values) and all(self.precision(m) <= self.target for m in self.values)
+
+    def active(self):
+        """Still worth another run."""
+        if self.failures >= MAX_FAILURES:
+            return False
+        if self.ok and not self.values:
+            return False            # runs, but nothing to refine
+        return not self.met()
+
+    def gain(self):
+        """Expected drop in relative half-width from one more run, summed over metrics."""
+        def soft(x):
+            return 1.0 if math.isinf(x) else x / (1.0 + x)
+        total = 0.0
+        for metric, values in self.values.items():
+            mean = sum(values) / len(values)
+            now = relative(halfwidth(values), mean)
+            after = relative(halfwidth(values, len(values) + 1), mean) if len(values) > 1 else 0.0
+            total += max(0.0, soft(now) - soft(max(after, self.target)))
+        return total
+
+def numeric(values):
+    return all(isinstance(v, (int, float)) and not isinstance(v, bool) for v in values)
+
+def mark_knees(probe, points):
+    """Flag points on either side of a large step along a numeric grid axis."""
+    for p in points:
+        p.knee = False
+    for axis in uarch_plan.varying(probe):
+        values = [{**p.defines, **p.args}[axis] for p in points]
+        if not numeric(values):
+            continue
+        lines = defaultdict(list)   # same values on every other axis
+        for p in points:
+            key = json.dumps({k: v for k, v in {**p.defines, **p.args}.items() if k != axis},
+                             sort_keys=True)
+            lines[key].append(p)
+        for line in lines.values():
+            line.sort(key=lambda p: {**p.defines, **p.args}[axis])
+            for a, b in zip(line, line[1:]):
+                for metric in set(a.values) & set(b.values):
+                    ya = uarch_metrics.median(a.values[metric])
+                    yb = uarch_metrics.median(b.values[metric])
+                    if ya and abs(yb / ya - 1) > KNEE_STEP:
+                        a.knee = b.knee = True
+
+# --- scheduling ---
+class Budget:
+    def __init__(self, seconds):
+        self.seconds = seconds
+        self.start = time.time()
+
+    def left(self):
+        return self.seconds - (time.time() - self.start)
+
+def estimate(point, points):
+    """Seconds one run of `point` should take: its own runs, else its probe's."""
+    cost = point.cost()
+    if cost is None:
+        costs = [p.cost() for p in points if p.probe is point.probe and p.cost() is not None]
+        cost = sum(costs) / len(costs) if costs else 0.0
+    return cost
+
+def run(plan, point, ctx, budget, share=None):
+    probe = dict(point.probe)
+    timeout = probe.get("timeout", plan.get("timeout"))
+    probe["timeout"] = max(1.0, min(timeout or math.inf, share or math.inf, budget.left()))
+    point_dir = uarch_plan.run_point(plan, probe, point.defines, point.args, point.runs, ctx)
+    point.load(point_dir)
+
+def existing(point, ctx):
+    """Load the repetitions a previous invocation left behind."""
+    base = os.path.join(ctx["out"], point.probe["name"], point.name)
+    while os.path.exists(os.path.join(base, f"rep{point.runs}", "point.json")):
+        point.load(os.path.join(base, f"rep{point.runs}"))
+
+def pick(points, budget):
+    """Best precision per second among the active points that fit."""
+    best, best_score = None, 0.0
+    for p in points:
+        if not p.active():
+            continue
+        cost = estimate(p, points)
+        if cost > budget.left():
+            continue
+        score = p.gain() * p.probe.get("weight", 1.0) * (KNEE_WEIGHT if p.knee else 1.0)
+        score /= max(cost, 1e-3)
+        if score > best_score:
+            best, best_score = p, score
+    return best
+
+def schedule(plan, probes, points, ctx, budget):
+    by_probe = {id(probe): [p for p in points if p.probe is probe] for probe in probes}
+    for rep in range(PILOT_REPS):
+        for p in points:
+            if p.runs <= rep and p.active() and estimate(p, points) <= budget.left():
+                slots = sum(max(0, PILOT_REPS - q.runs) for q in points if q.active())
+                run(plan, p, ctx, budget, budget.left() / slots if p.runs == 0 else None)
+    while True:
+        for probe in probes:
+            mark_knees(probe, by_probe[id(probe)])
+        p = pick(points, budget)
+        if p is None:
+            break
+        run(plan, p, ctx, budget)
+
+# --- report ---
+def fmt(x):
+    return "-" if x is None or math.isinf(x) or math.isnan(x) else f"{x:.4g}"
+
+def report(probes, points, budget, ctx):
+    rows, summary = [], {}
+    for probe in probes:
+        mine = [p for p in points if p.probe is probe]
+        met = sum(p.met() for p in mine)
+        runs = sum(p.runs for p in mine)
+        if met == len(mine):
+            status = "target met"
+        elif not any(p.ok for p in mine):
+            status = "no successful run"
+        elif not any(p.values for p in mine):
+            status = "no metrics"
+        else:
+            status = "budget exhausted"
+        print(f"probe {probe['name']}: {status}, {met}/{len(mine)} points within target, "
+              f"{runs} runs, {sum(sum(p.seconds) for p in mine):.0f} s")
+        entry = {"status": status, "runs": runs, "points": {}}
+        for p in mine:
+            metrics = {}
+            for metric, values in sorted(p.values.items()):
+                mean = sum(values) / len(values)
+                hw = halfwidth(values)
+                rel = p.precision(metric)
+                metrics[metric] = {"n": len(values), "mean": mean,
+                                   "halfwidth": None if math.isinf(hw) else hw,
+                                   "precision": None if math.isinf(rel) else rel,
+                                   "met": rel <= p.target}
+                unit = uarch_metrics.METRICS[metric].unit if metric in uarch_metrics.METRICS else ""
+                rows.append([probe["name"], p.name + (" *" if p.knee else ""), metric,
+                             str(len(values)), fmt(mean), "±" + fmt(hw) + (f" {unit}" if unit else ""),
+                             fmt(100 * rel) + "%" if not math.isinf(rel) else "-",
+                             "yes" if rel <= p.target else "no"])
+            entry["points"][p.name] = {"runs": p.runs, "failures": p.failures, "knee": p.knee,
+                                       "target": p.target, "seconds": sum(p.seconds),
+                                       "metrics": metrics}
+        summary[probe["name"]] = entry
+
+    header = ["probe", "point", "metric", "n", "mean", "95% CI", "precision", "met"]
+    widths = [max(len(r[i]) for r in rows + [header]) for i in range(len(header))]
+    print()
+    for r in [header] + rows:
+        print("  ".join(c.ljust(w) for c, w in zip(r, widths)).rstrip())
+    print("(* knee point)")
+    used = budget.seconds - budget.left()
+    print(f"used {used:.0f} of {budget.seconds:.0f} s")
+    with open(os.path.join(ctx["out"], "budget.json"), "w") as f:
+        json.dump({"budget_seconds": budget.seconds, "used_seconds": round(used, 1),
+                   "fingerprint": ctx["fingerprint_id"], "probes": summary}, f, indent=2)
+        f.write("\n")
+
+# --- entrypoint ---
+def main():
+    parser = argparse.ArgumentParser(description="run a uarch plan against a wall-clock budget")
+    parser.add_argument("plan", help="plan file (.toml or .json)")
+    parser.add_argument("--budget", help="wall-clock budget: 600, 90s, 10m, 1h (default: the plan's)")
+    parser.add_argument("--target", type=float,
+                        help=f"relative 95%% half-width to reach (default: plan's, else {DEFAULT_TARGET})")
+    parser.add_argument("--dry-run", action="store_true", help="print the points only")
+    parser.add_argument("--only", action="append", metavar="PROBE", help="run only these probes")
+    parser.add_argument("--out", help="override the plan's output directory")
+    parser.add_argument("--force", action="store_true", help="run even if page_size cannot be applied")
+    parser.add_argument("--ingest", action="store_true", help="store outputs in the results database")
+    args = parser.parse_args()
+
+    plan = uarch_plan.load(args.plan)
+    if not (args.budget or plan.get("budget")):
+        sys.exit("no budget: pass --budget or set `budget` in the plan")
+    budget = Budget(parse_budget(args.budget or plan["budget"]))
+    probes = [p for p in plan["probe"] if not args.only or p["name"] in args.only]
+    ctx = uarch_plan.context(plan, probes, args.out, args.dry_run, False, args.force, args.ingest)
+    points = []
+    for probe in probes:
+        target = args.target or probe.get("target", plan.get("target", DEFAULT_TARGET))
+        points += [Point(probe, d, a, target) for d, a in uarch_plan.grid(probe)]
+
+    print(f"plan {plan.get('name', args.plan)}: {len(points)} points, "
+          f"{budget.seconds:.0f} s budget -> {ctx['out']}")
+    if args.dry_run:
+        for p in points:
+            uarch_plan.run_point(plan, p.probe, p.defines, p.args, 0, ctx)
+        return
+    os.makedirs(ctx["out"], exist_ok=True)
+    for p in points:
+        existing(p, ctx)
+    restore = uarch_plan.thp_mode()
+    try:
+        schedule(plan, probes, points, ctx, budget)
+    finally:
+        if uarch_plan.thp_mode() != restore:
+            uarch_plan.write_thp(restore)
+    report(probes, points, budget, ctx)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,256 @@
+"""Side-by-side comparison of two or more host profiles.
+
+A profile is a directory of probe outputs, e.g. artemisia/ or sunbird/ in
+this tree, or a results directory from another machine. Outputs are
+aligned by kind (CSV file name, or header for stdout captures), not by
+path, since the hosts do not number their sections the same way
+(sunbird/5.4/5.4.1/btb_performance.csv vs artemisia/5.4/).
+
+  python3 tools/uarch_compare.py artemisia sunbird --out compare/
+
+writes compare/report.md containing:
+
+  - a capacity-planning summary of the headline metrics (cache sizes,
+    latencies, bandwidths, ROB, PRF, BTB, TLB) per host, with the
+    relative delta of every host against the first one
+  - per-output tables for every extracted metric
+  - probe source drift: files that exist on several hosts but differ
+    (has_branch_pd.c vs has_branch_pred.c, tlb.c)
+
+and one overlay PNG per aligned sweep. --no-plots skips matplotlib.
+"""
+import argparse
+import difflib
+import os
+import sys
+from collections import defaultdict
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import uarch_metrics  # noqa: E402
+from uarch_metrics import METRICS, median  # noqa: E402
+
+# Summary sections, in report order: (title, metric names)
+SUMMARY = [
+    ("Caches", ["cache_l1_bytes", "cache_l2_bytes", "cache_l3_bytes", "line_bytes"]),
+    ("Latency", ["lat_l1_cycles", "lat_l2_cycles", "lat_l3_cycles", "lat_dram_cycles",
+                 "chase_l1_cycles", "chase_dram_cycles"]),
+    ("Bandwidth", ["bw_load_bytes_per_cycle", "bw_store_bytes_per_cycle",
+                   "bw_rmw_bytes_per_cycle", "bw_nt_bytes_per_cycle"]),
+    ("Core", ["rob_knee_entries", "prf_knee_icount", "vpxor_latency_cycles", "vpxor_ipc"]),
+    ("Branch", ["btb_entries", "mispredict_penalty_cycles"]),
+    ("TLB", ["tlb_reach_pages", "page_walk_cycles"]),
+]
+
+# Overlay plots per kind: (x column, y column, row filter, log2 x axis)
+OVERLAYS = {
+    "cache_hierarchy_data.csv": ("working_set_size_bytes", "time_per_access_cycles",
+                                 lambda r: r.get("layout", "elem") in ("elem", "line"), True),
+    "cache_sweep_results.csv": ("working_set_size_bytes", "time_per_access_cycles", None, True),
+    "cache_heatmap.csv": ("size_bytes", "cycles_per_access",
+                          lambda r: r.get("stride_bytes") == "64" and r.get("threads", "1") == "1", True),
+    "cache_line_raw_data.csv": ("stride_bytes", "avg_cycles_per_access", None, True),
+    "prefetcher_data.csv": ("stride", "cycles_per_access", lambda r: r["type"] == "stride", True),
+    "robsize.csv": ("filler_count", "avg_cycles", None, False),
+    "prf_raw_data.csv": ("ICOUNT", "CYCLES", None, False),
+    "btb_performance.csv": ("Num_Branches", "Average_Cycles", None, True),
+    "tlb.csv": ("NumPages", "Cycles_per_Access", None, False),
+}
+
+# --- loading ---
+def sources(root):
+    """{relative path: text} of the probe sources in a profile."""
+    out = {}
+    for dirpath, _, files in os.walk(root):
+        for name in files:
+            if name.endswith((".c", ".cpp", ".h")):
+                path = os.path.join(dirpath, name)
+                with open(path, errors="replace") as f:
+                    out[os.path.relpath(path, root)] = f.read()
+    return out
+
+# --- formatting ---
+def fmt(value, unit):
+    if value is None:
+        return "-"
+    if unit == "bytes":
+        for scale, suffix in ((1 << 30, "G"), (1 << 20, "M"), (1 << 10, "K")):
+            if value >= scale:
+                return f"{value / scale:g}{suffix}"
+        return f"{value:g}"
+    return f"{value:.4g}" if abs(value) < 1000 else f"{value:.0f}"
+
+def delta(value, ref):
+    if value is None or ref is None or ref == 0:
+        return ""
+    return f" ({100 * (value - ref) / abs(ref):+.1f}%)"
+
+def table(header, rows):
+    lines = ["| " + " | ".join(header) + " |", "|" + "---|" * len(header)]
+    lines += ["| " + " | ".join(row) + " |" for row in rows]
+    return "\n".join(lines)
+
+def metric_row(name, hosts, values):
+    m = METRICS[name]
+    ref = values[hosts[0]].get(name)
+    cells = [fmt(values[hosts[0]].get(name), m.unit)]
+    cells += [fmt(values[h].get(name), m.unit) + delta(values[h].get(name), ref) for h in hosts[1:]]
+    return [f"{name} ({m.unit})"] + cells
+
+# --- report sections ---
+def summary_section(hosts, values):
+    out = ["## Summary", "",
+           f"Medians per host; deltas are relative to {hosts[0]}.", ""]
+    for title, names in SUMMARY:
+        rows = [metric_row(n, hosts, values) for n in names
+                if any(n in values[h] for h in hosts)]
+        if rows:
+            out += [f"### {title}", "", table(["metric"] + hosts, rows), ""]
+    return out
+
+def outputs_section(hosts, profiles, per_kind):
+    out = ["## Outputs", ""]
+    kinds = sorted(set().union(*(profiles[h] for h in hosts)))
+    for kind in kinds:
+        present = [h for h in hosts if kind in profiles[h]]
+        out += [f"### {kind}", ""]
+        out += [f"- {h}: `{profiles[h][kind]}`" for h in present]
+        missing = [h for h in hosts if h not in present]
+        if missing:
+            out.append(f"- missing on: {', '.join(missing)}")
+        names = sorted(set().union(*(per_kind[h].get(kind, {}) for h in present)))
+        if names:
+            vals = {h: {n: median(v) for n, v in per_kind[h].get(kind, {}).items()} for h in hosts}
+            rows = [metric_row(n, hosts, vals) + [
+                ", ".join(f"{h} n={len(per_kind[h][kind][n])}" for h in present
+                          if n in per_kind[h].get(kind, {}))] for n in names]
+            out += ["", table(["metric"] + hosts + ["samples"], rows)]
+        out.append("")
+    return out
+
+def drift_section(hosts):
+    """Same-path sources that differ, plus lone .c files paired per directory."""
+    src = {h: sources(h) for h in hosts}
+    ref = hosts[0]
+    rows = []
+    for other in hosts[1:]:
+        pairs = [(p, p) for p in sorted(set(src[ref]) & set(src[other]))]
+        # one .c per directory on each side under different names
+        by_dir = defaultdict(lambda: ([], []))
+        for p in set(src[ref]) - set(src[other]):
+            by_dir[os.path.dirname(p)][0].append(p)
+        for p in set(src[other]) - set(src[ref]):
+            by_dir[os.path.dirname(p)][1].append(p)
+        pairs += [(a[0], b[0]) for a, b in by_dir.values() if len(a) == 1 and len(b) == 1]
+        for a, b in sorted(pairs):
+            ta, tb = src[ref][a].splitlines(), src[other][b].splitlines()
+            if ta == tb:
+                continue
+            changed = sum(1 for l in difflib.unified_diff(ta, tb, lineterm="", n=0)
+                          if l[:1] in "+-" and not l.startswith(("+++", "---")))
+            name = a if a == b else f"{a} / {os.path.basename(b)}"
+            rows.append([name, other, str(len(ta)), str(len(tb)), str(changed)])
+    if not rows:
+        return []
+    return ["## Probe source drift", "",
+            f"Sources that differ from {ref}; results from these probes are not like for like.", "",
+            table(["source", "host", f"lines ({ref})", "lines (host)", "changed lines"], rows), ""]
+
+# --- plots ---
+def overlay(kind, hosts, profiles, out_dir):
+    import matplotlib.pyplot as plt
+
+    xcol, ycol, keep, logx = OVERLAYS[kind]
+    fig, (ax, ax_rel) = plt.subplots(2, 1, figsize=(10, 8), sharex=True,
+                                     gridspec_kw={"height_ratios": [3, 1]})
+    curves = {}
+    for h in hosts:
+        if kind not in profiles[h]:
+            continue
+        rows = uarch_metrics.read_rows(profiles[h][kind])
+        pts = defaultdict(list)
+        for r in rows:
+            if keep and not keep(r):
+                continue
+            x, y = uarch_metrics.num(r, xcol), uarch_metrics.num(r, ycol)
+            if x is not None and y is not None:
+                pts[x].append(y)
+        if not pts:
+            continue
+        xs = sorted(pts)
+        curves[h] = dict(zip(xs, [median(pts[x]) for x in xs]))
+        ax.plot(xs, [curves[h][x] for x in xs], marker=".", label=h)
+    if len(curves) < 2:
+        plt.close(fig)
+        return None
+
+    # relative delta against the first host, at the x values they share
+    ref = next(iter(curves))
+    for h, c in curves.items():
+        if h == ref:
+            continue
+        xs = sorted(set(c) & set(curves[ref]))
+        ax_rel.plot(xs, [100 * (c[x] - curves[ref][x]) / curves[ref][x] if curves[ref][x] else 0
+                         for x in xs], marker=".", label=f"{h} vs {ref}")
+    ax_rel.axhline(0, color="gray", linewidth=0.8)
+    ax_rel.set_ylabel("delta (%)")
+    ax_rel.set_xlabel(xcol)
+    ax.set_ylabel(ycol)
+    ax.set_title(f"{kind}: {' vs '.join(curves)}")
+    if logx:
+        ax.set_xscale("log", base=2)
+    for a in (ax, ax_rel):
+        a.grid(True, which="both", linestyle="--", alpha=0.7)
+        a.legend()
+    plt.tight_layout()
+    name = "overlay_" + os.path.splitext(kind)[0] + ".png"
+    fig.savefig(os.path.join(out_dir, name), dpi=150)
+    plt.close(fig)
+    return name
+
+# --- entrypoint ---
+def main():
+    parser = argparse.ArgumentParser(description="compare uarch host profiles")
+    parser.add_argument("profiles", nargs="+", help="host directories; the first is the reference")
+    parser.add_argument("--out", default="compare", help="report directory (default: compare)")
+    parser.add_argument("--no-plots", action="store_true", help="tables only")
+    args = parser.parse_args()
+    if len(args.profiles) < 2:
+        parser.error("need at least two profiles")
+
+    hosts = [os.path.normpath(p) for p in args.profiles]
+    profiles = {h: uarch_metrics.find_outputs(h) for h in hosts}
+    per_kind = {h: {k: uarch_metrics.extract(p, k) for k, p in profiles[h].items()} for h in hosts}
+
+    # headline values: median per metric, first output that has it
+    values = {h: {} for h in hosts}
+    for h in hosts:
+        for kind in sorted(per_kind[h]):
+            for name, samples in per_kind[h][kind].items():
+                values[h].setdefault(name, median(samples))
+
+    os.makedirs(args.out, exist_ok=True)
+    lines = [f"# uarch comparison: {' vs '.join(hosts)}", ""]
+    lines += summary_section(hosts, values)
+    lines += outputs_section(hosts, profiles, per_kind)
+    lines += drift_section(hosts)
+    if not args.no_plots:
+        try:
+            import matplotlib
+            matplotlib.use("Agg")
+        except ImportError:
+            print("matplotlib not available, writing tables only")
+            args.no_plots = True
+    if not args.no_plots:
+        plots = [overlay(k, hosts, profiles, args.out) for k in sorted(OVERLAYS)]
+        plots = [p for p in plots if p]
+        if plots:
+            lines += ["## Overlays", ""] + [f"![{p}]({p})" for p in plots] + [""]
+
+    report = os.path.join(args.out, "report.md")
+    with open(report, "w") as f:
+        f.write("\n".join(lines))
+    print("\n".join(summary_section(hosts, values)))
+    print(f"Report written to {report}")
+
+if __name__ == "__main__":
+    main()
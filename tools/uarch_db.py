@@ -0,0 +1,467 @@
+"""Local results database and drift alerts for the uarch probes.
+
+Every ingested CSV becomes a run tied to a machine fingerprint: the host
+identity (hostname, CPU model/stepping, CPU count) plus the environment
+that firmware and OS updates change (microcode, BIOS, kernel, governor,
+THP, SMT, turbo). uarch_metrics.py reduces each file to headline metrics;
+`check` tests the latest run of every metric against that host's
+baseline runs and flags drift beyond the metric's tolerance, naming the
+environment fields that changed in between.
+
+  python3 tools/uarch_db.py fingerprint > sunbird.json     # on the target host
+  python3 tools/uarch_db.py ingest --fingerprint sunbird.json sunbird/5.3/3/*.csv
+  python3 tools/uarch_db.py baseline --latest --host sunbird
+  python3 tools/uarch_db.py check --host sunbird            # exit 1 on regression or drift
+  python3 tools/uarch_db.py history lat_dram_cycles
+
+The database is SQLite at $UARCH_DB (default
+~/.local/share/uarch/results.sqlite). Only the standard library is used,
+so it runs on lab machines without pandas or scipy.
+"""
+import argparse
+import datetime
+import hashlib
+import json
+import math
+import os
+import platform
+import socket
+import sqlite3
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import uarch_metrics  # noqa: E402
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS machines (
+    id INTEGER PRIMARY KEY,
+    fingerprint TEXT UNIQUE NOT NULL,
+    host TEXT NOT NULL,
+    identity TEXT NOT NULL,
+    env TEXT NOT NULL,
+    first_seen TEXT NOT NULL
+);
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY,
+    machine_id INTEGER NOT NULL REFERENCES machines(id),
+    source TEXT NOT NULL,
+    kind TEXT NOT NULL,
+    file_sha TEXT NOT NULL,
+    git_rev TEXT,
+    label TEXT,
+    ingested_at TEXT NOT NULL,
+    baseline INTEGER NOT NULL DEFAULT 0,
+    UNIQUE (machine_id, file_sha)
+);
+CREATE TABLE IF NOT EXISTS samples (
+    run_id INTEGER NOT NULL REFERENCES runs(id),
+    metric TEXT NOT NULL,
+    value REAL NOT NULL
+);
+CREATE INDEX IF NOT EXISTS samples_metric ON samples (metric, run_id);
+"""
+
+IDENTITY_KEYS = ["host", "cpu_model", "cpu_family", "cpu_model_id", "stepping", "cpus"]
+
+# --- machine fingerprint ---
+def read_file(path):
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except OSError:
+        return "unknown"
+
+def cpuinfo():
+    info = {}
+    for line in read_file("/proc/cpuinfo").splitlines():
+        if ":" in line:
+            key, value = line.split(":", 1)
+            info.setdefault(key.strip(), value.strip())
+    return info
+
+def bracketed(text):
+    """The selected value of a sysfs '[always] madvise never' setting."""
+    if "[" in text and "]" in text:
+        return text[text.index("[") + 1:text.index("]")]
+    return text
+
+def fingerprint():
+    cpu = cpuinfo()
+    return {
+        "host": socket.gethostname().split(".")[0],
+        "cpu_model": cpu.get("model name", "unknown"),
+        "cpu_family": cpu.get("cpu family", "unknown"),
+        "cpu_model_id": cpu.get("model", "unknown"),
+        "stepping": cpu.get("stepping", "unknown"),
+        "cpus": str(os.cpu_count()),
+        "microcode": cpu.get("microcode", "unknown"),
+        "kernel": platform.release(),
+        "bios_vendor": read_file("/sys/class/dmi/id/bios_vendor"),
+        "bios_version": read_file("/sys/class/dmi/id/bios_version"),
+        "bios_date": read_file("/sys/class/dmi/id/bios_date"),
+        "governor": read_file("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"),
+        "thp": bracketed(read_file("/sys/kernel/mm/transparent_hugepage/enabled")),
+        "smt": read_file("/sys/devices/system/cpu/smt/control"),
+        "no_turbo": read_file("/sys/devices/system/cpu/intel_pstate/no_turbo"),
+    }
+
+def split_fingerprint(fp):
+    identity = {k: fp.get(k, "unknown") for k in IDENTITY_KEYS}
+    env = {k: v for k, v in sorted(fp.items()) if k not in IDENTITY_KEYS}
+    return identity, env
+
+def fingerprint_id(fp):
+    return hashlib.sha1(json.dumps(fp, sort_keys=True).encode()).hexdigest()[:16]
+
+def git_rev(path):
+    try:
+        out = subprocess.run(["git", "-C", os.path.dirname(os.path.abspath(path)),
+                              "rev-parse", "--short", "HEAD"],
+                             capture_output=True, text=True, timeout=10)
+        return out.stdout.strip() or None
+    except (OSError, subprocess.SubprocessError):
+        return None
+
+# --- statistics (two-sided p-values) ---
+def mean_var(xs):
+    n = len(xs)
+    m = sum(xs) / n
+    return m, (sum((x - m) ** 2 for x in xs) / (n - 1) if n > 1 else 0.0)
+
+def mann_whitney(a, b):
+    """Mann-Whitney U with tie correction, normal approximation."""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return float("nan")
+    merged = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    n = n1 + n2
+    rank_a, ties, i = 0.0, 0.0, 0
+    while i < n:
+        j = i
+        while j < n and merged[j][0] == merged[i][0]:
+            j += 1
+        rank = 0.5 * (i + 1 + j)
+        rank_a += rank * sum(1 for k in range(i, j) if merged[k][1] == 0)
+        t = j - i
+        ties += t ** 3 - t
+        i = j
+    u = rank_a - n1 * (n1 + 1) / 2
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1))) if n > 1 else 0.0
+    if var <= 0:
+        return 1.0
+    z = max(abs(u - n1 * n2 / 2.0) - 0.5, 0.0) / math.sqrt(var)
+    return math.erfc(z / math.sqrt(2))
+
+def betacf(a, b, x):
+    """Continued fraction for the regularized incomplete beta (Lentz)."""
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        for num in (m * (b - m) * x / ((a + m2 - 1) * (a + m2)),
+                    -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1))):
+            d = 1.0 + num * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + num / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1.0) < 1e-12:
+            break
+    return h
+
+def betainc(a, b, x):
+    if x <= 0:
+        return 0.0
+    if x >= 1:
+        return 1.0
+    lbeta = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+    front = math.exp(lbeta + a * math.log(x) + b * math.log(1 - x))
+    if x < (a + 1) / (a + b + 2):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1 - x) / b
+
+def welch(a, b):
+    """Welch's unequal-variance t-test."""
+    if len(a) < 2 or len(b) < 2:
+        return float("nan")
+    ma, va = mean_var(a)
+    mb, vb = mean_var(b)
+    se2 = va / len(a) + vb / len(b)
+    if se2 == 0:
+        return 1.0 if ma == mb else 0.0
+    t = (ma - mb) / math.sqrt(se2)
+    df = se2 ** 2 / ((va / len(a)) ** 2 / (len(a) - 1) + (vb / len(b)) ** 2 / (len(b) - 1))
+    return betainc(df / 2, 0.5, df / (df + t * t))
+
+def z_test(value, base):
+    """One candidate sample against the baseline spread."""
+    if len(base) < 3:
+        return float("nan")
+    m, v = mean_var(base)
+    if v == 0:
+        return 1.0 if value == m else 0.0
+    return math.erfc(abs(value - m) / math.sqrt(v) / math.sqrt(2))
+
+def compare(base, cand, metric, alpha):
+    """Verdict for one metric: dict with medians, change, p-values, status."""
+    mb, mc = uarch_metrics.median(base), uarch_metrics.median(cand)
+    change = (mc - mb) / abs(mb) if mb else float("inf") if mc != mb else 0.0
+    if len(cand) >= 2:
+        p_mw, p_welch = mann_whitney(base, cand), welch(base, cand)
+        p = p_mw
+    else:
+        p_mw = p_welch = float("nan")
+        p = z_test(cand[0], base)
+    worse = {"lower": change > 0, "higher": change < 0, "none": True}[metric.better]
+    status = "ok"
+    if abs(change) > metric.tolerance:
+        if math.isnan(p):
+            # too few samples to test (single-valued metrics such as cache
+            # sizes): the tolerance alone flags it, with no p-value behind it
+            status = "DRIFT (tolerance only)" if worse else "improved (tolerance only)"
+        elif p < alpha:
+            status = "REGRESSION" if worse else "improved"
+    return {"base": mb, "cand": mc, "change": change, "p_mw": p_mw,
+            "p_welch": p_welch, "p": p, "status": status}
+
+# --- database ---
+def db_path():
+    return os.environ.get("UARCH_DB", os.path.expanduser("~/.local/share/uarch/results.sqlite"))
+
+def connect():
+    path = db_path()
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    db = sqlite3.connect(path)
+    db.executescript(SCHEMA)
+    return db
+
+def machine_id(db, fp):
+    key = fingerprint_id(fp)
+    row = db.execute("SELECT id FROM machines WHERE fingerprint = ?", (key,)).fetchone()
+    if row:
+        return row[0]
+    identity, env = split_fingerprint(fp)
+    cur = db.execute(
+        "INSERT INTO machines (fingerprint, host, identity, env, first_seen) VALUES (?, ?, ?, ?, ?)",
+        (key, identity["host"], json.dumps(identity, sort_keys=True),
+         json.dumps(env, sort_keys=True), now()))
+    return cur.lastrowid
+
+def now():
+    return datetime.datetime.now().isoformat(timespec="seconds")
+
+def ingest(db, paths, fp, kind=None, label=None, baseline=False):
+    mid = machine_id(db, fp)
+    added = []
+    for path in paths:
+        metrics = uarch_metrics.extract(path, kind)
+        if metrics is None:
+            print(f"skip {path}: no extractor for {os.path.basename(path)}")
+            continue
+        if not metrics:
+            print(f"skip {path}: no metrics found")
+            continue
+        digest = uarch_metrics.sha256(path)
+        if db.execute("SELECT 1 FROM runs WHERE machine_id = ? AND file_sha = ?",
+                      (mid, digest)).fetchone():
+            print(f"skip {path}: already ingested")
+            continue
+        cur = db.execute(
+            "INSERT INTO runs (machine_id, source, kind, file_sha, git_rev, label, ingested_at, baseline)"
+            " VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+            (mid, os.path.abspath(path), kind or uarch_metrics.kind_of(path), digest,
+             git_rev(path), label, now(), int(baseline)))
+        for metric, samples in metrics.items():
+            db.executemany("INSERT INTO samples (run_id, metric, value) VALUES (?, ?, ?)",
+                           [(cur.lastrowid, metric, v) for v in samples])
+        added.append(cur.lastrowid)
+        print(f"run {cur.lastrowid}: {path} ({', '.join(sorted(metrics))})")
+    db.commit()
+    return added
+
+def host_filter(host):
+    return ("AND m.host = ?", (host,)) if host else ("", ())
+
+def runs_for(db, metric, host, baseline=None, kind=None):
+    """[(run_id, machine_id, host)] with samples of `metric`, oldest first."""
+    where, args = host_filter(host)
+    if kind is not None:
+        where += " AND r.kind = ?"
+        args += (kind,)
+    if baseline is not None:
+        where += " AND r.baseline = ?"
+        args += (int(baseline),)
+    return db.execute(
+        "SELECT DISTINCT r.id, r.machine_id, m.host FROM runs r"
+        " JOIN machines m ON m.id = r.machine_id"
+        " JOIN samples s ON s.run_id = r.id"
+        f" WHERE s.metric = ? {where} ORDER BY r.id", (metric,) + args).fetchall()
+
+def samples(db, run_ids, metric):
+    marks = ",".join("?" * len(run_ids))
+    return [v for (v,) in db.execute(
+        f"SELECT value FROM samples WHERE metric = ? AND run_id IN ({marks})",
+        (metric,) + tuple(run_ids))]
+
+def env_of(db, mid):
+    return json.loads(db.execute("SELECT env FROM machines WHERE id = ?", (mid,)).fetchone()[0])
+
+def env_diff(old, new):
+    return [f"{k}: {old.get(k)} -> {new.get(k)}"
+            for k in sorted(set(old) | set(new)) if old.get(k) != new.get(k)]
+
+def check(db, host=None, metrics=None, alpha=0.01, tolerance=None):
+    """Print a verdict per (host, metric); returns the number of regressions,
+    counting untestable drifts past tolerance (status DRIFT) as well."""
+    hosts = [host] if host else [h for (h,) in db.execute("SELECT DISTINCT host FROM machines ORDER BY host")]
+    regressions = 0
+    for h in hosts:
+        print(f"== {h}")
+        print(f"{'metric':<28} {'baseline':>10} {'latest':>10} {'change':>8} "
+              f"{'p(MW)':>8} {'p(Welch)':>8}  status")
+        envs = set()
+        for name, metric in uarch_metrics.METRICS.items():
+            if metrics and name not in metrics:
+                continue
+            if tolerance is not None:
+                metric = uarch_metrics.Metric(name, metric.unit, metric.better, tolerance, metric.desc)
+            # a metric is only compared between runs of the same probe output
+            kinds = [k for (k,) in db.execute(
+                "SELECT DISTINCT r.kind FROM runs r JOIN machines m ON m.id = r.machine_id"
+                " JOIN samples s ON s.run_id = r.id WHERE s.metric = ? AND m.host = ?"
+                " ORDER BY r.kind", (name, h))]
+            for kind in kinds:
+                runs = runs_for(db, name, h, kind=kind)
+                base = runs_for(db, name, h, baseline=True, kind=kind)
+                implicit = not base
+                if implicit:
+                    base = runs[:1]
+                cand = [r for r in runs if r not in base]
+                if not cand:
+                    continue
+                latest = cand[-1]
+                v = compare(samples(db, [r[0] for r in base], name),
+                            samples(db, [latest[0]], name), metric, alpha)
+                status = v["status"] + (" (implicit baseline)" if implicit else "")
+                label = name if len(kinds) == 1 else f"{name} [{kind}]"
+                print(f"{label:<28} {v['base']:>10.3f} {v['cand']:>10.3f} {100 * v['change']:>7.1f}% "
+                      f"{v['p_mw']:>8.2g} {v['p_welch']:>8.2g}  {status}")
+                if v["status"] == "REGRESSION" or v["status"].startswith("DRIFT"):
+                    regressions += 1
+                    envs.add((base[-1][1], latest[1]))
+        for old, new in sorted(envs):
+            diff = env_diff(env_of(db, old), env_of(db, new))
+            print("  environment since baseline: " + ("; ".join(diff) if diff else "unchanged"))
+    return regressions
+
+# --- commands ---
+def cmd_fingerprint(args):
+    json.dump(fingerprint(), sys.stdout, indent=2, sort_keys=True)
+    print()
+
+def cmd_ingest(args):
+    fp = fingerprint()
+    if args.fingerprint:
+        with open(args.fingerprint) as f:
+            fp = json.load(f)
+    if args.host:
+        fp["host"] = args.host
+    with connect() as db:
+        ingest(db, args.csv, fp, args.kind, args.label, args.baseline)
+
+def cmd_baseline(args):
+    with connect() as db:
+        where, params = host_filter(args.host)
+        if args.clear:
+            db.execute("UPDATE runs SET baseline = 0 WHERE machine_id IN"
+                       f" (SELECT m.id FROM machines m WHERE 1 {where})", params)
+        ids = list(args.runs)
+        if args.label:
+            ids += [r for (r,) in db.execute(
+                f"SELECT r.id FROM runs r JOIN machines m ON m.id = r.machine_id"
+                f" WHERE r.label = ? {where}", (args.label,) + params)]
+        if args.latest:
+            # newest run of every kind becomes that kind's baseline
+            ids += [r for (r,) in db.execute(
+                f"SELECT MAX(r.id) FROM runs r JOIN machines m ON m.id = r.machine_id"
+                f" WHERE 1 {where} GROUP BY m.host, r.kind", params)]
+        db.executemany("UPDATE runs SET baseline = 1 WHERE id = ?", [(i,) for i in ids])
+        print(f"{len(ids)} run(s) marked as baseline")
+
+def cmd_check(args):
+    with connect() as db:
+        n = check(db, args.host, args.metric, args.alpha, args.tolerance)
+    if n:
+        print(f"{n} regression(s)")
+        sys.exit(1)
+
+def cmd_history(args):
+    with connect() as db:
+        for run_id, mid, host in runs_for(db, args.metric, args.host):
+            vals = samples(db, [run_id], args.metric)
+            rev, label, base, when = db.execute(
+                "SELECT git_rev, label, baseline, ingested_at FROM runs WHERE id = ?",
+                (run_id,)).fetchone()
+            env = env_of(db, mid)
+            print(f"{run_id:>5} {host:<12} {when} median {uarch_metrics.median(vals):10.3f} "
+                  f"n={len(vals):<5} ucode {env.get('microcode')} kernel {env.get('kernel')}"
+                  f"{' [baseline]' if base else ''}{f' {label}' if label else ''}"
+                  f"{f' @{rev}' if rev else ''}")
+
+def cmd_machines(args):
+    with connect() as db:
+        for mid, fp, host, env, seen in db.execute(
+                "SELECT id, fingerprint, host, env, first_seen FROM machines ORDER BY id"):
+            env = json.loads(env)
+            print(f"{mid:>3} {fp} {host:<12} first seen {seen}  ucode {env.get('microcode')}"
+                  f"  bios {env.get('bios_version')}  kernel {env.get('kernel')}")
+
+def main():
+    parser = argparse.ArgumentParser(description="uarch results database")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("fingerprint", help="print this machine's fingerprint as JSON")
+    p.set_defaults(fn=cmd_fingerprint)
+
+    p = sub.add_parser("ingest", help="store probe CSVs as runs")
+    p.add_argument("csv", nargs="+")
+    p.add_argument("--fingerprint", help="JSON from `fingerprint` on the host that ran the probes")
+    p.add_argument("--host", help="override the host name in the fingerprint")
+    p.add_argument("--kind", help="extractor to use instead of the file name",
+                   choices=sorted(list(uarch_metrics.EXTRACTORS) + list(uarch_metrics.TEXT_EXTRACTORS)))
+    p.add_argument("--label", help="free-form tag, e.g. 'bios 2.1 + ucode 0x2b000603'")
+    p.add_argument("--baseline", action="store_true", help="mark the new runs as baseline")
+    p.set_defaults(fn=cmd_ingest)
+
+    p = sub.add_parser("baseline", help="mark runs as the comparison baseline")
+    p.add_argument("runs", nargs="*", type=int)
+    p.add_argument("--label", help="every run with this label")
+    p.add_argument("--latest", action="store_true", help="the newest run of each kind")
+    p.add_argument("--host")
+    p.add_argument("--clear", action="store_true", help="unmark the current baseline first")
+    p.set_defaults(fn=cmd_baseline)
+
+    p = sub.add_parser("check", help="test the latest runs against the baseline")
+    p.add_argument("--host")
+    p.add_argument("--metric", action="append", choices=sorted(uarch_metrics.METRICS))
+    p.add_argument("--alpha", type=float, default=0.01, help="significance level (default 0.01)")
+    p.add_argument("--tolerance", type=float,
+                   help="relative drift allowed for every metric (default: per metric)")
+    p.set_defaults(fn=cmd_check)
+
+    p = sub.add_parser("history", help="per-run medians of one metric")
+    p.add_argument("metric", choices=sorted(uarch_metrics.METRICS))
+    p.add_argument("--host")
+    p.set_defaults(fn=cmd_history)
+
+    p = sub.add_parser("machines", help="list fingerprints")
+    p.set_defaults(fn=cmd_machines)
+
+    args = parser.parse_args()
+    args.fn(args)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,290 @@
+"""Export a host's measured machine model as JSON and a constexpr header.
+
+Tile sizes, prefetch distances and padding in service code should come
+from what the probes measured, not from constants copied by hand. This
+reduces a host profile (a directory of probe outputs, see
+uarch_compare.py) to a flat machine model and writes:
+
+  <out>/uarch_model_<host>.json   values, units and the file each came from
+  <out>/uarch_model_<host>.h      constexpr constants in namespace uarch
+                                  (C++), UARCH_* macros (C and C++)
+  <out>/uarch_model.h             includes the header of the host class
+                                  selected with -DUARCH_HOST_<HOST>
+
+  python3 tools/uarch_export.py sunbird artemisia --out models/
+  python3 tools/uarch_export.py sunbird --sysfs --set dtlb_entries_4k=64
+
+A kernel can then specialize on the model, e.g.
+`template <std::size_t Tile = uarch::l2_bytes / 4> void blocked(...)`.
+
+Values come from the measured metrics; --sysfs fills cache sizes and line
+size the probes did not produce (only meaningful when run on the host
+itself), and --set overrides anything. Missing values are left out of
+the header, so a kernel that needs one fails to compile instead of
+silently using a default.
+
+Measured values are checked against BOUNDS first: a plateau finder that
+stops at a TLB ramp or a noisy branch probe should not end up as
+template arguments. A value outside its bounds is dropped (listed under
+"rejected" in the JSON). With --sysfs, a measured cache size is also
+compared with the kernel's cache description and replaced by it when the
+two disagree by more than SYSFS_RATIO (CPUID leaf 4 is what the kernel
+reports there). --set values are trusted.
+"""
+import argparse
+import datetime
+import json
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import uarch_metrics  # noqa: E402
+from uarch_metrics import median  # noqa: E402
+
+# Model key -> (metrics to take it from in order of preference, integer?, description)
+MODEL = [
+    ("l1d_bytes", ["cache_l1_bytes"], True, "L1 data cache capacity"),
+    ("l2_bytes", ["cache_l2_bytes"], True, "L2 capacity"),
+    ("l3_bytes", ["cache_l3_bytes"], True, "L3 capacity"),
+    ("line_bytes", ["line_bytes"], True, "effective line (fetch) size"),
+    ("dtlb_entries_4k", ["tlb_reach_pages"], True, "first-level DTLB reach in 4 KB pages"),
+    ("l1_latency_cycles", ["lat_l1_cycles", "chase_l1_cycles"], False, "L1 load-to-use latency"),
+    ("l2_latency_cycles", ["lat_l2_cycles"], False, "L2 hit latency"),
+    ("l3_latency_cycles", ["lat_l3_cycles"], False, "L3 hit latency"),
+    ("dram_latency_cycles", ["lat_dram_cycles", "chase_dram_cycles"], False, "DRAM latency"),
+    ("page_walk_cycles", ["page_walk_cycles"], False, "page-walk cost per TLB miss"),
+    ("load_bw_bytes_per_cycle", ["bw_load_bytes_per_cycle"], False, "sequential load bandwidth beyond the LLC"),
+    ("store_bw_bytes_per_cycle", ["bw_store_bytes_per_cycle", "bw_rmw_bytes_per_cycle"], False,
+     "sequential store bandwidth beyond the LLC"),
+    ("memory_parallelism", ["mlp_peak"], False, "peak outstanding misses"),
+    ("rob_entries", ["rob_knee_entries"], True, "reorder buffer capacity"),
+    ("prf_entries", ["prf_knee_icount"], True, "register file knee (instructions in flight)"),
+    ("btb_entries", ["btb_entries"], True, "largest BTB level capacity"),
+    ("mispredict_penalty_cycles", ["mispredict_penalty_cycles"], False, "branch mispredict penalty"),
+    ("vector_ipc", ["vpxor_ipc"], False, "AVX2 vpxor throughput per cycle"),
+]
+# Plausible range per key; anything outside is a measurement artefact
+BOUNDS = {
+    "l1d_bytes": (16 << 10, 256 << 10),
+    "l2_bytes": (128 << 10, 64 << 20),
+    "l3_bytes": (1 << 20, 4 << 30),
+    "line_bytes": (32, 256),
+    "dtlb_entries_4k": (16, 4096),
+    "l1_latency_cycles": (2, 10),
+    "l2_latency_cycles": (5, 40),
+    "l3_latency_cycles": (15, 150),
+    "dram_latency_cycles": (50, 2000),
+    "page_walk_cycles": (0, 2000),
+    "load_bw_bytes_per_cycle": (0.1, 256),
+    "store_bw_bytes_per_cycle": (0.1, 256),
+    "memory_parallelism": (1, 256),
+    "rob_entries": (32, 2048),
+    "prf_entries": (16, 2048),
+    "btb_entries": (16, 1 << 16),
+    "mispredict_penalty_cycles": (5, 50),
+    "vector_ipc": (0.1, 8),
+}
+SYSFS_RATIO = 1.5   # measured vs sysfs size beyond this: trust sysfs
+
+INTEGER = {key: integer for key, _, integer, _ in MODEL}
+DESC = {key: desc for key, _, _, desc in MODEL}
+
+SYSFS_CACHE = "/sys/devices/system/cpu/cpu0/cache"
+
+# --- model ---
+def parse_size(text):
+    """'48K' -> 49152, the sysfs cache size format."""
+    text = text.strip().upper()
+    scale = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}.get(text[-1:], 1)
+    return int(text.rstrip("KMG")) * scale
+
+def sysfs_values():
+    out = {}
+    for index in sorted(os.listdir(SYSFS_CACHE)) if os.path.isdir(SYSFS_CACHE) else []:
+        base = os.path.join(SYSFS_CACHE, index)
+        try:
+            level = int(open(os.path.join(base, "level")).read())
+            kind = open(os.path.join(base, "type")).read().strip()
+            size = parse_size(open(os.path.join(base, "size")).read())
+            line = int(open(os.path.join(base, "coherency_line_size")).read())
+        except (OSError, ValueError):
+            continue
+        if kind == "Instruction":
+            continue
+        out[{1: "l1d_bytes", 2: "l2_bytes", 3: "l3_bytes"}.get(level, f"l{level}_bytes")] = size
+        out.setdefault("line_bytes", line)
+    return out
+
+def build_model(root, use_sysfs=False, overrides=None):
+    host = os.path.basename(os.path.normpath(root))
+    outputs = uarch_metrics.find_outputs(root)
+    measured = {}
+    for kind, path in sorted(outputs.items()):
+        for metric, samples in (uarch_metrics.extract(path, kind) or {}).items():
+            measured.setdefault(metric, (median(samples), path))
+
+    values, rejected = {}, {}
+    for key, metrics, integer, _ in MODEL:
+        for metric in metrics:
+            if metric in measured:
+                value, path = measured[metric]
+                entry = {"value": value, "metric": metric, "source": path}
+                lo, hi = BOUNDS.get(key, (float("-inf"), float("inf")))
+                if not lo <= value <= hi:
+                    reason = f"outside [{lo:.0f}, {hi:.0f}]" if integer else f"outside [{lo:g}, {hi:g}]"
+                    rejected.setdefault(key, dict(entry, reason=reason))
+                    print(f"{host}: rejecting {key} = {value:g} from {metric} ({reason})")
+                    continue
+                values[key] = entry
+                break
+    if use_sysfs:
+        for key, value in sysfs_values().items():
+            entry = {"value": value, "metric": None, "source": "sysfs"}
+            if key not in values:
+                values[key] = entry
+                continue
+            # the measured line is the effective fetch size (128 with the
+            # adjacent-line prefetcher), so sysfs only fills it in
+            if key == "line_bytes":
+                continue
+            have = values[key]["value"]
+            if have > 0 and max(have / value, value / have) <= SYSFS_RATIO:
+                continue
+            rejected.setdefault(key, dict(values[key], reason=f"sysfs reports {value}"))
+            print(f"{host}: {key} = {have:g} from {values[key]['metric']} disagrees "
+                  f"with sysfs {value}; using sysfs")
+            values[key] = entry
+    for key, value in (overrides or {}).items():
+        values[key] = {"value": value, "metric": None, "source": "override"}
+    for key, entry in values.items():
+        if INTEGER.get(key, True):
+            entry["value"] = int(round(entry["value"]))
+    return {
+        "host": host,
+        "generated": datetime.datetime.now().isoformat(timespec="seconds"),
+        "profile": os.path.abspath(root),
+        "values": {k: values[k] for k in sorted(values, key=lambda k: list(INTEGER).index(k)
+                                                if k in INTEGER else len(INTEGER))},
+        "rejected": {k: rejected[k] for k in sorted(rejected)},
+    }
+
+# --- header ---
+def ident(host):
+    return re.sub(r"[^A-Za-z0-9]", "_", host)
+
+def literal(key, value, cxx):
+    if INTEGER.get(key, True):
+        return f"{value}" if cxx else f"{value}ULL"
+    text = f"{float(value):.6g}"
+    return text if re.search(r"[.e]", text) else text + ".0"
+
+def header(model):
+    host = ident(model["host"])
+    guard = f"UARCH_MODEL_{host.upper()}_H"
+    values = model["values"]
+    lines = [
+        "/*",
+        f"  Machine model for host class '{model['host']}', generated by",
+        "  tools/uarch_export.py from the probe outputs in",
+        f"  {model['profile']}",
+        f"  on {model['generated']}. Do not edit; re-run the exporter.",
+        "*/",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        f"#define UARCH_MODEL_HOST \"{model['host']}\"",
+    ]
+    width = max((len(k) for k in values), default=0)
+    for key, entry in values.items():
+        lines.append(f"#define UARCH_{key.upper():<{width}} {literal(key, entry['value'], False)}"
+                     f"  // {DESC.get(key, key)}")
+    lines += [
+        "",
+        "#ifdef __cplusplus",
+        "#include <cstddef>",
+        "",
+        "namespace uarch {",
+        f"constexpr const char* host_class = \"{model['host']}\";",
+    ]
+    for key, entry in values.items():
+        kind = "std::size_t" if INTEGER.get(key, True) else "double"
+        lines.append(f"constexpr {kind} {key} = {literal(key, entry['value'], True)};")
+    lines += [
+        "}  // namespace uarch",
+        "#endif",
+        "",
+        f"#endif  // {guard}",
+        "",
+    ]
+    return "\n".join(lines)
+
+def dispatcher(hosts):
+    lines = [
+        "/*",
+        "  Selects the machine model of the host class named by",
+        "  -DUARCH_HOST_<HOST>; generated by tools/uarch_export.py.",
+        "*/",
+        "#ifndef UARCH_MODEL_H",
+        "#define UARCH_MODEL_H",
+        "",
+    ]
+    for i, host in enumerate(hosts):
+        lines.append(f"#{'if' if i == 0 else 'elif'} defined(UARCH_HOST_{ident(host).upper()})")
+        lines.append(f"#include \"uarch_model_{ident(host)}.h\"")
+    names = ", ".join(f"UARCH_HOST_{ident(h).upper()}" for h in hosts)
+    lines += [
+        "#else",
+        f"#error \"define one of {names}\"",
+        "#endif",
+        "",
+        "#endif  // UARCH_MODEL_H",
+        "",
+    ]
+    return "\n".join(lines)
+
+# --- entrypoint ---
+def parse_set(items):
+    out = {}
+    for item in items or []:
+        key, _, value = item.partition("=")
+        if key not in INTEGER:
+            sys.exit(f"unknown model key '{key}' (one of {', '.join(INTEGER)})")
+        try:
+            out[key] = float(value)
+        except ValueError:
+            sys.exit(f"--set {item}: value is not a number")
+    return out
+
+def main():
+    parser = argparse.ArgumentParser(description="export uarch machine models")
+    parser.add_argument("profiles", nargs="+", help="host directories, one model each")
+    parser.add_argument("--out", default="models", help="output directory (default: models)")
+    parser.add_argument("--sysfs", action="store_true",
+                        help="fill missing cache sizes from this machine's sysfs and "
+                             "replace measured ones that disagree with it")
+    parser.add_argument("--set", action="append", metavar="KEY=VALUE",
+                        help="override a model value")
+    args = parser.parse_args()
+    overrides = parse_set(args.set)
+
+    os.makedirs(args.out, exist_ok=True)
+    hosts = []
+    for root in args.profiles:
+        model = build_model(root, args.sysfs, overrides)
+        name = ident(model["host"])
+        hosts.append(model["host"])
+        with open(os.path.join(args.out, f"uarch_model_{name}.json"), "w") as f:
+            json.dump(model, f, indent=2)
+            f.write("\n")
+        with open(os.path.join(args.out, f"uarch_model_{name}.h"), "w") as f:
+            f.write(header(model))
+        missing = [k for k in INTEGER if k not in model["values"]]
+        print(f"{model['host']}: {len(model['values'])} values"
+              + (f", missing {', '.join(missing)}" if missing else ""))
+    with open(os.path.join(args.out, "uarch_model.h"), "w") as f:
+        f.write(dispatcher(hosts))
+    print(f"Models written to {args.out}/")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,372 @@
+"""Headline metrics extracted from probe CSVs, for the results database.
+
+Each probe writes its own CSV layout. The extractors below reduce one file
+to a few named metrics, each a list of samples (several when the probe
+repeats a measurement, one when the metric is a fitted knee or a sweep
+endpoint). uarch_db.py stores the samples and tests them against a
+baseline; METRICS says which direction is a regression and how much
+relative drift is tolerated before anyone is paged.
+
+Extractors are keyed by CSV file name, since several probes share a
+header (has_cache and the old cache_levels both write
+working_set_size_bytes,time_per_access_cycles). Probes that print their
+results to stdout are recognised from the capture instead, whatever the
+file is called: tlb by its table header, avx2_cpi by its banner.
+"""
+import csv
+import hashlib
+import os
+import re
+from collections import defaultdict
+
+# --- metric definitions ---
+class Metric:
+    def __init__(self, name, unit, better, tolerance, desc):
+        self.name = name
+        self.unit = unit
+        self.better = better          # "lower", "higher" or "none" (any shift)
+        self.tolerance = tolerance    # relative change that counts as drift
+        self.desc = desc
+
+METRICS = {m.name: m for m in [
+    Metric("lat_l1_cycles", "cycles", "lower", 0.10, "L1 hit latency (miss_lat)"),
+    Metric("lat_l2_cycles", "cycles", "lower", 0.10, "L2 hit latency (miss_lat)"),
+    Metric("lat_l3_cycles", "cycles", "lower", 0.10, "L3 hit latency (miss_lat)"),
+    Metric("lat_dram_cycles", "cycles", "lower", 0.05, "DRAM latency (miss_lat)"),
+    Metric("chase_dram_cycles", "cycles", "lower", 0.05, "pointer chase at the largest working set"),
+    Metric("chase_l1_cycles", "cycles", "lower", 0.10, "pointer chase at the smallest working set"),
+    Metric("sweep_l1_cycles", "cycles", "lower", 0.10, "has_cache sweep at the smallest working set"),
+    Metric("cache_l1_bytes", "bytes", "none", 0.0, "largest working set before the 1st chase latency step"),
+    Metric("cache_l2_bytes", "bytes", "none", 0.0, "largest working set before the 2nd chase latency step"),
+    Metric("cache_l3_bytes", "bytes", "none", 0.0, "largest working set before the 3rd chase latency step"),
+    Metric("page_walk_cycles", "cycles", "lower", 0.10, "line - page_lines chase at the largest working set"),
+    Metric("bw_load_bytes_per_cycle", "B/cycle", "higher", 0.05, "sequential load bandwidth, largest set"),
+    Metric("bw_store_bytes_per_cycle", "B/cycle", "higher", 0.05, "sequential store bandwidth, largest set"),
+    Metric("bw_rmw_bytes_per_cycle", "B/cycle", "higher", 0.05, "sequential RMW bandwidth, largest set"),
+    Metric("bw_nt_bytes_per_cycle", "B/cycle", "higher", 0.05, "non-temporal store bandwidth, largest set"),
+    Metric("mispredict_penalty_cycles", "cycles", "lower", 0.10, "branch mispredict penalty"),
+    Metric("rob_knee_entries", "entries", "none", 0.05, "filler count at the ROB knee"),
+    Metric("prf_knee_icount", "instrs", "none", 0.05, "ICOUNT at the PRF knee"),
+    Metric("vpxor_ipc", "instrs/cycle", "higher", 0.10, "AVX2 vpxor throughput (avx2_cpi)"),
+    Metric("line_bytes", "bytes", "none", 0.0, "stride where the strided-access cost stops climbing"),
+    Metric("vpxor_latency_cycles", "cycles", "lower", 0.10, "AVX2 vpxor latency"),
+    Metric("dmp_random_cycles", "cycles", "lower", 0.10, "random index chase (dmp)"),
+    Metric("prefetch_seq_cycles", "cycles", "lower", 0.10, "sequential scan with prefetchers"),
+    Metric("prefetch_random_cycles", "cycles", "lower", 0.10, "random gather (prefetch probe)"),
+    Metric("incl_evicted_cycles", "cycles", "lower", 0.10, "reload after eviction (inclusivity)"),
+    Metric("stlf_penalty_cycles", "cycles", "lower", 0.15, "4K-alias store-forwarding penalty"),
+    Metric("mlp_peak", "misses", "higher", 0.10, "peak memory-level parallelism"),
+    Metric("tlb_reach_pages", "pages", "none", 0.0, "page count at the TLB latency knee"),
+    Metric("btb_entries", "branches", "none", 0.0, "largest BTB level capacity"),
+]}
+
+# --- helpers ---
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    if n == 0:
+        return float("nan")
+    mid = n // 2
+    return values[mid] if n % 2 else 0.5 * (values[mid - 1] + values[mid])
+
+def num(row, key):
+    try:
+        return float(row[key])
+    except (KeyError, TypeError, ValueError):
+        return None
+
+def grouped(rows, key, value):
+    """{key value: [samples]} over rows with a numeric `value`."""
+    out = defaultdict(list)
+    for row in rows:
+        v = num(row, value)
+        if v is not None:
+            out[row[key]].append(v)
+    return out
+
+def knee(points):
+    """x before the largest relative step up in y, over x-sorted medians."""
+    xs = sorted(points)
+    ys = [median(points[x]) for x in xs]
+    best, at = 0.0, None
+    for i in range(len(xs) - 1):
+        if ys[i] > 0 and ys[i + 1] / ys[i] > best:
+            best, at = ys[i + 1] / ys[i], xs[i]
+    return at
+
+def steps(points, ratio=1.4, count=3):
+    """Sizes before the first `count` latency steps of a sweep.
+
+    A step is a point whose next two neighbours both sit `ratio` above the
+    median of the plateau since the previous step, so one noisy sample
+    does not start a new level.
+    """
+    xs = sorted(points)
+    ys = [median(points[x]) for x in xs]
+    found, start = [], 0
+    for i in range(len(xs) - 2):
+        plateau = median(ys[start:i + 1])
+        if plateau > 0 and ys[i + 1] > ratio * plateau and ys[i + 2] > ratio * plateau:
+            found.append(xs[i])
+            start = i + 1
+            if len(found) == count:
+                break
+    return found
+
+def line_size(points, ratio=1.5, limit=4096):
+    """Stride at the end of the steepest climb, below a page.
+
+    Below the line size, doubling the stride doubles the lines touched per
+    access; past it every access is already a new line and the cost only
+    creeps up with prefetcher and TLB effects. The climb containing the
+    largest step is followed while each doubling still costs `ratio`x, so
+    a noisy step further out is ignored. With the adjacent-line prefetcher
+    pulling pairs this can find 128, the effective fetch (and
+    false-sharing) granularity rather than the architectural line.
+    """
+    xs = [x for x in sorted(points) if x <= limit]
+    ys = [median(points[x]) for x in xs]
+    rises = [ys[i + 1] / ys[i] if ys[i] > 0 else 0.0 for i in range(len(xs) - 1)]
+    if not rises or max(rises) < ratio:
+        return None
+    i = rises.index(max(rises))
+    while i + 1 < len(rises) and rises[i + 1] >= ratio:
+        i += 1
+    return xs[i + 1]
+
+# --- extractors: rows -> {metric: [samples]} ---
+def miss_lat(rows):
+    out = {}
+    names = [("l1_hit", "lat_l1_cycles"), ("l2_hit", "lat_l2_cycles"),
+             ("l3_hit", "lat_l3_cycles"), ("ram_access", "lat_dram_cycles")]
+    if rows and "level" in rows[0]:
+        # --hires histogram: expand bucket midpoints, capped by the caller
+        hist = defaultdict(list)
+        for row in rows:
+            mid = 0.5 * (float(row["lo"]) + float(row["hi"]))
+            hist[row["level"]].extend([mid] * int(row["count"]))
+        return {metric: hist[col] for col, metric in names if hist[col]}
+    return {metric: [v for v in (num(r, col) for r in rows) if v is not None]
+            for col, metric in names}
+
+def chase_sweep(rows):
+    """cache_hierarchy_data.csv; the layout column exists since the layout sweep,
+    core cycles (TSC scaled by the measured core clock) since uarch_freq.h."""
+    if not rows:
+        return {}
+    col = "core_cycles_per_access" if "core_cycles_per_access" in rows[0] else "time_per_access_cycles"
+    curves = defaultdict(lambda: defaultdict(list))
+    for row in rows:
+        curves[row.get("layout", "elem")][int(row["working_set_size_bytes"])].append(float(row[col]))
+    main = curves["line"] if "line" in curves else next(iter(curves.values()))
+    out = {"chase_dram_cycles": main[max(main)], "chase_l1_cycles": main[min(main)]}
+    for level, size in enumerate(steps(main), 1):
+        out[f"cache_l{level}_bytes"] = [size]
+    if "line" in curves and "page_lines" in curves:
+        top = max(set(curves["line"]) & set(curves["page_lines"]))
+        out["page_walk_cycles"] = [median(curves["line"][top]) - median(curves["page_lines"][top])]
+    return out
+
+def cache_sweep(rows):
+    sizes = grouped(rows, "working_set_size_bytes", "time_per_access_cycles")
+    sizes = {int(k): v for k, v in sizes.items()}
+    return {"sweep_l1_cycles": sizes[min(sizes)]} if sizes else {}
+
+def heatmap(rows):
+    """Bandwidth at the largest working set, most threads, smallest stride."""
+    if not rows:
+        return {}
+    if "size_bytes" not in rows[0]:
+        # pre-engine format: RMW, strided, one thread, sizes in KB
+        rows = [{"page": "4k", "threads": "1", "access": "rmw", "order": "strided",
+                 "size_bytes": str(int(r["array_size_kb"]) * 1024),
+                 "stride_bytes": r["stride_bytes"],
+                 "cycles_per_access": r["avg_cycles_per_access"]} for r in rows]
+    out = {}
+    for access in ("load", "store", "rmw", "nt"):
+        sel = [r for r in rows if r["access"] == access and r["order"] in ("seq", "strided")]
+        if not sel:
+            continue
+        size = max(int(r["size_bytes"]) for r in sel)
+        sel = [r for r in sel if int(r["size_bytes"]) == size]
+        threads = max(int(r["threads"]) for r in sel)
+        sel = [r for r in sel if int(r["threads"]) == threads]
+        stride = min(int(r["stride_bytes"]) for r in sel)
+        moved = min(stride, 64) * threads
+        out[f"bw_{access}_bytes_per_cycle"] = [
+            moved / float(r["cycles_per_access"]) for r in sel
+            if int(r["stride_bytes"]) == stride and float(r["cycles_per_access"]) > 0]
+    return out
+
+def branch_results(rows):
+    cyc = {r["test_type"]: float(r["cycles_per_iteration"]) for r in rows}
+    if "predictable" in cyc and "unpredictable" in cyc:
+        # a random taken/not-taken branch mispredicts half the time
+        return {"mispredict_penalty_cycles": [2 * (cyc["unpredictable"] - cyc["predictable"])]}
+    return {}
+
+def bpred_penalty(rows):
+    return {"mispredict_penalty_cycles": [v for v in (num(r, "penalty_cycles") for r in rows) if v is not None]}
+
+def robsize(rows):
+    points = {int(k): v for k, v in grouped(rows, "filler_count", "avg_cycles").items()}
+    at = knee(points)
+    return {"rob_knee_entries": [at]} if at is not None else {}
+
+def prf(rows):
+    points = {int(k): v for k, v in grouped(rows, "ICOUNT", "CYCLES").items()}
+    at = knee(points)
+    return {"prf_knee_icount": [at]} if at is not None else {}
+
+def vpxor(rows):
+    return {"vpxor_latency_cycles": [v for v in (num(r, "latency_cycles") for r in rows) if v is not None]}
+
+def dmp(rows):
+    return {"dmp_random_cycles": grouped(rows, "pattern", "cycles_per_step").get("random", [])}
+
+def prefetch(rows):
+    by = grouped(rows, "type", "cycles_per_access")
+    return {"prefetch_seq_cycles": by.get("sequential", []),
+            "prefetch_random_cycles": by.get("random", [])}
+
+def inclusivity(rows):
+    return {"incl_evicted_cycles": [v for v in (num(r, "probe_after_evict_time") for r in rows) if v is not None]}
+
+def stlf(rows):
+    return {"stlf_penalty_cycles": [float(r["penalty"]) for r in rows if r["case"] == "4k_alias"]}
+
+def mlp(rows):
+    vals = [v for v in (num(r, "mlp") for r in rows) if v is not None]
+    return {"mlp_peak": [max(vals)]} if vals else {}
+
+def btb_geometry(rows):
+    caps = [float(r["value"]) for r in rows if r["param"] == "entries"]
+    return {"btb_entries": [max(caps)]} if caps else {}
+
+def cache_line(rows):
+    points = {int(k): v for k, v in grouped(rows, "stride_bytes", "avg_cycles_per_access").items()}
+    at = line_size(points)
+    return {"line_bytes": [at]} if at is not None else {}
+
+def tlb(rows):
+    points = {int(k): v for k, v in grouped(rows, "NumPages", "Cycles_per_Access").items()}
+    at = knee(points)
+    return {"tlb_reach_pages": [at]} if at is not None else {}
+
+EXTRACTORS = {
+    "cache_latency_data.csv": miss_lat,
+    "cache_latency_hist.csv": miss_lat,
+    "cache_hierarchy_data.csv": chase_sweep,
+    "cache_sweep_results.csv": cache_sweep,
+    "cache_heatmap.csv": heatmap,
+    "branch_prediction_results.csv": branch_results,
+    "bpred_penalty.csv": bpred_penalty,
+    "robsize.csv": robsize,
+    "prf_raw_data.csv": prf,
+    "avx2_vpxor_latency.csv": vpxor,
+    "dmp_pointer_chase.csv": dmp,
+    "prefetcher_data.csv": prefetch,
+    "inclusivity_data.csv": inclusivity,
+    "stlf_penalties.csv": stlf,
+    "mlp.csv": mlp,
+    "btb_geometry.csv": btb_geometry,
+    "tlb.csv": tlb,
+    "cache_line_raw_data.csv": cache_line,
+}
+
+# --- text captures: text -> {metric: [samples]} ---
+def avx2_cpi(text):
+    m = re.search(r"Average IPC \(Instructions Per Cycle\):\s*([0-9.]+)", text)
+    return {"vpxor_ipc": [float(m.group(1))]} if m else {}
+
+TEXT_EXTRACTORS = {
+    "avx2_cpi.txt": avx2_cpi,
+}
+
+# first line of the capture -> kind
+BANNERS = {
+    "Measuring AVX2 vpxor throughput": "avx2_cpi.txt",
+}
+
+# stdout tables, matched by header when the file name is not known
+HEADERS = {
+    ("NumPages", "TotalSize_MiB", "Cycles_per_Access"): "tlb.csv",
+    ("NumPages", "TotalSize_MiB", "Cycles_per_Access", "Warmup_Batches"): "tlb.csv",
+}
+
+def read_rows(path):
+    """CSV rows, skipping the '## ...' banners and '->' notes of stdout captures,
+    and rows a probe marked valid=0 (CFS-throttled while it was timed)."""
+    with open(path, newline="") as f:
+        lines = [l for l in f if l.strip() and not l.lstrip().startswith(("#", "->"))]
+    return [r for r in csv.DictReader(lines, skipinitialspace=True) if r.get("valid") != "0"]
+
+def kind_of(path):
+    """Extractor key for a file: its name, else its header; None if unknown."""
+    name = os.path.basename(path)
+    if name in EXTRACTORS or name in TEXT_EXTRACTORS:
+        return name
+    try:
+        with open(path) as f:
+            first = f.readline().strip()
+        for banner, kind in BANNERS.items():
+            if first.startswith(banner):
+                return kind
+        rows = read_rows(path)
+    except (OSError, UnicodeDecodeError, csv.Error):
+        return None
+    return HEADERS.get(tuple(rows[0].keys())) if rows else None
+
+def sha256(path):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            h.update(block)
+    return h.hexdigest()
+
+def find_outputs(root):
+    """{kind: path} for every recognised output under a host directory.
+
+    Identical copies (5.5/2 and 5.8/2 prf_raw_data.csv) count once; of
+    differing files of one kind the newest wins, with a note.
+    """
+    found = defaultdict(list)
+    for dirpath, _, files in os.walk(root):
+        for name in files:
+            path = os.path.join(dirpath, name)
+            if not name.endswith((".csv", ".txt")):
+                continue
+            kind = kind_of(path)
+            if kind:
+                found[kind].append(path)
+    chosen = {}
+    for kind, paths in found.items():
+        unique = {sha256(p): p for p in sorted(paths)}
+        chosen[kind] = max(unique.values(), key=os.path.getmtime)
+        if len(unique) > 1:
+            print(f"{root}: {len(unique)} different {kind}, using {chosen[kind]}")
+    return chosen
+
+MAX_SAMPLES = 5000
+
+def extract(path, kind=None):
+    """{metric: [samples]} for one CSV, or None if no extractor matches."""
+    kind = kind or kind_of(path)
+    if kind in TEXT_EXTRACTORS:
+        with open(path) as f:
+            found = TEXT_EXTRACTORS[kind](f.read())
+    elif kind in EXTRACTORS:
+        found = EXTRACTORS[kind](read_rows(path))
+    else:
+        return None
+    out = {}
+    for metric, samples in found.items():
+        samples = [float(s) for s in samples if s is not None]
+        if not samples:
+            continue
+        if len(samples) > MAX_SAMPLES:
+            # even thinning keeps the distribution and the run order
+            step = len(samples) / MAX_SAMPLES
+            samples = [samples[int(i * step)] for i in range(MAX_SAMPLES)]
+        out[metric] = samples
+    return out
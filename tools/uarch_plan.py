@@ -0,0 +1,361 @@
+"""Declarative experiment plans: parameter grids over the probes.
+
+Sweep limits live in #defines (MAX_FILLERS, MAX_STRIDE, NUM_RUNS) and
+command-line options, so every variation used to mean an edit, a rebuild
+and a hand-named output file. A plan file (TOML or JSON, same schema)
+describes the whole experiment instead:
+
+  name = "rob-fillers"
+  repetitions = 3                 # per grid point
+  order = "interleaved"           # interleaved | sequential | shuffled
+  out = "results/{host}/{plan}"   # {host}, {plan}, {date}
+  pin = 2                         # CPU (or list of CPUs) the probe starts on
+  page_size = "4k"                # 4k: THP never, thp: THP always; unset: as is
+
+  [[probe]]
+  name = "rob"
+  source = "sunbird/5.8/1/rob_size.c"     # relative to the repository root
+  defines = { MAX_FILLERS = [300, 600], NUM_RUNS = 5 }   # -DNAME=value
+  args = { filler = ["alu", "load", "store"], isolate = true }  # --name=value
+  env = { UARCH_CHAIN_CACHE = "/var/tmp/uarch-chains" }
+  timeout = 3600
+
+Every list is a grid axis and scalars are fixed; a probe gets the
+cartesian product of its axes. pin, page_size, repetitions and timeout
+may be overridden per probe. Probes that still pin themselves to a fixed
+CPU override `pin`. `budget`, `target` (plan or probe) and `weight`
+(probe) are read by uarch_budget.py, which runs the same plans against a
+wall-clock budget instead of a fixed repetition count.
+
+Each unique set of defines is built once, with the compiler and flags of
+the source's `Build:` line when it has one (gcc/g++ -O2 -pthread
+otherwise), into
+<out>/.build/. Each point and repetition runs in its own directory,
+<out>/<probe>/<point>/rep<N>/, which collects the probe's output files,
+stdout.txt, stderr.txt and point.json (parameters, command, exit status,
+machine fingerprint, git revision). Points with a successful point.json
+are skipped, so re-running a plan continues it; --rerun forces them.
+
+  python3 tools/uarch_plan.py plans/rob_fillers.toml --dry-run
+  python3 tools/uarch_plan.py plans/rob_fillers.toml --ingest
+
+--ingest stores every recognised output in the results database
+(uarch_db.py) labelled plan:<name>/<probe>/<point>. TOML plans need
+Python 3.11 (tomllib); JSON plans work anywhere.
+"""
+import argparse
+import datetime
+import hashlib
+import itertools
+import json
+import os
+import random
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import uarch_db  # noqa: E402
+import uarch_metrics  # noqa: E402
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+THP = "/sys/kernel/mm/transparent_hugepage/enabled"
+PAGE_SIZES = {"4k": "never", "thp": "always"}
+ORDERS = ("interleaved", "sequential", "shuffled")
+PROBE_KEYS = {"name", "source", "defines", "args", "env", "cflags",
+              "pin", "page_size", "repetitions", "timeout", "target", "weight"}
+PLAN_KEYS = {"name", "repetitions", "order", "seed", "out", "pin", "page_size",
+             "timeout", "root", "probe", "budget", "target"}
+
+# --- loading ---
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if path.endswith(".json"):
+        plan = json.loads(data)
+    else:
+        try:
+            import tomllib
+        except ImportError:
+            sys.exit("TOML plans need Python 3.11+ (tomllib); use a .json plan")
+        plan = tomllib.loads(data.decode())
+    validate(plan, path)
+    return plan
+
+def validate(plan, path):
+    def fail(msg):
+        sys.exit(f"{path}: {msg}")
+    if not isinstance(plan.get("probe"), list) or not plan["probe"]:
+        fail("needs at least one [[probe]]")
+    for key in set(plan) - PLAN_KEYS:
+        fail(f"unknown key '{key}'")
+    if plan.get("order", "interleaved") not in ORDERS:
+        fail(f"order must be one of {', '.join(ORDERS)}")
+    names = set()
+    for probe in plan["probe"]:
+        for key in set(probe) - PROBE_KEYS:
+            fail(f"probe {probe.get('name', '?')}: unknown key '{key}'")
+        if "name" not in probe or "source" not in probe:
+            fail("every probe needs a name and a source")
+        if probe["name"] in names:
+            fail(f"probe name '{probe['name']}' used twice")
+        names.add(probe["name"])
+        page = probe.get("page_size", plan.get("page_size"))
+        if page is not None and page not in PAGE_SIZES:
+            fail(f"probe {probe['name']}: page_size must be one of {', '.join(PAGE_SIZES)}")
+        for table in ("defines", "args", "env"):
+            if not isinstance(probe.get(table, {}), dict):
+                fail(f"probe {probe['name']}: {table} must be a table")
+
+# --- expansion ---
+def axes(table):
+    """[(name, [values])] with scalars as one-value axes, in file order."""
+    return [(k, v if isinstance(v, list) else [v]) for k, v in (table or {}).items()]
+
+def grid(probe):
+    """Every (defines, args) combination of a probe."""
+    d_axes, a_axes = axes(probe.get("defines")), axes(probe.get("args"))
+    names = [n for n, _ in d_axes] + [n for n, _ in a_axes]
+    points = []
+    for combo in itertools.product(*[v for _, v in d_axes + a_axes]):
+        values = dict(zip(names, combo))
+        points.append(({n: values[n] for n, _ in d_axes}, {n: values[n] for n, _ in a_axes}))
+    return points
+
+def varying(probe):
+    """Names of the axes with more than one value: they name the point."""
+    return [n for n, v in axes(probe.get("defines")) + axes(probe.get("args")) if len(v) > 1]
+
+def point_name(probe, defines, args):
+    values = {**defines, **args}
+    parts = [f"{n}-{values[n]}" for n in varying(probe)]
+    return re.sub(r"[^A-Za-z0-9_.=-]", "_", "_".join(parts)) or "default"
+
+def schedule(plan, probes):
+    """[(probe, defines, args, rep)] in run order."""
+    per_point = []
+    for probe in probes:
+        reps = probe.get("repetitions", plan.get("repetitions", 1))
+        per_point += [(probe, d, a, reps) for d, a in grid(probe)]
+    order = plan.get("order", "interleaved")
+    if order == "sequential":
+        return [(p, d, a, r) for p, d, a, reps in per_point for r in range(reps)]
+    # interleaved: every point once per round, so slow drift hits all points alike
+    rounds = max(reps for *_, reps in per_point)
+    jobs = [(p, d, a, r) for r in range(rounds) for p, d, a, reps in per_point if r < reps]
+    if order == "shuffled":
+        random.Random(plan.get("seed", 0)).shuffle(jobs)
+    return jobs
+
+# --- building ---
+def build_line(source):
+    """Compiler and flags from a `Build: gcc -O2 -o x x.c` header line."""
+    with open(source, errors="replace") as f:
+        head = f.read(8192)
+    m = re.search(r"Build:\s*(.+)", head)
+    if not m:
+        return None
+    words = shlex.split(m.group(1))
+    out, skip = [], False
+    for w in words[1:]:
+        if skip:
+            skip = False
+        elif w == "-o":
+            skip = True
+        elif not w.endswith((".c", ".cpp", ".cc")):
+            out.append(w)
+    return words[0], out
+
+def compile_cmd(probe, source, defines, binary):
+    found = build_line(source)
+    if found:
+        compiler, flags = found
+    else:
+        compiler = "g++" if source.endswith((".cpp", ".cc")) else "gcc"
+        flags = ["-O2", "-pthread"]
+    flags += shlex.split(probe.get("cflags", ""))
+    flags += [f"-D{n}={v}" for n, v in defines.items()]
+    return [compiler] + flags + ["-o", binary, source]
+
+def build(probe, source, defines, out, dry_run):
+    """Path of the binary for this probe/defines, building it if needed."""
+    key = hashlib.sha1(json.dumps([source, defines, probe.get("cflags", "")],
+                                  sort_keys=True).encode()).hexdigest()[:10]
+    binary = os.path.join(out, ".build", f"{probe['name']}-{key}",
+                          os.path.splitext(os.path.basename(source))[0])
+    cmd = compile_cmd(probe, source, defines, binary)
+    if dry_run:
+        return binary, cmd
+    if not os.path.exists(binary) or os.path.getmtime(binary) < os.path.getmtime(source):
+        os.makedirs(os.path.dirname(binary), exist_ok=True)
+        print("  build: " + " ".join(shlex.quote(c) for c in cmd))
+        res = subprocess.run(cmd, capture_output=True, text=True)
+        if res.returncode != 0:
+            sys.exit(f"build of {probe['name']} failed:\n{res.stderr}")
+    return binary, cmd
+
+# --- running ---
+def argv(binary, args):
+    out = [binary]
+    for name, value in args.items():
+        if value is True:
+            out.append(f"--{name}")
+        elif value is not False:
+            out.append(f"--{name}={value}")
+    return out
+
+def thp_mode():
+    return uarch_db.bracketed(uarch_db.read_file(THP))
+
+def write_thp(mode):
+    try:
+        with open(THP, "w") as f:
+            f.write(mode)
+        return True
+    except OSError:
+        return False
+
+def set_page_size(page, force):
+    """Switch THP for this probe if asked and permitted; returns the mode in effect."""
+    if page is None:
+        return thp_mode()
+    want = PAGE_SIZES[page]
+    if thp_mode() != want:
+        if not write_thp(want):
+            msg = f"page_size {page} needs THP '{want}', it is '{thp_mode()}' (run as root)"
+            if not force:
+                sys.exit(msg + "; --force runs anyway")
+            print("warning: " + msg)
+    return thp_mode()
+
+def pin_set(pin):
+    if pin is None:
+        return None
+    return set(pin) if isinstance(pin, list) else {int(pin)}
+
+def done(point_dir):
+    try:
+        with open(os.path.join(point_dir, "point.json")) as f:
+            return json.load(f).get("returncode") == 0
+    except (OSError, ValueError):
+        return False
+
+def run_point(plan, probe, defines, args, rep, ctx):
+    """Run (or skip) one repetition of a point; returns its directory."""
+    name = point_name(probe, defines, args)
+    point_dir = os.path.join(ctx["out"], probe["name"], name, f"rep{rep}")
+    source = os.path.join(ctx["root"], probe["source"])
+    binary, build_cmd = build(probe, source, defines, ctx["out"], ctx["dry_run"])
+    cmd = argv(binary, args)
+    label = f"{probe['name']}/{name}/rep{rep}"
+    if ctx["dry_run"]:
+        print(f"{label}: {' '.join(shlex.quote(c) for c in cmd)}")
+        return point_dir
+    if done(point_dir) and not ctx["rerun"]:
+        print(f"{label}: done, skipping")
+        return point_dir
+
+    os.makedirs(point_dir, exist_ok=True)
+    before = set(os.listdir(point_dir))
+    page = set_page_size(probe.get("page_size", plan.get("page_size")), ctx["force"])
+    cpus = pin_set(probe.get("pin", plan.get("pin")))
+    env = dict(os.environ, **{k: str(v) for k, v in probe.get("env", {}).items()})
+    timeout = probe.get("timeout", plan.get("timeout"))
+    print(f"{label}: running")
+    started = time.time()
+    with open(os.path.join(point_dir, "stdout.txt"), "w") as out, \
+            open(os.path.join(point_dir, "stderr.txt"), "w") as err:
+        try:
+            res = subprocess.run(cmd, cwd=point_dir, stdout=out, stderr=err, env=env,
+                                 timeout=timeout,
+                                 preexec_fn=(lambda: os.sched_setaffinity(0, cpus)) if cpus else None)
+            rc = res.returncode
+        except subprocess.TimeoutExpired:
+            rc = "timeout"
+    outputs = sorted(set(os.listdir(point_dir)) - before - {"stdout.txt", "stderr.txt"})
+    record = {
+        "plan": plan.get("name"),
+        "probe": probe["name"],
+        "source": probe["source"],
+        "point": name,
+        "rep": rep,
+        "defines": defines,
+        "args": args,
+        "command": cmd,
+        "build": build_cmd,
+        "pin": sorted(cpus) if cpus else None,
+        "thp": page,
+        "returncode": rc,
+        "started": datetime.datetime.fromtimestamp(started).isoformat(timespec="seconds"),
+        "seconds": round(time.time() - started, 3),
+        "outputs": outputs,
+        "fingerprint": ctx["fingerprint_id"],
+        "git_rev": uarch_db.git_rev(source),
+    }
+    with open(os.path.join(point_dir, "point.json"), "w") as f:
+        json.dump(record, f, indent=2)
+        f.write("\n")
+    print(f"{label}: exit {rc} after {record['seconds']:.1f} s, {len(outputs)} output file(s)")
+
+    if ctx["db"] and rc == 0:
+        files = [os.path.join(point_dir, o) for o in outputs]
+        files.append(os.path.join(point_dir, "stdout.txt"))
+        files = [p for p in files if uarch_metrics.kind_of(p)]
+        uarch_db.ingest(ctx["db"], files, ctx["fingerprint"], label=f"plan:{plan.get('name')}/{label}")
+    return point_dir
+
+def context(plan, probes, out=None, dry_run=False, rerun=False, force=False, ingest=False):
+    """Settings shared by every run of a plan; exits if a probe source is missing."""
+    fp = uarch_db.fingerprint()
+    out = out or plan.get("out", "results/{host}/{plan}").format(
+        host=fp["host"], plan=plan.get("name", "plan"), date=datetime.date.today().isoformat())
+    ctx = {
+        "out": os.path.abspath(out),
+        "root": os.path.abspath(plan.get("root", REPO)),
+        "dry_run": dry_run,
+        "rerun": rerun,
+        "force": force,
+        "fingerprint": fp,
+        "fingerprint_id": uarch_db.fingerprint_id(fp),
+        "db": uarch_db.connect() if ingest and not dry_run else None,
+    }
+    for probe in probes:
+        if not os.path.exists(os.path.join(ctx["root"], probe["source"])):
+            sys.exit(f"probe {probe['name']}: no source {probe['source']} under {ctx['root']}")
+    return ctx
+
+# --- entrypoint ---
+def main():
+    parser = argparse.ArgumentParser(description="run a uarch experiment plan")
+    parser.add_argument("plan", help="plan file (.toml or .json)")
+    parser.add_argument("--dry-run", action="store_true", help="print the schedule only")
+    parser.add_argument("--only", action="append", metavar="PROBE", help="run only these probes")
+    parser.add_argument("--out", help="override the plan's output directory")
+    parser.add_argument("--rerun", action="store_true", help="re-run points that already succeeded")
+    parser.add_argument("--force", action="store_true", help="run even if page_size cannot be applied")
+    parser.add_argument("--ingest", action="store_true", help="store outputs in the results database")
+    args = parser.parse_args()
+
+    plan = load(args.plan)
+    probes = [p for p in plan["probe"] if not args.only or p["name"] in args.only]
+    ctx = context(plan, probes, args.out, args.dry_run, args.rerun, args.force, args.ingest)
+
+    jobs = schedule(plan, probes)
+    print(f"plan {plan.get('name', args.plan)}: {len(jobs)} runs -> {ctx['out']}")
+    if not args.dry_run:
+        os.makedirs(ctx["out"], exist_ok=True)
+        with open(os.path.join(ctx["out"], "plan.json"), "w") as f:
+            json.dump({"plan": plan, "fingerprint": ctx["fingerprint"], "runs": len(jobs)}, f, indent=2)
+            f.write("\n")
+    restore = thp_mode()
+    try:
+        for probe, defines, a, rep in jobs:
+            run_point(plan, probe, defines, a, rep, ctx)
+    finally:
+        if thp_mode() != restore:
+            write_thp(restore)
+
+if __name__ == "__main__":
+    main()